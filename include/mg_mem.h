@@ -0,0 +1,47 @@
+#ifndef MG_MEM_H
+#define MG_MEM_H
+
+#include "mg_type.h"
+
+s32 func_8004DE44(s32 arena);
+s32 func_8004DE60(s32 arena);
+s32 *func_8004DE7C(s32 arena, s32 size);
+
+#ifdef ARENA_BINS
+/* The arena first, as in the routines above; src/28590.c says why */
+void func_8004E058(s32 arena, void *ptr);
+void arena_coalesce(s32 arena);
+void arena_set_deferred_free(s32 arena, bool enable);
+#endif
+
+#ifdef ENHANCEMENTS
+/* What func_8004E1E0 takes for the frame heap, both halves together, off
+ * the top of the main heap without the expansion pak and off the top of the
+ * expansion pak with it.
+ */
+#ifndef FRAME_HEAP_SIZE
+#define FRAME_HEAP_SIZE           0x8000
+#endif
+#ifndef FRAME_HEAP_SIZE_EXPANSION
+#define FRAME_HEAP_SIZE_EXPANSION 0x40000
+#endif
+
+typedef struct MGFrameHeapStats
+{
+    /* 0x0 */  u32 size;          /* per half */
+    /* 0x4 */  u32 used;          /* in the current half */
+    /* 0x8 */  u32 high_water;
+    /* 0xC */  u32 frames;
+    /* 0x10 */ u32 overflows;
+    /* 0x14 */ u32 overflow_size; /* largest request that didn't fit */
+} MGFrameHeapStats;
+
+void frame_heap_init(void *base, u32 size);
+void *frame_alloc(u32 size);
+u32 frame_mark(void);
+void frame_release(u32 mark);
+void frame_heap_get_stats(MGFrameHeapStats *stats);
+void frame_heap_print_stats(void);
+#endif
+
+#endif
@@ -151,6 +151,10 @@ typedef struct {
     s32		startAddr;		/* Address in data ROM */
     s32		frameCnt;		/* Buffer frame counter */
     char*	ptr;			/* Value of the pointer to buffer */
+#ifdef NU_AU_DMA_CACHE
+    u32		useFrame;	/* nuAuFrameCounter when last used */
+    u8		prefetched;	/* Read ahead of a voice and not used yet */
+#endif	/* NU_AU_DMA_CACHE */
 } NUDMABuffer;
 /*--------------------------------------*/
 /* DMA callback for the Sequence Player	*/
@@ -161,7 +165,18 @@ typedef struct {
     u8		initialized;  /* Flag indicating whether the structure has been initialized */
     NUDMABuffer* firstUsed;   /* Start of the DMA Buffer linked list being used */
     NUDMABuffer* firstFree;   /* Start of the free DMA Buffer linked list */
+#ifdef NU_AU_DMA_CACHE
+    NUDMABuffer** index;      /* Buffers being used, in ascending order of startAddr */
+    s32		indexCnt;
+    ALLink	lru;          /* Buffers being used, least recently used first */
+#endif	/* NU_AU_DMA_CACHE */
 } NUDMAState;
+#ifdef NU_AU_DMA_CACHE
+/* Per voice state for the DMA callback */
+typedef struct {
+    s32		nextAddr;     /* Where the voice's next sequential read starts */
+} NUDMAStream;
+#endif	/* NU_AU_DMA_CACHE */
 
 /* Sequence Display structure*/
 typedef struct st_Seqence{
@@ -221,6 +236,13 @@ extern s16		nuAuDmaBufNum;
 extern s16		nuAuDmaBufSize;
 extern NUDMAState	nuAuDmaState;
 extern NUDMABuffer*	nuAuDmaBuf;
+#ifdef NU_AU_DMA_CACHE
+extern u32		nuAuDmaHitCount;	/* DMA callbacks served from a buffer */
+extern u32		nuAuDmaMissCount;	/* DMA callbacks that started a PI-DMA */
+extern u32		nuAuDmaNoBufCount;	/* DMA callbacks with no buffer to use */
+extern u32		nuAuDmaPrefetchCount;	/* PI-DMAs started ahead of a voice */
+extern u32		nuAuDmaPrefetchHitCount;/* Prefetched buffers later used */
+#endif	/* NU_AU_DMA_CACHE */
 extern Acmd*		nuAuCmdListBuf; 	/* pointer of command list */
 extern u32		nuAuAcmdLen;
 extern u8		nuAuRetraceCount;
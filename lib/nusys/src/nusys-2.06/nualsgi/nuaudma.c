@@ -23,7 +23,16 @@ s16		nuAuDmaBufSize = NU_AU_DMA_BUFFER_SIZE;
 
 static s32	nuAuDmaNext;
 
+#ifdef NU_AU_DMA_CACHE
+u32		nuAuDmaHitCount = 0;
+u32		nuAuDmaMissCount = 0;
+u32		nuAuDmaNoBufCount = 0;
+u32		nuAuDmaPrefetchCount = 0;
+u32		nuAuDmaPrefetchHitCount = 0;
+#endif	/* NU_AU_DMA_CACHE */
 
+
+#ifndef NU_AU_DMA_CACHE
 /*----------------------------------------------------------------------*/
 /*	DMA CallBack 							*/
 /*									*/
@@ -182,6 +191,224 @@ s32 nuAuDmaCallBack(s32 addr, s32 len, void *state)
 #endif /* USE_EPI */
     return (s32) osVirtualToPhysical(freeBuffer) + delta;
 }
+#else	/* NU_AU_DMA_CACHE */
+
+/*----------------------------------------------------------------------*/
+/*	Buffer index							*/
+/*									*/
+/*   The buffers being used are kept in nuAuDmaState.index in ascending	*/
+/*   order of startAddr, and in nuAuDmaState.lru in order of use.	*/
+/*   All buffers are nuAuDmaBufSize, so only the one starting nearest	*/
+/*   below an address can hold it; a binary search finds that one.	*/
+/*----------------------------------------------------------------------*/
+/* Number of buffers in the index starting at or below addr */
+static s32 nuAuDmaIndexFind(s32 addr)
+{
+    s32		low = 0;
+    s32		high = nuAuDmaState.indexCnt;
+    s32		mid;
+
+    while(low < high){
+	mid = (low + high) >> 1;
+	if(nuAuDmaState.index[mid]->startAddr <= addr){
+	    low = mid + 1;
+	} else {
+	    high = mid;
+	}
+    }
+    return low;
+}
+
+/* The buffer holding addr to addr+len, or NULL */
+static NUDMABuffer* nuAuDmaIndexLookup(s32 addr, s32 len)
+{
+    s32		pos;
+    NUDMABuffer* dmaPtr;
+
+    pos = nuAuDmaIndexFind(addr);
+    if(pos == 0){
+	return NULL;
+    }
+    dmaPtr = nuAuDmaState.index[pos - 1];
+    if(addr + len > dmaPtr->startAddr + nuAuDmaBufSize){
+	return NULL;
+    }
+    return dmaPtr;
+}
+
+static void nuAuDmaIndexInsert(NUDMABuffer* dmaPtr)
+{
+    s32		pos;
+    s32		i;
+
+    pos = nuAuDmaIndexFind(dmaPtr->startAddr);
+    for(i = nuAuDmaState.indexCnt; i > pos; i--){
+	nuAuDmaState.index[i] = nuAuDmaState.index[i - 1];
+    }
+    nuAuDmaState.index[pos] = dmaPtr;
+    nuAuDmaState.indexCnt++;
+}
+
+static void nuAuDmaIndexRemove(NUDMABuffer* dmaPtr)
+{
+    s32		pos;
+
+    /* Buffers with the same startAddr may sit either side of it */
+    pos = nuAuDmaIndexFind(dmaPtr->startAddr);
+    while(nuAuDmaState.index[--pos] != dmaPtr)
+	;
+    nuAuDmaState.indexCnt--;
+    for(; pos < nuAuDmaState.indexCnt; pos++){
+	nuAuDmaState.index[pos] = nuAuDmaState.index[pos + 1];
+    }
+}
+
+/*----------------------------------------------------------------------*/
+/*	Get a buffer to DMA into					*/
+/*									*/
+/*   A free buffer if there is one, otherwise the least recently used,	*/
+/*   as long as it has been unused for more than keep frames. No audio	*/
+/*   task can still be reading a buffer unused for more than		*/
+/*   NU_AU_BUFFER_USE_FRAME, the frameCnt of the list version.		*/
+/* IN	keep	Frames a buffer must have been unused for		*/
+/* RTN	The buffer, now the most recently used, or NULL			*/
+/*----------------------------------------------------------------------*/
+static NUDMABuffer* nuAuDmaBufferGet(u32 keep)
+{
+    NUDMABuffer* dmaPtr;
+
+    dmaPtr = nuAuDmaState.firstFree;
+    if(dmaPtr){
+	nuAuDmaState.firstFree = (NUDMABuffer*)dmaPtr->node.next;
+    } else {
+	dmaPtr = (NUDMABuffer*)nuAuDmaState.lru.next;
+	if((ALLink*)dmaPtr == &nuAuDmaState.lru
+	   || nuAuFrameCounter - dmaPtr->useFrame <= keep){
+	    return NULL;
+	}
+	nuAuDmaIndexRemove(dmaPtr);
+    }
+    alUnlink((ALLink*)dmaPtr);
+    alLink((ALLink*)dmaPtr, nuAuDmaState.lru.prev);
+    dmaPtr->useFrame = nuAuFrameCounter;
+    dmaPtr->prefetched = 0;
+    return dmaPtr;
+}
+
+/*----------------------------------------------------------------------*/
+/*	Start reading ROM into a buffer					*/
+/* IN	dmaPtr	Buffer from nuAuDmaBufferGet				*/
+/* 	addr	ROM address, 2-byte aligned				*/
+/*----------------------------------------------------------------------*/
+static void nuAuDmaBufferRead(NUDMABuffer* dmaPtr, s32 addr)
+{
+#ifdef USE_EPI
+    OSIoMesg*	dmaIoMesgBufPtr;
+#endif /* USE_EPI */
+
+    dmaPtr->startAddr = addr;
+    nuAuDmaIndexInsert(dmaPtr);
+
+#ifdef	NU_DEBUG
+    nuAuDebDmaFrame++;
+    if(nuAuDebFlag & NU_AU_DEBUG_DISABLEDMA){
+	return;
+    }
+#endif	/* NU_DEBUG	*/
+
+    /* At most one DMA per buffer per frame, so nuAuDmaIOMesgBuf is enough */
+#ifdef USE_EPI
+    dmaIoMesgBufPtr = &nuAuDmaIOMesgBuf[nuAuDmaNext++];
+    dmaIoMesgBufPtr->hdr.pri      = OS_MESG_PRI_NORMAL;
+    dmaIoMesgBufPtr->hdr.retQueue = &nuAuDmaMesgQ;
+    dmaIoMesgBufPtr->dramAddr     = dmaPtr->ptr;
+    dmaIoMesgBufPtr->devAddr      = (u32)addr;
+    dmaIoMesgBufPtr->size         = nuAuDmaBufSize;
+    osEPiStartDma(nuPiCartHandle, dmaIoMesgBufPtr, OS_READ);
+#else
+    osPiStartDma(&nuAuDmaIOMesgBuf[nuAuDmaNext++], OS_MESG_PRI_NORMAL, OS_READ,
+		 (u32)addr, dmaPtr->ptr, nuAuDmaBufSize, &nuAuDmaMesgQ);
+#endif /* USE_EPI */
+}
+
+/*----------------------------------------------------------------------*/
+/*	DMA CallBack 							*/
+/*									*/
+/*   DMA callback routine for the synthesizer driver			*/
+/*   Finds the buffer holding the data through the index, or reads it	*/
+/*   into a free or least recently used buffer by DMA transfer.	*/
+/*   When a voice reads sequentially, as ADPCM data is played, and its	*/
+/*   next read would not be found, the DMA for it is started now so	*/
+/*   the data is there when the voice gets to it.			*/
+/* IN	addr	ROM address with data				*/
+/* 	len	Data size						*/
+/* 	state	The voice's NUDMAStream, from nuAuDmaNew		*/
+/*----------------------------------------------------------------------*/
+s32 nuAuDmaCallBack(s32 addr, s32 len, void *state)
+{
+    NUDMAStream* stream = (NUDMAStream*)state;
+    NUDMABuffer* dmaPtr;
+    NUDMABuffer* nextPtr;
+    s32		sequential = 0;
+    s32		next;
+
+#ifdef	NU_DEBUG
+    nuAuDebDmaCallbackFrame++;
+    if(len > nuAuDmaBufSize){
+	nuAuDebStatus |= NU_AU_DEBUG_DMABUFSIZE;
+	if(nuAuDebFlag & NU_AU_DEBUG_NORMAL){
+	    osSyncPrintf("nuAuDmaCallBack: DMA Buffer size is too small.\n");
+	}
+    }
+#endif	/* NU_DEBUG */
+
+    next = addr + len;
+    if(stream){
+	sequential = (stream->nextAddr == addr);
+	stream->nextAddr = next;
+    }
+
+    dmaPtr = nuAuDmaIndexLookup(addr, len);
+    if(dmaPtr){
+	nuAuDmaHitCount++;
+	if(dmaPtr->prefetched){
+	    dmaPtr->prefetched = 0;
+	    nuAuDmaPrefetchHitCount++;
+	}
+	dmaPtr->useFrame = nuAuFrameCounter;
+	alUnlink((ALLink*)dmaPtr);
+	alLink((ALLink*)dmaPtr, nuAuDmaState.lru.prev);
+    } else {
+	dmaPtr = nuAuDmaBufferGet(NU_AU_BUFFER_USE_FRAME);
+
+	/* As before, a buffer being used is better than stopping. */
+	if(dmaPtr == NULL){
+	    nuAuDmaNoBufCount++;
+#ifdef NU_DEBUG
+	    if(nuAuDebFlag & NU_AU_DEBUG_NORMAL){
+		osSyncPrintf("auDmaCallBack: no dma buffer!!\n");
+	    }
+	    nuAuDebStatus |= NU_AU_DEBUG_NODMABUF;
+#endif /* NU_DEBUG */
+	    return(int)OS_K0_TO_PHYSICAL(((NUDMABuffer*)nuAuDmaState.lru.prev)->ptr);
+	}
+	nuAuDmaMissCount++;
+	nuAuDmaBufferRead(dmaPtr, addr & ~1);
+    }
+
+    /* Leave buffers that only just became reusable for reads that can't wait. */
+    if(sequential && !nuAuDmaIndexLookup(next, len)){
+	nextPtr = nuAuDmaBufferGet(NU_AU_BUFFER_USE_FRAME * 2 + 1);
+	if(nextPtr){
+	    nuAuDmaPrefetchCount++;
+	    nuAuDmaBufferRead(nextPtr, next & ~1);
+	    nextPtr->prefetched = 1;
+	}
+    }
+
+    return (s32) osVirtualToPhysical(dmaPtr->ptr + addr - dmaPtr->startAddr);
+}
+#endif	/* NU_AU_DMA_CACHE */
 
 
 /*----------------------------------------------------------------------*/ 
@@ -197,6 +424,9 @@ s32 nuAuDmaCallBack(s32 addr, s32 len, void *state)
 ALDMAproc nuAuDmaNew(NUDMAState **state)
 {
     s32 i;
+#ifdef NU_AU_DMA_CACHE
+    NUDMAStream* stream;
+#endif	/* NU_AU_DMA_CACHE */
     
     /* Check whether initialized. If not, initialize. */
     if(!nuAuDmaState.initialized) {
@@ -221,11 +451,26 @@ ALDMAproc nuAuDmaNew(NUDMAState **state)
 	    nuAuDmaBuf[i].ptr = nuAuHeapAlloc(nuAuDmaBufSize);
 	}
 	nuAuDmaBuf[i].ptr = nuAuHeapAlloc(nuAuDmaBufSize);
+#ifdef NU_AU_DMA_CACHE
+	nuAuDmaState.index = nuAuHeapAlloc(nuAuDmaBufNum * sizeof(NUDMABuffer*));
+	nuAuDmaState.indexCnt = 0;
+	nuAuDmaState.lru.next = &nuAuDmaState.lru;
+	nuAuDmaState.lru.prev = &nuAuDmaState.lru;
+#endif	/* NU_AU_DMA_CACHE */
 	/* The initialized flag settings */
 	nuAuDmaState.initialized++;
     }
     nuAuDmaNext = 0;
+#ifdef NU_AU_DMA_CACHE
+    /* Each voice gets its own state, to tell when it reads sequentially. */
+    stream = nuAuHeapAlloc(sizeof(NUDMAStream));
+    if(stream){
+	stream->nextAddr = -1;
+    }
+    *state = (NUDMAState*)stream;
+#else
     *state = &nuAuDmaState;  /* Assign the nuDmaState structure pointer to state. */
+#endif	/* NU_AU_DMA_CACHE */
     
     return nuAuDmaCallBack;
 }
@@ -243,10 +488,15 @@ ALDMAproc nuAuDmaNew(NUDMAState **state)
 void nuAuCleanDMABuffers(void)
 {
     
+#ifndef NU_AU_DMA_CACHE
     NUDMABuffer *dmaPtr,*nextPtr;
+#endif	/* NU_AU_DMA_CACHE */
 
 #ifdef	NU_DEBUG
     u32	DmaUseCnt = 0;
+#ifdef NU_AU_DMA_CACHE
+    ALLink* link;
+#endif	/* NU_AU_DMA_CACHE */
 #endif	/* NU_DEBUG	*/
     
 #ifdef NU_DEBUG
@@ -263,6 +513,20 @@ void nuAuCleanDMABuffers(void)
     nuAuDmaNext = 0;    
 #endif	/* NU_DEBUG */
     
+#ifdef NU_AU_DMA_CACHE
+    /*------------------------------------------------------*/
+    /*  Buffers stay where they are until nuAuDmaCallBack	*/
+    /*  reuses them, so there is nothing to free.		*/
+    /*------------------------------------------------------*/
+#ifdef	NU_DEBUG
+    for(link = nuAuDmaState.lru.prev; link != &nuAuDmaState.lru; link = link->prev){
+	if(nuAuFrameCounter - ((NUDMABuffer*)link)->useFrame > NU_AU_BUFFER_USE_FRAME){
+	    break;
+	}
+	DmaUseCnt++;
+    }
+#endif	/* NU_DEBUG	*/
+#else
     dmaPtr =nuAuDmaState.firstUsed;
     
     while(dmaPtr) {
@@ -296,6 +560,7 @@ void nuAuCleanDMABuffers(void)
 	
 	dmaPtr = nextPtr;
     }
+#endif	/* NU_AU_DMA_CACHE */
 
     
 #ifdef	NU_DEBUG
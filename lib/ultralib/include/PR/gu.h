@@ -76,6 +76,36 @@ extern int guLoadTextureBlockMipMap(Gfx **glist, unsigned char *tbuf, Image *im,
 		unsigned char shifts, unsigned char shiftt, unsigned char cfs, 
 		unsigned char cft);
 
+#ifdef GU_MIPMAP_BAKED
+/*
+ * With GU_MIPMAP_BAKED, a mipmap tools/mipbake has built ahead of time, as
+ * guLoadTextureBlockMipMap would build it in tbuf, can be loaded with
+ * guLoadTextureBlockMipMapBaked: it stuffs the same display list, loading
+ * from the texels after the header, and filters nothing. The asset must
+ * be 8-byte aligned in RDRAM, as tbuf must.
+ */
+#define GU_MIPMAP_MAGIC		0x4D495042	/* "MIPB" */
+
+typedef struct {
+	unsigned int	magic;
+	unsigned char	fmt, siz;
+	unsigned char	level;		/* the last tile set up */
+	unsigned char	err;		/* what guLoadTextureBlockMipMap returned */
+	unsigned int	length;		/* texels loaded, as it counts them */
+	struct {
+		unsigned short	w;	/* line width in texels */
+		unsigned short	s, t;
+		unsigned short	addr;	/* in TMEM, in bytes */
+	} tile[8];
+	unsigned int	size;		/* bytes of texels after the header */
+} GuMipMapBaked;
+
+extern int guLoadTextureBlockMipMapBaked(Gfx **glist, GuMipMapBaked *mm,
+		unsigned char startTile, unsigned char pal, unsigned char cms, 
+		unsigned char cmt, unsigned char masks, unsigned char maskt, 
+		unsigned char shifts, unsigned char shiftt);
+#endif
+
 extern int 	guGetDPLoadTextureTileSz (int ult, int lrt);
 extern void 	guDPLoadTextureTile (Gfx *glistp, void *timg,
 			int texl_fmt, int texl_size,
@@ -128,6 +128,9 @@ typedef struct {
     u8          *cur;
     s32         len;
     s32         count;
+#ifdef AL_HEAP_MARK
+    u8          *high;          /* furthest cur has got since alHeapInit */
+#endif
 } ALHeap;
 
 #define AL_HEAP_DEBUG   1
@@ -138,6 +141,33 @@ void    alHeapInit(ALHeap *hp, u8 *base, s32 len);
 void    *alHeapDBAlloc(u8 *file, s32 line, ALHeap *hp, s32 num, s32 size);
 s32     alHeapCheck(ALHeap *hp);
 
+#ifdef AL_HEAP_MARK
+/*
+ * A checkpoint in a heap: alHeapRelease gives back everything allocated
+ * since the alHeapMark that set it, which has to have been released
+ * before any mark set ahead of it is.
+ */
+typedef struct {
+    u8          *cur;
+    s32         count;
+} ALHeapMark;
+
+typedef struct {
+    s32         used;           /* bytes allocated now                  */
+    s32         high;           /* the most there have been at once     */
+    s32         free;           /* bytes left                           */
+    s32         blocks;         /* allocations now; _DEBUG only         */
+    s32         requested;      /* bytes they asked for; _DEBUG only    */
+    s32         largest;        /* the largest of them; _DEBUG only     */
+    u8          *largestFile;   /* where that was allocated             */
+    s32         largestLine;
+} ALHeapReport;
+
+void    alHeapMark(ALHeap *hp, ALHeapMark *mark);
+void    alHeapRelease(ALHeap *hp, ALHeapMark *mark);
+s32     alHeapReport(ALHeap *hp, ALHeapReport *report);
+#endif
+
 #ifdef _DEBUG
 #define alHeapAlloc(hp, elem ,size) alHeapDBAlloc((u8 *) __FILE__,__LINE__,(hp),(elem),(size))
 #else
@@ -349,6 +379,20 @@ typedef struct {
     s32                 outputRate;     /* output sample rate */
     s32                 maxOutSamples;  /* Maximum samples rsp can generate
                                            at one time at output rate */
+#ifdef AL_SYN_STEAL_HEAP
+    struct PVoice_s     **stealHeap;    /* allocated voices that can be stolen */
+    s32                 stealCount;
+    u32                 stealOrder;     /* allocation order, for ties */
+    u32                 voiceAllocs;
+    u32                 voiceSteals;
+    u32                 voiceFails;
+#endif
+#ifdef AL_PROFILE
+    struct ALProfile_s  *profile;       /* see alSynSetProfile, 0 for none */
+#endif
+#ifdef AL_ADPCM_SHARE
+    struct ALLoadShare_s *loadShare;    /* what the last decoder pulled */
+#endif
 } ALSynth;
 
 void    alSynNew(ALSynth *s, ALSynConfig *config);
@@ -373,6 +417,108 @@ void    alSynSetFXMix(ALSynth *s, ALVoice *voice, u8 fxmix);
 void    alSynSetPriority(ALSynth *s, ALVoice *voice, s16 priority);
 s16     alSynGetPriority(ALSynth *s, ALVoice *voice);
 
+#ifdef AL_SYN_STEAL_HEAP
+/*
+ * With AL_SYN_STEAL_HEAP the voices a steal may take are kept in a min-heap
+ * on (priority, allocation order), so the one the pAllocList scan would
+ * pick is found without the scan.
+ */
+#define AL_SYN_PRIORITY_LEVELS  128
+
+typedef struct {
+    u32         allocs;         /* physical voices handed out, stolen ones included */
+    u32         steals;
+    u32         fails;          /* allocations that found nothing to steal */
+    u16         occupancy[AL_SYN_PRIORITY_LEVELS]; /* allocated voices by priority,
+                                                       clamped to the range */
+} ALSynVoiceStats;
+
+void    alSynGetVoiceStats(ALSynth *s, ALSynVoiceStats *stats);
+#endif
+
+#ifdef AL_ADPCM_SHARE
+/*
+ * With AL_ADPCM_SHARE a voice whose ADPCM decoder would decode exactly what
+ * the voice pulled just before it decoded in the same slice (the same
+ * wavetable, from the same place and the same state, as layered or
+ * doubled notes do) takes that output, still in DMEM, and a copy of its
+ * state rather than decoding it again. Voices that have drifted apart
+ * decode on their own, but bytes another voice has already fetched in the
+ * slice are read from that fetch rather than asked of the DMA callback
+ * again, which relies on the callback's buffers lasting the frame, as the
+ * command list already does.
+ */
+typedef struct {
+    u32         pulls;          /* alAdpcmPull calls with samples to make */
+    u32         shared;         /* of those, taken from the voice before */
+    u32         fetches;        /* calls to the DMA callback */
+    u32         fetchBytes;
+    u32         reused;         /* fetches served from an earlier one */
+    u32         savedBytes;     /* bytes not fetched for either reason */
+} ALSynLoadStats;
+
+void    alSynGetLoadStats(ALSynth *s, ALSynLoadStats *stats);
+#endif
+
+#ifdef AL_PROFILE
+/*
+ * With AL_PROFILE alAudioFrame times itself, in osGetCount counts, split
+ * into where it went: each time is exclusive of the others, so
+ * AL_PROF_FRAME, their sum, is the whole of alAudioFrame. AL_PROF_LOAD is
+ * alAdpcmPull and alRaw16Pull, AL_PROF_PARAM the parameter updates
+ * alEnvmixerPull applies, AL_PROF_FX alFxPull less the buses it pulls, and
+ * AL_PROF_SYNTH the rest: the main and aux buses, the output and the voice
+ * bookkeeping. AL_PROF_CMDS and AL_PROF_DMAS count the frame's Acmds and
+ * the calls made to the DMA callback.
+ */
+#define AL_PROF_CLIENT          0
+#define AL_PROF_PARAM           1
+#define AL_PROF_LOAD            2
+#define AL_PROF_RESAMPLE        3
+#define AL_PROF_ENVMIX          4
+#define AL_PROF_FX              5
+#define AL_PROF_SYNTH           6
+#define AL_PROF_FRAME           7
+#define AL_PROF_CMDS            8
+#define AL_PROF_DMAS            9
+#define AL_PROF_COUNT           10
+
+#ifndef AL_PROFILE_FRAMES
+#define AL_PROFILE_FRAMES       60      /* frames the statistics cover */
+#endif
+#define AL_PROFILE_DEPTH        8       /* pulls nested in one another */
+
+typedef struct {
+    u32         value[AL_PROF_COUNT];
+} ALProfileFrame;
+
+typedef struct {
+    u32         min;
+    u32         avg;
+    u32         max;
+} ALProfileStat;
+
+typedef struct ALProfile_s {
+    ALProfileFrame      frame;          /* the one alAudioFrame is in   */
+    ALProfileFrame      history[AL_PROFILE_FRAMES];
+    ALProfileFrame      overrun;        /* the last over budget         */
+    u32                 frames;         /* since alProfileInit          */
+    u32                 overruns;
+    u32                 budget;         /* counts for AL_PROF_FRAME, 0
+                                           for no limit                 */
+    s32                 depth;
+    struct {
+        u32     start;
+        u32     children;               /* counts taken by nested ones  */
+    } stack[AL_PROFILE_DEPTH];
+} ALProfile;
+
+void    alProfileInit(ALProfile *p, u32 budget);
+void    alSynSetProfile(ALSynth *s, ALProfile *p);
+void    alProfileGetStats(ALProfile *p, ALProfileStat *stats);
+void    alProfileDump(ALProfile *p);
+#endif
+
 ALFxRef *alSynAllocFX(ALSynth *s, s16 bus, ALSynConfig *c, ALHeap *hp);
 ALFxRef alSynGetFXRef(ALSynth *s, s16 bus, s16 index);
 void    alSynFreeFX(ALSynth *s, ALFxRef *fx);
@@ -615,6 +761,9 @@ typedef struct {
     ALLink      freeList;
     ALLink      allocList;
     s32         eventCount;
+#ifdef AL_EVTQ_WHEEL
+    struct ALEvtqWheel_s *wheel;        /* see alEvtqNewWheel, 0 for none */
+#endif
 } ALEventQueue;
 
 void            alEvtqNew(ALEventQueue *evtq, ALEventListItem *items,
@@ -625,6 +774,40 @@ void            alEvtqPostEvent(ALEventQueue *evtq, ALEvent *evt,
 void        	alEvtqFlush(ALEventQueue *evtq);
 void        	alEvtqFlushType(ALEventQueue *evtq, s16 type);
 
+#ifdef AL_EVTQ_WHEEL
+/*
+ * With AL_EVTQ_WHEEL a queue can be given a two-level timing wheel that
+ * indexes its list by absolute time, so a post starts its walk from the
+ * last event in the slot at or before its own rather than from the head.
+ * The list is still the queue and the order events come out in is the
+ * list's. Level 0 has a slot per 2^AL_EVTQ_WHEEL_SHIFT microseconds of
+ * the span the queue's time is in (a span being AL_EVTQ_WHEEL_SLOTS of
+ * those, about 262ms), level 1 a slot per span for the spans after it, to
+ * about 16.5s; events further out are walked to from the last one on the
+ * wheel. The players give their queues one from their heap. Code that unlinks an event from allocList itself calls
+ * __alEvtqUnlink on it first, while it is still linked, or, before taking
+ * out many, __alEvtqChanged, which has the wheel rebuilt at the next post.
+ */
+#define AL_EVTQ_WHEEL_SLOTS     64
+#define AL_EVTQ_WHEEL_SHIFT     12
+
+typedef struct {
+    ALEventListItem     *last;          /* the slot's last event on the list */
+    u32                 time;           /* and its absolute time */
+} ALEvtqSlot;
+
+typedef struct ALEvtqWheel_s {
+    u32                 now;            /* time of the last event handed out */
+    s32                 stale;          /* the slots need rebuilding */
+    u32                 used[2][AL_EVTQ_WHEEL_SLOTS / 32]; /* slots in use, per level */
+    ALEvtqSlot          slot[2][AL_EVTQ_WHEEL_SLOTS];
+} ALEvtqWheel;
+
+void            alEvtqNewWheel(ALEventQueue *evtq, ALEvtqWheel *wheel);
+void            __alEvtqUnlink(ALEventQueue *evtq, ALEventListItem *item);
+void            __alEvtqChanged(ALEventQueue *evtq);
+#endif
+
 
 #define AL_PHASE_ATTACK         0
 #define AL_PHASE_NOTEON         0
@@ -661,6 +844,9 @@ typedef struct {
     u8                  fxmix;          /* current fx mix for this chan     */
     u8                  sustain;        /* current sustain pedal state      */
     f32                 pitchBend;      /* current pitch bend val in cents  */
+#ifdef AL_SEQP_SOUND_INDEX
+    u8                  *soundTable;    /* instrument's key/velocity index  */
+#endif
 } ALChanState;
 
 typedef struct ALSeq_s {
@@ -693,6 +879,10 @@ typedef struct ALCSeq_s {
     u8            curBULen[16];      /* if > 0, then in backup mode           */
     u8            lastStatus[16];    /* for running status                    */
     u32           evtDeltaTicks[16]; /* delta time to next event              */
+#ifdef AL_CSEQ_TRACK_CACHE
+    u8            *trackCache[16];   /* tracks decoded by alCSeqNewCached     */
+    u32           cached;            /* set if curLoc points into trackCache  */
+#endif
 } ALCSeq;
 
 typedef struct {
@@ -719,6 +909,10 @@ typedef struct {
     void        *initOsc;
     void        *updateOsc;
     void        *stopOsc;
+#ifdef AL_SEQP_SOUND_INDEX
+    s32         soundIndexSize;    /* heap bytes for the key/velocity
+                                      index, 0 for none (see seqplayer.c) */
+#endif
 } ALSeqpConfig;
 
 typedef ALMicroTime   (*ALOscInit)(void **oscState,f32 *initVal, u8 oscType,
@@ -749,6 +943,9 @@ typedef struct {
     ALOscInit           initOsc;
     ALOscUpdate         updateOsc;
     ALOscStop           stopOsc;
+#ifdef AL_SEQP_SOUND_INDEX
+    struct ALSoundIndex_s *soundIndex;  /* same place in ALCSPlayer     */
+#endif
     ALSeqMarker         *loopStart;
     ALSeqMarker         *loopEnd;
     s32                 loopCount;      /* -1 = loop forever, 0 = no loop   */
@@ -777,6 +974,9 @@ typedef struct {
     ALOscInit           initOsc;
     ALOscUpdate         updateOsc;
     ALOscStop           stopOsc;
+#ifdef AL_SEQP_SOUND_INDEX
+    struct ALSoundIndex_s *soundIndex;
+#endif
 } ALCSPlayer;
 
 /*
@@ -794,6 +994,9 @@ void    alSeqGetLoc(ALSeq *seq, ALSeqMarker *marker);
  * Compact Sequence data representation routines
  */
 void    alCSeqNew(ALCSeq *seq, u8 *ptr);
+#ifdef AL_CSEQ_TRACK_CACHE
+s32     alCSeqNewCached(ALCSeq *seq, u8 *ptr, ALHeap *hp);
+#endif
 void    alCSeqNextEvent(ALCSeq *seq,ALEvent *evt);
 s32     alCSeqGetTicks(ALCSeq *seq);
 f32     alCSeqTicksToSec(ALCSeq *seq, s32 ticks, u32 tempo);
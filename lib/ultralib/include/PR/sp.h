@@ -165,6 +165,11 @@ typedef struct sprite Sprite;
 #define	spDraw			spX2Draw
 #define	spInit			spX2Init
 #define	spFinish		spX2Finish
+#ifdef SP_BATCH
+#define	spBatchDraw		spX2BatchDraw
+#define	spBatchFlush		spX2BatchFlush
+#define	spBatchGetStats		spX2BatchGetStats
+#endif
 #elif	defined(F3DEX_GBI)
 #define	spMove			spXMove
 #define	spSetZ			spXSetZ
@@ -172,6 +177,11 @@ typedef struct sprite Sprite;
 #define	spDraw			spXDraw
 #define	spInit			spXInit
 #define	spFinish		spXFinish
+#ifdef SP_BATCH
+#define	spBatchDraw		spXBatchDraw
+#define	spBatchFlush		spXBatchFlush
+#define	spBatchGetStats		spXBatchGetStats
+#endif
 #endif
 
 /*
@@ -189,6 +199,42 @@ void spInit( Gfx **glistp );
 void spScissor( s32 xmin, s32 xmax, s32 ymin, s32 ymax );
 void spFinish( Gfx **glistp );
 
+#ifdef SP_BATCH
+/*
+ * With SP_BATCH sprites can be queued with spBatchDraw and drawn together
+ * by spBatchFlush, between spInit and spFinish, into the caller's list
+ * rather than each sprite's own. The queue is drawn a layer at a time,
+ * lowest first, and within a layer sprites sharing a texture format and
+ * bitmap (an atlas) are drawn one after another, so a texture or TLUT
+ * that TMEM already holds isn't loaded again, primitive color, combiner,
+ * depth, TLUT mode and cycle type are only set when they change, and the
+ * pipe sync after each rectangle is only sent when something that needs
+ * it follows. Order within a layer is not kept. The caller's list needs
+ * room for what spDraw would have put in each sprite's, and a few more;
+ * what doesn't fit before glistend is dropped.
+ */
+#ifndef SP_BATCH_MAX
+#define SP_BATCH_MAX		64	/* sprites a flush can hold */
+#endif
+
+typedef struct {
+	u32	sprites;	/* drawn by spBatchFlush */
+	u32	rects;
+	u32	loads;		/* textures loaded */
+	u32	loadsSkipped;	/* rectangles drawn from what TMEM held */
+	u32	tluts;		/* TLUTs loaded */
+	u32	tlutsSkipped;
+	u32	states;		/* state commands sent */
+	u32	statesSkipped;	/* left out as already set */
+	u32	syncsSkipped;	/* pipe syncs left out between rectangles */
+	u32	dropped;	/* sprites the queue or list had no room for */
+} SpBatchStats;
+
+void spBatchDraw( Sprite *sp, s32 layer );
+void spBatchFlush( Gfx **glistp, Gfx *glistend );
+void spBatchGetStats( SpBatchStats *stats );	/* counts since spInit */
+#endif
+
 #ifdef _LANGUAGE_C_PLUS_PLUS
 }
 #endif
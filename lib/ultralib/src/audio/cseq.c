@@ -27,6 +27,9 @@
 static u32 __readVarLen(ALCSeq *s,u32 track);
 static u8  __getTrackByte(ALCSeq *s,u32 track);
 static u32 __alCSeqGetTrackEvent(ALCSeq *seq, u32 track, ALEvent *event); 
+#ifdef AL_CSEQ_TRACK_CACHE
+static void __alCSeqRewind(ALCSeq *seq, ALCSeq *from);
+#endif
 
 void alCSeqNew(ALCSeq *seq, u8 *ptr)
 {
@@ -38,9 +41,15 @@ void alCSeqNew(ALCSeq *seq, u8 *ptr)
     seq->lastDeltaTicks = 0;
     seq->lastTicks = 0;
     seq->deltaFlag = 1;
+#ifdef AL_CSEQ_TRACK_CACHE
+    seq->cached = 0;
+#endif
 
     for(i = 0; i < 16; i++)
     {
+#ifdef AL_CSEQ_TRACK_CACHE
+        seq->trackCache[i] = 0;
+#endif
         seq->lastStatus[i] = 0;
         seq->curBUPtr[i] = 0;
         seq->curBULen[i] = 0;
@@ -268,6 +277,11 @@ void alCSeqNewMarker(ALCSeq *seq, ALCSeqMarker *m, u32 ticks)
     s32         i;
     
 
+#ifdef AL_CSEQ_TRACK_CACHE
+    if (seq->cached)
+        __alCSeqRewind(&tempSeq, seq);  /* shares the decoded tracks */
+    else
+#endif
     alCSeqNew(&tempSeq, (u8*)seq->base);
     
     do {
@@ -334,6 +348,10 @@ static u8 __getTrackByte(ALCSeq *seq,u32 track)
 {
     u8      theByte;
 
+#ifdef AL_CSEQ_TRACK_CACHE
+    if (seq->cached)
+        return *seq->curLoc[track]++;
+#endif
     
     if(seq->curBULen[track])  
     {
@@ -398,12 +416,256 @@ static u32 __readVarLen(ALCSeq *seq,u32 track)
     return (value);
 }
 
+#ifdef AL_CSEQ_TRACK_CACHE
+/*
+ * Decoded track cache. alCSeqNewCached expands each track's backup sections
+ * once, into its own heap buffer, so that __getTrackByte becomes a plain
+ * read and curBULen stays 0. The decoded track is the same event stream with
+ * the block codes resolved: literal 0xFE bytes stand alone, and each loop
+ * end keeps its six byte record (loop count, current count, offset), with
+ * the offset rewritten to reach back within the decoded track. So neither
+ * __alCSeqGetTrackEvent nor the markers need to know which they are reading;
+ * a marker simply points into the decoded track.
+ *
+ * As with the compressed data, the loop counts live in the track, and
+ * players and markers built on the same ALCSeq share them.
+ */
+#define AL_CSEQ_CACHE_LOOPS     16      /* loop ends per track */
+#define AL_CSEQ_CACHE_MAX       0x40000 /* decoded bytes per track */
+#define AL_CSEQ_CACHE_NONE      0xFFFFFFFF
+
+typedef struct {
+    ALCSeq      cur;                    /* compressed cursor, in one track */
+    u32         track;
+    u8          *out;                   /* 0 while measuring */
+    u32         len;
+    s32         loops;                  /* loop ends passed so far */
+    s32         targets;                /* loop ends known from the last pass */
+    u8          *target[AL_CSEQ_CACHE_LOOPS];   /* where each loop end jumps to */
+    u32         targetAt[AL_CSEQ_CACHE_LOOPS];  /* ... and that in the decoded track */
+    u32         loopAt[AL_CSEQ_CACHE_LOOPS];    /* the loop end record in the decoded track */
+} ALCSeqDecoder;
+
+static u8 __cacheByte(ALCSeqDecoder *d)
+{
+    u8  theByte = __getTrackByte(&d->cur, d->track);
 
+    if (d->out)
+        d->out[d->len] = theByte;
+    d->len++;
+    return theByte;
+}
 
+static void __cacheVarLen(ALCSeqDecoder *d)
+{
+    while (__cacheByte(d) & 0x80)
+        ;
+}
 
+/*
+ * Walks one track from its start to its end of track event, copying the
+ * bytes __alCSeqGetTrackEvent and __readVarLen would read. Returns FALSE for
+ * anything the decoded form can't reproduce: a loop end read inside a
+ * backup section, one jumping somewhere no event starts with running status
+ * cleared, or more loop ends or data than allowed for.
+ */
+static s32 __cacheTrack(ALCSeqDecoder *d, u8 *ptr)
+{
+    ALCSeq      *seq = &d->cur;
+    u32         track = d->track;
+    u8          status, type, lastStatus = 0;
+    u8          *tmpPtr;
+    u32         offset;
+    s32         i;
 
+    seq->curLoc[track] = ptr;
+    seq->curBUPtr[track] = 0;
+    seq->curBULen[track] = 0;
+    seq->cached = 0;
+    d->len = 0;
+    d->loops = 0;
+
+    for (;;)
+    {
+        if (d->len > AL_CSEQ_CACHE_MAX)
+            return FALSE;
+
+        /* a delta time: note it if an earlier pass found a loop jumping here */
+        if (seq->curBULen[track] == 0 && lastStatus == 0)
+        {
+            for (i = 0; i < d->targets; i++)
+                if (d->target[i] == seq->curLoc[track] && d->targetAt[i] == AL_CSEQ_CACHE_NONE)
+                    d->targetAt[i] = d->len;
+        }
 
+        __cacheVarLen(d);
+        status = __cacheByte(d);
 
+        if (status == AL_MIDI_Meta)
+        {
+            type = __cacheByte(d);
 
+            if (type == AL_MIDI_META_TEMPO)
+            {
+                __cacheByte(d);
+                __cacheByte(d);
+                __cacheByte(d);
+                lastStatus = 0;
+            }
+            else if (type == AL_MIDI_META_EOT)
+                return TRUE;
+            else if (type == AL_CMIDI_LOOPSTART_CODE)
+            {
+                __cacheByte(d);
+                __cacheByte(d);
+                lastStatus = 0;
+            }
+            else if (type == AL_CMIDI_LOOPEND_CODE)
+            {
+                /* read in place, like __alCSeqGetTrackEvent does */
+                if (seq->curBULen[track] || d->loops == AL_CSEQ_CACHE_LOOPS)
+                    return FALSE;
+
+                tmpPtr = seq->curLoc[track];
+                offset = (tmpPtr[2] << 24) + (tmpPtr[3] << 16) + (tmpPtr[4] << 8) + tmpPtr[5];
+                d->target[d->loops] = tmpPtr + 6 - offset;
+                d->loopAt[d->loops] = d->len;
+                d->loops++;
+
+                /* the offset is filled in once the target is known */
+                for (i = 0; i < 6; i++)
+                {
+                    if (d->out)
+                        d->out[d->len] = (i < 2 ? tmpPtr[i] : 0);
+                    d->len++;
+                }
+                seq->curLoc[track] = tmpPtr + 6;
+                lastStatus = 0;
+            }
+        }
+        else
+        {
+            if (status & 0x80)
+            {
+                __cacheByte(d);
+                lastStatus = status;
+            }
+            else
+                status = lastStatus;
 
+            if (((status & 0xf0) != AL_MIDI_ProgramChange) &&
+                ((status & 0xf0) != AL_MIDI_ChannelPressure))
+            {
+                __cacheByte(d);
+                if ((status & 0xf0) == AL_MIDI_NoteOn)
+                    __cacheVarLen(d);
+            }
+        }
+    }
+}
 
+/*
+ * Three passes over the track: one to find the loop ends, one to find
+ * where they land in the decoded track and how long it is, and one to
+ * write it.
+ */
+static u8 *__cacheNewTrack(ALCSeqDecoder *d, u8 *ptr, ALHeap *hp)
+{
+    u8          *buf, *tmpPtr;
+    u32         offset;
+    s32         i;
+
+    d->out = 0;
+    d->targets = 0;
+    if (!__cacheTrack(d, ptr))
+        return 0;
+
+    d->targets = d->loops;
+    for (i = 0; i < d->targets; i++)
+        d->targetAt[i] = AL_CSEQ_CACHE_NONE;
+    __cacheTrack(d, ptr);
+    for (i = 0; i < d->targets; i++)
+        if (d->targetAt[i] == AL_CSEQ_CACHE_NONE || d->targetAt[i] > d->loopAt[i])
+            return 0;
+
+    buf = alHeapAlloc(hp, 1, d->len);
+    if (!buf)
+        return 0;
+
+    d->out = buf;
+    for (i = 0; i < d->targets; i++)
+        d->targetAt[i] = AL_CSEQ_CACHE_NONE;
+    __cacheTrack(d, ptr);
+
+    for (i = 0; i < d->loops; i++)
+    {
+        tmpPtr = buf + d->loopAt[i] + 2;
+        offset = d->loopAt[i] + 6 - d->targetAt[i];
+        *tmpPtr++ = offset >> 24;
+        *tmpPtr++ = offset >> 16;
+        *tmpPtr++ = offset >> 8;
+        *tmpPtr++ = offset;
+    }
+    return buf;
+}
+
+/* alCSeqNew, but over the tracks seq already has decoded */
+static void __alCSeqRewind(ALCSeq *seq, ALCSeq *from)
+{
+    u32         i;
+
+    seq->base = from->base;
+    seq->validTracks = 0;
+    seq->lastDeltaTicks = 0;
+    seq->lastTicks = 0;
+    seq->deltaFlag = 1;
+    seq->cached = 1;
+
+    for (i = 0; i < 16; i++)
+    {
+        seq->lastStatus[i] = 0;
+        seq->curBUPtr[i] = 0;
+        seq->curBULen[i] = 0;
+        seq->trackCache[i] = from->trackCache[i];
+        seq->curLoc[i] = seq->trackCache[i];
+        if (seq->curLoc[i])
+        {
+            seq->validTracks |= 1 << i;
+            seq->evtDeltaTicks[i] = __readVarLen(seq, i);
+        }
+    }
+
+    seq->qnpt = from->qnpt;
+}
+
+/*
+ * Like alCSeqNew, then decodes every track into hp. Returns TRUE if seq
+ * now plays from the decoded tracks; if any track can't be decoded, or hp
+ * runs out, seq is left as alCSeqNew made it (whatever was allocated stays
+ * allocated) and FALSE is returned.
+ */
+s32 alCSeqNewCached(ALCSeq *seq, u8 *ptr, ALHeap *hp)
+{
+    ALCSeqDecoder       d;
+    u32                 i;
+
+    alCSeqNew(seq, ptr);
+
+    for (i = 0; i < 16; i++)
+    {
+        if ((seq->validTracks >> i) & 1)
+        {
+            d.track = i;
+            seq->trackCache[i] = __cacheNewTrack(&d, ptr + seq->base->trackOffset[i], hp);
+            if (!seq->trackCache[i])
+            {
+                alCSeqNew(seq, ptr);
+                return FALSE;
+            }
+        }
+    }
+
+    __alCSeqRewind(seq, seq);
+    return TRUE;
+}
+#endif /* AL_CSEQ_TRACK_CACHE */
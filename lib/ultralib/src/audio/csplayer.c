@@ -81,6 +81,9 @@ void alCSPNew(ALCSPlayer *seqp, ALSeqpConfig *c)
     seqp->initOsc       = c->initOsc;
     seqp->updateOsc     = c->updateOsc;
     seqp->stopOsc       = c->stopOsc;
+#ifdef AL_SEQP_SOUND_INDEX
+    seqp->soundIndex    = __soundIndexNew(hp, c->soundIndexSize);
+#endif
 
     seqp->nextEvent.type = AL_SEQP_API_EVT;	/* this will start the voice handler "spinning" */
 
@@ -110,6 +113,9 @@ void alCSPNew(ALCSPlayer *seqp, ALSeqpConfig *c)
     // init the event queue
     items = alHeapAlloc(hp, c->maxEvents, sizeof(ALEventListItem));
     alEvtqNew(&seqp->evtq, items, c->maxEvents);
+#ifdef AL_EVTQ_WHEEL
+    alEvtqNewWheel(&seqp->evtq, alHeapAlloc(hp, 1, sizeof(ALEvtqWheel)));
+#endif
 
     /*
      * add ourselves to the driver
@@ -309,6 +315,10 @@ static ALMicroTime __CSPVoiceHandler(void *node)
 	    assert(seqp->state == AL_STOPPED);	/* Must be fully stopped to change banks. */
 
 	    seqp->bank = seqp->nextEvent.msg.spbank.bank;
+#ifdef AL_SEQP_SOUND_INDEX
+	    if (seqp->soundIndex)	/* the bank may have been reloaded in place */
+		seqp->soundIndex->bank = 0;
+#endif
 	    __initFromBank((ALSeqPlayer *)seqp, seqp->bank);
 	    break;
 
@@ -798,6 +808,9 @@ static void __CSPHandleMetaMsg(ALCSPlayer *seqp, ALEvent *event)
 		nextNode = (ALEventListItem*)thisNode->node.next;
 		if(thisNode->evt.type == AL_CSP_NOTEOFF_EVT)
 		{
+#ifdef AL_EVTQ_WHEEL
+		    __alEvtqChanged(&seqp->evtq);
+#endif
 		    alUnlink((ALLink*)thisNode);
 
 		    if(firstTemp)
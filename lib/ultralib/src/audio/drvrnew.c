@@ -247,6 +247,11 @@ void alLoadNew(ALLoadFilter *f, ALDMANew dmaNew, ALHeap *hp)
     f->lastsam = 0;
     f->first = 1;
     f->memin = 0;
+#ifdef AL_ADPCM_SHARE
+    f->twin = 0;
+    f->twinGen = 0;
+    f->gen = 0;
+#endif
 }
 
 void alResampleNew(ALResampler *r, ALHeap *hp)
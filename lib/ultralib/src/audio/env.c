@@ -64,7 +64,11 @@ extern	f64	__pow(f64, f64);
  */
 static  Acmd *_pullSubFrame(void *filter, s16 *inp, s16 *outp, s32 outCount,
                             s32 sampleOffset, Acmd *p) ;
+#ifdef AL_ENV_RATE_TABLE
+static  s16 _getRate(s32 vol, s32 tgt, s32 count, u16* ratel);
+#else
 static  s16 _getRate(f64 vol, f64 tgt, s32 count, u16* ratel);
+#endif
 
 static  f32 _getVol(f32 ivol, s32 samples, s16 ratem, u16 ratel);
 
@@ -87,6 +91,9 @@ Acmd *alEnvmixerPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
 #ifdef AUD_PROFILE
     lastCnt[++cnt_index] = osGetCount();
 #endif
+#ifdef AL_PROFILE
+    __alProfileBegin();
+#endif
 
     /*
      * Force the input to be the resampler output
@@ -105,6 +112,9 @@ Acmd *alEnvmixerPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
         assert(samples >= 0);
         assert(samples <= AL_MAX_RSP_SAMPLES);
 
+#ifdef AL_PROFILE
+        __alProfileBegin();
+#endif
 
         switch (e->ctrlList->type) {
           case (AL_FILTER_START_VOICE_ALT):
@@ -290,6 +300,9 @@ Acmd *alEnvmixerPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
             e->ctrlTail = 0;
         
         __freeParam(thisParam);
+#ifdef AL_PROFILE
+        __alProfileEnd(AL_PROF_PARAM);
+#endif
         
     }
     
@@ -303,6 +316,9 @@ Acmd *alEnvmixerPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
 
 #ifdef AUD_PROFILE
     PROFILE_AUD(env_num, env_cnt, env_max, env_min);
+#endif
+#ifdef AL_PROFILE
+    __alProfileEnd(AL_PROF_ENVMIX);
 #endif
     return ptr;
 }
@@ -386,12 +402,20 @@ static Acmd* _pullSubFrame(void *filter, s16 *inp, s16 *outp, s32 outCount,
          * Calculate derived parameters
          */
         e->ltgt = (e->volume * eqpower[e->pan]) >> 15;
+#ifdef AL_ENV_RATE_TABLE
+        e->lratm = _getRate(e->cvolL, e->ltgt, e->segEnd, &(e->lratl));
+#else
         e->lratm = _getRate((f64)e->cvolL, (f64)e->ltgt,
                             e->segEnd, &(e->lratl));
+#endif
         e->rtgt = (e->volume *
                    eqpower[EQPOWER_LENGTH - e->pan - 1]) >> 15;
+#ifdef AL_ENV_RATE_TABLE
+        e->rratm = _getRate(e->cvolR, e->rtgt, e->segEnd, &(e->rratl));
+#else
         e->rratm = _getRate((f64)e->cvolR, (f64)e->rtgt, e->segEnd,
                             &(e->rratl));
+#endif
 
         aSetVolume(ptr++, A_LEFT | A_VOL, e->cvolL, 0, 0);
         aSetVolume(ptr++, A_RIGHT | A_VOL, e->cvolR, 0, 0);
@@ -456,6 +480,7 @@ _ldexpf(f64 in, s32 ex)
 		    RWW 28jun95
 */
 
+#ifndef AL_ENV_RATE_TABLE
 static
 s16 _getRate(f64 vol, f64 tgt, s32 count, u16* ratel)
 {
@@ -548,6 +573,151 @@ s16 _getRate(f64 vol, f64 tgt, s32 count, u16* ratel)
 
 }
 
+#else /* AL_ENV_RATE_TABLE */
+
+/*
+ * The same rate in fixed point, without the f64 pow.
+ *
+ * Volumes are whole numbers, so the exponent and the three mantissa bits
+ * of tgt/vol that the float version gets from _frexpf() come from shifting
+ * and dividing integers, and its log table gives log2(tgt/vol) in 8.24.
+ * The rate is (tgt/vol)^(1/count) raised to the 8th, which is 2 to the
+ * power 8*log2(tgt/vol)/count. The integer part of that is a shift and
+ * the fraction is looked up in exp2tab, 2^(i/256) in 4.28, interpolating
+ * between entries. Against the float version ratem:ratel is off by at
+ * most one in ratel (tools/seqrender/envbench sweeps it). Where the float
+ * version overflows ratem it saturates instead, as for a count of 0.
+ */
+static s32 logtab24[] = {
+    -15309830, -12617674, -10195229, -7993303,
+    -5975105,  -4112297,  -2382683,  -768464
+};
+
+static u32 exp2tab[257] = {
+    0x10000000, 0x100b1afa, 0x10163daa, 0x10216814, 0x102c9a3e, 0x1037d42e,
+    0x104315e8, 0x104e5f73, 0x1059b0d3, 0x10650a0e, 0x10706b2a, 0x107bd42b,
+    0x10874518, 0x1092bdf6, 0x109e3ecb, 0x10a9c79b, 0x10b5586d, 0x10c0f146,
+    0x10cc922b, 0x10d83b23, 0x10e3ec33, 0x10efa560, 0x10fb66b0, 0x11073029,
+    0x111301d0, 0x111edbab, 0x112abdc0, 0x1136a815, 0x11429aaf, 0x114e9593,
+    0x115a98c9, 0x1166a454, 0x1172b83c, 0x117ed487, 0x118af939, 0x11972658,
+    0x11a35beb, 0x11af99f8, 0x11bbe084, 0x11c82f95, 0x11d48731, 0x11e0e75f,
+    0x11ed5023, 0x11f9c184, 0x12063b88, 0x1212be35, 0x121f4991, 0x122bdda2,
+    0x12387a6e, 0x12451ffc, 0x1251ce50, 0x125e8571, 0x126b4566, 0x12780e34,
+    0x1284dfe2, 0x1291ba76, 0x129e9df5, 0x12ab8a67, 0x12b87fd1, 0x12c57e39,
+    0x12d285a7, 0x12df961f, 0x12ecafa9, 0x12f9d24b, 0x1306fe0a, 0x131432ee,
+    0x132170fc, 0x132eb83c, 0x133c08b2, 0x13496267, 0x1356c560, 0x136431a3,
+    0x1371a737, 0x137f2623, 0x138cae6d, 0x139a401b, 0x13a7db35, 0x13b57fc0,
+    0x13c32dc3, 0x13d0e545, 0x13dea64c, 0x13ec70df, 0x13fa4505, 0x140822c3,
+    0x14160a22, 0x1423fb27, 0x1431f5d9, 0x143ffa40, 0x144e0860, 0x145c2043,
+    0x146a41ed, 0x14786d67, 0x1486a2b6, 0x1494e1e2, 0x14a32af1, 0x14b17dea,
+    0x14bfdad5, 0x14ce41b8, 0x14dcb29a, 0x14eb2d82, 0x14f9b277, 0x1508417f,
+    0x1516daa3, 0x15257de8, 0x15342b57, 0x1542e2f5, 0x1551a4ca, 0x156070de,
+    0x156f4737, 0x157e27dc, 0x158d12d5, 0x159c0828, 0x15ab07dd, 0x15ba11fc,
+    0x15c9268a, 0x15d84591, 0x15e76f16, 0x15f6a321, 0x1605e1b9, 0x16152ae7,
+    0x16247eb0, 0x1633dd1d, 0x16434635, 0x1652b9ff, 0x16623882, 0x1671c1c7,
+    0x168155d4, 0x1690f4b2, 0x16a09e66, 0x16b052fa, 0x16c01275, 0x16cfdcde,
+    0x16dfb23c, 0x16ef9298, 0x16ff7df9, 0x170f7467, 0x171f75e9, 0x172f8287,
+    0x173f9a49, 0x174fbd36, 0x175feb56, 0x177024b2, 0x17806950, 0x1790b939,
+    0x17a11474, 0x17b17b09, 0x17c1ed01, 0x17d26a63, 0x17e2f337, 0x17f38785,
+    0x18042754, 0x1814d2ae, 0x18258999, 0x18364c1f, 0x18471a46, 0x1857f418,
+    0x1868d99b, 0x1879cad9, 0x188ac7da, 0x189bd0a4, 0x18ace542, 0x18be05bb,
+    0x18cf3217, 0x18e06a5e, 0x18f1ae99, 0x1902fed0, 0x19145b0c, 0x1925c354,
+    0x193737b1, 0x1948b82b, 0x195a44cc, 0x196bdd9a, 0x197d82a0, 0x198f33e4,
+    0x19a0f171, 0x19b2bb4d, 0x19c49183, 0x19d67419, 0x19e8631a, 0x19fa5e8d,
+    0x1a0c667b, 0x1a1e7aee, 0x1a309bec, 0x1a42c980, 0x1a5503b2, 0x1a674a8b,
+    0x1a799e13, 0x1a8bfe54, 0x1a9e6b55, 0x1ab0e521, 0x1ac36bc0, 0x1ad5ff3a,
+    0x1ae89f99, 0x1afb4ce6, 0x1b0e072a, 0x1b20ce6d, 0x1b33a2b8, 0x1b468416,
+    0x1b59728e, 0x1b6c6e2a, 0x1b7f76f3, 0x1b928cf2, 0x1ba5b031, 0x1bb8e0b8,
+    0x1bcc1e90, 0x1bdf69c4, 0x1bf2c25c, 0x1c062861, 0x1c199bde, 0x1c2d1cda,
+    0x1c40ab60, 0x1c544779, 0x1c67f12e, 0x1c7ba88a, 0x1c8f6d94, 0x1ca34057,
+    0x1cb720dd, 0x1ccb0f2e, 0x1cdf0b55, 0x1cf3155b, 0x1d072d4a, 0x1d1b532b,
+    0x1d2f8708, 0x1d43c8eb, 0x1d5818dd, 0x1d6c76e8, 0x1d80e317, 0x1d955d72,
+    0x1da9e604, 0x1dbe7cd6, 0x1dd321f3, 0x1de7d564, 0x1dfc9733, 0x1e11676b,
+    0x1e264615, 0x1e3b333b, 0x1e502ee8, 0x1e653924, 0x1e7a51fc, 0x1e8f7978,
+    0x1ea4afa3, 0x1eb9f486, 0x1ecf482e, 0x1ee4aaa2, 0x1efa1bee, 0x1f0f9c1d,
+    0x1f252b37, 0x1f3ac949, 0x1f50765b, 0x1f66327a, 0x1f7bfdae, 0x1f91d802,
+    0x1fa7c182, 0x1fbdba37, 0x1fd3c22c, 0x1fe9d96b, 0x20000000
+};
+
+static
+s16 _getRate(s32 vol, s32 tgt, s32 count, u16* ratel)
+{
+    s16         s;
+    s32         num, den, ex, indx, lg, k;
+    u32         f, a;
+
+#ifdef AUD_PROFILE
+    lastCnt[++cnt_index] = osGetCount();
+#endif
+    
+    if (count == 0){
+        if (tgt >= vol){
+            *ratel = 0xffff;
+            return 0x7fff;
+        }
+        else{
+            *ratel = 0;
+            return 0;
+        }
+    }
+
+    if (tgt < 1)
+        tgt = 1;
+    if (vol <= 0) vol = 1;	/* zero and neg values not allowed */
+
+    /*
+     * tgt/vol = num/den * 2^ex, with 1/2 <= num/den < 1
+     */
+    num = tgt;
+    den = vol;
+    ex = 0;
+    while (num >= den) {
+        den <<= 1;
+        ex++;
+    }
+    while ((num << 1) < den) {
+        num <<= 1;
+        ex--;
+    }
+    indx = (num << 4) / den;	/* 8 <= indx < 16 */
+
+    /*
+     * log2 of the rate^8, then 2 to that
+     */
+    lg = ((ex * (1 << 24) + logtab24[indx - 8]) * 8) / count;
+    k = lg >> 24;
+    f = lg & 0xffffff;
+    a = exp2tab[f >> 16];
+    a += ((exp2tab[(f >> 16) + 1] - a) * ((f >> 5) & 0x7ff)) >> 11;
+
+    /*
+     * The rate is a * 2^(k - 28). ratel is the fraction times 0xffff,
+     * which is the fraction less 1/65536 of it
+     */
+    if (k >= 15) {
+        *ratel = 0xffff;
+        return 0x7fff;
+    }
+    if (k >= 13) {
+        s = a >> (28 - k);
+        f = (a << (k - 12)) & 0xffff;
+        *ratel = (f * 0xffff) >> 16;
+    } else if (k >= 0) {
+        s = a >> (28 - k);
+        f = a & ((1 << (28 - k)) - 1);
+        *ratel = (f - (f >> 16)) >> (12 - k);
+    } else {
+        s = 0;
+        *ratel = (k > -20) ? (a - (a >> 16)) >> (12 - k) : 0;
+    }
+
+#ifdef AUD_PROFILE
+    PROFILE_AUD(rate_num, rate_cnt, rate_max, rate_min);
+#endif
+    return s;
+}
+#endif /* AL_ENV_RATE_TABLE */
+
 static
 f32 _getVol(f32 ivol, s32 samples, s16 ratem, u16 ratel)
 {
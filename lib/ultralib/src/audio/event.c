@@ -22,12 +22,349 @@
 #include <os_internal.h>
 #include <ultraerror.h>
 
+#ifdef AL_EVTQ_WHEEL
+/*
+ * The wheel is only ever a place to start walking the list from, so a slot
+ * may miss events but must never name one that has left the list: handing
+ * one out or unlinking it frees or moves back its slot if it was the slot's
+ * last, and flushing or a bulk edit marks the whole wheel stale.
+ */
+#define WHEEL_SPAN_SHIFT    (AL_EVTQ_WHEEL_SHIFT + 6)  /* 2^6 level 0 slots per span */
+#define WHEEL_MASK          (AL_EVTQ_WHEEL_SLOTS - 1)
+#define WHEEL_BEFORE        -1      /* before the queue's time, from a negative delta */
+#define WHEEL_PAST          2       /* past level 1 */
+
+#define WHEEL_USED(w, l, s) ((w)->used[l][(s) >> 5] & (1u << ((s) & 31)))
+
+static s32 __wheelLevel(ALEvtqWheel *w, u32 time, s32 *slot)
+{
+    u32 span = time >> WHEEL_SPAN_SHIFT;
+    u32 cur = w->now >> WHEEL_SPAN_SHIFT;
+
+    if ((s32)(time - w->now) < 0)
+        return WHEEL_BEFORE;
+
+    if (span == cur) {
+        *slot = (time >> AL_EVTQ_WHEEL_SHIFT) & WHEEL_MASK;
+        return 0;
+    }
+
+    if (span - cur < AL_EVTQ_WHEEL_SLOTS) {
+        *slot = span & WHEEL_MASK;
+        return 1;
+    }
+
+    return WHEEL_PAST;
+}
+
+static void __wheelSet(ALEvtqWheel *w, s32 level, s32 slot, ALEventListItem *item, u32 time)
+{
+    w->slot[level][slot].last = item;
+    w->slot[level][slot].time = time;
+    w->used[level][slot >> 5] |= 1u << (slot & 31);
+}
+
+/* The highest bit set in bits, which isn't 0 */
+static s32 __wheelBit(u32 bits)
+{
+    s32 bit = 0;
+
+    if (bits >> 16) { bits >>= 16; bit += 16; }
+    if (bits >> 8)  { bits >>= 8;  bit += 8; }
+    if (bits >> 4)  { bits >>= 4;  bit += 4; }
+    if (bits >> 2)  { bits >>= 2;  bit += 2; }
+    if (bits >> 1)  { bit += 1; }
+    return bit;
+}
+
+/* The highest slot in use in [from, to), or -1 */
+static s32 __wheelHighest(u32 *used, s32 from, s32 to)
+{
+    u32 bits;
+    s32 word;
+
+    while (to > from) {
+        word = (to - 1) >> 5;
+        bits = used[word];
+        if (to & 31)
+            bits &= (1u << (to & 31)) - 1;
+        if (from > (word << 5))
+            bits &= ~((1u << (from & 31)) - 1);
+
+        if (bits)
+            return (word << 5) + __wheelBit(bits);
+        to = word << 5;
+    }
+
+    return -1;
+}
+
+/*
+ * The latest level 1 slot in use for a span before end's, or -1. Level 1's
+ * slots start after the current span's and wrap round.
+ */
+static s32 __wheelBefore(ALEvtqWheel *w, s32 end)
+{
+    s32 first = ((w->now >> WHEEL_SPAN_SHIFT) + 1) & WHEEL_MASK;
+    s32 slot;
+
+    if (first <= end)
+        return __wheelHighest(w->used[1], first, end);
+
+    slot = __wheelHighest(w->used[1], 0, end);
+    if (slot < 0)
+        slot = __wheelHighest(w->used[1], first, AL_EVTQ_WHEEL_SLOTS);
+    return slot;
+}
+
+/*
+ * Where to start walking the list to find time's place: the last event on
+ * the wheel at or before it, or the head of the list, at the queue's time.
+ */
+static ALLink *__wheelStart(ALEventQueue *evtq, u32 time, u32 *at)
+{
+    ALEvtqWheel *w = evtq->wheel;
+    ALEvtqSlot  *s;
+    s32         level;
+    s32         slot = 0;
+    s32         prev = -1;
+
+    level = __wheelLevel(w, time, &slot);
+    if (level == WHEEL_BEFORE) {
+        *at = w->now;
+        return &evtq->allocList;
+    }
+
+    if (level != 0) {
+        if (level == 1 && WHEEL_USED(w, 1, slot) && (s32)(w->slot[1][slot].time - time) <= 0)
+            prev = slot;
+        else if (level == 1)
+            prev = __wheelBefore(w, slot);
+        else
+            prev = __wheelBefore(w, (w->now >> WHEEL_SPAN_SHIFT) & WHEEL_MASK);
+
+        if (prev >= 0) {
+            s = &w->slot[1][prev];
+            *at = s->time;
+            return (ALLink *)s->last;
+        }
+        slot = AL_EVTQ_WHEEL_SLOTS;
+    } else if (WHEEL_USED(w, 0, slot) && (s32)(w->slot[0][slot].time - time) <= 0) {
+        prev = slot;
+    }
+
+    if (prev < 0)
+        prev = __wheelHighest(w->used[0], 0, slot);
+
+    if (prev >= 0) {
+        s = &w->slot[0][prev];
+        *at = s->time;
+        return (ALLink *)s->last;
+    }
+
+    *at = w->now;
+    return &evtq->allocList;
+}
+
+/*
+ * Puts the events after node, whose time is at, on the wheel, as far as
+ * the first beyond level maxLevel.
+ */
+static void __wheelFill(ALEvtqWheel *w, ALLink *node, u32 at, s32 maxLevel)
+{
+    s32 level;
+    s32 slot = 0;
+
+    for (node = node->next; node != 0; node = node->next) {
+        at += ((ALEventListItem *)node)->delta;
+        level = __wheelLevel(w, at, &slot);
+        if (level > maxLevel)
+            break;
+        if (level != WHEEL_BEFORE)
+            __wheelSet(w, level, slot, (ALEventListItem *)node, at);
+    }
+}
+
+static void __wheelRebuild(ALEventQueue *evtq)
+{
+    ALEvtqWheel *w = evtq->wheel;
+
+    bzero(w->used, sizeof(w->used));
+    __wheelFill(w, &evtq->allocList, w->now, 1);
+    w->stale = FALSE;
+}
+
+/*
+ * The queue's time has moved on to a later span. Everything in the old
+ * one has been handed out, so level 0 is empty; the new span's events,
+ * which lead the list, come down to it from level 1, and those that were
+ * past the wheel and are now within level 1 go up on it, after its last.
+ */
+static void __wheelAdvance(ALEventQueue *evtq, u32 time)
+{
+    ALEvtqWheel *w = evtq->wheel;
+    ALEvtqSlot  *s;
+    u32         span = w->now >> WHEEL_SPAN_SHIFT;
+    u32         to = time >> WHEEL_SPAN_SHIFT;
+    s32         prev;
+
+    w->now = time;
+    bzero(w->used[0], sizeof(w->used[0]));
+    if (to - span >= AL_EVTQ_WHEEL_SLOTS) {
+        bzero(w->used[1], sizeof(w->used[1]));
+    } else {
+        while (span != to) {
+            span++;
+            w->used[1][(span & WHEEL_MASK) >> 5] &= ~(1u << (span & 31));
+        }
+    }
+
+    __wheelFill(w, &evtq->allocList, time, 0);
+
+    prev = __wheelBefore(w, to & WHEEL_MASK);
+    if (prev >= 0) {
+        s = &w->slot[1][prev];
+        __wheelFill(w, (ALLink *)s->last, s->time, 1);
+    } else {
+        __wheelFill(w, &evtq->allocList, time, 1);
+    }
+}
+
+/* alEvtqNextEvent has just handed out item, delta after the last */
+static void __wheelNext(ALEventQueue *evtq, ALEventListItem *item, ALMicroTime delta)
+{
+    ALEvtqWheel *w = evtq->wheel;
+    u32         time = w->now + delta;
+    s32         slot;
+
+    if (w->stale || delta < 0) {
+        w->now = time;
+        w->stale = TRUE;
+    } else if ((time >> WHEEL_SPAN_SHIFT) != (w->now >> WHEEL_SPAN_SHIFT)) {
+        __wheelAdvance(evtq, time);
+    } else {
+        w->now = time;
+        slot = (time >> AL_EVTQ_WHEEL_SHIFT) & WHEEL_MASK;
+        if (w->slot[0][slot].last == item)
+            w->used[0][slot >> 5] &= ~(1u << (slot & 31));
+    }
+}
+
+/*
+ * alEvtqPostEvent's walk from the wheel: item goes after the last event
+ * at or before its time, or at the end at the last event's time, with the
+ * same deltas the walk from the head would give it.
+ */
+static void __wheelPost(ALEventQueue *evtq, ALEventListItem *item, ALMicroTime delta)
+{
+    ALEvtqWheel         *w = evtq->wheel;
+    ALLink              *node;
+    ALEventListItem     *nextItem;
+    u32                 time;
+    u32                 at;
+    s32                 level;
+    s32                 slot = 0;
+    s32                 nextSlot = 0;
+
+    if (w->stale)
+        __wheelRebuild(evtq);
+
+    if (delta == AL_EVTQ_END) {
+        /* a time past the wheel starts from its last event */
+        node = __wheelStart(evtq, w->now + AL_EVTQ_END, &at);
+        while (node->next) {
+            node = node->next;
+            at += ((ALEventListItem *)node)->delta;
+        }
+        time = at;
+    } else {
+        time = w->now + delta;
+        node = __wheelStart(evtq, time, &at);
+        while (node->next && ((ALEventListItem *)node->next)->delta <= (s32)(time - at)) {
+            node = node->next;
+            at += ((ALEventListItem *)node)->delta;
+        }
+    }
+
+    item->delta = time - at;
+    nextItem = (ALEventListItem *)node->next;
+    if (nextItem)
+        nextItem->delta -= item->delta;
+    alLink((ALLink *)item, node);
+
+    level = __wheelLevel(w, time, &slot);
+    if (level == 0 || level == 1) {
+        if (!nextItem || __wheelLevel(w, time + nextItem->delta, &nextSlot) != level || nextSlot != slot)
+            __wheelSet(w, level, slot, item, time);
+    }
+}
+
+void alEvtqNewWheel(ALEventQueue *evtq, ALEvtqWheel *wheel)
+{
+    evtq->wheel = wheel;
+    if (wheel) {
+        wheel->now = 0;
+        wheel->stale = TRUE;
+    }
+}
+
+/*
+ * item is about to be unlinked by code other than this file's. If it is a
+ * slot's last, the event before it takes its place when it is in the same
+ * slot, else the slot is freed.
+ */
+void __alEvtqUnlink(ALEventQueue *evtq, ALEventListItem *item)
+{
+    ALEvtqWheel *w = evtq->wheel;
+    ALEvtqSlot  *s;
+    ALLink      *prev;
+    u32         bits;
+    s32         level;
+    s32         word;
+    s32         slot;
+    s32         prevSlot = 0;
+
+    if (!w || w->stale)
+        return;
+
+    for (level = 0; level < 2; level++) {
+        for (word = 0; word < AL_EVTQ_WHEEL_SLOTS / 32; word++) {
+            for (bits = w->used[level][word]; bits != 0; bits &= bits - 1) {
+                slot = (word << 5) + __wheelBit(bits & -bits);
+                s = &w->slot[level][slot];
+                if (s->last != item)
+                    continue;
+
+                prev = item->node.prev;
+                if (prev != &evtq->allocList &&
+                    __wheelLevel(w, s->time - item->delta, &prevSlot) == level && prevSlot == slot) {
+                    s->last = (ALEventListItem *)prev;
+                    s->time -= item->delta;
+                } else {
+                    w->used[level][word] &= ~(1u << (slot & 31));
+                }
+                return;
+            }
+        }
+    }
+}
+
+void __alEvtqChanged(ALEventQueue *evtq)
+{
+    if (evtq->wheel)
+        evtq->wheel->stale = TRUE;
+}
+#endif
+
 
 void alEvtqNew(ALEventQueue *evtq, ALEventListItem *items, s32 itemCount)
 {
     s32 i;
     
     evtq->eventCount     = 0;
+#ifdef AL_EVTQ_WHEEL
+    evtq->wheel          = 0;
+#endif
     evtq->allocList.next = 0;
     evtq->allocList.prev = 0;
     evtq->freeList.next  = 0;
@@ -54,6 +391,10 @@ ALMicroTime alEvtqNextEvent(ALEventQueue *evtq, ALEvent *evt)
         alCopy(&item->evt, evt, sizeof(*evt));
         alLink((ALLink *)item, &evtq->freeList);
 	delta = item->delta;
+#ifdef AL_EVTQ_WHEEL
+        if (evtq->wheel)
+            __wheelNext(evtq, item, delta);
+#endif
     }
     else
     {
@@ -93,6 +434,14 @@ void alEvtqPostEvent(ALEventQueue *evtq, ALEvent *evt, ALMicroTime delta)
     alUnlink((ALLink *)item);
     alCopy(evt, &item->evt, sizeof(*evt));
 
+#ifdef AL_EVTQ_WHEEL
+    if (evtq->wheel) {
+        __wheelPost(evtq, item, delta);
+        osSetIntMask(mask);
+        return;
+    }
+#endif
+
     if (delta == AL_EVTQ_END)
         postAtEnd = -1;
     
@@ -131,6 +480,9 @@ void alEvtqFlush(ALEventQueue *evtq)
     OSIntMask   mask;
 
     mask = osSetIntMask(OS_IM_NONE);
+#ifdef AL_EVTQ_WHEEL
+    __alEvtqChanged(evtq);
+#endif
 
     thisNode = evtq->allocList.next;
     while( thisNode != 0 ) {
@@ -155,6 +507,9 @@ void alEvtqFlushType(ALEventQueue *evtq, s16 type)
     OSIntMask   	mask;
 
     mask = osSetIntMask(OS_IM_NONE);
+#ifdef AL_EVTQ_WHEEL
+    __alEvtqChanged(evtq);
+#endif
 
     thisNode = evtq->allocList.next;
     while( thisNode != 0 )
@@ -39,11 +39,18 @@ void *alHeapDBAlloc(u8 *file, s32 line, ALHeap *hp, s32 num, s32 size)
 
         ptr = hp->cur;
         hp->cur += bytes;
+#ifdef AL_HEAP_MARK
+        if (hp->cur > hp->high)
+            hp->high = hp->cur;
+#endif
 
 #ifdef _DEBUG    
         ((HeapInfo *)ptr)->magic = AL_HEAP_MAGIC;
         ((HeapInfo *)ptr)->size  = bytes;
         ((HeapInfo *)ptr)->count = hp->count;
+#ifdef AL_HEAP_MARK
+        ((HeapInfo *)ptr)->request = num*size;
+#endif
         if (file) {
             ((HeapInfo *)ptr)->file  = file;
             ((HeapInfo *)ptr)->line  = line;
@@ -63,3 +70,47 @@ void *alHeapDBAlloc(u8 *file, s32 line, ALHeap *hp, s32 num, s32 size)
 
     return ptr;
 }
+
+#ifdef AL_HEAP_MARK
+void alHeapMark(ALHeap *hp, ALHeapMark *mark)
+{
+    mark->cur   = hp->cur;
+    mark->count = hp->count;
+}
+
+/*
+ * Nothing allocated since the mark may still be in use: players have to
+ * have been deleted, banks and sequences finished with. A mark past
+ * hp->cur was released out of order, and one below hp->base was set on
+ * another heap; both are left alone before anything is read through them.
+ * So, in the _DEBUG library, is one that isn't where an allocation
+ * started, which was also set on another heap.
+ */
+void alHeapRelease(ALHeap *hp, ALHeapMark *mark)
+{
+#ifdef _DEBUG
+    u8  *ptr;
+#endif
+
+    if (mark->cur < hp->base || mark->cur > hp->cur) {
+#ifdef _DEBUG
+        __osError(ERR_ALHEAPCORRUPT, 0);
+#endif
+        return;
+    }
+
+#ifdef _DEBUG
+    for (ptr = hp->base; ptr < mark->cur; ptr += ((HeapInfo *)ptr)->size)
+        if (((HeapInfo *)ptr)->magic != AL_HEAP_MAGIC)
+            break;
+
+    if (ptr != mark->cur) {
+        __osError(ERR_ALHEAPCORRUPT, 0);
+        return;
+    }
+#endif
+
+    hp->cur   = mark->cur;
+    hp->count = mark->count;
+}
+#endif
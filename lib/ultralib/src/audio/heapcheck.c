@@ -68,4 +68,47 @@ s32 alHeapCheck(ALHeap *hp)
     return rv;
 }
 
+#ifdef AL_HEAP_MARK
+/*
+ * How much of the heap is in use, and has been at most. In the _DEBUG
+ * library, which keeps a HeapInfo ahead of each allocation, also how many
+ * there are and how much of what they take was asked for, the rest going
+ * to the HeapInfo and rounding up to AL_CACHE_ALIGN, and which is largest.
+ * Returns alHeapCheck's result.
+ */
+s32 alHeapReport(ALHeap *hp, ALHeapReport *report)
+{
+    s32         rv;
+#ifdef _DEBUG
+    HeapInfo    *hi;
+    u8          *ptr;
+#endif
+
+    report->used = hp->cur - hp->base;
+    report->high = hp->high - hp->base;
+    report->free = hp->len - (hp->cur - hp->base);
+    report->blocks = 0;
+    report->requested = 0;
+    report->largest = 0;
+    report->largestFile = 0;
+    report->largestLine = 0;
+
+    if ((rv = alHeapCheck(hp)) != 0)
+        return rv;
+
+#ifdef _DEBUG
+    for (ptr = hp->base; ptr < hp->cur; ptr += hi->size) {
+        hi = (HeapInfo *)ptr;
 
+        report->blocks++;
+        report->requested += hi->request;
+        if (hi->request > report->largest) {
+            report->largest = hi->request;
+            report->largestFile = hi->file;
+            report->largestLine = hi->line;
+        }
+    }
+#endif
+    return rv;
+}
+#endif
@@ -33,5 +33,8 @@ void alHeapInit(ALHeap *hp, u8 *base, s32 len)
     hp->len  = len;
     hp->cur  = hp->base;
     hp->count = 0;
+#ifdef AL_HEAP_MARK
+    hp->high = hp->base;
+#endif
 }
 
@@ -37,6 +37,13 @@ extern u32 cnt_index, adpcm_num, adpcm_cnt, adpcm_max, adpcm_min, lastCnt[];
 static
 Acmd *_decodeChunk(Acmd *ptr, ALLoadFilter *f, s32 tsam, s32 nbytes, s16 outp, s16 inp, u32 flags);
 
+#ifdef AL_ADPCM_SHARE
+static ALLoadShare *_shareSlice(void);
+static s32 _shareMatch(ALLoadShare *share, ALLoadFilter *f, s16 outp, s32 outCount);
+static Acmd *_shareTake(ALLoadShare *share, ALLoadFilter *f, s16 *outp, Acmd *p);
+static s32 _shareFetch(ALLoadFilter *f, s32 nbytes);
+#endif
+
 Acmd *alAdpcmPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd *p) 
 {
     Acmd        *ptr = p;
@@ -53,6 +60,9 @@ Acmd *alAdpcmPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
     s32         bEnd;
     s32         decoded = 0;
     s32         looped = 0;
+#ifdef AL_ADPCM_SHARE
+    ALLoadShare *share;
+#endif
     
     ALLoadFilter *f = (ALLoadFilter *)filter;
 
@@ -63,6 +73,32 @@ Acmd *alAdpcmPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
     if (outCount == 0)
         return ptr;
 
+#ifdef AL_PROFILE
+    __alProfileBegin();
+#endif
+
+#ifdef AL_ADPCM_SHARE
+    share = _shareSlice();
+    share->stats.pulls++;
+    if (_shareMatch(share, f, *outp, outCount)) {
+        ptr = _shareTake(share, f, outp, ptr);
+#ifdef AL_PROFILE
+        __alProfileEnd(AL_PROF_LOAD);
+#endif
+        return ptr;
+    }
+
+    /*
+     * Keep what this pull starts from for the next voice to compare
+     * with; until it's done the decoder's DMEM holds neither
+     */
+    share->last = 0;
+    share->before = *f;
+    share->outCount = outCount;
+    share->outp = *outp;
+    share->fetched = 0;
+#endif
+
     inp = AL_DECODER_IN;
     aLoadADPCM(ptr++, f->bookSize,
                K0_TO_PHYS(f->table->waveInfo.adpcmWave.book->book));
@@ -148,6 +184,14 @@ Acmd *alAdpcmPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
         f->memin += ADPCMFBYTES*nframes;    
 #ifdef AUD_PROFILE
         PROFILE_AUD(adpcm_num, adpcm_cnt, adpcm_max, adpcm_min);
+#endif
+#ifdef AL_ADPCM_SHARE
+        share->last = f;
+        share->after = *f;
+        share->outpAfter = *outp;
+#endif
+#ifdef AL_PROFILE
+        __alProfileEnd(AL_PROF_LOAD);
 #endif
         return ptr;
     }
@@ -202,6 +246,14 @@ Acmd *alAdpcmPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
 #ifdef AUD_PROFILE
     PROFILE_AUD(adpcm_num, adpcm_cnt, adpcm_max, adpcm_min);
 #endif
+#ifdef AL_ADPCM_SHARE
+    share->last = f;
+    share->after = *f;
+    share->outpAfter = *outp;
+#endif
+#ifdef AL_PROFILE
+    __alProfileEnd(AL_PROF_LOAD);
+#endif
 
     return ptr;
 }
@@ -223,12 +275,23 @@ Acmd *alRaw16Pull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
 
     if (outCount == 0)
         return ptr;
+
+#ifdef AL_PROFILE
+    __alProfileBegin();
+#endif
+#ifdef AL_ADPCM_SHARE
+    /* This loads over the decoder's output */
+    _shareSlice()->last = 0;
+#endif
     
     if ((outCount + f->sample > f->loop.end) && (f->loop.count != 0)){
 
         nSam = f->loop.end - f->sample;
         nbytes = nSam<<1;
         if (nSam > 0){
+#ifdef AL_PROFILE
+            __alProfileCount(AL_PROF_DMAS);
+#endif
             dramLoc = (f->dma)(f->memin, nbytes, f->dmaState);
             
             /*
@@ -270,6 +333,9 @@ Acmd *alRaw16Pull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
             /*
              * Do the next section, same as last.
              */
+#ifdef AL_PROFILE
+            __alProfileCount(AL_PROF_DMAS);
+#endif
             dramLoc = (f->dma)(f->memin, nbytes, f->dmaState);
             
             /*
@@ -297,6 +363,9 @@ Acmd *alRaw16Pull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
         f->sample += outCount;
         f->memin += (outCount<<1);
         
+#ifdef AL_PROFILE
+        __alProfileEnd(AL_PROF_LOAD);
+#endif
         return ptr;
     }
 
@@ -317,6 +386,9 @@ Acmd *alRaw16Pull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
     if (overFlow < nbytes){
         if (outCount > 0){
             nbytes -= overFlow;
+#ifdef AL_PROFILE
+            __alProfileCount(AL_PROF_DMAS);
+#endif
             dramLoc = (f->dma)(f->memin, nbytes, f->dmaState);
             
             /*
@@ -346,6 +418,9 @@ Acmd *alRaw16Pull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset, Acmd
             startZero = 0;
         aClearBuffer(ptr++, startZero + *outp, overFlow);
     }
+#ifdef AL_PROFILE
+    __alProfileEnd(AL_PROF_LOAD);
+#endif
     return ptr;
 }
 
@@ -444,7 +519,14 @@ Acmd *_decodeChunk(Acmd *ptr, ALLoadFilter *f, s32 tsam, s32 nbytes, s16 outp, s
         dramLoc;
     
     if (nbytes > 0){
+#ifdef AL_ADPCM_SHARE
+        dramLoc = _shareFetch(f, nbytes);
+#else
+#ifdef AL_PROFILE
+        __alProfileCount(AL_PROF_DMAS);
+#endif
         dramLoc = (f->dma)(f->memin, nbytes, f->dmaState);
+#endif
         /*
          * Make sure enough is loaded into DMEM to take care
          * of 8 byte alignment
@@ -463,9 +545,124 @@ Acmd *_decodeChunk(Acmd *ptr, ALLoadFilter *f, s32 tsam, s32 nbytes, s16 outp, s
     aSetBuffer(ptr++, 0, inp + dramAlign, outp, tsam<<1);
     aADPCMdec(ptr++, flags, K0_TO_PHYS(f->state));
     f->first = 0;
+#ifdef AL_ADPCM_SHARE
+    f->gen++;
+    f->twin = 0;
+#endif
 
     return ptr;
 }
 
+#ifdef AL_ADPCM_SHARE
+/* The synthesizer's share record, cleared when a new slice has begun */
+static ALLoadShare *_shareSlice(void)
+{
+    ALSynth     *drvr = &alGlobals->drvr;
+    ALLoadShare *share = drvr->loadShare;
+
+    if (share->time != drvr->curSamples) {
+        share->time = drvr->curSamples;
+        share->last = 0;
+        share->nfetch = 0;
+        share->next = 0;
+    }
+    return share;
+}
+
+/*
+ * Whether f would decode just what the last voice did: the same samples of
+ * the same wavetable into the same place, from the same state. Either both
+ * start afresh, or f's state is a copy of the last voice's and the last
+ * voice hadn't written its own since.
+ */
+static s32 _shareMatch(ALLoadShare *share, ALLoadFilter *f, s16 outp, s32 outCount)
+{
+    ALLoadFilter *a = &share->before;
+
+    if (share->last == 0 || share->last == f)
+        return 0;
+
+    if (share->outCount != outCount || share->outp != outp ||
+        a->table != f->table || a->memin != f->memin ||
+        a->sample != f->sample || a->lastsam != f->lastsam ||
+        a->first != f->first || a->loop.start != f->loop.start ||
+        a->loop.end != f->loop.end || a->loop.count != f->loop.count)
+        return 0;
+
+    return f->first || (f->twin == share->last && f->twinGen == a->gen);
+}
+
+/*
+ * Leaves f where the last voice's pull left it, with *outp at its output,
+ * and its state copied over if that was written
+ */
+static Acmd *_shareTake(ALLoadShare *share, ALLoadFilter *f, s16 *outp, Acmd *p)
+{
+    Acmd         *ptr = p;
+    ALLoadFilter *a = &share->after;
+
+    if (a->gen != share->before.gen) {
+        aSetBuffer(ptr++, 0, AL_DECODER_IN, AL_DECODER_IN, sizeof(ADPCM_STATE));
+        aLoadBuffer(ptr++, K0_TO_PHYS(share->last->state));
+        aSaveBuffer(ptr++, K0_TO_PHYS(f->state));
+        f->gen++;
+    }
+
+    f->memin = a->memin;
+    f->sample = a->sample;
+    f->lastsam = a->lastsam;
+    f->first = a->first;
+    f->loop.count = a->loop.count;
+    f->twin = share->last;
+    f->twinGen = a->gen;
+    *outp = share->outpAfter;
+
+    share->stats.shared++;
+    share->stats.savedBytes += share->fetched;
+    return ptr;
+}
+
+/*
+ * The DRAM address of nbytes of the wavetable at f->memin, from a fetch
+ * already made this slice if one covers them, or from the DMA callback
+ */
+static s32 _shareFetch(ALLoadFilter *f, s32 nbytes)
+{
+    ALLoadShare  *share = alGlobals->drvr.loadShare;
+    ALShareFetch *e;
+    s32          i;
+
+    share->fetched += nbytes;
+    for (i = 0; i < share->nfetch; i++) {
+        e = &share->fetch[i];
+        if (f->memin >= e->memin && f->memin + nbytes <= e->memin + e->len) {
+            share->stats.reused++;
+            share->stats.savedBytes += nbytes;
+            return e->dramLoc + (f->memin - e->memin);
+        }
+    }
+
+#ifdef AL_PROFILE
+    __alProfileCount(AL_PROF_DMAS);
+#endif
+    e = &share->fetch[share->next];
+    e->dramLoc = (f->dma)(f->memin, nbytes, f->dmaState);
+    e->memin = f->memin;
+    e->len = nbytes;
+    share->next = (share->next + 1) % AL_SHARE_FETCHES;
+    if (share->nfetch < AL_SHARE_FETCHES)
+        share->nfetch++;
+
+    share->stats.fetches++;
+    share->stats.fetchBytes += nbytes;
+    return e->dramLoc;
+}
+
+void alSynGetLoadStats(ALSynth *drvr, ALSynLoadStats *stats)
+{
+    *stats = drvr->loadShare->stats;
+}
+#endif
+
 
 
@@ -52,6 +52,10 @@ Acmd *alResamplePull(void *filter, s16 *outp, s32 outCnt, s32 sampleOffset, Acmd
     if (!outCnt)
         return ptr;
 
+#ifdef AL_PROFILE
+    __alProfileBegin();
+#endif
+
     /*
      * check if resampler is required
      */
@@ -98,6 +102,9 @@ Acmd *alResamplePull(void *filter, s16 *outp, s32 outCnt, s32 sampleOffset, Acmd
     
 #ifdef AUD_PROFILE
     PROFILE_AUD(resampler_num, resampler_cnt, resampler_max, resampler_min);
+#endif
+#ifdef AL_PROFILE
+    __alProfileEnd(AL_PROF_RESAMPLE);
 #endif
     return ptr;
 }
@@ -54,6 +54,33 @@ f32  _doModFunc(ALDelay *d, s32 count);
 
 static s32 L_INC[] = { L0_INC, L1_INC, L2_INC };
 
+#ifdef AL_FX_FUSED
+/*
+ * The fused path works in three DMEM buffers: the aux left bus, which
+ * holds the input after it is written to the delay line, and AL_TEMP_0
+ * and AL_TEMP_1. For each it keeps the tap (a delay, as in ALDelay's input
+ * and output) whose delay line samples it holds a copy of, if any, so
+ * that a tap already in DMEM isn't loaded again and a buffer that hasn't
+ * changed since it was loaded isn't saved back.
+ */
+#define FX_BUFFERS	3
+#define FX_NO_TAP	0xffffffff
+
+typedef struct {
+    s32		buff[FX_BUFFERS];
+    u32		tap[FX_BUFFERS];
+    u32		used[FX_BUFFERS];	/* when last used, for choosing one to load into */
+    u32		clock;
+} ALFxBuffers;
+
+static s32  _fxFind(ALFxBuffers *b, u32 tap, s32 skip);
+static s32  _fxVictim(ALFxBuffers *b, s32 skip);
+static s32  _fxExact(ALFx *r, u32 tap, s32 count);
+static void _fxSaved(ALFx *r, ALFxBuffers *b, s32 i, u32 tap, s32 count);
+static Acmd *_fxLoadBuffer(ALFx *r, s16 *curr_ptr, s32 buff, s32 count, Acmd *p);
+static Acmd *_fxChorusBuffer(ALFx *r, ALDelay *d, s32 buff, s32 incount, Acmd *p);
+#endif
+
 /***********************************************************************
  * Reverb filter public interfaces
  ***********************************************************************/
@@ -63,9 +90,16 @@ Acmd *alFxPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
     Acmd        *ptr = p;
     ALFx	*r = (ALFx *)filter;
     ALFilter    *source = r->filter.source;
+#ifdef AL_FX_FUSED
+    s16		i, input, output;
+    s32		b1, b2, j;
+    ALFxBuffers	fb;
+    ALDelay	*d;
+#else
     s16		i, buff1, buff2, input, output;
     s16		*in_ptr, *out_ptr, gain, *prev_out_ptr = 0;
     ALDelay	*d, *pd;
+#endif
 
 #ifdef AUD_PROFILE
     lastCnt[++cnt_index] = osGetCount();
@@ -79,11 +113,16 @@ Acmd *alFxPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
      * pull channels going into this effect first
      */
     ptr = (*source->handler)(source, outp, outCount, sampleOffset, p);
+#ifdef AL_PROFILE
+    __alProfileBegin();
+#endif
 
     input  = AL_AUX_L_OUT;
     output = AL_AUX_R_OUT;
+#ifndef AL_FX_FUSED
     buff1  = AL_TEMP_0;
     buff2  = AL_TEMP_1;
+#endif
     
     aSetBuffer(ptr++, 0, 0, 0, outCount<<1);  /* set the buffer size */
     aMix(ptr++, 0, 0xda83, AL_AUX_L_OUT, input); /* .707L = L - .293L */
@@ -93,6 +132,89 @@ Acmd *alFxPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
 
     aClearBuffer(ptr++, output, outCount<<1); /* clear the AL_AUX_R_OUT */
 
+#ifdef AL_FX_FUSED
+    fb.buff[0] = input;
+    fb.buff[1] = AL_TEMP_0;
+    fb.buff[2] = AL_TEMP_1;
+    for (j = 0; j < FX_BUFFERS; j++) {
+	fb.tap[j] = FX_NO_TAP;
+	fb.used[j] = 0;
+    }
+    fb.clock = 0;
+    if (_fxExact(r, 0, outCount))
+	fb.tap[0] = 0;		/* just saved at r->input */
+
+    for (i = 0; i < r->section_count; i++) {
+	d = &r->delay[i];
+
+	/*
+	 * a section that neither adds to the output nor changes the
+	 * delay line has nothing to do. One with no gain that feeds
+	 * back still has to run, since later sections read its taps.
+	 */
+	if (!d->gain && !d->ffcoef && !d->fbcoef && !d->lp && !d->rs)
+	    continue;
+
+	/*
+	 * the input tap, only if it gets mixed; mixing into it in place
+	 * is fine, as it is saved back straight after
+	 */
+	b1 = -1;
+	if (d->ffcoef || d->fbcoef) {
+	    if ((b1 = _fxFind(&fb, d->input, -1)) < 0) {
+		b1 = _fxVictim(&fb, d->rs ? -1 : _fxFind(&fb, d->output, -1));
+		ptr = _fxLoadBuffer(r, &r->input[-d->input], fb.buff[b1], outCount, ptr);
+		fb.tap[b1] = d->input;
+	    }
+	    fb.used[b1] = ++fb.clock;
+	}
+
+	/*
+	 * the output tap, in a buffer of its own since it gets changed
+	 */
+	if (d->rs) {
+	    b2 = _fxVictim(&fb, b1);
+	    ptr = _fxChorusBuffer(r, d, fb.buff[b2], outCount, ptr);
+	    fb.tap[b2] = FX_NO_TAP;
+	} else if ((b2 = _fxFind(&fb, d->output, b1)) < 0) {
+	    b2 = _fxVictim(&fb, b1);
+	    if (b1 >= 0 && fb.tap[b1] == d->output) {
+		aDMEMMove(ptr++, fb.buff[b1], fb.buff[b2], outCount<<1);
+	    } else {
+		ptr = _fxLoadBuffer(r, &r->input[-d->output], fb.buff[b2], outCount, ptr);
+	    }
+	    fb.tap[b2] = d->output;
+	}
+	fb.used[b2] = ++fb.clock;
+
+	if (d->ffcoef) {
+	    aMix(ptr++, 0, (u16)d->ffcoef, fb.buff[b1], fb.buff[b2]);
+	    fb.tap[b2] = FX_NO_TAP;
+	}
+
+	if (d->fbcoef) {
+	    aMix(ptr++, 0, (u16)d->fbcoef, fb.buff[b2], fb.buff[b1]);
+	    ptr = _saveBuffer(r, &r->input[-d->input], fb.buff[b1], outCount, ptr);
+	    _fxSaved(r, &fb, b1, d->input, outCount);
+	}
+
+	if (d->lp) {
+	    ptr = _filterBuffer(d->lp, fb.buff[b2], outCount, ptr);
+	    fb.tap[b2] = FX_NO_TAP;
+	}
+
+	/*
+	 * once, and only if it changed since it was loaded
+	 */
+	if (!d->rs && fb.tap[b2] != d->output) {
+	    ptr = _saveBuffer(r, &r->input[-d->output], fb.buff[b2], outCount, ptr);
+	    _fxSaved(r, &fb, b2, d->output, outCount);
+	}
+
+	if (d->gain)
+	    aMix(ptr++, 0, (u16)d->gain, fb.buff[b2], output);
+    }
+#else
     for (i = 0; i < r->section_count; i++) {
 	d  = &r->delay[i];  /* get the ALDelay structure */
 	in_ptr  = &r->input[-d->input];
@@ -128,6 +250,7 @@ Acmd *alFxPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
 	
 	prev_out_ptr = &r->input[d->output];
     }
+#endif
 
     /*
      * bump the master delay line input pointer
@@ -145,6 +268,9 @@ Acmd *alFxPull(void *filter, s16 *outp, s32 outCount, s32 sampleOffset,
 
 #ifdef AUD_PROFILE
     PROFILE_AUD(reverb_num, reverb_cnt, reverb_max, reverb_min);
+#endif
+#ifdef AL_PROFILE
+    __alProfileEnd(AL_PROF_FX);
 #endif
     return ptr;
 }
@@ -413,6 +539,162 @@ Acmd *_filterBuffer(ALLowPass *lp, s32 buff, s32 count, Acmd *p)
 
 
 
+#ifdef AL_FX_FUSED
+/*
+ * Returns the buffer other than skip that holds tap, or -1
+ */
+static s32 _fxFind(ALFxBuffers *b, u32 tap, s32 skip)
+{
+    s32 i;
+
+    for (i = 0; i < FX_BUFFERS; i++)
+        if (i != skip && b->tap[i] == tap)
+            return i;
+    return -1;
+}
+
+/*
+ * Returns the temp buffer other than skip to load into: an empty one if
+ * there is one, else the one used longest ago
+ */
+static s32 _fxVictim(ALFxBuffers *b, s32 skip)
+{
+    s32 i, victim = -1;
+
+    for (i = 1; i < FX_BUFFERS; i++) {
+        if (i == skip)
+            continue;
+        if (b->tap[i] == FX_NO_TAP)
+            return i;
+        if (victim < 0 || b->used[i] < b->used[victim])
+            victim = i;
+    }
+    return victim;
+}
+
+/*
+ * Whether count samples saved at tap load back as they were. The DMA
+ * rounds RDRAM addresses down to 8 bytes, so once outCount has left
+ * r->input off that, a save and a load of the same tap move the samples
+ * over and only a load again gives what _loadBuffer() would.
+ */
+static s32 _fxExact(ALFx *r, u32 tap, s32 count)
+{
+    s16     *ptr = &r->input[-tap];
+
+    if (ptr < r->base)
+        ptr += r->length;
+    if ((s32)ptr & 0x7)
+        return 0;
+    return ptr + count <= &r->base[r->length] || !((&r->base[r->length] - ptr) & 0x3);
+}
+
+/*
+ * Buffer i was saved to tap. Any other buffer holding samples the save
+ * may have written over no longer matches the delay line; with the DMA
+ * rounding addresses down to 8 bytes that is anything within count + 8
+ * samples either way, around the end of the line too. Buffer i itself
+ * only does if the save loads back as it was.
+ */
+static void _fxSaved(ALFx *r, ALFxBuffers *b, s32 i, u32 tap, s32 count)
+{
+    s32 j, dist;
+
+    for (j = 0; j < FX_BUFFERS; j++) {
+        if (j == i || b->tap[j] == FX_NO_TAP)
+            continue;
+        dist = (s32)(b->tap[j] - tap);
+        if (dist < 0)
+            dist = -dist;
+        if (dist < count + 8 || (s32)r->length - dist < count + 8)
+            b->tap[j] = FX_NO_TAP;
+    }
+    b->tap[i] = _fxExact(r, tap, count) ? tap : FX_NO_TAP;
+}
+
+/*
+ * _loadBuffer(), less the buffer size it sets again afterwards when the
+ * load didn't wrap and the size is still count
+ */
+static Acmd *_fxLoadBuffer(ALFx *r, s16 *curr_ptr, s32 buff, s32 count, Acmd *p)
+{
+    Acmd    *ptr = p;
+    s32     after_end, before_end;
+    s16     *updated_ptr, *delay_end;
+
+#ifdef AUD_PROFILE
+    lastCnt[++cnt_index] = osGetCount();
+#endif
+
+    delay_end = &r->base[r->length];
+
+#ifdef _DEBUG
+    if(curr_ptr > delay_end)
+        __osError(ERR_ALMODDELAYOVERFLOW, 1, delay_end - curr_ptr);
+#endif
+
+    if (curr_ptr < r->base)
+	curr_ptr += r->length;
+    updated_ptr = curr_ptr + count;
+
+    if (updated_ptr > delay_end) {
+        after_end = updated_ptr - delay_end;
+        before_end = delay_end - curr_ptr;
+
+        aSetBuffer(ptr++, 0, buff, 0, before_end<<1);
+        aLoadBuffer(ptr++, osVirtualToPhysical(curr_ptr));
+        aSetBuffer(ptr++, 0, buff+(before_end<<1), 0, after_end<<1);
+        aLoadBuffer(ptr++, osVirtualToPhysical(r->base));
+        aSetBuffer(ptr++, 0, 0, 0, count<<1);
+    } else {
+        aSetBuffer(ptr++, 0, buff, 0, count<<1);
+        aLoadBuffer(ptr++, osVirtualToPhysical(curr_ptr));
+    }
+
+#ifdef AUD_PROFILE
+    PROFILE_AUD(load_num, load_cnt, load_max, load_min);
+#endif
+    return ptr;
+}
+
+/*
+ * _loadOutputBuffer() for a chorus section. The modulation for the pull
+ * comes out as a pitch the resampler takes, ratio/UNITY_PITCH, which the
+ * sample count is then worked out from in whole numbers. Both come out
+ * the same as _loadOutputBuffer()'s: it quantizes its float ratio to that
+ * pitch, and the counts are small enough for f32 to hold exactly.
+ */
+static Acmd *_fxChorusBuffer(ALFx *r, ALDelay *d, s32 buff, s32 incount, Acmd *p)
+{
+    Acmd        *ptr = p;
+    s32         ratio, count, rbuff = AL_TEMP_2;
+    s16         *out_ptr;
+    f32         fincount, delta;
+    s32         ramalign, length;
+
+    length = d->output - d->input;
+    delta = _doModFunc(d, incount);
+    delta /= length;
+    ratio = UNITY_PITCH - (s32)(delta * UNITY_PITCH);
+
+    fincount = d->rs->delta + (f32)(ratio * incount) / UNITY_PITCH;
+    count = (s32) fincount;
+    d->rs->delta = fincount - (f32)count;
+
+    out_ptr = &r->input[-(d->output - d->rsdelta)];
+    ramalign = ((s32)out_ptr & 0x7) >> 1;
+    ptr = _fxLoadBuffer(r, out_ptr - ramalign, rbuff, count + ramalign, ptr);
+
+    aSetBuffer(ptr++, 0, rbuff + (ramalign<<1), buff, incount<<1);
+    aResample(ptr++, d->rs->first, ratio, osVirtualToPhysical(d->rs->state));
+
+    d->rs->first = 0;
+    d->rsdelta += count - incount;
+
+    return ptr;
+}
+#endif /* AL_FX_FUSED */
+
 /*
  * Generate a triangle wave from -1 to 1, and find the current position
  * in the wave. (Rate of the wave is controlled by d->rsinc, which is chorus
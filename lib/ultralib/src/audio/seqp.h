@@ -35,3 +35,20 @@ void            __seqpStopOsc(ALSeqPlayer *seqp, ALVoiceState *vs);
 
 void		__postNextSeqEvent(ALSeqPlayer *seqp);			/* sct 11/7/95 */
 
+#ifdef AL_SEQP_SOUND_INDEX
+typedef struct {
+    ALInstrument        *instrument;
+    u8                  *table;         /* 0 if it didn't fit */
+} ALSoundIndexEntry;
+
+typedef struct ALSoundIndex_s {
+    ALBank              *bank;          /* the entries are for this bank    */
+    ALSoundIndexEntry   *entries;       /* instArray, then the percussion   */
+    s32                 count;
+    u8                  *base;
+    s32                 size;
+} ALSoundIndex;
+
+ALSoundIndex    *__soundIndexNew(ALHeap *hp, s32 size);
+#endif
+
@@ -78,6 +78,9 @@ void alSeqpNew(ALSeqPlayer *seqp, ALSeqpConfig *c)
     seqp->initOsc       = c->initOsc;
     seqp->updateOsc     = c->updateOsc;
     seqp->stopOsc       = c->stopOsc;
+#ifdef AL_SEQP_SOUND_INDEX
+    seqp->soundIndex    = __soundIndexNew(hp, c->soundIndexSize);
+#endif
     seqp->loopStart = 0;
     seqp->loopEnd   = 0;
     seqp->loopCount = 0;      /* -1 = loop forever, 0 = no loop   */
@@ -110,6 +113,9 @@ void alSeqpNew(ALSeqPlayer *seqp, ALSeqpConfig *c)
      */
     items = alHeapAlloc(hp, c->maxEvents, sizeof(ALEventListItem));
     alEvtqNew(&seqp->evtq, items, c->maxEvents);
+#ifdef AL_EVTQ_WHEEL
+    alEvtqNewWheel(&seqp->evtq, alHeapAlloc(hp, 1, sizeof(ALEvtqWheel)));
+#endif
 
     /*
      * add ourselves to the driver
@@ -310,6 +316,10 @@ ALMicroTime __seqpVoiceHandler(void *node)
 	      assert(seqp->state == AL_STOPPED);	/* Must be fully stopped to change banks. */
 
 	      seqp->bank = seqp->nextEvent.msg.spbank.bank;
+#ifdef AL_SEQP_SOUND_INDEX
+	      if (seqp->soundIndex)	/* the bank may have been reloaded in place */
+		  seqp->soundIndex->bank = 0;
+#endif
 	      __initFromBank(seqp, seqp->bank);
 	      break;
 
@@ -901,11 +911,20 @@ ALSound *__lookupSoundQuick(ALSeqPlayer *seqp, u8 key, u8 vel, u8 chan)
     s32 r = inst->soundCount;
     s32 i;
     ALKeyMap *keymap;
+#ifdef AL_SEQP_SOUND_INDEX
+    u8 *table = seqp->chanState[chan].soundTable;
+#endif
 #if BUILD_VERSION < VERSION_J
 #line 885
 #endif
     assert(inst != NULL);       /* sct 10/31/95 - If inst is NULL, then the seqp probably wasn't setup correctly. */
 
+#ifdef AL_SEQP_SOUND_INDEX
+    if (table && key < 128 && vel < 128) {
+        i = table[128 + table[vel] * 128 + key];
+        return (i ? inst->soundArray[i-1] : 0);
+    }
+#endif
     
     while (r >= l) {
         i = (l+r)/2;
@@ -926,6 +945,140 @@ ALSound *__lookupSoundQuick(ALSeqPlayer *seqp, u8 key, u8 vel, u8 chan)
     return 0;
 }
 
+#ifdef AL_SEQP_SOUND_INDEX
+/*
+ * The key/velocity index. For each instrument of the bank it holds the
+ * sound __lookupSoundQuick's search would find for every key and
+ * velocity, so a note on costs one table read:
+ *
+ *      table[vel]                      velocity band
+ *      table[128 + band * 128 + key]   sound array position + 1, or 0
+ *
+ * Bands split velocity at every keymap's velocityMin and velocityMax + 1.
+ * Within a band each comparison the search makes comes out the same, so
+ * one row of keys stands for the whole band. Instruments are indexed in
+ * bank order until the space given in ALSeqpConfig runs out; the rest,
+ * and any with more than 255 sounds, keep using the search.
+ */
+ALSoundIndex *__soundIndexNew(ALHeap *hp, s32 size)
+{
+    ALSoundIndex *index;
+
+    if (size <= 0)
+        return 0;
+
+    index = alHeapAlloc(hp, 1, sizeof(ALSoundIndex));
+    index->bank = 0;
+    index->entries = 0;
+    index->count = 0;
+    index->base = alHeapAlloc(hp, 1, size);
+    index->size = size;
+    return index;
+}
+
+/* __lookupSoundQuick's search, returning the position + 1 */
+static s32 __searchSound(ALInstrument *inst, u8 key, u8 vel)
+{
+    s32 l = 1;
+    s32 r = inst->soundCount;
+    s32 i;
+    ALKeyMap *keymap;
+
+    while (r >= l) {
+        i = (l+r)/2;
+
+        keymap = inst->soundArray[i-1]->keyMap;
+
+        if ((key >= keymap->keyMin) && (key <= keymap->keyMax) &&
+            (vel >= keymap->velocityMin) && (vel <= keymap->velocityMax)) {
+            return i;
+        } else if ((key < keymap->keyMin) ||
+                   ((vel < keymap->velocityMin) && (key <= keymap->keyMax))) {
+            r = i - 1;
+        } else {
+            l = i + 1;
+        }
+    }
+
+    return 0;
+}
+
+static u8 *__buildSoundTable(ALInstrument *inst, u8 *ptr, u8 *end)
+{
+    u8          split[128];
+    ALKeyMap    *keymap;
+    s32         bands = 0;
+    s32         i, key, vel;
+    u8          *row;
+
+    if (inst->soundCount > 255)
+        return 0;
+
+    for (vel = 0; vel < 128; vel++)
+        split[vel] = (vel == 0);
+    for (i = 0; i < inst->soundCount; i++) {
+        keymap = inst->soundArray[i]->keyMap;
+        if (keymap->velocityMin < 128)
+            split[keymap->velocityMin] = 1;
+        if (keymap->velocityMax < 127)
+            split[keymap->velocityMax + 1] = 1;
+    }
+    for (vel = 0; vel < 128; vel++)
+        bands += split[vel];
+
+    if (end - ptr < 128 + bands * 128)
+        return 0;
+
+    for (vel = 0; vel < 128; vel++) {
+        ptr[vel] = (vel == 0 ? 0 : ptr[vel - 1] + split[vel]);
+        if (split[vel]) {
+            row = ptr + 128 + ptr[vel] * 128;
+            for (key = 0; key < 128; key++)
+                row[key] = __searchSound(inst, key, vel);
+        }
+    }
+    return ptr;
+}
+
+static void __buildSoundIndex(ALSoundIndex *index, ALBank *b)
+{
+    u8                  *ptr = index->base;
+    u8                  *end = index->base + index->size;
+    ALInstrument        *inst;
+    s32                 i;
+
+    index->bank = b;
+    index->count = b->instCount + 1;
+    if ((u32)index->count * sizeof(ALSoundIndexEntry) > (u32)index->size) {
+        index->count = 0;
+        return;
+    }
+    index->entries = (ALSoundIndexEntry *)ptr;
+    ptr += index->count * sizeof(ALSoundIndexEntry);
+
+    for (i = 0; i < index->count; i++) {
+        inst = (i < b->instCount ? b->instArray[i] : b->percussion);
+        index->entries[i].instrument = inst;
+        index->entries[i].table = (inst ? __buildSoundTable(inst, ptr, end) : 0);
+        if (index->entries[i].table)
+            ptr += 128 + (index->entries[i].table[127] + 1) * 128;
+    }
+}
+
+static u8 *__soundTable(ALSoundIndex *index, ALInstrument *inst)
+{
+    s32 i;
+
+    if (index && inst) {
+        for (i = 0; i < index->count; i++) {
+            if (index->entries[i].instrument == inst)
+                return index->entries[i].table;
+        }
+    }
+    return 0;
+}
+#endif
+
 
 /*
  * __vsVol calculates the target volume for the voice based on the
@@ -988,6 +1141,7 @@ s32	seqpSetChannelMask(SEQP *seqp, u16 bitmask);
 
 #endif
 
+
 void __seqpReleaseVoice(ALSeqPlayer *seqp, ALVoice *voice,
                         ALMicroTime deltaTime)
 {
@@ -1011,6 +1165,9 @@ void __seqpReleaseVoice(ALSeqPlayer *seqp, ALVoice *voice,
 	    nextItem = (ALEventListItem *)nextNode;
 	    if (thisItem->evt.type == AL_SEQP_ENV_EVT) {
 		if(thisItem->evt.msg.vol.voice == voice) {
+#ifdef AL_EVTQ_WHEEL
+		    __alEvtqUnlink(&seqp->evtq, thisItem);
+#endif
 		    if( nextItem )
 			nextItem->delta += thisItem->delta;
 		    alUnlink(thisNode);
@@ -1077,6 +1234,9 @@ char __voiceNeedsNoteKill (ALSeqPlayer *seqp, ALVoice *voice, ALMicroTime killTi
 	    {
 		if (itemTime > killTime)
 		{
+#ifdef AL_EVTQ_WHEEL
+		    __alEvtqUnlink(&seqp->evtq, thisItem);
+#endif
 		    if ((ALEventListItem *)nextNode)
 			((ALEventListItem *)nextNode)->delta += thisItem->delta;
 		    alUnlink(thisNode);
@@ -1116,6 +1276,11 @@ void __initFromBank(ALSeqPlayer *seqp, ALBank *b)
     /* set to the first available instrument. */
     for(i = 0; !inst ; i++)
       inst = b->instArray[i];
+
+#ifdef AL_SEQP_SOUND_INDEX
+    if (seqp->soundIndex && seqp->soundIndex->bank != b)
+      __buildSoundIndex(seqp->soundIndex, b);
+#endif
     
     /* sct 11/6/95 - Setup the channel state for the given instrument. */
     /* There is some wasted effort here since both calls the same state vars */
@@ -1140,6 +1305,9 @@ void __initFromBank(ALSeqPlayer *seqp, ALBank *b)
 void __setInstChanState(ALSeqPlayer *seqp, ALInstrument *inst, s32 chan)
 {
     seqp->chanState[chan].instrument = inst;
+#ifdef AL_SEQP_SOUND_INDEX
+    seqp->chanState[chan].soundTable = __soundTable(seqp->soundIndex, inst);
+#endif
     seqp->chanState[chan].pan = inst->pan;
     seqp->chanState[chan].vol = inst->volume;
     seqp->chanState[chan].priority = inst->priority;
@@ -1174,6 +1342,9 @@ void __initChanState(ALSeqPlayer *seqp)
     for (i = 0; i < seqp->maxChannels; i++)
     {
         seqp->chanState[i].instrument = 0;
+#ifdef AL_SEQP_SOUND_INDEX
+        seqp->chanState[i].soundTable = 0;
+#endif
 	__resetPerfChanState (seqp, i);
     }
 }
@@ -1194,6 +1365,9 @@ void __seqpStopOsc(ALSeqPlayer *seqp, ALVoiceState *vs)
             if(thisNode->evt.msg.osc.vs == vs)
             {
                 (*seqp->stopOsc)(thisNode->evt.msg.osc.oscState);
+#ifdef AL_EVTQ_WHEEL
+                __alEvtqUnlink(&seqp->evtq, thisNode);
+#endif
                 alUnlink((ALLink*)thisNode);
                 if(nextNode)
                     nextNode->delta += thisNode->delta;
@@ -49,6 +49,9 @@ void alSndpNew(ALSndPlayer *sndp, ALSndpConfig *c)
      */
     ptr = alHeapAlloc(c->heap, 1, c->maxEvents * sizeof(ALEventListItem));
     alEvtqNew(&sndp->evtq, (ALEventListItem *)ptr, c->maxEvents);
+#ifdef AL_EVTQ_WHEEL
+    alEvtqNewWheel(&sndp->evtq, alHeapAlloc(c->heap, 1, sizeof(ALEvtqWheel)));
+#endif
     
     /*
      * add ourselves to the driver
@@ -250,6 +253,9 @@ static void _removeEvents(ALEventQueue *evtq, ALSoundState *state)
         nextItem = (ALEventListItem *)nextNode;
         thisEvent = (ALSndpEvent *) &thisItem->evt;
         if (thisEvent->common.state == state){
+#ifdef AL_EVTQ_WHEEL
+            __alEvtqUnlink(evtq, thisItem);
+#endif
             if( nextItem )
                 nextItem->delta += thisItem->delta;
             alUnlink(thisNode);
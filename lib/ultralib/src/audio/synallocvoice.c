@@ -91,6 +91,10 @@ s32 alSynAllocVoice(ALSynth *drvr, ALVoice *voice, ALVoiceConfig *vc)
             
         pvoice->vvoice = voice;     /* assign new voice  */
         voice->pvoice  = pvoice;
+#ifdef AL_SYN_STEAL_HEAP
+        if (!stolen)                /* a stolen voice can't be stolen again */
+            __pvoiceHeapInsert(drvr, pvoice);
+#endif
 
     }
     
@@ -100,7 +104,9 @@ s32 alSynAllocVoice(ALSynth *drvr, ALVoice *voice, ALVoiceConfig *vc)
 s32 _allocatePVoice(ALSynth *drvr, PVoice **pvoice, s16 priority)
 {
     ALLink      *dl;
+#ifndef AL_SYN_STEAL_HEAP
     PVoice      *pv;
+#endif
     s32         stolen = 0;
     
     if ((dl = drvr->pLameList.next) != 0) { /* check the lame list first */
@@ -112,6 +118,14 @@ s32 _allocatePVoice(ALSynth *drvr, PVoice **pvoice, s16 priority)
         alUnlink(dl);
         alLink(dl, &drvr->pAllocList);        
     } else { /* steal one */
+#ifdef AL_SYN_STEAL_HEAP
+        /* the top is the oldest of the lowest priority, as the scan finds */
+        if (drvr->stealCount > 0 && drvr->stealHeap[0]->vvoice->priority <= priority) {
+            *pvoice = drvr->stealHeap[0];
+            __pvoiceHeapRemove(drvr, *pvoice);
+            stolen = 1;
+        }
+#else
         for (dl = drvr->pAllocList.next; dl != 0; dl = dl->next) {
             pv = (PVoice *)dl;
 
@@ -125,8 +139,100 @@ s32 _allocatePVoice(ALSynth *drvr, PVoice **pvoice, s16 priority)
                 stolen = 1;
             }
         }
+#endif
     }
+
+#ifdef AL_SYN_STEAL_HEAP
+    if (*pvoice)
+        drvr->voiceAllocs++;
+    else
+        drvr->voiceFails++;
+    drvr->voiceSteals += stolen;
+#endif
     
     return stolen;
 }
 
+#ifdef AL_SYN_STEAL_HEAP
+static s32 __pvoiceBefore(PVoice *a, PVoice *b)
+{
+    if (a->vvoice->priority != b->vvoice->priority)
+        return (a->vvoice->priority < b->vvoice->priority);
+    return ((s32)(a->stealOrder - b->stealOrder) < 0);
+}
+
+static void __pvoiceSift(ALSynth *drvr, PVoice *pv, s32 i)
+{
+    PVoice      **heap = drvr->stealHeap;
+    s32         child;
+
+    while (i > 0 && __pvoiceBefore(pv, heap[(i - 1) >> 1])) {
+        heap[i] = heap[(i - 1) >> 1];
+        heap[i]->stealIndex = i;
+        i = (i - 1) >> 1;
+    }
+    while ((child = 2 * i + 1) < drvr->stealCount) {
+        if (child + 1 < drvr->stealCount && __pvoiceBefore(heap[child + 1], heap[child]))
+            child++;
+        if (!__pvoiceBefore(heap[child], pv))
+            break;
+        heap[i] = heap[child];
+        heap[i]->stealIndex = i;
+        i = child;
+    }
+    heap[i] = pv;
+    pv->stealIndex = i;
+}
+
+void __pvoiceHeapInsert(ALSynth *drvr, PVoice *pvoice)
+{
+    pvoice->stealOrder = drvr->stealOrder++;
+    __pvoiceSift(drvr, pvoice, drvr->stealCount++);
+}
+
+void __pvoiceHeapRemove(ALSynth *drvr, PVoice *pvoice)
+{
+    s32         i = pvoice->stealIndex;
+    PVoice      *last;
+
+    if (i < 0)
+        return;
+
+    pvoice->stealIndex = -1;
+    last = drvr->stealHeap[--drvr->stealCount];
+    if (last != pvoice)
+        __pvoiceSift(drvr, last, i);
+}
+
+/* After the voice's priority changed */
+void __pvoiceHeapUpdate(ALSynth *drvr, PVoice *pvoice)
+{
+    if (pvoice->stealIndex >= 0)
+        __pvoiceSift(drvr, pvoice, pvoice->stealIndex);
+}
+
+void alSynGetVoiceStats(ALSynth *drvr, ALSynVoiceStats *stats)
+{
+    ALLink      *dl;
+    PVoice      *pv;
+    s32         priority;
+    s32         i;
+
+    stats->allocs = drvr->voiceAllocs;
+    stats->steals = drvr->voiceSteals;
+    stats->fails  = drvr->voiceFails;
+
+    for (i = 0; i < AL_SYN_PRIORITY_LEVELS; i++)
+        stats->occupancy[i] = 0;
+    for (dl = drvr->pAllocList.next; dl != 0; dl = dl->next) {
+        pv = (PVoice *)dl;
+        priority = (pv->vvoice ? pv->vvoice->priority : 0);
+        if (priority < 0)
+            priority = 0;
+        else if (priority >= AL_SYN_PRIORITY_LEVELS)
+            priority = AL_SYN_PRIORITY_LEVELS - 1;
+        stats->occupancy[priority]++;
+    }
+}
+#endif
+
@@ -19,9 +19,16 @@
  *====================================================================*/
 
 #include <libaudio.h>
+#ifdef AL_SYN_STEAL_HEAP
+#include "synthInternals.h"
+#endif
 
 void alSynSetPriority(ALSynth *s, ALVoice *voice, s16 priority)
 {
     voice->priority = priority;
+#ifdef AL_SYN_STEAL_HEAP
+    if (voice->pvoice)
+        __pvoiceHeapUpdate(s, voice->pvoice);
+#endif
 }
 
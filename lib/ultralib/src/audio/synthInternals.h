@@ -150,7 +150,7 @@ void    alFilterNew(ALFilter *f, ALCmdHandler h, ALSetParam s, s32 type);
 #define AL_MAX_ADPCM_STATES     3       /* Depends on number of subframes
                                          * per frame and loop length
                                          */
-typedef struct {
+typedef struct ALLoadFilter_s {
     ALFilter                    filter;
     ADPCM_STATE                 *state;
     ADPCM_STATE                 *lstate;
@@ -163,6 +163,11 @@ typedef struct {
     s32                         lastsam;
     s32                         first;
     s32                         memin; 
+#ifdef AL_ADPCM_SHARE
+    struct ALLoadFilter_s       *twin;  /* state copied from twin's... */
+    u32                         twinGen;/* ...when its gen was this */
+    u32                         gen;    /* bumped each time state is written */
+#endif
 } ALLoadFilter;
 
 void    alLoadNew(ALLoadFilter *f, ALDMANew dma, ALHeap *hp);
@@ -170,6 +175,37 @@ Acmd    *alAdpcmPull(void *f, s16 *outp, s32 byteCount, s32 sampleOffset, Acmd *
 Acmd    *alRaw16Pull(void *f, s16 *outp, s32 byteCount, s32 sampleOffset, Acmd *p);
 s32     alLoadParam(void *filter, s32 paramID, void *param);
 
+#ifdef AL_ADPCM_SHARE
+#define AL_SHARE_FETCHES        8       /* fetches remembered per slice */
+
+typedef struct {
+    s32                         memin;
+    s32                         len;
+    s32                         dramLoc;        /* what the DMA callback gave */
+} ALShareFetch;
+
+/*
+ * The synthesizer's record of the last alAdpcmPull, for the next voice to
+ * share, and of the slice's fetches. time is the drvr->curSamples they
+ * were made at; last is 0 once something else has written the decoder's
+ * part of DMEM.
+ */
+typedef struct ALLoadShare_s {
+    s32                 time;
+    ALLoadFilter        *last;
+    ALLoadFilter        before;         /* last as it was before the pull */
+    ALLoadFilter        after;          /* and after */
+    s32                 outCount;
+    s16                 outp;           /* *outp it was pulled with */
+    s16                 outpAfter;      /* and where it left it */
+    s32                 fetched;        /* bytes the pull read */
+    s32                 nfetch;
+    s32                 next;           /* fetch[] slot to fill next */
+    ALShareFetch        fetch[AL_SHARE_FETCHES];
+    ALSynLoadStats      stats;
+} ALLoadShare;
+#endif
+
 typedef struct ALResampler_s {
     ALFilter            filter;
     RESAMPLE_STATE      *state;
@@ -292,6 +328,12 @@ Acmd    *alEnvmixerPull(void *f, s16 *outp, s32 out, s32 sampleOffset, Acmd *p);
 s32     alEnvmixerParam(void *filter, s32 paramID, void *param);
 
 
+#ifdef AL_PROFILE
+void    __alProfileBegin(void);
+void    __alProfileEnd(s32 id);
+void    __alProfileCount(s32 id);
+#endif
+
 /*
  * heap stuff
  */
@@ -301,7 +343,11 @@ typedef struct {
     u8          *file;  /* file that this alloc was called from         */
     s32         line;   /* line that it was called from                 */
     s32         count;  /* heap call number                             */
+#ifdef AL_HEAP_MARK
+    s32         request;/* bytes asked for, for alHeapReport            */
+#else
     s32         pad0;
+#endif
     s32         pad1;
     s32         pad2;   /* Make it 32 bytes                             */
 } HeapInfo;
@@ -320,6 +366,10 @@ typedef struct PVoice_s {
     ALResampler         resampler;
     ALEnvMixer		envmixer;
     s32                 offset;
+#ifdef AL_SYN_STEAL_HEAP
+    s32                 stealIndex;     /* in drvr->stealHeap, or -1 */
+    u32                 stealOrder;
+#endif
 } PVoice;
 
 /*
@@ -329,6 +379,11 @@ ALParam         *__allocParam(void);
 void            __freeParam(ALParam *param);
 void            _freePVoice(ALSynth *drvr, PVoice *pvoice);
 void            _collectPVoices(ALSynth *drvr);
+#ifdef AL_SYN_STEAL_HEAP
+void            __pvoiceHeapInsert(ALSynth *drvr, PVoice *pvoice);
+void            __pvoiceHeapRemove(ALSynth *drvr, PVoice *pvoice);
+void            __pvoiceHeapUpdate(ALSynth *drvr, PVoice *pvoice);
+#endif
 
 s32             _timeToSamples(ALSynth *ALSynth, s32 micros);
 ALMicroTime     _samplesToTime(ALSynth *synth, s32 samples);
@@ -27,6 +27,15 @@ extern u32 cnt_index, drvr_num, drvr_cnt, drvr_max, drvr_min, lastCnt[];
 extern u32 client_num, client_cnt, client_max, client_min;
 #endif
 
+#if defined(AL_PROFILE) || defined(AL_ADPCM_SHARE)
+#include <os.h>
+#endif
+
+#ifdef AL_PROFILE
+static void __alProfileStartFrame(ALProfile *p);
+static void __alProfileEndFrame(ALProfile *p, s32 cmds);
+#endif
+
 #ifndef MIN
 #   define MIN(a,b) (((a)<(b))?(a):(b))
 #endif
@@ -100,10 +109,29 @@ void alSynNew(ALSynth *drvr, ALSynConfig *c)
     drvr->pAllocList.prev = 0;
 
     pvoices = alHeapAlloc(hp, c->maxPVoices, sizeof(PVoice));
+#ifdef AL_SYN_STEAL_HEAP
+    drvr->stealHeap = alHeapAlloc(hp, c->maxPVoices, sizeof(PVoice *));
+    drvr->stealCount = 0;
+    drvr->stealOrder = 0;
+    drvr->voiceAllocs = 0;
+    drvr->voiceSteals = 0;
+    drvr->voiceFails = 0;
+#endif
+#ifdef AL_PROFILE
+    drvr->profile = 0;
+#endif
+#ifdef AL_ADPCM_SHARE
+    drvr->loadShare = alHeapAlloc(hp, 1, sizeof(ALLoadShare));
+    bzero(drvr->loadShare, sizeof(ALLoadShare));
+    drvr->loadShare->time = -1;
+#endif
     for (i = 0; i < c->maxPVoices; i++) {
         pv = &pvoices[i];
         alLink((ALLink *)pv, &drvr->pFreeList);
         pv->vvoice = 0;
+#ifdef AL_SYN_STEAL_HEAP
+        pv->stealIndex = -1;
+#endif
 
         alLoadNew(&pv->decoder, drvr->dma, hp);
         alLoadParam(&pv->decoder, AL_FILTER_SET_SOURCE, 0);
@@ -160,6 +188,11 @@ Acmd *alAudioFrame(Acmd *cmdList, s32 *cmdLen, s16 *outBuf, s32 outLen)
         return cmdList;         /* nothing to do */
     }    
 
+#ifdef AL_PROFILE
+    if (drvr->profile)
+        __alProfileStartFrame(drvr->profile);
+#endif
+
     /*
      * run down list of clients and execute callback if needed this
      * subframe. Here we do all the work for the frame at the
@@ -170,6 +203,9 @@ Acmd *alAudioFrame(Acmd *cmdList, s32 *cmdLen, s16 *outBuf, s32 outLen)
 #ifdef AUD_PROFILE
     lastCnt[++cnt_index] = osGetCount();
 #endif
+#ifdef AL_PROFILE
+    __alProfileBegin();
+#endif
 
     /*
      * paramSamples = time of next parameter change.
@@ -200,6 +236,9 @@ Acmd *alAudioFrame(Acmd *cmdList, s32 *cmdLen, s16 *outBuf, s32 outLen)
 #ifdef AUD_PROFILE
     PROFILE_AUD(client_num, client_cnt, client_max, client_min);
 #endif
+#ifdef AL_PROFILE
+    __alProfileEnd(AL_PROF_CLIENT);
+#endif
 
     /*
      * Now build the command list in small chunks
@@ -227,6 +266,10 @@ Acmd *alAudioFrame(Acmd *cmdList, s32 *cmdLen, s16 *outBuf, s32 outLen)
 
     _collectPVoices(drvr); /* collect free physical voices */
     
+#ifdef AL_PROFILE
+    if (drvr->profile)
+        __alProfileEndFrame(drvr->profile, *cmdLen);
+#endif
 #ifdef AUD_PROFILE
     PROFILE_AUD(drvr_num, drvr_cnt, drvr_max, drvr_min);
 #endif
@@ -277,6 +320,9 @@ void _freePVoice(ALSynth *drvr, PVoice *pvoice)
     /*
      * move the voice from the allocated list to the lame list
      */
+#ifdef AL_SYN_STEAL_HEAP
+    __pvoiceHeapRemove(drvr, pvoice);
+#endif
     alUnlink((ALLink *)pvoice);
     alLink((ALLink *)pvoice, &drvr->pLameList);
 }
@@ -319,5 +365,149 @@ static s32 __nextSampleTime(ALSynth *drvr, ALPlayer **client)
     return (*client)->samplesLeft;
 }
 
+#ifdef AL_PROFILE
+/***********************************************************************
+ * Audio frame profiler
+ ***********************************************************************/
+static const char *__alProfileNames[AL_PROF_COUNT] = {
+    "clients", "params", "load", "resample", "envmixer", "fx", "synth",
+    "frame", "acmds", "dmas"
+};
+
+void alProfileInit(ALProfile *p, u32 budget)
+{
+    bzero(p, sizeof(ALProfile));
+    p->budget = budget;
+}
+
+/*
+ * Takes effect from the next alAudioFrame; call it between frames, not
+ * from a client handler.
+ */
+void alSynSetProfile(ALSynth *s, ALProfile *p)
+{
+    s->profile = p;
+}
+
+/*
+ * The minimum, mean and maximum of each of a frame's AL_PROF_* values
+ * over the last AL_PROFILE_FRAMES frames
+ */
+void alProfileGetStats(ALProfile *p, ALProfileStat *stats)
+{
+    s32         n = MIN(p->frames, AL_PROFILE_FRAMES);
+    s32         i, j;
+    u32         v, sum;
+
+    for (i = 0; i < AL_PROF_COUNT; i++) {
+        stats[i].min = 0;
+        stats[i].max = 0;
+        sum = 0;
+        for (j = 0; j < n; j++) {
+            v = p->history[j].value[i];
+            if (j == 0 || v < stats[i].min)
+                stats[i].min = v;
+            if (v > stats[i].max)
+                stats[i].max = v;
+            sum += v;
+        }
+        stats[i].avg = n ? sum / n : 0;
+    }
+}
+
+/*
+ * Prints the statistics to the debug console, times in microseconds,
+ * alongside the last frame that went over budget
+ */
+void alProfileDump(ALProfile *p)
+{
+    ALProfileStat       stats[AL_PROF_COUNT];
+    s32                 i;
+
+    alProfileGetStats(p, stats);
+
+    osSyncPrintf("audio profile: %u frames, %u over a budget of %uus\n",
+                 p->frames, p->overruns, (u32)OS_CYCLES_TO_USEC(p->budget));
+    osSyncPrintf("%-9s %7s %7s %7s %7s\n", "", "min", "avg", "max", "overrun");
+    for (i = 0; i < AL_PROF_COUNT; i++) {
+        if (i < AL_PROF_CMDS)
+            osSyncPrintf("%-9s %7u %7u %7u %7u\n", __alProfileNames[i],
+                         (u32)OS_CYCLES_TO_USEC(stats[i].min),
+                         (u32)OS_CYCLES_TO_USEC(stats[i].avg),
+                         (u32)OS_CYCLES_TO_USEC(stats[i].max),
+                         (u32)OS_CYCLES_TO_USEC(p->overrun.value[i]));
+        else
+            osSyncPrintf("%-9s %7u %7u %7u %7u\n", __alProfileNames[i],
+                         stats[i].min, stats[i].avg, stats[i].max,
+                         p->overrun.value[i]);
+    }
+}
+
+static void __alProfileStartFrame(ALProfile *p)
+{
+    bzero(&p->frame, sizeof(ALProfileFrame));
+    p->depth = 0;
+    __alProfileBegin();         /* AL_PROF_SYNTH */
+}
+
+static void __alProfileEndFrame(ALProfile *p, s32 cmds)
+{
+    ALProfileFrame      *f = &p->frame;
+    s32                 i;
 
+    __alProfileEnd(AL_PROF_SYNTH);
+
+    f->value[AL_PROF_FRAME] = 0;
+    for (i = 0; i < AL_PROF_FRAME; i++)
+        f->value[AL_PROF_FRAME] += f->value[i];
+    f->value[AL_PROF_CMDS] = cmds;
+
+    p->history[p->frames % AL_PROFILE_FRAMES] = *f;
+    p->frames++;
+    if (p->budget && f->value[AL_PROF_FRAME] > p->budget) {
+        p->overrun = *f;
+        p->overruns++;
+    }
+}
 
+/*
+ * A timed section starts. Each takes the counts since its start less
+ * those of the sections nested in it; past AL_PROFILE_DEPTH deep, a
+ * section's counts go to the one it is in.
+ */
+void __alProfileBegin(void)
+{
+    ALProfile   *p = alGlobals->drvr.profile;
+
+    if (p == 0)
+        return;
+    if (p->depth < AL_PROFILE_DEPTH) {
+        p->stack[p->depth].start = osGetCount();
+        p->stack[p->depth].children = 0;
+    }
+    p->depth++;
+}
+
+void __alProfileEnd(s32 id)
+{
+    ALProfile   *p = alGlobals->drvr.profile;
+    u32         elapsed;
+
+    if (p == 0 || p->depth == 0)
+        return;
+    if (--p->depth < AL_PROFILE_DEPTH) {
+        elapsed = osGetCount() - p->stack[p->depth].start;
+        p->frame.value[id] += elapsed - p->stack[p->depth].children;
+        if (p->depth > 0)
+            p->stack[p->depth - 1].children += elapsed;
+    }
+}
+
+void __alProfileCount(s32 id)
+{
+    ALProfile   *p = alGlobals->drvr.profile;
+
+    if (p)
+        p->frame.value[id]++;
+}
+#endif
@@ -569,6 +569,51 @@ stuffDisplayList(glistp, im, tbuf, startTile, pal, cms, cmt, masks, maskt, shift
 return errNo;
 } /* end guLoadTextureBlockMipMap */
 
+#ifdef GU_MIPMAP_BAKED
+/*************************************************************************
+ * Loads a mipmap tools/mipbake built ahead of time: the statics are set *
+ * as the generation above would have left them, and the display list   *
+ * is stuffed from them, loading from the baked texels.                 *
+ *************************************************************************
+ * Returns what guLoadTextureBlockMipMap would have, or 2 if mm is not  *
+ * a baked mipmap.                                                      *
+ ************************************************************************/
+
+int guLoadTextureBlockMipMapBaked(Gfx **glistp, GuMipMapBaked *mm,
+ unsigned char startTile, unsigned char pal, unsigned char cms, unsigned char cmt, 
+ unsigned char masks, unsigned char maskt, unsigned char shifts, unsigned char shiftt)
+{
+	Image	im;
+	int	i;
+
+	if (mm->magic != GU_MIPMAP_MAGIC || mm->siz > G_IM_SIZ_32b || mm->level > MM_MAX_LEVEL)
+	{
+		errNo = 2;
+		return errNo;
+	}
+
+	im.fmt = mm->fmt;
+	im.siz = mm->siz;
+	txlsize = sizeParams[im.siz].tsize;
+	length = mm->length;
+	level = mm->level;
+
+	for (i = 0; i <= level; i++)
+	{
+		mipmap[i].w = mm->tile[i].w;
+		mipmap[i].s = mm->tile[i].s;
+		mipmap[i].t = mm->tile[i].t;
+		mipmap[i].addr = mm->tile[i].addr;
+	}
+
+	if (mm->err) errNo = mm->err;
+
+	stuffDisplayList(glistp, &im, (char *)(mm + 1), startTile, pal, cms, cmt, masks, maskt, shifts, shiftt);
+
+	return errNo;
+}
+#endif
+
 /******************************************************************************
  * 
  * Apply Kernel :
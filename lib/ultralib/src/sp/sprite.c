@@ -79,6 +79,199 @@ spScissor (s32 xmin, s32 xmax, s32 ymin, s32 ymax )
 
 static int *prev_bmbuf = NULL;
 
+#ifdef SP_BATCH
+/*
+ * While spBatchFlush draws, spDraw writes to sp_batch_gl rather than the
+ * sprite's list and leaves out what the sprite before it already set, and
+ * drawbitmap only loads what TMEM doesn't already hold.
+ */
+typedef struct {
+    Sprite	*sp;
+    s32		layer;
+} SpBatchEntry;
+
+/* What TMEM was last loaded with, as drawbitmap would load it */
+typedef struct {
+    int		*buf;
+    s16		fmt, siz;
+    s16		width, height;
+    s16		shuf, lutoffset;
+    s16		s, t, w, h;		/* G_IM_SIZ_DD's tile */
+} SpBatchTex;
+
+#define SP_BS_ZDEPTH	0
+#define SP_BS_PRIM	1
+#define SP_BS_COMBINE	2
+#define SP_BS_TLUT	3
+#define SP_BS_CYCLE	4
+#define SP_BS_COUNT	5
+
+static SpBatchEntry	sp_batch[SP_BATCH_MAX];
+static s32		sp_batch_count = 0;
+static SpBatchStats	sp_batch_stats;
+
+static s32		sp_batching = 0;
+static Gfx		*sp_batch_gl;
+static s32		sp_batch_sync;	/* a rectangle has gone out unsynced */
+static u32		sp_batch_known;	/* which of sp_batch_state are set */
+static u32		sp_batch_state[SP_BS_COUNT];
+
+static s32		sp_batch_tex_valid;
+static SpBatchTex	sp_batch_tex;
+static s32		sp_batch_tlut_valid;
+static int		*sp_batch_tlut;
+static s16		sp_batch_tlut_n, sp_batch_tlut_start;
+
+/*
+ * batchset()
+ *
+ *   Whether state "which" is already "value" in a flush; if it isn't, it
+ *   will be once the caller has sent the command.
+ */
+static s32
+batchset( s32 which, u32 value )
+{
+    if( !sp_batching )
+	return 0;
+
+    if( (sp_batch_known & (1 << which)) && sp_batch_state[which] == value ) {
+	sp_batch_stats.statesSkipped++;
+	return 1;
+    }
+    sp_batch_known |= 1 << which;
+    sp_batch_state[which] = value;
+    sp_batch_stats.states++;
+    return 0;
+}
+
+static void
+batchknow( s32 which, u32 value )
+{
+    sp_batch_known |= 1 << which;
+    sp_batch_state[which] = value;
+}
+
+static void
+batchforget( s32 which )
+{
+    sp_batch_known &= ~(1 << which);
+}
+
+/*
+ * batchsync()
+ *
+ *   Sends the pipe sync the last rectangle went without, before something
+ *   that needs it.
+ */
+static void
+batchsync( Gfx **glp )
+{
+    Gfx *gl;
+
+    if( sp_batching && sp_batch_sync ) {
+	gl = *glp;
+	gDPPipeSync( gl++ );
+	*glp = gl;
+	sp_batch_sync = 0;
+    }
+}
+
+/*
+ * batchsyncbefore()
+ *
+ *   Puts that sync in front of what has been sent since mark, if anything
+ *   has; what spDraw sets up for a sprite is sent without looking.
+ */
+static void
+batchsyncbefore( Gfx *mark, Gfx **glp )
+{
+    Gfx *gl;
+
+    if( !sp_batching || !sp_batch_sync || *glp == mark )
+	return;
+
+    for( gl = *glp; gl > mark; gl-- )
+	*gl = *(gl - 1);
+    gDPPipeSync( mark );
+    *glp += 1;
+    sp_batch_sync = 0;
+}
+
+/*
+ * batchresident()
+ *
+ *   Whether TMEM already holds the texture drawbitmap would load for b; if
+ *   it doesn't, it will once drawbitmap has loaded it.
+ */
+static s32
+batchresident( Sprite *s, Bitmap *b )
+{
+    SpBatchTex t, *r;
+
+    t.buf = b->buf;
+    t.fmt = s->bmfmt;
+    t.siz = s->bmsiz;
+    t.width = b->width_img;
+    t.height = s->bmHreal;
+    t.shuf = (s->attr & SP_TEXSHUF) != 0;
+    t.lutoffset = b->LUToffset;
+    if( s->bmsiz == G_IM_SIZ_DD ) {
+	t.s = b->s;
+	t.t = b->t;
+	t.w = b->width;
+	t.h = b->actualHeight;
+    } else {
+	t.s = t.t = t.w = t.h = 0;
+    }
+
+    r = &sp_batch_tex;
+    if( sp_batch_tex_valid && r->buf == t.buf && r->fmt == t.fmt &&
+	r->siz == t.siz && r->width == t.width && r->height == t.height &&
+	r->shuf == t.shuf && r->lutoffset == t.lutoffset &&
+	r->s == t.s && r->t == t.t && r->w == t.w && r->h == t.h ) {
+	sp_batch_stats.loadsSkipped++;
+	return 1;
+    }
+
+    *r = t;
+    sp_batch_tex_valid = 1;
+    sp_batch_stats.loads++;
+
+    /* Only a CI texture is sure to stay below the TLUT */
+    if( t.fmt != G_IM_FMT_CI )
+	sp_batch_tlut_valid = 0;
+    return 0;
+}
+
+/*
+ * batchtlut()
+ *
+ *   The same for the sprite's TLUT.
+ */
+static s32
+batchtlut( Sprite *s )
+{
+    if( !sp_batching )
+	return 0;
+
+    if( sp_batch_tlut_valid && sp_batch_tlut == s->LUT &&
+	sp_batch_tlut_n == s->nTLUT && sp_batch_tlut_start == s->startTLUT ) {
+	sp_batch_stats.tlutsSkipped++;
+	return 1;
+    }
+
+    sp_batch_tlut = s->LUT;
+    sp_batch_tlut_n = s->nTLUT;
+    sp_batch_tlut_start = s->startTLUT;
+    sp_batch_tlut_valid = 1;
+    sp_batch_stats.tluts++;
+
+    if( sp_batch_tex.fmt != G_IM_FMT_CI )
+	sp_batch_tex_valid = 0;
+    return 0;
+}
+#endif /* SP_BATCH */
+
 /*
  * drawbitmap()
  *
@@ -182,7 +375,12 @@ drawbitmap (Gfx **glp, Sprite *s, Bitmap *b,
 #define LOAD_TEX
 
 #ifdef LOAD_TEX
+#ifdef SP_BATCH
+    if( sp_batching ? !batchresident(s, b) : b->buf != prev_bmbuf ) {
+	batchsync( &gl );
+#else
     if( b->buf != prev_bmbuf ) {
+#endif
 	switch(s->bmsiz) 
 	  {
 #if BUILD_VERSION >= VERSION_J
@@ -354,6 +552,15 @@ drawbitmap (Gfx **glp, Sprite *s, Bitmap *b,
 
     gSPTextureRectangle(gl++,g->xh,g->yh,g->xl,g->yl,g->tile,g->s,g->t,g->dsdx,g->dtdy);
 
+#ifdef SP_BATCH
+    if( sp_batching ) {
+	/* Only sent once something that needs it comes */
+	if( sp_batch_sync )
+	    sp_batch_stats.syncsSkipped++;
+	sp_batch_sync = 1;
+	sp_batch_stats.rects++;
+    } else
+#endif
     gDPPipeSync(gl++);
 
     *glp = gl;
@@ -373,6 +580,14 @@ spInit( Gfx **glistp )
 #endif
     sp_attr = 0;
 
+#ifdef SP_BATCH
+    {
+	static SpBatchStats nostats;
+
+	sp_batch_stats = nostats;
+    }
+#endif
+
     scissor_xmin = 0;
     scissor_ymin = 0;
 
@@ -427,6 +642,9 @@ spDraw ( Sprite   *s )
     float	ftx, fty;
     s32		fs, ft;
     s32		ex, ey;
+#ifdef SP_BATCH
+    u32		cycle;
+#endif
 
 #ifdef rmDEBUG
     rmonPrintf("spDraw (Sprite 0x%08x )\n", s );
@@ -435,11 +653,19 @@ spDraw ( Sprite   *s )
     if (s->attr & SP_HIDDEN)
 	return(NULL);
 
+#ifdef SP_BATCH
+    if( sp_batching ) {
+	gl = sp_batch_gl;
+    } else {
+#endif
     prev_bmbuf = NULL;
 
     gl = s->rsp_dl_next;
     if( gl == NULL )
 	gl = s->rsp_dl;
+#ifdef SP_BATCH
+    }
+#endif
     dl_start = gl;
 
 #ifndef NDEBUG
@@ -484,12 +710,24 @@ spDraw ( Sprite   *s )
     sp_attr = s->attr;
 
     if( sp_attr & SP_Z ) {
+#ifdef SP_BATCH
+	if( !batchset(SP_BS_ZDEPTH, (u16)s->zdepth) )
+#endif
 	gDPSetPrimDepth(gl++, s->zdepth, 0);
     };
 
 
+#ifdef SP_BATCH
+    if( !batchset(SP_BS_PRIM, ((u32)s->red << 24) | (s->green << 16) |
+				(s->blue << 8) | s->alpha) )
+#endif
     gDPSetPrimColor( gl++, 0, 0, s->red, s->green, s->blue, s->alpha);
 
+#ifdef SP_BATCH
+    /* Which of the three combine modes below */
+    if( !batchset(SP_BS_COMBINE, s->alpha == 255 ? 0 :
+		  (s->bmfmt == G_IM_FMT_IA || s->bmfmt == G_IM_FMT_I) ? 1 : 2) ) {
+#endif
     if (s->bmfmt == G_IM_FMT_IA || s->bmfmt == G_IM_FMT_I) {
 	if( s->alpha == 255 ) {
 	    gDPSetCombineMode ( gl++, 
@@ -511,14 +749,43 @@ spDraw ( Sprite   *s )
 			       G_CC_MODULATERGBA_PRIM);
 	};
     }
+#ifdef SP_BATCH
+    }
+#endif
 
 
     if( s->bmfmt == G_IM_FMT_CI ) {
+#ifdef SP_BATCH
+	if( !batchset(SP_BS_TLUT, G_TT_RGBA16) )
+#endif
 	gDPSetTextureLUT( gl++, G_TT_RGBA16);
+#ifdef SP_BATCH
+	if( !batchtlut(s) ) {
+#endif
 	gDPLoadTLUT( gl++, s->nTLUT, 256+s->startTLUT, s->LUT );
 	gDPLoadSync( gl++ );
+#ifdef SP_BATCH
+	}
+#endif
     };
 
+#ifdef SP_BATCH
+    /*
+     * What the sprite before left for spDraw's end to put back is left as
+     * it is until a sprite needs it otherwise.
+     */
+    if( sp_batching && s->bmfmt != G_IM_FMT_CI &&
+	!batchset(SP_BS_TLUT, G_TT_NONE) )
+	gDPSetTextureLUT( gl++, G_TT_NONE);
+
+    if( (s->attr & SP_FASTCOPY) && (s->bmfmt != G_IM_FMT_YUV) )
+	cycle = G_CYC_COPY;
+    else
+	cycle = G_CYC_1CYCLE;
+    if( sp_batching && b != NULL && !batchset(SP_BS_CYCLE, cycle) )
+	gDPSetCycleType( gl++, cycle);
+#endif
+
 #define MY_K0   (175 & 0x1ff)
 #define MY_K1   (-43 & 0x1ff)
 #define MY_K2   (-89 & 0x1ff)
@@ -539,6 +806,13 @@ spDraw ( Sprite   *s )
 	gDPSetCombineMode( gl++, G_CC_YUV2RGB, G_CC_PASS2);
     }
 
+#ifdef SP_BATCH
+    if( sp_batching && s->bmfmt == G_IM_FMT_YUV ) {
+	batchforget( SP_BS_COMBINE );
+	batchforget( SP_BS_CYCLE );
+    }
+#endif
+
     if (s->attr & SP_SCALE) {
 	sx = s->scalex;
 	sy = s->scaley;
@@ -552,8 +826,15 @@ spDraw ( Sprite   *s )
 
     if( b ) {
 
-	if( (s->attr & SP_FASTCOPY) && (s->bmfmt != G_IM_FMT_YUV) )
+	if( (s->attr & SP_FASTCOPY) && (s->bmfmt != G_IM_FMT_YUV)
+#ifdef SP_BATCH
+	    && !sp_batching
+#endif
+	    )
 	    gDPSetCycleType( gl++, G_CYC_COPY);
+#ifdef SP_BATCH
+	batchsyncbefore( dl_start, &gl );
+#endif
 
 	x = 0.0F;
 	y = 0.0F;
@@ -665,10 +946,20 @@ spDraw ( Sprite   *s )
 	    ex += s->expx;
 	}
 
-	if (s->attr & SP_FASTCOPY)
+	if (s->attr & SP_FASTCOPY
+#ifdef SP_BATCH
+	    && !sp_batching
+#endif
+	    )
 	    gDPSetCycleType( gl++, G_CYC_1CYCLE);
 
 	if(s->bmfmt == G_IM_FMT_YUV) {
+#ifdef SP_BATCH
+	    if( sp_batching ) {
+		batchsync( &gl );
+		batchknow( SP_BS_CYCLE, G_CYC_1CYCLE );
+	    }
+#endif
 	    gDPSetCycleType( gl++, G_CYC_1CYCLE);
 	    gDPSetTextureFilter ( gl++, G_TF_BILERP );
 	    gDPSetTextureConvert( gl++, G_TC_FILT   );
@@ -677,6 +968,9 @@ spDraw ( Sprite   *s )
     } else {
 	int rgba;
 
+#ifdef SP_BATCH
+	batchsyncbefore( dl_start, &gl );
+#endif
 	x = (s32)s->x;
 	y = (s32)s->y;
 	x2 = s->x + (s->width*sx)-1;
@@ -708,6 +1002,13 @@ spDraw ( Sprite   *s )
 
 	    rgba = GPACK_RGBA5551((s->red), (s->green), (s->blue), (s->alpha>>7));
 
+#ifdef SP_BATCH
+	    if( sp_batching ) {
+		batchsync( &gl );
+		batchknow( SP_BS_CYCLE, G_CYC_1CYCLE );
+	    }
+#endif
+
 	    gSPTexture ( gl++, 0x8000, 0x8000, 0, G_TX_RENDERTILE, G_OFF);
 	    gDPSetCycleType( gl++, G_CYC_FILL);
 	    gDPSetFillColor( gl++, (rgba << 16) | (rgba) );
@@ -718,6 +1019,13 @@ spDraw ( Sprite   *s )
 	}
     }
 
+#ifdef SP_BATCH
+    if( sp_batching ) {
+	sp_batch_gl = gl;
+	return(  dl_start );
+    }
+#endif
+
     if( s->bmfmt == G_IM_FMT_CI ) {
 	gDPSetTextureLUT( gl++, G_TT_NONE);
     };
@@ -759,3 +1067,121 @@ spFinish( Gfx **glistp )
 
     *glistp = gl;
 }
+
+#ifdef SP_BATCH
+/*
+ * spBatchDraw()
+ *
+ *   Queues a sprite for the next spBatchFlush.
+ */
+void
+spBatchDraw( Sprite *sp, s32 layer )
+{
+    if (sp->attr & SP_HIDDEN)
+	return;
+
+    assert(sp_batch_count < SP_BATCH_MAX);
+    if( sp_batch_count >= SP_BATCH_MAX ) {
+	sp_batch_stats.dropped++;
+	return;
+    }
+    sp_batch[sp_batch_count].sp = sp;
+    sp_batch[sp_batch_count].layer = layer;
+    sp_batch_count++;
+}
+
+/*
+ * Whether a is drawn before b: by layer, then so that sprites sharing a
+ * format, TLUT and first bitmap come together.
+ */
+static s32
+batchbefore( SpBatchEntry *a, SpBatchEntry *b )
+{
+    Sprite *sa = a->sp, *sb = b->sp;
+    u32 ba, bb;
+
+    if( a->layer != b->layer )
+	return a->layer < b->layer;
+    if( sa->bmfmt != sb->bmfmt )
+	return sa->bmfmt < sb->bmfmt;
+    if( sa->bmsiz != sb->bmsiz )
+	return sa->bmsiz < sb->bmsiz;
+    if( sa->LUT != sb->LUT )
+	return (u32)sa->LUT < (u32)sb->LUT;
+    ba = sa->bitmap != NULL ? (u32)sa->bitmap->buf : 0;
+    bb = sb->bitmap != NULL ? (u32)sb->bitmap->buf : 0;
+    return ba < bb;
+}
+
+/*
+ * Past what spDraw puts in a sprite's own list, less its end, a sprite
+ * drawn in a flush can send a pipe sync, TLUT mode and cycle type; the
+ * flush ends with up to three more.
+ */
+#define SP_BATCH_EXTRA		(2 + 3)
+
+/*
+ * spBatchFlush()
+ *
+ *   Draws the queued sprites into *glistp, which ends at glistend, and
+ *   empties the queue.  A sprite is only drawn if its ndisplist, and
+ *   SP_BATCH_EXTRA more, fit before glistend; it, and those after it,
+ *   are otherwise dropped.
+ */
+void
+spBatchFlush( Gfx **glistp, Gfx *glistend )
+{
+    SpBatchEntry e;
+    Sprite *s;
+    Gfx *start;
+    s32 i, j;
+
+    /* Insertion, so sprites that compare equal keep the order they came in */
+    for( i = 1; i < sp_batch_count; i++ ) {
+	e = sp_batch[i];
+	for( j = i; j > 0 && batchbefore(&e, &sp_batch[j-1]); j-- )
+	    sp_batch[j] = sp_batch[j-1];
+	sp_batch[j] = e;
+    }
+
+    sp_batching = 1;
+    sp_batch_gl = *glistp;
+    sp_batch_sync = 0;
+    sp_batch_tex_valid = 0;
+    sp_batch_tlut_valid = 0;
+
+    /* What spInit, and every spDraw, leave behind */
+    sp_batch_known = 0;
+    batchknow( SP_BS_TLUT, G_TT_NONE );
+    batchknow( SP_BS_CYCLE, G_CYC_1CYCLE );
+
+    for( i = 0; i < sp_batch_count; i++ ) {
+	s = sp_batch[i].sp;
+	assert(glistend - sp_batch_gl >= s->ndisplist + SP_BATCH_EXTRA);
+	if( glistend - sp_batch_gl < s->ndisplist + SP_BATCH_EXTRA ) {
+	    sp_batch_stats.dropped += sp_batch_count - i;
+	    break;
+	}
+	start = sp_batch_gl;
+	if( spDraw( s ) != NULL )
+	    sp_batch_stats.sprites++;
+	assert((sp_batch_gl - start) <= s->ndisplist + SP_BATCH_EXTRA - 3);
+    }
+
+    batchsync( &sp_batch_gl );
+    if( !batchset(SP_BS_TLUT, G_TT_NONE) )
+	gDPSetTextureLUT( sp_batch_gl++, G_TT_NONE);
+    if( !batchset(SP_BS_CYCLE, G_CYC_1CYCLE) )
+	gDPSetCycleType( sp_batch_gl++, G_CYC_1CYCLE);
+
+    sp_batching = 0;
+    sp_batch_count = 0;
+    *glistp = sp_batch_gl;
+}
+
+void
+spBatchGetStats( SpBatchStats *stats )
+{
+    *stats = sp_batch_stats;
+}
+#endif /* SP_BATCH */
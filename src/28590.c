@@ -1,7 +1,13 @@
 #include "include_asm.h"
 #include "mg_type.h"
 #include "mg.h"
+#include "mg_log.h"
+#include "mg_mem.h"
 #include "ultra64.h"
+#include "nusys.h"
+#ifdef ENHANCEMENTS
+#include "overlay_manager.h"
+#endif
 
 typedef struct st_unk_0x800DC6E0
 {
@@ -28,7 +34,12 @@ extern st_unk_0x800DC6E0 D_800DC6E0[];
 extern s8 D_800BFEE4;
 extern s8 D_800DAF60[0x4B0];
 extern const char D_800CCA90;
+#ifdef ENHANCEMENTS
+/* Written as a whole descriptor, so it has to be one */
+st_unk_0x800DC6E0 D_800DC728;
+#else
 void *D_800DC728;
+#endif
 
 void func_8004D9C0();
 void func_8004DA24(s8*, u32, u32);
@@ -128,10 +139,457 @@ INCLUDE_ASM("asm/nonmatchings/28590", func_8004DAF4);
 
 INCLUDE_ASM("asm/nonmatchings/28590", func_8004DC44);
 
+/* ARENA_BINS is a flag of its own rather than part of ENHANCEMENTS. The bins
+ * are only an index over the block lists, which stay the real free list:
+ * func_8004DE7C, func_8004E058, func_8004DD70 and func_8004DDE4 keep them in
+ * step, but func_8004E184, func_8004E27C, func_8004E288, func_8004E2DC and
+ * func_8004E47C are still asm and may edit block headers behind their back.
+ * So every entry point first checks the arena's free byte count against the
+ * one it last left, and rebuilds the bins from the list if it has moved.
+ *
+ * That misses edits whose sizes cancel out, say a block taken and another of
+ * the same size freed, so the bins are never trusted on their own either: no
+ * link is followed or written through until the block it leads to has been
+ * checked to be a free block on the list, of its bin's size, linked both
+ * ways. Anything that fails marks the bins stale and they are rebuilt before
+ * the call returns. A block freed behind the bins' back isn't in any bin
+ * until then, so an allocation that finds nothing rebuilds them and looks
+ * again before it gives up.
+ */
+#ifdef ARENA_BINS
+/* D_800DC728, which func_8004E1E0 sets up as func_8004DDE4 does an arena, is
+ * D_800DC6E0[3]
+ */
+#define ARENA_COUNT       4
+#define ARENA_BLOCK_USED  0x12345678
+/* Size and tag and the two links; unk_0x10 on is the caller's */
+#define ARENA_HEADER_SIZE (sizeof(st_unk_0x800DC6E0) - 2 * sizeof(s32))
+
+/* Free blocks stay on the arena's address ordered block list exactly as
+ * before, but their first two payload words also link them into a bin for
+ * their size class. Below 0x200 there is one bin per 8 bytes, so any block in
+ * a bin at or above the request's fits; above that each power of two is split
+ * into four bins.
+ */
+#define ARENA_EXACT_BINS  64
+#define ARENA_BIN_COUNT   128
+#define ARENA_BIN_MIN     sizeof(MGArenaFreeBlock) /* header plus the two bin links */
+
+typedef struct MGArenaFreeBlock
+{
+    /* 0x0 */  s32 size;
+    /* 0x4 */  s32 tag;
+    /* 0x8 */  st_unk_0x800DC6E0 *next;
+    /* 0xC */  st_unk_0x800DC6E0 *prev;
+    /* 0x10 */ struct MGArenaFreeBlock *bin_next;
+    /* 0x14 */ struct MGArenaFreeBlock *bin_prev;
+} MGArenaFreeBlock;
+
+typedef struct MGArenaBins
+{
+    /* 0x0 */   u32 nonempty[ARENA_BIN_COUNT / 32];
+    /* 0x10 */  MGArenaFreeBlock *bins[ARENA_BIN_COUNT];
+    /* 0x210 */ u8 *start; /* Lowest and highest address handed to the arena */
+    /* 0x214 */ u8 *end;
+    /* 0x218 */ bool stale;
+} MGArenaBins;
+
+static MGArenaBins arena_bins[ARENA_COUNT];
+
+/* Arenas whose frees skip merging until arena_coalesce(), and how many
+ * unmerged frees each has outstanding.
+ */
+static bool arena_deferred[ARENA_COUNT];
+static s32 arena_pending[ARENA_COUNT];
+
+/* unk_0x10 as each arena's bin code last left it */
+static s32 arena_free_seen[ARENA_COUNT];
+
+static const u8 arena_debruijn[32] =
+{
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+};
+
+static s32 arena_lowest_bit(u32 bits)
+{
+    return arena_debruijn[((bits & -bits) * 0x077CB531) >> 27];
+}
+
+static s32 arena_highest_bit(u32 bits)
+{
+    s32 bit = 0;
+
+    if (bits & 0xFFFF0000) { bits >>= 16; bit += 16; }
+    if (bits & 0xFF00)     { bits >>= 8;  bit += 8; }
+    if (bits & 0xF0)       { bits >>= 4;  bit += 4; }
+    if (bits & 0xC)        { bits >>= 2;  bit += 2; }
+    if (bits & 0x2)        { bit += 1; }
+
+    return bit;
+}
+
+static s32 arena_size_class(u32 size)
+{
+    s32 log2;
+    s32 class;
+
+    if (size < ARENA_EXACT_BINS * 8)
+    {
+        return size >> 3;
+    }
+
+    log2 = arena_highest_bit(size);
+    class = ARENA_EXACT_BINS + (log2 - 9) * 4 + ((size >> (log2 - 2)) & 3);
+
+    return (class < ARENA_BIN_COUNT) ? class : ARENA_BIN_COUNT - 1;
+}
+
+/* Whether a link that may be left over from before an edit behind the bins'
+ * back can be read through: the arena itself, or a word aligned header
+ * inside the memory handed to it.
+ */
+static bool arena_bin_readable(MGArenaBins *bins, void *ptr)
+{
+    return ptr == &D_800DC6E0[bins - arena_bins] ||
+           ((u8 *)ptr >= bins->start && (u8 *)ptr + ARENA_HEADER_SIZE <= bins->end && ((u32)ptr & 3) == 0);
+}
+
+/* Whether a block in bin class is still a free block on the list of a size
+ * that belongs there, linked both ways into the bin. Nothing is read through
+ * a link before it has been checked to be readable.
+ */
+static bool arena_bin_current(MGArenaBins *bins, MGArenaFreeBlock *block, s32 class)
+{
+    if (!arena_bin_readable(bins, block) || block->tag != 0 || (u32)block->size < ARENA_BIN_MIN ||
+        (u32)block->size > (u32)(bins->end - (u8 *)block) || arena_size_class(block->size) != class ||
+        !arena_bin_readable(bins, block->next) || !arena_bin_readable(bins, block->prev) ||
+        block->next->unk_0xC != (st_unk_0x800DC6E0 *)block || block->prev->unk_0x8 != (st_unk_0x800DC6E0 *)block)
+    {
+        return false;
+    }
+
+    if (block->bin_prev == NULL ? bins->bins[class] != block
+                                : !arena_bin_readable(bins, block->bin_prev) || block->bin_prev->bin_next != block)
+    {
+        return false;
+    }
+
+    return block->bin_next == NULL || (arena_bin_readable(bins, block->bin_next) && block->bin_next->bin_prev == block);
+}
+
+static void arena_bin_insert(MGArenaBins *bins, st_unk_0x800DC6E0 *block)
+{
+    MGArenaFreeBlock *free_block = (MGArenaFreeBlock *)block;
+    MGArenaFreeBlock *head;
+    s32 class;
+
+    /* Too small to hold the links, and too small to satisfy any request */
+    if ((u32)free_block->size < ARENA_BIN_MIN || bins->stale)
+    {
+        return;
+    }
+
+    class = arena_size_class(free_block->size);
+    head = bins->bins[class];
+    if (head != NULL && !arena_bin_current(bins, head, class))
+    {
+        bins->stale = true;
+        return;
+    }
+
+    free_block->bin_prev = NULL;
+    free_block->bin_next = head;
+    if (head != NULL)
+    {
+        head->bin_prev = free_block;
+    }
+    bins->bins[class] = free_block;
+    bins->nonempty[class >> 5] |= 1 << (class & 31);
+}
+
+static void arena_bin_remove(MGArenaBins *bins, st_unk_0x800DC6E0 *block)
+{
+    MGArenaFreeBlock *free_block = (MGArenaFreeBlock *)block;
+    s32 class;
+
+    if ((u32)free_block->size < ARENA_BIN_MIN || bins->stale)
+    {
+        return;
+    }
+
+    class = arena_size_class(free_block->size);
+    if (!arena_bin_current(bins, free_block, class))
+    {
+        bins->stale = true;
+        return;
+    }
+
+    if (free_block->bin_prev != NULL)
+    {
+        free_block->bin_prev->bin_next = free_block->bin_next;
+    }
+    else
+    {
+        bins->bins[class] = free_block->bin_next;
+    }
+    if (free_block->bin_next != NULL)
+    {
+        free_block->bin_next->bin_prev = free_block->bin_prev;
+    }
+    if (bins->bins[class] == NULL)
+    {
+        bins->nonempty[class >> 5] &= ~(1 << (class & 31));
+    }
+}
+
+/* First non-empty bin at or above class, or -1 */
+static s32 arena_bin_next(MGArenaBins *bins, s32 class)
+{
+    s32 word = class >> 5;
+    u32 bits;
+
+    if (class >= ARENA_BIN_COUNT)
+    {
+        return -1;
+    }
+
+    bits = bins->nonempty[word] & ~((1 << (class & 31)) - 1);
+    while (bits == 0)
+    {
+        if (++word >= ARENA_BIN_COUNT / 32)
+        {
+            return -1;
+        }
+        bits = bins->nonempty[word];
+    }
+
+    return (word << 5) + arena_lowest_bit(bits);
+}
+
+/* Smallest block of at least size in the request's own bin, or else the
+ * first block of the next bin up, all of which fit. NULL if there is none,
+ * or, with the bins marked stale, if a block it looked at has been changed
+ * behind their back.
+ */
+static st_unk_0x800DC6E0 *arena_bin_find(MGArenaBins *bins, u32 size)
+{
+    MGArenaFreeBlock *block;
+    MGArenaFreeBlock *best = NULL;
+    s32 class = arena_size_class(size);
+
+    if (class >= ARENA_EXACT_BINS)
+    {
+        for (block = bins->bins[class]; block != NULL; block = block->bin_next)
+        {
+            if (!arena_bin_current(bins, block, class))
+            {
+                bins->stale = true;
+                return NULL;
+            }
+            if ((u32)block->size >= size && (best == NULL || block->size < best->size))
+            {
+                best = block;
+            }
+        }
+        if (best != NULL)
+        {
+            return (st_unk_0x800DC6E0 *)best;
+        }
+        class++;
+    }
+
+    class = arena_bin_next(bins, class);
+    if (class < 0)
+    {
+        return NULL;
+    }
+
+    block = bins->bins[class];
+    if (!arena_bin_current(bins, block, class))
+    {
+        bins->stale = true;
+        return NULL;
+    }
+
+    return (st_unk_0x800DC6E0 *)block;
+}
+
+/* Bins every free block on the arena's list afresh */
+static void arena_bins_rebuild(s32 arg0)
+{
+    st_unk_0x800DC6E0 *arena = &D_800DC6E0[arg0];
+    MGArenaBins *bins = &arena_bins[arg0];
+    st_unk_0x800DC6E0 *block;
+
+    bzero(bins->nonempty, sizeof(bins->nonempty));
+    bzero(bins->bins, sizeof(bins->bins));
+    bins->stale = false;
+    for (block = arena->unk_0x8; block != arena; block = block->unk_0x8)
+    {
+        /* Memory asm handed to the arena is only seen here */
+        if (bins->start == NULL || (u8 *)block < bins->start)
+        {
+            bins->start = (u8 *)block;
+        }
+        if ((u8 *)block + block->unk_0x0 > bins->end)
+        {
+            bins->end = (u8 *)block + block->unk_0x0;
+        }
+        if (block->unk_0x4 == 0)
+        {
+            arena_bin_insert(bins, block);
+        }
+    }
+    arena_free_seen[arg0] = arena->unk_0x10;
+}
+
+/* Anything that frees or takes memory other than through the bins changes
+ * the free byte count, unless it cancels out; the bin operations catch that.
+ */
+static void arena_bins_sync(s32 arg0)
+{
+    if (D_800DC6E0[arg0].unk_0x10 != arena_free_seen[arg0] || arena_bins[arg0].stale)
+    {
+        arena_bins_rebuild(arg0);
+    }
+}
+
+/* Largest free block, from the highest non-empty bin. Leaves the bins in
+ * step, and unk_0x10 noted as seen.
+ */
+static s32 arena_bin_largest(s32 arg0)
+{
+    MGArenaBins *bins = &arena_bins[arg0];
+    MGArenaFreeBlock *block;
+    s32 largest = 0;
+    bool rebuilt = false;
+    s32 class;
+    s32 word;
+
+    arena_free_seen[arg0] = D_800DC6E0[arg0].unk_0x10;
+    arena_bins_sync(arg0);
+
+    for (word = ARENA_BIN_COUNT / 32 - 1; word >= 0; word--)
+    {
+        if (bins->nonempty[word] != 0)
+        {
+            class = (word << 5) + arena_highest_bit(bins->nonempty[word]);
+            for (block = bins->bins[class]; block != NULL; block = block->bin_next)
+            {
+                if (!arena_bin_current(bins, block, class))
+                {
+                    /* Freshly rebuilt bins are all current, so once is enough */
+                    if (rebuilt)
+                    {
+                        return largest;
+                    }
+                    arena_bins_rebuild(arg0);
+                    rebuilt = true;
+                    largest = 0;
+                    word = ARENA_BIN_COUNT / 32;
+                    break;
+                }
+                if (block->size > largest)
+                {
+                    largest = block->size;
+                }
+            }
+            if (block == NULL)
+            {
+                break;
+            }
+        }
+    }
+
+    return largest;
+}
+
+/* Merges an unlinked free block with the free blocks physically either side
+ * of it. The block list is kept in address order, so its links already act
+ * as boundary tags and both neighbours are one step away.
+ */
+static st_unk_0x800DC6E0 *arena_merge(MGArenaBins *bins, st_unk_0x800DC6E0 *block)
+{
+    st_unk_0x800DC6E0 *next = block->unk_0x8;
+    st_unk_0x800DC6E0 *prev = block->unk_0xC;
+
+    if (next->unk_0x4 == 0 && (u8 *)block + block->unk_0x0 == (u8 *)next)
+    {
+        arena_bin_remove(bins, next);
+        block->unk_0x0 += next->unk_0x0;
+        block->unk_0x8 = next->unk_0x8;
+        next->unk_0x8->unk_0xC = block;
+    }
+
+    if (prev->unk_0x4 == 0 && (u8 *)prev + prev->unk_0x0 == (u8 *)block)
+    {
+        arena_bin_remove(bins, prev);
+        prev->unk_0x0 += block->unk_0x0;
+        prev->unk_0x8 = block->unk_0x8;
+        block->unk_0x8->unk_0xC = prev;
+        block = prev;
+    }
+
+    return block;
+}
+
+/* One pass over the arena merging every run of adjacent free blocks left
+ * behind by deferred frees, then the bins afresh, as the pass is a walk over
+ * every block anyway. Interrupts must already be masked.
+ */
+static void arena_coalesce_locked(s32 arg0)
+{
+    st_unk_0x800DC6E0 *arena = &D_800DC6E0[arg0];
+    st_unk_0x800DC6E0 *block;
+    st_unk_0x800DC6E0 *next;
+
+    for (block = arena->unk_0x8; block != arena; block = block->unk_0x8)
+    {
+        next = block->unk_0x8;
+        while (block->unk_0x4 == 0 && next->unk_0x4 == 0 && (u8 *)block + block->unk_0x0 == (u8 *)next)
+        {
+            block->unk_0x0 += next->unk_0x0;
+            block->unk_0x8 = next->unk_0x8;
+            next->unk_0x8->unk_0xC = block;
+            next = block->unk_0x8;
+        }
+    }
+
+    arena_bins_rebuild(arg0);
+    arena_pending[arg0] = 0;
+    arena->unk_0x14 = arena_bin_largest(arg0);
+}
+
+void arena_coalesce(s32 arg0)
+{
+    u32 mask = osSetIntMask(0x00000001);
+
+    arena_coalesce_locked(arg0);
+    osSetIntMask(mask);
+}
+
+/* While enabled, frees on the arena only return blocks to their bins, which
+ * keeps bursts of frees (scene teardown) cheap. Turning it off merges
+ * everything freed in the meantime.
+ */
+void arena_set_deferred_free(s32 arg0, bool enable)
+{
+    arena_deferred[arg0] = enable;
+    if (!enable && arena_pending[arg0] != 0)
+    {
+        arena_coalesce(arg0);
+    }
+}
+#endif
+
 void func_8004DD70(s32 arg0, st_unk_0x800DC6E0 *arg1, s32 arg2)
 {
     s32 temp_a2;
 
+#ifdef ARENA_BINS
+    arena_bins_sync(arg0);
+#endif
     temp_a2 = arg2 - (s32)arg1;
     arg1->unk_0x0 = temp_a2;
     D_800DC6E0[arg0].unk_0x10 = D_800DC6E0[arg0].unk_0x10 + temp_a2;
@@ -140,6 +598,19 @@ void func_8004DD70(s32 arg0, st_unk_0x800DC6E0 *arg1, s32 arg2)
     arg1->unk_0xC = D_800DC6E0[arg0].unk_0xC;
     D_800DC6E0[arg0].unk_0xC->unk_0x8 = arg1;
     D_800DC6E0[arg0].unk_0xC = arg1;
+#ifdef ARENA_BINS
+    if (arena_bins[arg0].start == NULL || (u8 *)arg1 < arena_bins[arg0].start)
+    {
+        arena_bins[arg0].start = (u8 *)arg1;
+    }
+    if ((u8 *)arg1 + temp_a2 > arena_bins[arg0].end)
+    {
+        arena_bins[arg0].end = (u8 *)arg1 + temp_a2;
+    }
+    arena_bin_insert(&arena_bins[arg0], arg1);
+    arena_free_seen[arg0] = D_800DC6E0[arg0].unk_0x10;
+    arena_bins_sync(arg0);
+#endif
 }
 
 void func_8004DDE4(s32 arg0)
@@ -149,6 +620,11 @@ void func_8004DDE4(s32 arg0)
     D_800DC6E0[arg0].unk_0x4 = -1;
     D_800DC6E0[arg0].unk_0x8 = D_800DC6E0[arg0].unk_0xC = &D_800DC6E0[arg0];
     D_800DC6E0[arg0].unk_0x14 = -1;
+#ifdef ARENA_BINS
+    bzero(&arena_bins[arg0], sizeof(MGArenaBins));
+    arena_pending[arg0] = 0;
+    arena_free_seen[arg0] = 0;
+#endif
 }
 
 s32 func_8004DE44(s32 arg0)
@@ -161,7 +637,71 @@ s32 func_8004DE60(s32 arg0)
     return D_800DC6E0[arg0].unk_0x14;
 }
 
-#ifdef NON_MATCHING
+#ifdef ARENA_BINS
+/* Size class lookup in place of the best-fit walk over every block. The
+ * arena's free byte count (unk_0x10) and largest free block (unk_0x14) are
+ * kept as before.
+ */
+s32 *func_8004DE7C(s32 arg0, s32 arg1)
+{
+    st_unk_0x800DC6E0 *arena = &D_800DC6E0[arg0];
+    MGArenaBins *bins = &arena_bins[arg0];
+    st_unk_0x800DC6E0 *block;
+    st_unk_0x800DC6E0 *rest;
+    u32 requested_size;
+    u32 mask;
+
+    requested_size = (arg1 + ARENA_HEADER_SIZE + 7) & (~7);
+    mask = osSetIntMask(0x00000001);
+
+    arena_bins_sync(arg0);
+    block = arena_bin_find(bins, requested_size);
+    if (block == NULL)
+    {
+        /* Out of step, or a fit freed behind the bins' back isn't in them */
+        arena_bins_rebuild(arg0);
+        block = arena_bin_find(bins, requested_size);
+    }
+    if (block == NULL && arena_pending[arg0] != 0)
+    {
+        arena_coalesce_locked(arg0);
+        block = arena_bin_find(bins, requested_size);
+    }
+    if (block == NULL)
+    {
+        arena->unk_0x14 = arena_bin_largest(arg0);
+        osSetIntMask(mask);
+        osSyncPrintf(&D_800CCA90);
+        return NULL;
+    }
+
+    arena_bin_remove(bins, block);
+
+    if ((block->unk_0x0 - requested_size) > ARENA_HEADER_SIZE)
+    {
+        rest = (st_unk_0x800DC6E0 *)((u8 *)block + requested_size);
+        rest->unk_0x0 = block->unk_0x0 - requested_size;
+        rest->unk_0x4 = 0;
+        block->unk_0x8->unk_0xC = rest;
+        rest->unk_0x8 = block->unk_0x8;
+        block->unk_0x8 = rest;
+        rest->unk_0xC = block;
+        block->unk_0x0 = requested_size;
+        arena->unk_0x10 -= requested_size;
+        arena_bin_insert(bins, rest);
+    }
+    else
+    {
+        arena->unk_0x10 -= block->unk_0x0;
+    }
+
+    block->unk_0x4 = ARENA_BLOCK_USED;
+    arena->unk_0x14 = arena_bin_largest(arg0);
+    osSetIntMask(mask);
+
+    return &block->unk_0x10;
+}
+#elif defined(NON_MATCHING)
 /* This function appears to be a general purpose memory allocator. It searches
  * through the memory arena and identifies the first available free space block
  * which is large enough to fit the requested memory size.
@@ -259,13 +799,289 @@ s32 *func_8004DE7C(s32 arg0, s32 arg1)
 INCLUDE_ASM("asm/nonmatchings/28590", func_8004DE7C);
 #endif
 
+#ifdef ARENA_BINS
+/* Free has to keep the bins in step with the block list, so it is replaced
+ * along with the allocator. Its callers are all asm, and asm/ is extracted
+ * from the ROM rather than kept in the tree, so (arena, ptr) couldn't be read
+ * off them: it is the order every arena routine here takes, the arena index
+ * first (func_8004DD70, func_8004DDE4, func_8004DE44, func_8004DE60 and
+ * func_8004DE7C). A caller passing them the other way round would pass an
+ * RDRAM address as the arena, which is never below ARENA_COUNT, so that is
+ * refused before anything is touched.
+ */
+void func_8004E058(s32 arg0, void *arg1)
+{
+    st_unk_0x800DC6E0 *arena;
+    MGArenaBins *bins;
+    st_unk_0x800DC6E0 *block;
+    u32 mask;
+
+    if ((u32)arg0 >= ARENA_COUNT)
+    {
+        LOG_INFO1("MemFree: bad arena %08x\n", arg0);
+        return;
+    }
+
+    if (arg1 == NULL)
+    {
+        return;
+    }
+
+    arena = &D_800DC6E0[arg0];
+    bins = &arena_bins[arg0];
+    block = (st_unk_0x800DC6E0 *)((u8 *)arg1 - ARENA_HEADER_SIZE);
+    mask = osSetIntMask(0x00000001);
+
+    if (block->unk_0x4 != ARENA_BLOCK_USED)
+    {
+        osSetIntMask(mask);
+        LOG_INFO1("MemFree: bad block %08x\n", arg1);
+        return;
+    }
+
+    arena_bins_sync(arg0);
+    block->unk_0x4 = 0;
+    arena->unk_0x10 += block->unk_0x0;
+
+    if (arena_deferred[arg0])
+    {
+        arena_pending[arg0]++;
+    }
+    else
+    {
+        block = arena_merge(bins, block);
+    }
+
+    arena_bin_insert(bins, block);
+    if (block->unk_0x0 > arena->unk_0x14)
+    {
+        arena->unk_0x14 = block->unk_0x0;
+    }
+    arena_free_seen[arg0] = arena->unk_0x10;
+    arena_bins_sync(arg0);
+
+    osSetIntMask(mask);
+}
+#else
 INCLUDE_ASM("asm/nonmatchings/28590", func_8004E058);
+#endif
+
+#ifdef ENHANCEMENTS
+/* Double buffered bump allocator for data that only has to live until the
+ * frame it was built for has been drawn. Each frame buffer swap reported by
+ * nuGfxTaskMgr flips allocation to the other half and resets it.
+ *
+ * This assumes graphics runs at most one task ahead: the half being reset
+ * was filled before the previous swap, so the task that read it has to have
+ * finished by this one. A game that queues a second task before the first
+ * is swapped in would have the RDP reading memory that is being reused.
+ */
+typedef struct MGFrameHeap
+{
+    /* 0x0 */  u8 *base[2];
+    /* 0x8 */  u32 size;
+    /* 0xC */  u32 top;
+    /* 0x10 */ u8 current;
+    /* 0x11 */ u8 generation;
+    /* 0x12 */ u8 overflow_logged;
+    /* 0x14 */ MGFrameHeapStats stats;
+    /* 0x2C */ NUGfxSwapCfbFunc chained; /* The swap callback installed before ours */
+} MGFrameHeap;
+
+static MGFrameHeap frame_heap;
+
+static void frame_heap_swap(void *task)
+{
+    u32 mask = osSetIntMask(0x00000001);
+
+    frame_heap.current ^= 1;
+    frame_heap.generation++;
+    frame_heap.top = 0;
+    frame_heap.overflow_logged = false;
+    frame_heap.stats.frames++;
+    osSetIntMask(mask);
+
+    if (frame_heap.chained != NULL)
+    {
+        frame_heap.chained(task);
+    }
+}
+
+/* Puts frame_heap_swap in front of whichever swap callback is set */
+static void frame_heap_hook(void)
+{
+    frame_heap.chained = nuGfxSwapCfbFunc;
+    nuGfxSwapCfbFuncSet(frame_heap_swap);
+}
+
+/* Takes the swap callback over, passing each swap on to whichever one was
+ * set. func_8004E1E0 calls it at boot, which may be before nuGfxInit sets
+ * nuGfxSwapCfb, so frame_alloc takes the callback back, chaining whatever
+ * replaced it, if anything has set one since.
+ */
+void frame_heap_init(void *base, u32 size)
+{
+    u32 half = (size / 2) & ~7;
+    NUGfxSwapCfbFunc chained = frame_heap.chained;
+
+    bzero(&frame_heap, sizeof(MGFrameHeap));
+    frame_heap.base[0] = (u8 *)base;
+    frame_heap.base[1] = (u8 *)base + half;
+    frame_heap.size = half;
+    frame_heap.stats.size = half;
+
+    /* Once is enough; a second init would chain the callback to itself */
+    if (nuGfxSwapCfbFunc == frame_heap_swap)
+    {
+        frame_heap.chained = chained;
+    }
+    else
+    {
+        frame_heap_hook();
+    }
+}
+
+void *frame_alloc(u32 size)
+{
+    void *ptr;
+    u32 top;
+    u32 mask;
+    bool report;
+
+    if (frame_heap.size == 0)
+    {
+        return NULL;
+    }
+
+    if (nuGfxSwapCfbFunc != frame_heap_swap)
+    {
+        LOG_INFO1("FrameHeap: swap callback %08x set over ours, chaining it\n", nuGfxSwapCfbFunc);
+        frame_heap_hook();
+    }
+
+    size = (size + 7) & ~7;
+    mask = osSetIntMask(0x00000001);
+
+    top = frame_heap.top + size;
+    if (top > frame_heap.size || top < size)
+    {
+        frame_heap.stats.overflows++;
+        if (size > frame_heap.stats.overflow_size)
+        {
+            frame_heap.stats.overflow_size = size;
+        }
+        report = !frame_heap.overflow_logged;
+        frame_heap.overflow_logged = true;
+        top = frame_heap.size - frame_heap.top;
+        osSetIntMask(mask);
+
+        if (report)
+        {
+            LOG_INFO2("FrameHeap: out of memory, 0x%x requested, 0x%x left\n", size, top);
+        }
+        return NULL;
+    }
+
+    ptr = frame_heap.base[frame_heap.current] + frame_heap.top;
+    frame_heap.top = top;
+    if (top > frame_heap.stats.high_water)
+    {
+        frame_heap.stats.high_water = top;
+    }
+    osSetIntMask(mask);
+
+    return ptr;
+}
+
+/* Marks carry the frame they were taken in, so a release can't reach into a
+ * half that has since been handed to another frame.
+ */
+u32 frame_mark(void)
+{
+    u32 mask = osSetIntMask(0x00000001);
+    u32 mark = (frame_heap.generation << 24) | frame_heap.top;
+
+    osSetIntMask(mask);
+    return mark;
+}
+
+void frame_release(u32 mark)
+{
+    u32 mask = osSetIntMask(0x00000001);
+    bool stale = (mark >> 24) != frame_heap.generation || (mark & 0xFFFFFF) > frame_heap.top;
+
+    if (!stale)
+    {
+        frame_heap.top = mark & 0xFFFFFF;
+    }
+    osSetIntMask(mask);
+
+    if (stale)
+    {
+        LOG_INFO1("FrameHeap: stale mark %08x\n", mark);
+    }
+}
+
+void frame_heap_get_stats(MGFrameHeapStats *stats)
+{
+    u32 mask = osSetIntMask(0x00000001);
+
+    *stats = frame_heap.stats;
+    stats->used = frame_heap.top;
+    osSetIntMask(mask);
+}
+
+void frame_heap_print_stats(void)
+{
+    MGFrameHeapStats stats;
+
+    frame_heap_get_stats(&stats);
+    LOG_INFO3("FrameHeap: 0x%x used, high water 0x%x of 0x%x\n", stats.used, stats.high_water, stats.size);
+    LOG_INFO3("FrameHeap: %d frames, %d overflows, largest 0x%x\n", stats.frames, stats.overflows, stats.overflow_size);
+}
+#endif
 
 INCLUDE_ASM("asm/nonmatchings/28590", func_8004E184);
 
 void *func_8004E184(void *, void *); 
 
-#ifdef NON_MATCHING
+#ifdef ENHANCEMENTS
+/* The NON_MATCHING body below, with the frame heap taken off the top of the
+ * memory it is given from before func_8004E184 hands the rest to the heap:
+ * the expansion pak when there is one (arg0 is 1), else the main heap. With
+ * the expansion pak the overlay residency cache goes above the frame heap;
+ * without it the cache stays off. The other two arguments were only ever
+ * overwritten, so they're dropped.
+ */
+void func_8004E1E0(s32 arg0)
+{
+    st_unk_0x800DC6E0 *arena = &D_800DC728;
+    u8 *top;
+
+    arena->unk_0x4 = -1;
+    arena->unk_0x0 = 0;
+    arena->unk_0x10 = 0;
+    arena->unk_0x8 = arena->unk_0xC = arena;
+
+    if (arg0 == 1)
+    {
+        func_8004E184((void *)0x8025D800, (void *)0x802EA000);
+        top = (u8 *)0x80800000 - OVERLAY_RESIDENCY_SIZE;
+        overlay_residency_init(top, OVERLAY_RESIDENCY_SIZE);
+        top -= FRAME_HEAP_SIZE_EXPANSION;
+        frame_heap_init(top, FRAME_HEAP_SIZE_EXPANSION);
+        func_8004E184((void *)0x80600000, top);
+    }
+    else
+    {
+        top = (u8 *)0x802EA000 - FRAME_HEAP_SIZE;
+        frame_heap_init(top, FRAME_HEAP_SIZE);
+        func_8004E184((void *)0x8025D800, top);
+    }
+
+    arena->unk_0x14 = -1;
+}
+#elif defined(NON_MATCHING)
 void func_8004E1E0(s32 arg0,
                     struct MemoryBlockDescriptor *a,
                     struct MemoryBlockDescriptor *b)
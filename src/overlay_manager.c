@@ -5,20 +5,6 @@
 #include "mg.h"
 #include "ultra64.h"
 
-typedef struct
-{
-    /* 0x0 */  s8 active;
-    /* 0x4 */  s8 *unk_0x4;
-    /* 0x8 */  u32 rom_start_addr;
-    /* 0xC */  u32 rom_end_addr;
-    /* 0x10 */ void *overlay_start_addr;
-    /* 0x14 */ void *data_start_addr;
-    /* 0x18 */ void *bss_start_addr;
-    /* 0x1C */ void *overlay_end_addr;
-    /* 0x20 */ void (*constructor)(void); /* These likely take some void ptr arguments... */
-    /* 0x24 */ void (*destructor)(void);
-} MGOverlayInfo;
-
 extern void func_80080DCC();
 extern void func_801FD624();
 extern bool flag_is_set(u32);
@@ -46,6 +32,116 @@ s32 func_80025D78(s32 index)
     return D_800D2930[index] | 0x100;
 }
 
+#ifdef ENHANCEMENTS
+/* Bit j of overlay_conflict_mask[i] is set when sets i and j share VRAM */
+static u32 overlay_conflict_mask[OVERLAY_COUNT];
+/* Modules (0x00-0x3F) owned by each set, split into two words */
+static u32 overlay_module_mask[OVERLAY_COUNT][2];
+/* Bit i is set while overlays[i].active */
+static u32 overlay_live_mask;
+
+static void overlay_build_conflict_masks(void)
+{
+    u32 i;
+    u32 j;
+    s8 *cursor;
+
+    for (i = 0; i < OVERLAY_COUNT; i++)
+    {
+        overlay_conflict_mask[i] = 0;
+        overlay_module_mask[i][0] = 0;
+        overlay_module_mask[i][1] = 0;
+
+        /* Same interval test as func_80025F18 */
+        for (j = 0; j < OVERLAY_COUNT; j++)
+        {
+            if (j == i
+                || overlays[j].overlay_start_addr > overlays[i].overlay_end_addr
+                || overlays[j].overlay_end_addr < overlays[i].overlay_start_addr)
+            {
+                continue;
+            }
+
+            overlay_conflict_mask[i] |= 1 << j;
+        }
+
+        for (cursor = overlays[i].unk_0x4; *cursor != -1; cursor++)
+        {
+            overlay_module_mask[i][*cursor >> 5] |= 1 << (*cursor & 0x1F);
+        }
+    }
+
+    overlay_live_mask = 0;
+    for (i = 0; i < OVERLAY_COUNT; i++)
+    {
+        if (overlays[i].active)
+        {
+            overlay_live_mask |= 1 << i;
+        }
+    }
+}
+
+/* Bit number of a single set bit: (bit * 0x077CB531) >> 27 is unique for each.
+ * The mask keeps the index in range where u32 is wider, as in tools/ovlharness.
+ */
+static const u8 overlay_bit_numbers[32] = {
+    0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+    31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9,
+};
+
+#define OVERLAY_BIT_NUMBER(bit) overlay_bit_numbers[(((bit) * 0x077CB531U) >> 27) & 0x1F]
+
+/* Of the given modules, the ones with an RDP request from this or the previous frame */
+static u32 overlay_recent_modules(u32 modules, s32 base)
+{
+    u32 recent = 0;
+    u32 bit;
+
+    while (modules != 0)
+    {
+        bit = modules & -modules;
+        modules ^= bit;
+
+        if (D_800B67F0 - D_8012CFC0[base + OVERLAY_BIT_NUMBER(bit)] < 2)
+        {
+            recent |= bit;
+        }
+    }
+
+    return recent;
+}
+
+/* Mask form of func_80025F18's scan. A false result is confirmed (and
+ * reported) by the original scan.
+ */
+static bool overlay_can_load(s32 new_overlay_index)
+{
+    u32 conflicts = overlay_conflict_mask[new_overlay_index];
+    u32 modules[2];
+    u32 bit;
+    u32 i;
+
+    if (conflicts & overlay_live_mask)
+    {
+        return false;
+    }
+
+    modules[0] = 0;
+    modules[1] = 0;
+    while (conflicts != 0)
+    {
+        bit = conflicts & -conflicts;
+        conflicts ^= bit;
+
+        i = OVERLAY_BIT_NUMBER(bit);
+        modules[0] |= overlay_module_mask[i][0];
+        modules[1] |= overlay_module_mask[i][1];
+    }
+
+    return (overlay_recent_modules(modules[0], 0) | overlay_recent_modules(modules[1], 0x20)) == 0;
+}
+#endif
+
 void func_80025D8C(void)
 {
     s32 i;
@@ -92,6 +188,10 @@ void func_80025D8C(void)
             D_800FC858[i] = 1;
         }
     }
+
+#ifdef ENHANCEMENTS
+    overlay_build_conflict_masks();
+#endif
 }
 
 s32 func_80025EC8(s32 overlay_num)
@@ -126,6 +226,13 @@ bool func_80025F18(s32 new_overlay_index)
         return true;
     }
 
+#ifdef ENHANCEMENTS
+    if (overlay_can_load(new_overlay_index))
+    {
+        return true;
+    }
+#endif
+
     for (overlay_index = 0; (u32)overlay_index < OVERLAY_COUNT; overlay_index++)
     {
         if (overlay_index == new_overlay_index
@@ -165,6 +272,825 @@ bool func_80025F18(s32 new_overlay_index)
     return true;
 }
 
+#ifdef ENHANCEMENTS
+extern OSPiHandle *nuPiCartHandle;
+
+/* Past DCACHE_SIZE/ICACHE_SIZE the libultra cache routines switch to index
+ * ops that write back and evict every line. Feeding them half-cache chunks
+ * keeps them on hit ops, so only lines inside the range are touched.
+ */
+static void overlay_cache_op(void (*op)(void *, s32), void *addr, u32 size, u32 chunk)
+{
+    u8 *cursor = addr;
+    u32 step;
+
+    while (size != 0)
+    {
+        step = size > chunk ? chunk : size;
+        op(cursor, step);
+        cursor += step;
+        size -= step;
+    }
+}
+
+#define overlay_dcache_writeback(addr, size) overlay_cache_op(osWritebackDCache, (addr), (size), DCACHE_SIZE / 2)
+#define overlay_dcache_inval(addr, size)     overlay_cache_op(osInvalDCache, (addr), (size), DCACHE_SIZE / 2)
+#define overlay_icache_inval(addr, size)     overlay_cache_op(osInvalICache, (addr), (size), ICACHE_SIZE / 2)
+
+/* Debug mode check that the range maintenance left no stale or dirty line:
+ * the cached view of the range must equal the uncached one.
+ */
+static void overlay_cache_verify(s32 overlay_index, void *start, void *end)
+{
+    u32 *cached = start;
+    u32 *uncached = OS_PHYSICAL_TO_K1(osVirtualToPhysical(start));
+
+    if (!debug_mode)
+    {
+        return;
+    }
+
+    for (; cached < (u32 *)end; cached++, uncached++)
+    {
+        if (*cached != *uncached)
+        {
+            LOG_INFO2("ModuleSet %x cache mismatch at %x\n", overlay_index, cached);
+            return;
+        }
+    }
+}
+
+/* Binary log of the last OVERLAY_TRACE_COUNT loads and unloads, in osGetCount ticks */
+static MGOverlayTrace overlay_traces[OVERLAY_TRACE_COUNT];
+static u32 overlay_trace_total;
+
+static void overlay_trace_commit(MGOverlayTrace *trace)
+{
+    overlay_traces[overlay_trace_total % OVERLAY_TRACE_COUNT] = *trace;
+    overlay_trace_total++;
+}
+
+/* Copies out up to max entries, oldest first. Returns how many were copied. */
+s32 overlay_trace_read(MGOverlayTrace *out, s32 max)
+{
+    u32 first = overlay_trace_total > OVERLAY_TRACE_COUNT ? overlay_trace_total - OVERLAY_TRACE_COUNT : 0;
+    s32 count = 0;
+
+    for (; first < overlay_trace_total && count < max; first++)
+    {
+        out[count++] = overlay_traces[first % OVERLAY_TRACE_COUNT];
+    }
+
+    return count;
+}
+
+void overlay_trace_clear(void)
+{
+    overlay_trace_total = 0;
+}
+
+static u32 overlay_trace_phase(MGOverlayTrace *trace, s32 phase)
+{
+    switch (phase)
+    {
+        case OVERLAY_TRACE_DMA:
+            return trace->dma_end - trace->dma_start;
+        case OVERLAY_TRACE_BZERO:
+            return trace->bzero_cycles;
+        case OVERLAY_TRACE_CACHE:
+            return trace->cache_cycles;
+        default:
+            return trace->call_cycles;
+    }
+}
+
+/* Per-set min/avg/max of each phase over the entries still in the ring */
+void overlay_trace_summarize(s32 overlay_index, s32 kind, MGOverlayTraceSummary *summary)
+{
+    u32 first = overlay_trace_total > OVERLAY_TRACE_COUNT ? overlay_trace_total - OVERLAY_TRACE_COUNT : 0;
+    u32 totals[OVERLAY_TRACE_PHASES];
+    MGOverlayTrace *trace;
+    u32 cycles;
+    s32 phase;
+
+    bzero(summary, sizeof(*summary));
+    bzero(totals, sizeof(totals));
+
+    for (; first < overlay_trace_total; first++)
+    {
+        trace = &overlay_traces[first % OVERLAY_TRACE_COUNT];
+        if (trace->overlay_index != overlay_index || trace->kind != kind)
+        {
+            continue;
+        }
+
+        for (phase = 0; phase < OVERLAY_TRACE_PHASES; phase++)
+        {
+            cycles = overlay_trace_phase(trace, phase);
+            if (summary->count == 0 || cycles < summary->min[phase])
+            {
+                summary->min[phase] = cycles;
+            }
+            if (cycles > summary->max[phase])
+            {
+                summary->max[phase] = cycles;
+            }
+            totals[phase] += cycles;
+        }
+
+        summary->bytes += trace->bytes;
+        summary->count++;
+    }
+
+    for (phase = 0; phase < OVERLAY_TRACE_PHASES; phase++)
+    {
+        summary->avg[phase] = summary->count != 0 ? totals[phase] / summary->count : 0;
+    }
+}
+
+void overlay_trace_print(void)
+{
+    u32 first = overlay_trace_total > OVERLAY_TRACE_COUNT ? overlay_trace_total - OVERLAY_TRACE_COUNT : 0;
+    MGOverlayTrace *trace;
+
+    osSyncPrintf("ModuleSet trace (usec): set kind src dma bzero cache call bytes\n");
+
+    for (; first < overlay_trace_total; first++)
+    {
+        trace = &overlay_traces[first % OVERLAY_TRACE_COUNT];
+        osSyncPrintf("%x %d %d %u %u %u %u %x\n",
+                     trace->overlay_index,
+                     trace->kind,
+                     trace->source,
+                     (u32)OS_CYCLES_TO_USEC(trace->dma_end - trace->dma_start),
+                     (u32)OS_CYCLES_TO_USEC(trace->bzero_cycles),
+                     (u32)OS_CYCLES_TO_USEC(trace->cache_cycles),
+                     (u32)OS_CYCLES_TO_USEC(trace->call_cycles),
+                     trace->bytes);
+    }
+}
+
+void overlay_trace_print_summary(void)
+{
+    static const char *phase_names[OVERLAY_TRACE_PHASES] = { "dma", "bzero", "cache", "call" };
+    MGOverlayTraceSummary summary;
+    u32 i;
+    s32 kind;
+    s32 phase;
+
+    for (i = 0; i < OVERLAY_COUNT; i++)
+    {
+        for (kind = OVERLAY_TRACE_LOAD; kind <= OVERLAY_TRACE_UNLOAD; kind++)
+        {
+            overlay_trace_summarize(i, kind, &summary);
+            if (summary.count == 0)
+            {
+                continue;
+            }
+
+            osSyncPrintf("ModuleSet %x %s x%u, %x bytes\n", i, kind == OVERLAY_TRACE_LOAD ? "load" : "unload",
+                         summary.count, summary.bytes);
+
+            for (phase = 0; phase < OVERLAY_TRACE_PHASES; phase++)
+            {
+                osSyncPrintf("  %s min %u avg %u max %u usec\n",
+                             phase_names[phase],
+                             (u32)OS_CYCLES_TO_USEC(summary.min[phase]),
+                             (u32)OS_CYCLES_TO_USEC(summary.avg[phase]),
+                             (u32)OS_CYCLES_TO_USEC(summary.max[phase]));
+            }
+        }
+    }
+}
+
+/* Pristine text+data images of recently loaded sets, kept in the top of the
+ * expansion pak so a reload is a copy instead of a ROM DMA. Images are
+ * captured right after the DMA, before the constructor can touch the data.
+ */
+typedef struct
+{
+    /* 0x0 */ u8 *addr;  /* NULL when the set has no resident image */
+    /* 0x4 */ u32 size;
+    /* 0x8 */ u32 stamp; /* LRU age */
+} MGOverlayResidency;
+
+static MGOverlayResidency overlay_residency[OVERLAY_COUNT];
+static u8 *overlay_residency_base;
+static u32 overlay_residency_size;
+static u32 overlay_residency_clock;
+static MGOverlayResidencyStats overlay_residency_stats;
+
+void overlay_residency_init(void *base, u32 size)
+{
+    u32 i;
+
+    overlay_residency_base = base;
+    overlay_residency_size = size;
+    overlay_residency_clock = 0;
+    bzero(&overlay_residency_stats, sizeof(overlay_residency_stats));
+
+    for (i = 0; i < OVERLAY_COUNT; i++)
+    {
+        overlay_residency[i].addr = NULL;
+    }
+}
+
+void overlay_residency_get_stats(MGOverlayResidencyStats *stats)
+{
+    *stats = overlay_residency_stats;
+}
+
+void overlay_residency_print_stats(void)
+{
+    MGOverlayResidencyStats *stats = &overlay_residency_stats;
+
+    osSyncPrintf("ModuleSet residency: %u hits %u misses (%u%%), %x bytes saved\n",
+                 stats->hits,
+                 stats->misses,
+                 stats->hits + stats->misses != 0 ? stats->hits * 100 / (stats->hits + stats->misses) : 0,
+                 stats->bytes_saved);
+    osSyncPrintf("ModuleSet residency: %u stored %u evicted %u too large\n",
+                 stats->stores,
+                 stats->evictions,
+                 stats->rejects);
+}
+
+/* First fit in the gaps between resident images; there are at most 17 of them */
+static u8 *overlay_residency_fit(u32 size)
+{
+    u8 *candidate = overlay_residency_base;
+    u8 *end = overlay_residency_base + overlay_residency_size;
+    bool moved;
+    u32 i;
+
+    do
+    {
+        moved = false;
+
+        for (i = 0; i < OVERLAY_COUNT; i++)
+        {
+            MGOverlayResidency *entry = &overlay_residency[i];
+
+            if (entry->addr != NULL && entry->addr < candidate + size && entry->addr + entry->size > candidate)
+            {
+                candidate = entry->addr + entry->size;
+                moved = true;
+            }
+        }
+    } while (moved && candidate + size <= end);
+
+    return candidate + size <= end ? candidate : NULL;
+}
+
+static void overlay_residency_store(s32 overlay_index)
+{
+    MGOverlayInfo *overlay = &overlays[overlay_index];
+    MGOverlayResidency *entry = &overlay_residency[overlay_index];
+    MGOverlayResidency *victim;
+    u32 size = (u8 *)overlay->bss_start_addr - (u8 *)overlay->overlay_start_addr;
+    u8 *addr;
+    u32 i;
+
+    if (overlay_residency_base == NULL || entry->addr != NULL)
+    {
+        return;
+    }
+
+    if (size > overlay_residency_size)
+    {
+        overlay_residency_stats.rejects++;
+        return;
+    }
+
+    while ((addr = overlay_residency_fit(size)) == NULL)
+    {
+        victim = NULL;
+
+        for (i = 0; i < OVERLAY_COUNT; i++)
+        {
+            if (overlay_residency[i].addr != NULL && (victim == NULL || overlay_residency[i].stamp < victim->stamp))
+            {
+                victim = &overlay_residency[i];
+            }
+        }
+
+        victim->addr = NULL;
+        overlay_residency_stats.evictions++;
+    }
+
+    bcopy(overlay->overlay_start_addr, addr, size);
+    entry->addr = addr;
+    entry->size = size;
+    entry->stamp = overlay_residency_clock++;
+    overlay_residency_stats.stores++;
+}
+
+/* Copies a resident image into place. Returns false on a miss. */
+static bool overlay_residency_fetch(s32 overlay_index)
+{
+    MGOverlayInfo *overlay = &overlays[overlay_index];
+    MGOverlayResidency *entry = &overlay_residency[overlay_index];
+
+    if (overlay_residency_base == NULL)
+    {
+        return false;
+    }
+
+    if (entry->addr == NULL)
+    {
+        overlay_residency_stats.misses++;
+        return false;
+    }
+
+    bcopy(entry->addr, overlay->overlay_start_addr, entry->size);
+    entry->stamp = overlay_residency_clock++;
+    overlay_residency_stats.hits++;
+    overlay_residency_stats.bytes_saved += overlay->rom_end_addr - overlay->rom_start_addr;
+    return true;
+}
+
+/* Same chunking as nuPiReadRom so audio DMAs can still interleave */
+#define OVERLAY_DMA_BLOCK_SIZE 0x4000U
+#define OVERLAY_DMA_DEPTH 8
+
+#define YAZ0_MAGIC 0x59617A30 /* "Yaz0" */
+#define YAZ0_HEADER_SIZE 0x10
+
+/* Decoder state for a packed (tools/ovlpack) overlay, kept across DMA blocks */
+typedef struct
+{
+    /* 0x0 */  u8 *src;
+    /* 0x4 */  u8 *dst;
+    /* 0x8 */  u8 *dst_end;
+    /* 0xC */  u32 group;
+    /* 0x10 */ s32 group_bits;
+} MGYaz0Stream;
+
+typedef struct
+{
+    /* 0x0 */  s32 overlay_index; /* Absolute No., valid unless state is OVERLAY_LOAD_IDLE */
+    /* 0x4 */  s32 state;
+    /* 0x8 */  bool commit;       /* Construct and activate once the image is resident */
+    /* 0xC */  u32 rom_addr;
+    /* 0x10 */ u8 *dram_addr;
+    /* 0x14 */ u32 remaining;
+    /* 0x18 */ s32 in_flight;
+    /* 0x1C */ s32 io_index;
+    /* 0x20 */ OSMesgQueue *done_queue;
+    /* 0x24 */ OSMesg done_msg;
+    /* 0x28 */ bool compressed;
+    /* 0x2C */ bool resident;     /* Filled from the expansion pak instead of ROM */
+    /* 0x30 */ u8 *stage;         /* Where a packed image lands */
+    /* 0x34 */ u8 *arrived;       /* End of the data the PI has delivered so far */
+    /* 0x38 */ u8 *stage_end;
+    /* 0x3C */ MGYaz0Stream yaz0;
+    /* 0x50 */ MGOverlayTrace trace;
+    /* 0x6C */ bool aborted;      /* Cancelled; whatever has landed is only part of the image */
+} MGOverlayLoadRequest;
+
+static MGOverlayLoadRequest overlay_request;
+static OSIoMesg overlay_io_mesgs[OVERLAY_DMA_DEPTH];
+static OSMesgQueue overlay_dma_queue;
+static OSMesg overlay_dma_mesgs[OVERLAY_DMA_DEPTH];
+static bool overlay_dma_queue_created;
+
+/* Decodes as far as the delivered input allows. Unless this is the last block,
+ * stop short of a group header plus token that might straddle the next block.
+ */
+static void overlay_yaz0_decode(MGYaz0Stream *stream, u8 *src_limit, bool last)
+{
+    u8 *src = stream->src;
+    u8 *dst = stream->dst;
+    u32 group = stream->group;
+    s32 group_bits = stream->group_bits;
+    u8 *copy;
+    u32 length;
+
+    while (dst < stream->dst_end && src < src_limit)
+    {
+        if (!last && src_limit - src < 4)
+        {
+            break;
+        }
+
+        if (group_bits == 0)
+        {
+            group = *src++;
+            group_bits = 8;
+        }
+
+        if (group & 0x80)
+        {
+            *dst++ = *src++;
+        }
+        else
+        {
+            copy = dst - ((((src[0] & 0xF) << 8) | src[1]) + 1);
+            length = src[0] >> 4;
+            src += 2;
+
+            if (length == 0)
+            {
+                length = *src++ + 0x12;
+            }
+            else
+            {
+                length += 2;
+            }
+
+            if (length > (u32)(stream->dst_end - dst))
+            {
+                length = stream->dst_end - dst;
+            }
+
+            while (length-- != 0)
+            {
+                *dst++ = *copy++;
+            }
+        }
+
+        group <<= 1;
+        group_bits--;
+    }
+
+    stream->src = src;
+    stream->dst = dst;
+    stream->group = group;
+    stream->group_bits = group_bits;
+}
+
+/* Keep up to OVERLAY_DMA_DEPTH blocks queued on the PI manager */
+static void overlay_dma_issue(void)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+    OSIoMesg *io;
+    u32 read_size;
+
+    while (req->in_flight < OVERLAY_DMA_DEPTH && req->remaining != 0)
+    {
+        read_size = req->remaining > OVERLAY_DMA_BLOCK_SIZE ? OVERLAY_DMA_BLOCK_SIZE : req->remaining;
+
+        io = &overlay_io_mesgs[req->io_index];
+        io->hdr.pri = OS_MESG_PRI_NORMAL;
+        io->hdr.retQueue = &overlay_dma_queue;
+        io->dramAddr = req->dram_addr;
+        io->devAddr = req->rom_addr;
+        io->size = read_size;
+        osEPiStartDma(nuPiCartHandle, io, OS_READ);
+
+        req->io_index = (req->io_index + 1) % OVERLAY_DMA_DEPTH;
+        req->in_flight++;
+        req->rom_addr += read_size;
+        req->dram_addr += read_size;
+        req->remaining -= read_size;
+    }
+}
+
+/* Reap finished blocks and refill the window. With OS_MESG_BLOCK this only
+ * returns once the whole image has landed.
+ */
+static void overlay_dma_service(s32 flag)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+
+    while (req->in_flight != 0)
+    {
+        if (osRecvMesg(&overlay_dma_queue, NULL, flag) != 0)
+        {
+            break;
+        }
+
+        req->in_flight--;
+        if (req->in_flight == 0 && req->remaining == 0)
+        {
+            /* The last block, taken before its decode so that isn't counted as DMA */
+            req->trace.dma_end = osGetCount();
+        }
+
+        overlay_dma_issue();
+
+        if (req->compressed && !req->aborted)
+        {
+            /* Blocks complete in order, so the next block's DMA overlaps this decode */
+            req->arrived += OVERLAY_DMA_BLOCK_SIZE;
+            if (req->arrived > req->stage_end)
+            {
+                req->arrived = req->stage_end;
+            }
+
+            overlay_yaz0_decode(&req->yaz0, req->arrived, req->arrived == req->stage_end);
+        }
+    }
+
+    if (req->state == OVERLAY_LOAD_BUSY && req->remaining == 0 && req->in_flight == 0 && !req->aborted)
+    {
+        /* Only a whole image may be kept for later loads */
+        if (req->compressed && req->yaz0.dst != req->yaz0.dst_end)
+        {
+            LOG_INFO1("ModuleSet %x packed image is truncated\n", req->overlay_index);
+        }
+        else
+        {
+            overlay_residency_store(req->overlay_index);
+        }
+
+        req->state = OVERLAY_LOAD_PREFETCHED;
+    }
+}
+
+/* Stop issuing blocks and wait out the ones the PI manager already holds */
+static void overlay_request_cancel(void)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+
+    LOG_INFO1("Drop Prefetch ModuleSet %x (absolute No.)\n", req->overlay_index);
+
+    req->remaining = 0;
+    req->aborted = true;
+    overlay_dma_service(OS_MESG_BLOCK);
+    req->state = OVERLAY_LOAD_IDLE;
+}
+
+/* Byte by byte, so the host harness reads it the same */
+static u32 overlay_read_be32(u8 *p)
+{
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+/* Reads the Yaz0 header of a packed image into its stage, which the caller
+ * has invalidated. True if it is one tools/ovlpack wrote for this set: the
+ * magic, then the set's text+data as the decoded size.
+ */
+static bool overlay_yaz0_probe(MGOverlayInfo *overlay, u8 *stage)
+{
+    OSIoMesg *io = &overlay_io_mesgs[0];
+
+    io->hdr.pri = OS_MESG_PRI_NORMAL;
+    io->hdr.retQueue = &overlay_dma_queue;
+    io->dramAddr = stage;
+    io->devAddr = overlay->rom_start_addr;
+    io->size = YAZ0_HEADER_SIZE;
+    osEPiStartDma(nuPiCartHandle, io, OS_READ);
+    osRecvMesg(&overlay_dma_queue, NULL, OS_MESG_BLOCK);
+
+    return overlay_read_be32(stage) == YAZ0_MAGIC
+        && overlay_read_be32(stage + 4) == (u32)((u8 *)overlay->bss_start_addr - (u8 *)overlay->overlay_start_addr);
+}
+
+/* Returns false, leaving the request idle, for a packed image that isn't one */
+static bool overlay_request_begin(s32 overlay_index, bool commit)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+    MGOverlayInfo *overlay = &overlays[overlay_index];
+    u32 size = overlay->rom_end_addr - overlay->rom_start_addr;
+    u8 *dram_addr = overlay->overlay_start_addr;
+
+    if (!overlay_dma_queue_created)
+    {
+        osCreateMesgQueue(&overlay_dma_queue, overlay_dma_mesgs, OVERLAY_DMA_DEPTH);
+        overlay_dma_queue_created = true;
+    }
+
+    req->overlay_index = overlay_index;
+    req->commit = commit;
+    req->in_flight = 0;
+    req->aborted = false;
+    req->done_queue = NULL;
+    req->done_msg = NULL;
+    req->compressed = false;
+
+    bzero(&req->trace, sizeof(req->trace));
+    req->trace.overlay_index = overlay_index;
+    req->trace.kind = OVERLAY_TRACE_LOAD;
+    req->trace.dma_start = osGetCount();
+
+    req->resident = overlay_residency_fetch(overlay_index);
+    if (req->resident)
+    {
+        LOG_INFO1("ModuleSet %x is resident\n", overlay_index);
+        req->trace.source = OVERLAY_TRACE_RESIDENT;
+        req->trace.bytes = (u8 *)overlay->bss_start_addr - (u8 *)overlay->overlay_start_addr;
+        req->trace.dma_end = osGetCount();
+        req->remaining = 0;
+        req->state = OVERLAY_LOAD_PREFETCHED;
+        return true;
+    }
+
+    /* A ROM image smaller than text+data can't be a raw one, so it must carry
+     * the Yaz0 header ovlpack writes; the decoder is only started once that
+     * has been read back. The image is staged at the end of the set's own
+     * footprint and decoded forwards in place; ovlpack only packs a set if
+     * the decoder can never overtake its input.
+     */
+    if (size < (u32)((u8 *)overlay->bss_start_addr - (u8 *)overlay->overlay_start_addr))
+    {
+        dram_addr = (u8 *)(((u32)overlay->overlay_end_addr - size) & ~0xF);
+        overlay_dcache_inval(dram_addr, size);
+
+        if (!overlay_yaz0_probe(overlay, dram_addr))
+        {
+            LOG_INFO1("ModuleSet %x packed image has a bad header\n", overlay_index);
+            return false;
+        }
+
+        req->compressed = true;
+        req->yaz0.src = dram_addr + YAZ0_HEADER_SIZE;
+        req->yaz0.dst = overlay->overlay_start_addr;
+        req->yaz0.dst_end = overlay->bss_start_addr;
+        req->yaz0.group = 0;
+        req->yaz0.group_bits = 0;
+        LOG_INFO2("ModuleSet %x is packed (%x bytes)\n", overlay_index, size);
+    }
+    else
+    {
+        overlay_dcache_inval(dram_addr, size);
+    }
+
+    req->trace.source = req->compressed ? OVERLAY_TRACE_PACKED : OVERLAY_TRACE_ROM;
+    req->trace.bytes = size;
+    req->state = OVERLAY_LOAD_BUSY;
+    req->rom_addr = overlay->rom_start_addr;
+    req->dram_addr = dram_addr;
+    req->stage = dram_addr;
+    req->arrived = dram_addr;
+    req->stage_end = dram_addr + size;
+    req->remaining = size;
+
+    overlay_dma_issue();
+    return true;
+}
+
+/* Runs on whichever thread polls, which is the game thread */
+static void overlay_request_finish(void)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+    MGOverlayInfo *overlay = &overlays[req->overlay_index];
+    MGOverlayTrace *trace = &req->trace;
+    u32 byte_index;
+    s8 *bytes;
+    u32 count;
+
+    bytes = overlay->unk_0x4;
+
+    count = osGetCount();
+    bzero(overlay->bss_start_addr, overlay->overlay_end_addr - overlay->bss_start_addr);
+    trace->bzero_cycles = osGetCount() - count;
+
+    count = osGetCount();
+    if (req->compressed || req->resident)
+    {
+        /* The decoder or the copy wrote text and data through the D-cache */
+        overlay_dcache_writeback(overlay->overlay_start_addr, overlay->overlay_end_addr - overlay->overlay_start_addr);
+    }
+    else
+    {
+        overlay_dcache_writeback(overlay->bss_start_addr, overlay->overlay_end_addr - overlay->bss_start_addr);
+    }
+
+    overlay_icache_inval(overlay->overlay_start_addr, overlay->data_start_addr - overlay->overlay_start_addr);
+    trace->cache_cycles = osGetCount() - count;
+    overlay_cache_verify(req->overlay_index, overlay->overlay_start_addr, overlay->overlay_end_addr);
+
+    count = osGetCount();
+    if (overlay->constructor != NULL)
+    {
+        overlay->constructor();
+    }
+    trace->call_cycles = osGetCount() - count;
+    overlay_trace_commit(trace);
+
+    for (byte_index = 0; bytes[byte_index] != -1; byte_index++)
+    {
+        D_800FC858[bytes[byte_index]] = 1;
+    }
+
+    overlay->active = true;
+    overlay_live_mask |= 1 << req->overlay_index;
+    req->state = OVERLAY_LOAD_IDLE;
+
+    LOG_INFO1("Complete Load ModuleSet %x (absolute No.)\n", req->overlay_index);
+
+    if (req->done_queue != NULL)
+    {
+        osSendMesg(req->done_queue, req->done_msg, OS_MESG_NOBLOCK);
+    }
+}
+
+/* Advances the pending load. Returns OVERLAY_LOAD_COMPLETE exactly once, on the
+ * call that ran the constructor.
+ */
+s32 overlay_load_poll(void)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+
+    if (req->state == OVERLAY_LOAD_IDLE)
+    {
+        return OVERLAY_LOAD_IDLE;
+    }
+
+    overlay_dma_service(OS_MESG_NOBLOCK);
+
+    if (req->state == OVERLAY_LOAD_PREFETCHED && req->commit)
+    {
+        overlay_request_finish();
+        return OVERLAY_LOAD_COMPLETE;
+    }
+
+    return req->state;
+}
+
+s32 overlay_load_wait(void)
+{
+    if (overlay_request.state == OVERLAY_LOAD_IDLE)
+    {
+        return OVERLAY_LOAD_IDLE;
+    }
+
+    overlay_dma_service(OS_MESG_BLOCK);
+    return overlay_load_poll();
+}
+
+/* Starts pulling a module set in without constructing it. Only a hint: it is
+ * ignored while another load is in flight or if the set can't load right now.
+ */
+bool overlay_prefetch(s32 overlay_num)
+{
+    s32 overlay_index = func_80025EC8(overlay_num);
+
+    if (overlay_request.state != OVERLAY_LOAD_IDLE || overlays[overlay_index].active)
+    {
+        return false;
+    }
+
+    if (!func_80025F18(overlay_num))
+    {
+        return false;
+    }
+
+    LOG_INFO1("Prefetch ModuleSet %x (absolute No.)\n", overlay_index);
+    return overlay_request_begin(overlay_index, false);
+}
+
+/* Queues a load. done_queue (optional) receives done_msg once the constructor
+ * has run from overlay_load_poll/overlay_load_wait. Fails while another
+ * committed load is still in flight.
+ */
+bool load_overlay_async(s32 overlay_num, OSMesgQueue *done_queue, OSMesg done_msg)
+{
+    MGOverlayLoadRequest *req = &overlay_request;
+    s32 overlay_index;
+
+    if (!func_80025F18(overlay_num))
+    {
+        LOG_INFO1("Can't Load ModuleSet %x (logical No.)\n", overlay_num);
+        return false;
+    }
+
+    overlay_index = func_80025EC8(overlay_num);
+
+    if (req->state != OVERLAY_LOAD_IDLE && req->overlay_index != overlay_index)
+    {
+        if (req->commit)
+        {
+            LOG_INFO1("Can't Load ModuleSet %x (PI busy)\n", overlay_index);
+            return false;
+        }
+
+        overlay_request_cancel();
+    }
+
+    LOG_INFO1("Load ModuleSet %x (absolute No.)\n", overlay_index);
+
+    if (req->state == OVERLAY_LOAD_IDLE && !overlay_request_begin(overlay_index, true))
+    {
+        LOG_INFO1("Can't Load ModuleSet %x (bad image)\n", overlay_index);
+        return false;
+    }
+
+    req->commit = true;
+    req->done_queue = done_queue;
+    req->done_msg = done_msg;
+
+    overlay_load_poll();
+    return true;
+}
+
+bool load_overlay(s32 overlay_index)
+{
+    if (overlay_request.state != OVERLAY_LOAD_IDLE && overlay_request.commit)
+    {
+        overlay_load_wait();
+    }
+
+    if (!load_overlay_async(overlay_index, NULL, NULL))
+    {
+        return false;
+    }
+
+    overlay_load_wait();
+    return true;
+}
+#else
 bool load_overlay(s32 overlay_index)
 {
     bool success;
@@ -216,7 +1142,64 @@ bool load_overlay(s32 overlay_index)
 
     return success;
 }
+#endif
+
+#ifdef ENHANCEMENTS
+void unload_overlay(s32 overlay_index)
+{
+    MGOverlayInfo *overlay;
+    MGOverlayTrace trace;
+    u32 byte_index;
+    s8 *bytes;
+    u32 count;
 
+    overlay_index = func_80025EC8(overlay_index);
+    overlay = &overlays[overlay_index];
+    if (!overlay->active)
+    {
+        return;
+    }
+
+    bzero(&trace, sizeof(trace));
+    trace.overlay_index = overlay_index;
+    trace.kind = OVERLAY_TRACE_UNLOAD;
+
+    count = osGetCount();
+    if (overlay->destructor != NULL)
+    {
+        overlay->destructor();
+    }
+    trace.call_cycles = osGetCount() - count;
+
+    bytes = overlay->unk_0x4;
+    overlay->active = false;
+    overlay_live_mask &= ~(1 << overlay_index);
+    LOG_INFO1("Moduleset %x Disposed\n", overlay_index);
+
+    for (byte_index = 0; bytes[byte_index] != -1; byte_index++)
+    {
+        D_800FC858[bytes[byte_index]] = 0;
+    }
+
+    /* Text is never dirtied by the CPU, so only data and bss need writing back */
+    count = osGetCount();
+    overlay_dcache_writeback(overlay->data_start_addr, overlay->overlay_end_addr - overlay->data_start_addr);
+    trace.cache_cycles = osGetCount() - count;
+    trace.bytes = (u8 *)overlay->overlay_end_addr - (u8 *)overlay->data_start_addr;
+
+    if (debug_mode && (osVirtualToPhysical(overlay->overlay_start_addr) <= 0x3FFFFFU))
+    {
+        count = osGetCount();
+        bzero(overlay->overlay_start_addr, overlay->data_start_addr - overlay->overlay_start_addr);
+        trace.bzero_cycles = osGetCount() - count;
+        overlay_dcache_writeback(overlay->overlay_start_addr, overlay->data_start_addr - overlay->overlay_start_addr);
+        overlay_icache_inval(overlay->overlay_start_addr, overlay->data_start_addr - overlay->overlay_start_addr);
+    }
+
+    overlay_cache_verify(overlay_index, overlay->overlay_start_addr, overlay->overlay_end_addr);
+    overlay_trace_commit(&trace);
+}
+#else
 void unload_overlay(s32 overlay_index)
 {
     MGOverlayInfo *overlay;
@@ -261,6 +1244,7 @@ void unload_overlay(s32 overlay_index)
         osInvalICache(overlay->overlay_start_addr, overlay->data_start_addr - overlay->overlay_start_addr);
     }
 }
+#endif
 
 /* Likely unused */
 s32 func_80026358(void)
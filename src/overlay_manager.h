@@ -3,7 +3,122 @@
 
 #include "mg_type.h"
 
+typedef struct
+{
+    /* 0x0 */  s8 active;
+    /* 0x4 */  s8 *unk_0x4;
+    /* 0x8 */  u32 rom_start_addr;
+    /* 0xC */  u32 rom_end_addr;
+    /* 0x10 */ void *overlay_start_addr;
+    /* 0x14 */ void *data_start_addr;
+    /* 0x18 */ void *bss_start_addr;
+    /* 0x1C */ void *overlay_end_addr;
+    /* 0x20 */ void (*constructor)(void); /* These likely take some void ptr arguments... */
+    /* 0x24 */ void (*destructor)(void);
+} MGOverlayInfo;
+
+extern MGOverlayInfo overlays[17];
+
 void func_80025D8C(void);
+bool func_80025F18(s32 new_overlay_index);
 bool load_overlay(s32 overlay_index);
+void unload_overlay(s32 overlay_index);
+
+#ifdef ENHANCEMENTS
+#include "ultra64.h"
+
+typedef enum
+{
+    OVERLAY_LOAD_IDLE,
+    OVERLAY_LOAD_BUSY,       /* ROM DMA in flight */
+    OVERLAY_LOAD_PREFETCHED, /* Image resident, waiting to be committed */
+    OVERLAY_LOAD_COMPLETE    /* Constructor ran during this poll */
+} MGOverlayLoadState;
+
+/* What func_8004E1E0 gives overlay_residency_init off the top of the
+ * expansion pak before handing the rest to the heap. Without the expansion
+ * pak the cache stays off.
+ */
+#ifndef OVERLAY_RESIDENCY_SIZE
+#define OVERLAY_RESIDENCY_SIZE 0x100000
+#endif
+
+typedef struct
+{
+    /* 0x0 */  u32 hits;
+    /* 0x4 */  u32 misses;
+    /* 0x8 */  u32 bytes_saved; /* ROM bytes not DMA'd thanks to hits */
+    /* 0xC */  u32 stores;
+    /* 0x10 */ u32 evictions;
+    /* 0x14 */ u32 rejects;     /* Images larger than the whole cache */
+} MGOverlayResidencyStats;
+
+/* load_overlay is load_overlay_async followed by overlay_load_wait. Nothing
+ * else calls these yet: the scene code that switches module sets, menu to
+ * course included, is still asm, so there's no C call site for a prefetch.
+ * ovlharness exercises them until there is.
+ */
+bool load_overlay_async(s32 overlay_num, OSMesgQueue *done_queue, OSMesg done_msg);
+bool overlay_prefetch(s32 overlay_num);
+s32 overlay_load_poll(void);
+s32 overlay_load_wait(void);
+
+#define OVERLAY_TRACE_COUNT 64
+
+typedef enum
+{
+    OVERLAY_TRACE_LOAD,
+    OVERLAY_TRACE_UNLOAD
+} MGOverlayTraceKind;
+
+typedef enum
+{
+    OVERLAY_TRACE_ROM,
+    OVERLAY_TRACE_PACKED,
+    OVERLAY_TRACE_RESIDENT
+} MGOverlayTraceSource;
+
+typedef enum
+{
+    OVERLAY_TRACE_DMA,
+    OVERLAY_TRACE_BZERO,
+    OVERLAY_TRACE_CACHE,
+    OVERLAY_TRACE_CALL, /* Constructor or destructor */
+    OVERLAY_TRACE_PHASES
+} MGOverlayTracePhase;
+
+/* Timestamps and durations are osGetCount ticks */
+typedef struct
+{
+    /* 0x0 */  u8 overlay_index;
+    /* 0x1 */  u8 kind;
+    /* 0x2 */  u8 source;
+    /* 0x4 */  u32 dma_start;    /* Also brackets the copy for resident images */
+    /* 0x8 */  u32 dma_end;      /* Last block's completion as received; a poll sees it late */
+    /* 0xC */  u32 bzero_cycles;
+    /* 0x10 */ u32 cache_cycles;
+    /* 0x14 */ u32 call_cycles;
+    /* 0x18 */ u32 bytes;        /* Read from ROM or the expansion pak; written back on unload */
+} MGOverlayTrace;
+
+typedef struct
+{
+    /* 0x0 */  u32 count;
+    /* 0x4 */  u32 bytes;
+    /* 0x8 */  u32 min[OVERLAY_TRACE_PHASES];
+    /* 0x18 */ u32 avg[OVERLAY_TRACE_PHASES];
+    /* 0x28 */ u32 max[OVERLAY_TRACE_PHASES];
+} MGOverlayTraceSummary;
+
+s32 overlay_trace_read(MGOverlayTrace *out, s32 max);
+void overlay_trace_clear(void);
+void overlay_trace_summarize(s32 overlay_index, s32 kind, MGOverlayTraceSummary *summary);
+void overlay_trace_print(void);
+void overlay_trace_print_summary(void);
+
+void overlay_residency_init(void *base, u32 size);
+void overlay_residency_get_stats(MGOverlayResidencyStats *stats);
+void overlay_residency_print_stats(void);
+#endif
 
 #endif
@@ -0,0 +1,532 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "acmd.h"
+#include "kernels.h"
+
+#define ALIGN(x, a) (((x) + ((a) - 1)) & ~((a) - 1))
+
+#define MAX_COUNT ACMD_MAX_COUNT
+
+#define FLAG_INIT 0x01
+#define FLAG_LOOP 0x02
+#define FLAG_LEFT 0x02
+#define FLAG_VOL  0x04
+#define FLAG_AUX  0x08
+
+typedef struct {
+    int64_t value;
+    int64_t step;
+    int64_t target;
+} Ramp;
+
+/* What ENVMIXER keeps in the voice's ENVMIX_STATE between frames */
+typedef struct {
+    int16_t wet;
+    int16_t pad0;
+    int16_t dry;
+    int16_t pad1;
+    int32_t target[2];
+    int32_t rate[2];
+    int32_t seq[2];
+    int32_t value[2];
+} EnvState;
+
+static const AcmdKernels* const kernel_sets[ACMD_KERNELS_COUNT] = {
+    &acmd_kernels_scalar,
+#ifdef ACMD_HAVE_X86
+    &acmd_kernels_sse2,
+    &acmd_kernels_avx2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const char* const kernel_names[ACMD_KERNELS_COUNT] = { "scalar", "sse2", "avx2" };
+
+static int cpu_supports(AcmdKernelLevel level) {
+    if (level == ACMD_KERNELS_SCALAR) {
+        return 1;
+    }
+    if (level >= ACMD_KERNELS_COUNT || kernel_sets[level] == NULL) {
+        return 0;
+    }
+#ifdef ACMD_HAVE_X86
+    __builtin_cpu_init();
+    if (level == ACMD_KERNELS_SSE2) {
+        return __builtin_cpu_supports("sse2");
+    }
+    if (level == ACMD_KERNELS_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return 0;
+}
+
+AcmdKernelLevel acmd_best_kernels(void) {
+    int level;
+
+    for (level = ACMD_KERNELS_COUNT - 1; level > ACMD_KERNELS_SCALAR; level--) {
+        if (cpu_supports((AcmdKernelLevel)level)) {
+            return (AcmdKernelLevel)level;
+        }
+    }
+    return ACMD_KERNELS_SCALAR;
+}
+
+const char* acmd_kernels_name(AcmdKernelLevel level) {
+    return level < ACMD_KERNELS_COUNT ? kernel_names[level] : "?";
+}
+
+AcmdKernelLevel acmd_kernels_from_env(void) {
+    const char* name = getenv("ACMD_KERNELS");
+    int level;
+
+    if (name != NULL) {
+        for (level = 0; level < ACMD_KERNELS_COUNT; level++) {
+            if (strcmp(name, kernel_names[level]) == 0 && cpu_supports((AcmdKernelLevel)level)) {
+                return (AcmdKernelLevel)level;
+            }
+        }
+    }
+    return acmd_best_kernels();
+}
+
+int acmd_set_kernels(AcmdState* state, AcmdKernelLevel level) {
+    if (!cpu_supports(level)) {
+        return 0;
+    }
+    state->kernels = kernel_sets[level];
+    state->level = level;
+    return 1;
+}
+
+void acmd_init(AcmdState* state, void* rdram, size_t rdram_size) {
+    int i;
+
+    memset(state, 0, sizeof(*state));
+    state->rdram = rdram;
+    state->rdram_size = rdram_size;
+    for (i = 0; i < 16; i++) {
+        acmd_adpcm_matrix(state->adpcm_matrix[i], state->codebook + i * 16);
+    }
+    acmd_set_kernels(state, acmd_best_kernels());
+}
+
+static uint32_t address(AcmdState* state, uint32_t so) {
+    return state->segments[(so >> 24) % ACMD_SEGMENTS] + (so & 0xFFFFFF);
+}
+
+/* DRAM for a DMA of size bytes, or NULL if it falls outside the image */
+static uint8_t* dram(AcmdState* state, uint32_t addr, size_t size) {
+    if (addr > state->rdram_size || size > state->rdram_size - addr) {
+        state->stats.bad_addresses++;
+        return NULL;
+    }
+    return state->rdram + addr;
+}
+
+static uint8_t* dmem(AcmdState* state, uint32_t addr) {
+    return state->dmem.u8 + (addr & (ACMD_DMEM_SIZE - 1));
+}
+
+static int16_t* dmem16(AcmdState* state, uint32_t addr) {
+    return (int16_t*)dmem(state, addr & ~1);
+}
+
+static uint32_t buffer_count(AcmdState* state, uint32_t align) {
+    uint32_t count = ALIGN((uint32_t)state->count, align);
+
+    return count < MAX_COUNT ? count : MAX_COUNT;
+}
+
+/* The vector kernels read a group before writing it, so partially overlapping
+ * buffers go through the scalar kernel to keep its sample-by-sample order. */
+static int overlaps(const void* a, size_t a_size, const void* b, size_t b_size) {
+    const uint8_t* pa = a;
+    const uint8_t* pb = b;
+
+    return pa != pb && pa < pb + b_size && pb < pa + a_size;
+}
+
+static void cmd_adpcm(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint8_t flags = w0 >> 16;
+    uint32_t addr = address(state, w1);
+    uint32_t count = buffer_count(state, 32);
+    uint32_t in = state->in;
+    int16_t* out = dmem16(state, state->out);
+    int16_t last[16];
+    int16_t x[10];
+    uint8_t* saved;
+    uint32_t i;
+
+    if (flags & FLAG_INIT) {
+        memset(last, 0, sizeof(last));
+    } else if ((saved = dram(state, (flags & FLAG_LOOP) ? state->loop : addr, sizeof(last))) != NULL) {
+        memcpy(last, saved, sizeof(last));
+    } else {
+        memset(last, 0, sizeof(last));
+    }
+
+    memcpy(out, last, sizeof(last));
+    out += 16;
+
+    for (; count != 0; count -= 32) {
+        uint8_t code = *dmem(state, in++);
+        uint32_t rshift = (code >> 4) < 12 ? 12 - (code >> 4) : 0;
+        const int16_t* book = state->codebook + (code & 0xF) * 16;
+        const int16_t* matrix = state->adpcm_matrix[code & 0xF];
+        int16_t residuals[16];
+
+        for (i = 0; i < 8; i++) {
+            uint8_t byte = *dmem(state, in++);
+
+            residuals[i * 2] = (int16_t)((byte & 0xF0) << 8) >> rshift;
+            residuals[i * 2 + 1] = (int16_t)((byte & 0x0F) << 12) >> rshift;
+        }
+
+        x[0] = last[14];
+        x[1] = last[15];
+        memcpy(x + 2, residuals, 8 * sizeof(int16_t));
+        state->kernels->adpcm(last, book, matrix, x);
+
+        x[0] = last[6];
+        x[1] = last[7];
+        memcpy(x + 2, residuals + 8, 8 * sizeof(int16_t));
+        state->kernels->adpcm(last + 8, book, matrix, x);
+
+        memcpy(out, last, sizeof(last));
+        out += 16;
+    }
+
+    if ((saved = dram(state, addr, sizeof(last))) != NULL) {
+        memcpy(saved, last, sizeof(last));
+    }
+}
+
+static void cmd_clearbuff(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint32_t count = w1 & 0xFFF;
+
+    if (count != 0) {
+        memset(dmem(state, (w0 & 0xFFFF) + ACMD_DMEM_BASE), 0, ALIGN(count, 16));
+    }
+}
+
+static int16_t ramp_step(Ramp* ramp) {
+    int reached;
+
+    ramp->value += ramp->step;
+    reached = (ramp->step <= 0) ? (ramp->value <= ramp->target) : (ramp->value >= ramp->target);
+    if (reached) {
+        ramp->value = ramp->target;
+        ramp->step = 0;
+    }
+    return (int16_t)(ramp->value >> 16);
+}
+
+static void cmd_envmixer(AcmdState* state, uint32_t w0, uint32_t w1) {
+    int16_t (*gains)[ACMD_MAX_COUNT / 2] = state->gains;
+    uint8_t flags = w0 >> 16;
+    uint32_t addr = address(state, w1);
+    uint32_t count = buffer_count(state, 16);
+    uint32_t samples = count / 2;
+    const int16_t* in = dmem16(state, state->in);
+    int16_t* outputs[4];
+    const AcmdKernels* kernels;
+    EnvState env;
+    Ramp ramps[2];
+    int32_t seq[2];
+    int32_t rates[2];
+    int16_t dry;
+    int16_t wet;
+    uint8_t* saved = dram(state, addr, sizeof(EnvState));
+    uint32_t i;
+    int n;
+    int k;
+
+    if ((flags & FLAG_INIT) || saved == NULL) {
+        for (k = 0; k < 2; k++) {
+            ramps[k].value = (int32_t)state->vol[k] * 0x10000;
+            ramps[k].target = (int32_t)state->target[k] * 0x10000;
+            rates[k] = state->rate[k];
+            seq[k] = (int32_t)((int64_t)state->vol[k] * state->rate[k]);
+        }
+        dry = state->dry;
+        wet = state->wet;
+    } else {
+        memcpy(&env, saved, sizeof(env));
+        for (k = 0; k < 2; k++) {
+            ramps[k].value = env.value[k];
+            ramps[k].target = env.target[k];
+            rates[k] = env.rate[k];
+            seq[k] = env.seq[k];
+        }
+        dry = env.dry;
+        wet = env.wet;
+    }
+
+    for (k = 0; k < 2; k++) {
+        ramps[k].step = ramps[k].target - ramps[k].value;
+    }
+
+    /* The volume ramps don't depend on the samples, so work out every gain first */
+    for (i = 0; i < samples; i += 8) {
+        for (k = 0; k < 2; k++) {
+            if (ramps[k].step != 0) {
+                seq[k] = (int32_t)(((int64_t)seq[k] * rates[k]) >> 16);
+                ramps[k].step = (seq[k] - ramps[k].value) >> 3;
+            }
+        }
+        for (k = 0; k < 8; k++) {
+            int16_t l_vol = ramp_step(&ramps[0]);
+            int16_t r_vol = ramp_step(&ramps[1]);
+
+            gains[0][i + k] = acmd_clamp16((l_vol * dry + 0x4000) >> 15);
+            gains[1][i + k] = acmd_clamp16((r_vol * dry + 0x4000) >> 15);
+            gains[2][i + k] = acmd_clamp16((l_vol * wet + 0x4000) >> 15);
+            gains[3][i + k] = acmd_clamp16((r_vol * wet + 0x4000) >> 15);
+        }
+    }
+
+    outputs[0] = dmem16(state, state->out);
+    outputs[1] = dmem16(state, state->dry_right);
+    outputs[2] = dmem16(state, state->wet_left);
+    outputs[3] = dmem16(state, state->wet_right);
+    n = (flags & FLAG_AUX) ? 4 : 2;
+    for (k = 0; k < n; k++) {
+        kernels = overlaps(outputs[k], count, in, count) ? &acmd_kernels_scalar : state->kernels;
+        kernels->mix_gains(outputs[k], in, gains[k], samples);
+    }
+
+    if (saved != NULL) {
+        memset(&env, 0, sizeof(env));
+        env.wet = wet;
+        env.dry = dry;
+        for (k = 0; k < 2; k++) {
+            env.target[k] = (int32_t)ramps[k].target;
+            env.rate[k] = rates[k];
+            env.seq[k] = seq[k];
+            env.value[k] = (int32_t)ramps[k].value;
+        }
+        memcpy(saved, &env, sizeof(env));
+    }
+}
+
+static void cmd_loadbuff(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint32_t count = ALIGN((uint32_t)state->count, 8);
+    uint8_t* src;
+
+    if (state->count != 0 && (src = dram(state, address(state, w1) & ~7, count)) != NULL) {
+        memcpy(dmem(state, state->in & ~3), src, count < MAX_COUNT ? count : MAX_COUNT);
+    }
+}
+
+static void cmd_savebuff(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint32_t count = ALIGN((uint32_t)state->count, 8);
+    uint8_t* dst;
+
+    if (state->count != 0 && (dst = dram(state, address(state, w1) & ~7, count)) != NULL) {
+        memcpy(dst, dmem(state, state->out & ~3), count < MAX_COUNT ? count : MAX_COUNT);
+    }
+}
+
+static void cmd_resample(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint16_t* pos = state->positions;
+    uint8_t* phase = state->phases;
+    uint8_t flags = w0 >> 16;
+    uint32_t pitch = (w0 & 0xFFFF) << 1;
+    uint32_t addr = address(state, w1);
+    uint32_t n = buffer_count(state, 16) / 2;
+    int16_t* src = dmem16(state, state->in - 8);
+    int16_t* dst = dmem16(state, state->out);
+    uint8_t* saved = dram(state, addr, 10);
+    const AcmdKernels* kernels;
+    uint32_t accu;
+    uint32_t p = 0;
+    uint16_t accu16;
+    uint32_t i;
+
+    if ((flags & FLAG_INIT) || saved == NULL) {
+        memset(src, 0, 4 * sizeof(int16_t));
+        accu = 0;
+    } else {
+        memcpy(src, saved, 4 * sizeof(int16_t));
+        memcpy(&accu16, saved + 8, sizeof(accu16));
+        accu = accu16;
+    }
+
+    for (i = 0; i < n; i++) {
+        pos[i] = p;
+        phase[i] = (accu & 0xFC00) >> 10;
+        accu += pitch;
+        p += accu >> 16;
+        accu &= 0xFFFF;
+    }
+
+    kernels = overlaps(dst, n * 2, src, (pos[n ? n - 1 : 0] + 4) * 2) ? &acmd_kernels_scalar : state->kernels;
+    kernels->resample(dst, src, pos, phase, n);
+
+    if (saved != NULL) {
+        accu16 = accu;
+        memcpy(saved, src + p, 4 * sizeof(int16_t));
+        memcpy(saved + 8, &accu16, sizeof(accu16));
+    }
+}
+
+static void cmd_setbuff(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint8_t flags = w0 >> 16;
+
+    if (flags & FLAG_AUX) {
+        state->dry_right = (w0 & 0xFFFF) + ACMD_DMEM_BASE;
+        state->wet_left = (w1 >> 16) + ACMD_DMEM_BASE;
+        state->wet_right = (w1 & 0xFFFF) + ACMD_DMEM_BASE;
+    } else {
+        state->in = (w0 & 0xFFFF) + ACMD_DMEM_BASE;
+        state->out = (w1 >> 16) + ACMD_DMEM_BASE;
+        state->count = w1 & 0xFFFF;
+    }
+}
+
+static void cmd_setvol(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint8_t flags = w0 >> 16;
+    int lr = (flags & FLAG_LEFT) ? 0 : 1;
+
+    if (flags & FLAG_AUX) {
+        state->dry = w0 & 0xFFFF;
+        state->wet = w1 & 0xFFFF;
+    } else if (flags & FLAG_VOL) {
+        state->vol[lr] = w0 & 0xFFFF;
+    } else {
+        state->target[lr] = w0 & 0xFFFF;
+        state->rate[lr] = w1;
+    }
+}
+
+static void cmd_dmemmove(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint8_t* src = dmem(state, (w0 & 0xFFFF) + ACMD_DMEM_BASE);
+    uint8_t* dst = dmem(state, (w1 >> 16) + ACMD_DMEM_BASE);
+    uint32_t count = ALIGN(w1 & 0xFFFF, 16);
+    uint32_t i;
+
+    if (count > MAX_COUNT) {
+        count = MAX_COUNT;
+    }
+    /* A byte at a time, so an overlapping move forwards repeats like the microcode's */
+    if (overlaps(dst, count, src, count) && dst > src) {
+        for (i = 0; i < count; i++) {
+            dst[i] = src[i];
+        }
+    } else {
+        memmove(dst, src, count);
+    }
+}
+
+static void cmd_loadadpcm(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint32_t count = ALIGN(w0 & 0xFFFF, 8);
+    uint8_t* src;
+    int i;
+
+    if (count > sizeof(state->codebook)) {
+        count = sizeof(state->codebook);
+    }
+    if ((src = dram(state, address(state, w1), count)) != NULL) {
+        memcpy(state->codebook, src, count);
+        for (i = 0; i < (int)(count + 31) / 32; i++) {
+            acmd_adpcm_matrix(state->adpcm_matrix[i], state->codebook + i * 16);
+        }
+    }
+}
+
+static void cmd_mixer(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint32_t count = buffer_count(state, 32);
+    int16_t* src = dmem16(state, (w1 >> 16) + ACMD_DMEM_BASE);
+    int16_t* dst = dmem16(state, (w1 & 0xFFFF) + ACMD_DMEM_BASE);
+    const AcmdKernels* kernels = overlaps(dst, count, src, count) ? &acmd_kernels_scalar : state->kernels;
+
+    if (state->count != 0) {
+        kernels->mix(dst, src, count / 2, (int16_t)(w0 & 0xFFFF));
+    }
+}
+
+static void cmd_interleave(AcmdState* state, uint32_t w0, uint32_t w1) {
+    uint32_t count = buffer_count(state, 16);
+    int16_t* left = dmem16(state, (w1 >> 16) + ACMD_DMEM_BASE);
+    int16_t* right = dmem16(state, (w1 & 0xFFFF) + ACMD_DMEM_BASE);
+    int16_t* dst = dmem16(state, state->out);
+    const AcmdKernels* kernels = state->kernels;
+
+    if (overlaps(dst, count * 2, left, count) || overlaps(dst, count * 2, right, count) || dst == left ||
+        dst == right) {
+        kernels = &acmd_kernels_scalar;
+    }
+    if (state->count != 0) {
+        kernels->interleave(dst, left, right, count / 2);
+    }
+}
+
+void acmd_run(AcmdState* state, const AcmdWord* list, size_t count) {
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        uint32_t w0 = list[i].w0;
+        uint32_t w1 = list[i].w1;
+        uint32_t op = w0 >> 24;
+
+        if (op >= ACMD_OPCODES) {
+            state->stats.unsupported++;
+            continue;
+        }
+        state->stats.commands[op]++;
+
+        switch (op) {
+            case ACMD_SPNOOP:
+                break;
+            case ACMD_ADPCM:
+                cmd_adpcm(state, w0, w1);
+                break;
+            case ACMD_CLEARBUFF:
+                cmd_clearbuff(state, w0, w1);
+                break;
+            case ACMD_ENVMIXER:
+                cmd_envmixer(state, w0, w1);
+                break;
+            case ACMD_LOADBUFF:
+                cmd_loadbuff(state, w0, w1);
+                break;
+            case ACMD_RESAMPLE:
+                cmd_resample(state, w0, w1);
+                break;
+            case ACMD_SAVEBUFF:
+                cmd_savebuff(state, w0, w1);
+                break;
+            case ACMD_SEGMENT:
+                state->segments[(w1 >> 24) % ACMD_SEGMENTS] = w1 & 0xFFFFFF;
+                break;
+            case ACMD_SETBUFF:
+                cmd_setbuff(state, w0, w1);
+                break;
+            case ACMD_SETVOL:
+                cmd_setvol(state, w0, w1);
+                break;
+            case ACMD_DMEMMOVE:
+                cmd_dmemmove(state, w0, w1);
+                break;
+            case ACMD_LOADADPCM:
+                cmd_loadadpcm(state, w0, w1);
+                break;
+            case ACMD_MIXER:
+                cmd_mixer(state, w0, w1);
+                break;
+            case ACMD_INTERLEAVE:
+                cmd_interleave(state, w0, w1);
+                break;
+            case ACMD_SETLOOP:
+                state->loop = address(state, w1);
+                break;
+            default:
+                state->stats.unsupported++;
+                break;
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef ACMD_H
+#define ACMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Host interpreter for the audio command lists alAudioFrame builds for the
+ * aspMain microcode (abi.h). It keeps DMEM and the microcode's registers in an
+ * AcmdState and reads/writes DRAM through a caller-supplied RDRAM image, in
+ * which command addresses are offsets.
+ *
+ * 16-bit data (samples, codebooks, saved state) is host-endian, as the host
+ * build of the synthesizer writes it. ADPCM frames are read as bytes.
+ */
+
+#define ACMD_DMEM_SIZE  0x1000
+#define ACMD_DMEM_BASE  0x5C0 /* buffer offsets in the list are relative to this */
+#define ACMD_DMEM_SLACK 0x2000 /* runs off the end land here rather than wrapping */
+#define ACMD_MAX_COUNT  0xFF0  /* longest buffer a command touches, in bytes */
+#define ACMD_SEGMENTS   16
+
+/* Opcodes, as in abi.h */
+enum {
+    ACMD_SPNOOP,
+    ACMD_ADPCM,
+    ACMD_CLEARBUFF,
+    ACMD_ENVMIXER,
+    ACMD_LOADBUFF,
+    ACMD_RESAMPLE,
+    ACMD_SAVEBUFF,
+    ACMD_SEGMENT,
+    ACMD_SETBUFF,
+    ACMD_SETVOL,
+    ACMD_DMEMMOVE,
+    ACMD_LOADADPCM,
+    ACMD_MIXER,
+    ACMD_INTERLEAVE,
+    ACMD_POLEF,
+    ACMD_SETLOOP,
+    ACMD_OPCODES
+};
+
+/* Same layout as Acmd's words */
+typedef struct {
+    uint32_t w0;
+    uint32_t w1;
+} AcmdWord;
+
+typedef enum {
+    ACMD_KERNELS_SCALAR,
+    ACMD_KERNELS_SSE2,
+    ACMD_KERNELS_AVX2,
+    ACMD_KERNELS_COUNT
+} AcmdKernelLevel;
+
+typedef struct AcmdKernels AcmdKernels;
+
+typedef struct {
+    uint64_t commands[ACMD_OPCODES];
+    uint64_t unsupported;   /* opcodes with no implementation (POLEF) or out of range */
+    uint64_t bad_addresses; /* DMA outside the RDRAM image, skipped */
+} AcmdStats;
+
+typedef struct {
+    union {
+        uint8_t u8[ACMD_DMEM_SIZE + ACMD_DMEM_SLACK];
+        int16_t s16[(ACMD_DMEM_SIZE + ACMD_DMEM_SLACK) / 2];
+    } dmem __attribute__((aligned(32)));
+
+    uint8_t* rdram;
+    size_t rdram_size;
+    uint32_t segments[ACMD_SEGMENTS];
+
+    /* SETBUFF */
+    uint16_t in;
+    uint16_t out;
+    uint16_t count;
+    uint16_t dry_right;
+    uint16_t wet_left;
+    uint16_t wet_right;
+
+    /* SETVOL */
+    int16_t vol[2];
+    int16_t target[2];
+    int32_t rate[2];
+    int16_t dry;
+    int16_t wet;
+
+    /* SETLOOP, LOADADPCM */
+    uint32_t loop;
+    int16_t codebook[16 * 16];
+    int16_t adpcm_matrix[16][80] __attribute__((aligned(32)));
+
+    /* Scratch for ENVMIXER's gains and RESAMPLE's taps */
+    int16_t gains[4][ACMD_MAX_COUNT / 2] __attribute__((aligned(32)));
+    uint16_t positions[ACMD_MAX_COUNT / 2];
+    uint8_t phases[ACMD_MAX_COUNT / 2];
+
+    const AcmdKernels* kernels;
+    AcmdKernelLevel level;
+    AcmdStats stats;
+} AcmdState;
+
+void acmd_init(AcmdState* state, void* rdram, size_t rdram_size);
+
+/* Best level this CPU runs, and its name */
+AcmdKernelLevel acmd_best_kernels(void);
+const char* acmd_kernels_name(AcmdKernelLevel level);
+
+/* Returns 0 if the level isn't built in or this CPU can't run it */
+int acmd_set_kernels(AcmdState* state, AcmdKernelLevel level);
+
+/* Looks up ACMD_KERNELS (scalar, sse2, avx2) in the environment, else the best level */
+AcmdKernelLevel acmd_kernels_from_env(void);
+
+void acmd_run(AcmdState* state, const AcmdWord* list, size_t count);
+
+#endif
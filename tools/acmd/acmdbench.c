@@ -0,0 +1,292 @@
+/*
+ * acmdbench: checks every kernel set against the scalar one and times them.
+ *
+ *   acmdbench [--voices n] [--frames n] [--rate hz] [--seed n]
+ *
+ * First each kernel is fed random and worst-case input. Then a command list
+ * shaped like alAudioFrame's (ADPCM voices through resample and envelope
+ * mixing, aux mixdown, interleave and save) is rendered with each set from
+ * the same RDRAM image, and the resulting images are compared byte for byte.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acmd.h"
+#include "kernels.h"
+
+/* DMEM layout from synthInternals.h */
+#define AL_DECODER_IN    0
+#define AL_RESAMPLER_OUT 0
+#define AL_DECODER_OUT   320
+#define AL_MAIN_L_OUT    1088
+#define AL_MAIN_R_OUT    1408
+#define AL_AUX_L_OUT     1728
+#define AL_AUX_R_OUT     2048
+
+#define FRAME_SAMPLES 160
+#define RDRAM_SIZE    0x800000
+#define VOICE_STATE   0x1000
+#define VOICE_BOOK    0x20000
+#define VOICE_WAVE    0x40000
+#define WAVE_SIZE     0x10000
+#define OUTPUT        0x400000
+
+#define W0(op, flags, low) (((uint32_t)(op) << 24) | (((uint32_t)(flags) & 0xFF) << 16) | ((uint32_t)(low) & 0xFFFF))
+#define HL(high, low)      ((((uint32_t)(high) & 0xFFFF) << 16) | ((uint32_t)(low) & 0xFFFF))
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return rng_state >> 8;
+}
+
+static int16_t rng_sample(void) {
+    switch (rng() % 8) {
+        case 0:
+            return -0x8000;
+        case 1:
+            return 0x7FFF;
+        default:
+            return (int16_t)rng();
+    }
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int check_kernels(const AcmdKernels* k, const char* name) {
+    enum { N = 184 };
+    int16_t src[N + 8], src2[N], gains[N], expect[N * 2], got[N * 2], book[16], matrix[80], x[10];
+    uint16_t pos[N];
+    uint8_t phase[N];
+    const AcmdKernels* ref = &acmd_kernels_scalar;
+    int failures = 0;
+    int round;
+    int i;
+
+    for (round = 0; round < 2000; round++) {
+        size_t n = 1 + rng() % N;
+        int16_t gain = rng_sample();
+        uint32_t p = 0;
+
+        for (i = 0; i < N + 8; i++) {
+            src[i] = rng_sample();
+        }
+        for (i = 0; i < N; i++) {
+            src2[i] = rng_sample();
+            gains[i] = rng_sample();
+            expect[i] = got[i] = rng_sample();
+            pos[i] = p;
+            phase[i] = rng() % 64;
+            p += rng() % 2;
+        }
+
+        ref->mix(expect, src, n, gain);
+        k->mix(got, src, n, gain);
+        failures += memcmp(expect, got, n * 2) != 0;
+
+        ref->mix_gains(expect, src, gains, n);
+        k->mix_gains(got, src, gains, n);
+        failures += memcmp(expect, got, n * 2) != 0;
+
+        ref->resample(expect, src, pos, phase, n);
+        k->resample(got, src, pos, phase, n);
+        failures += memcmp(expect, got, n * 2) != 0;
+
+        ref->interleave(expect, src, src2, n);
+        k->interleave(got, src, src2, n);
+        failures += memcmp(expect, got, n * 4) != 0;
+
+        for (i = 0; i < 16; i++) {
+            book[i] = rng_sample();
+        }
+        for (i = 0; i < 10; i++) {
+            x[i] = rng_sample();
+        }
+        acmd_adpcm_matrix(matrix, book);
+        ref->adpcm(expect, book, matrix, x);
+        k->adpcm(got, book, matrix, x);
+        failures += memcmp(expect, got, 16) != 0;
+    }
+
+    printf("%-6s kernels: %s\n", name, failures ? "MISMATCH" : "match scalar");
+    return failures;
+}
+
+/* One audio frame for every voice, then the mixdown */
+static size_t build_frame(AcmdWord* list, int voices, int frame, uint32_t* wave_pos, const uint16_t* pitch) {
+    AcmdWord* cmd = list;
+    int v;
+
+#define EMIT(a, b) (cmd->w0 = (a), cmd->w1 = (b), cmd++)
+    EMIT(W0(ACMD_SEGMENT, 0, 0), 0);
+    EMIT(W0(ACMD_CLEARBUFF, 0, AL_MAIN_L_OUT), FRAME_SAMPLES * 2);
+    EMIT(W0(ACMD_CLEARBUFF, 0, AL_MAIN_R_OUT), FRAME_SAMPLES * 2);
+    EMIT(W0(ACMD_CLEARBUFF, 0, AL_AUX_L_OUT), FRAME_SAMPLES * 2);
+    EMIT(W0(ACMD_CLEARBUFF, 0, AL_AUX_R_OUT), FRAME_SAMPLES * 2);
+
+    for (v = 0; v < voices; v++) {
+        uint32_t state = VOICE_STATE + v * 0x100;
+        uint32_t needed = (FRAME_SAMPLES * pitch[v] >> 15) + 4;
+        uint32_t frames = (needed + 15) / 16;
+        uint32_t bytes = frames * 9;
+
+        if (wave_pos[v] + bytes > WAVE_SIZE) {
+            wave_pos[v] = 0;
+        }
+
+        EMIT(W0(ACMD_LOADADPCM, 0, 64), VOICE_BOOK + v * 0x40);
+        EMIT(W0(ACMD_SETBUFF, 0, AL_DECODER_IN), HL(0, (bytes + 7) & ~7));
+        EMIT(W0(ACMD_LOADBUFF, 0, 0), VOICE_WAVE + v * WAVE_SIZE + wave_pos[v]);
+        EMIT(W0(ACMD_SETLOOP, 0, 0), state + 0x20);
+        EMIT(W0(ACMD_SETBUFF, 0, AL_DECODER_IN), HL(AL_DECODER_OUT, frames * 32));
+        EMIT(W0(ACMD_ADPCM, frame == 0 ? 1 : 0, 0), state);
+        EMIT(W0(ACMD_SETBUFF, 0, AL_DECODER_OUT + 32), HL(AL_RESAMPLER_OUT, FRAME_SAMPLES * 2));
+        EMIT(W0(ACMD_RESAMPLE, frame == 0 ? 1 : 0, pitch[v]), state + 0x40);
+        EMIT(W0(ACMD_SETBUFF, 0, AL_RESAMPLER_OUT), HL(AL_MAIN_L_OUT, FRAME_SAMPLES * 2));
+        EMIT(W0(ACMD_SETBUFF, 8, AL_MAIN_R_OUT), HL(AL_AUX_L_OUT, AL_AUX_R_OUT));
+        if (frame == 0) {
+            EMIT(W0(ACMD_SETVOL, 6, 0x1000 + v * 0x100), 0);
+            EMIT(W0(ACMD_SETVOL, 4, 0x2000), 0);
+            EMIT(W0(ACMD_SETVOL, 2, 0x7000), 0x00010800 + v * 0x40);
+            EMIT(W0(ACMD_SETVOL, 0, 0x0400), 0x0000F000);
+            EMIT(W0(ACMD_SETVOL, 8, 0x7FFF), 0x2000);
+            EMIT(W0(ACMD_ENVMIXER, 9, 0), state + 0x50);
+        } else {
+            EMIT(W0(ACMD_ENVMIXER, 8, 0), state + 0x50);
+        }
+
+        wave_pos[v] += bytes;
+    }
+
+    EMIT(W0(ACMD_SETBUFF, 0, 0), HL(0, FRAME_SAMPLES * 2));
+    EMIT(W0(ACMD_MIXER, 0, 0x5A82), HL(AL_AUX_L_OUT, AL_MAIN_L_OUT));
+    EMIT(W0(ACMD_MIXER, 0, 0xDA83), HL(AL_AUX_R_OUT, AL_MAIN_R_OUT));
+    EMIT(W0(ACMD_DMEMMOVE, 0, AL_AUX_L_OUT), HL(AL_AUX_R_OUT, FRAME_SAMPLES * 2));
+    EMIT(W0(ACMD_INTERLEAVE, 0, 0), HL(AL_MAIN_L_OUT, AL_MAIN_R_OUT));
+    EMIT(W0(ACMD_SETBUFF, 0, 0), HL(0, FRAME_SAMPLES * 4));
+    EMIT(W0(ACMD_SAVEBUFF, 0, 0), OUTPUT + (frame * FRAME_SAMPLES * 4) % 0x100000);
+#undef EMIT
+
+    return cmd - list;
+}
+
+int main(int argc, char** argv) {
+    int voices = 24;
+    int frames = 2000;
+    double rate = 32000.0;
+    uint8_t* image;
+    uint8_t* reference = NULL;
+    uint8_t* rdram;
+    AcmdWord* list;
+    uint32_t* wave_pos;
+    uint16_t* pitch;
+    AcmdState* state;
+    double scalar_time = 0.0;
+    int failures = 0;
+    int level;
+    int i;
+
+    rng_state = 1;
+    for (i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--voices") == 0) {
+            voices = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--frames") == 0) {
+            frames = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--rate") == 0) {
+            rate = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            rng_state = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: acmdbench [--voices n] [--frames n] [--rate hz] [--seed n]\n");
+            return 1;
+        }
+    }
+    if (voices < 1 || voices > 32 || frames < 1) {
+        fprintf(stderr, "acmdbench: 1-32 voices and at least one frame\n");
+        return 1;
+    }
+
+    for (level = ACMD_KERNELS_SSE2; level < ACMD_KERNELS_COUNT; level++) {
+        AcmdState probe;
+
+        acmd_init(&probe, NULL, 0);
+        if (acmd_set_kernels(&probe, (AcmdKernelLevel)level)) {
+            failures += check_kernels(probe.kernels, acmd_kernels_name((AcmdKernelLevel)level));
+        } else {
+            printf("%-6s kernels: not supported here\n", acmd_kernels_name((AcmdKernelLevel)level));
+        }
+    }
+
+    image = malloc(RDRAM_SIZE);
+    rdram = malloc(RDRAM_SIZE);
+    list = malloc(sizeof(AcmdWord) * (16 + voices * 20));
+    wave_pos = calloc(voices, sizeof(uint32_t));
+    pitch = malloc(voices * sizeof(uint16_t));
+    state = malloc(sizeof(AcmdState));
+    if (image == NULL || rdram == NULL || list == NULL || wave_pos == NULL || pitch == NULL || state == NULL) {
+        fprintf(stderr, "acmdbench: out of memory\n");
+        return 1;
+    }
+
+    memset(image, 0, RDRAM_SIZE);
+    for (i = 0; i < voices; i++) {
+        int16_t book[32];
+        int k;
+
+        for (k = 0; k < 32; k++) {
+            book[k] = (int16_t)(rng() % 8192) - 4096;
+        }
+        memcpy(image + VOICE_BOOK + i * 0x40, book, sizeof(book));
+        for (k = 0; k < WAVE_SIZE; k++) {
+            image[VOICE_WAVE + i * WAVE_SIZE + k] = rng();
+        }
+        pitch[i] = 0x4000 + rng() % 0xB000;
+    }
+
+    printf("\n%d voices, %d frames of %d samples at %.0f Hz\n", voices, frames, FRAME_SAMPLES, rate);
+    for (level = 0; level < ACMD_KERNELS_COUNT; level++) {
+        double start;
+        double elapsed;
+        int frame;
+
+        acmd_init(state, rdram, RDRAM_SIZE);
+        if (!acmd_set_kernels(state, (AcmdKernelLevel)level)) {
+            continue;
+        }
+        memcpy(rdram, image, RDRAM_SIZE);
+        memset(wave_pos, 0, voices * sizeof(uint32_t));
+
+        start = now();
+        for (frame = 0; frame < frames; frame++) {
+            acmd_run(state, list, build_frame(list, voices, frame, wave_pos, pitch));
+        }
+        elapsed = now() - start;
+
+        if (level == ACMD_KERNELS_SCALAR) {
+            scalar_time = elapsed;
+            reference = malloc(RDRAM_SIZE);
+            memcpy(reference, rdram, RDRAM_SIZE);
+        }
+
+        printf("%-6s %8.3f s  %7.1fx realtime  %5.2fx scalar  %s\n", acmd_kernels_name((AcmdKernelLevel)level),
+               elapsed, frames * FRAME_SAMPLES / rate / elapsed, scalar_time / elapsed,
+               level == ACMD_KERNELS_SCALAR ? "" : memcmp(reference, rdram, RDRAM_SIZE) ? "MISMATCH" : "identical");
+        if (level != ACMD_KERNELS_SCALAR && memcmp(reference, rdram, RDRAM_SIZE) != 0) {
+            failures++;
+        }
+        if (state->stats.unsupported || state->stats.bad_addresses) {
+            printf("       %llu unsupported commands, %llu bad addresses\n",
+                   (unsigned long long)state->stats.unsupported, (unsigned long long)state->stats.bad_addresses);
+        }
+    }
+
+    return failures != 0;
+}
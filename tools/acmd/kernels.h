@@ -0,0 +1,61 @@
+#ifndef ACMD_KERNELS_H
+#define ACMD_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The inner loops of the commands. Every set produces exactly what the scalar
+ * set does: sums are taken modulo 2^32 like the scalar code, so the order
+ * terms are added in doesn't matter, and results are clamped the same way.
+ *
+ * Sample counts are multiples of 8 for lists alAudioFrame builds; the vector
+ * sets still handle any tail.
+ */
+struct AcmdKernels {
+    /* dst[i] = clamp(dst[i] + (src[i] * gain >> 15)) */
+    void (*mix)(int16_t* dst, const int16_t* src, size_t n, int16_t gain);
+
+    /* The same with a gain per sample, for ENVMIXER */
+    void (*mix_gains)(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n);
+
+    /* dst[i] = clamp(sum of src[pos[i] + k] * acmd_resample_table[phase[i] * 4 + k] >> 15) */
+    void (*resample)(int16_t* dst, const int16_t* src, const uint16_t* pos, const uint8_t* phase, size_t n);
+
+    /*
+     * Eight samples of an ADPCM frame. x holds the two previous samples then
+     * the eight scaled residuals; book is the predictor's 16 codebook entries
+     * and matrix the same predictor as built by acmd_adpcm_matrix.
+     */
+    void (*adpcm)(int16_t* dst, const int16_t* book, const int16_t* matrix, const int16_t* x);
+
+    void (*interleave)(int16_t* dst, const int16_t* left, const int16_t* right, size_t n);
+};
+
+extern const int16_t acmd_resample_table[64 * 4];
+
+/*
+ * Predictor as an 8x10 matrix over x, stored as five column pairs of eight
+ * interleaved rows (pair-major) so a pair of inputs can be multiplied in one
+ * madd.
+ */
+void acmd_adpcm_matrix(int16_t* matrix, const int16_t* book);
+
+static inline int16_t acmd_clamp16(int32_t value) {
+    if (value < -0x8000) {
+        return -0x8000;
+    }
+    if (value > 0x7FFF) {
+        return 0x7FFF;
+    }
+    return (int16_t)value;
+}
+
+extern const struct AcmdKernels acmd_kernels_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct AcmdKernels acmd_kernels_sse2;
+extern const struct AcmdKernels acmd_kernels_avx2;
+#define ACMD_HAVE_X86 1
+#endif
+
+#endif
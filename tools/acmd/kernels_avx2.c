@@ -0,0 +1,118 @@
+#include <string.h>
+
+#include "kernels.h"
+
+#ifdef ACMD_HAVE_X86
+#include <immintrin.h>
+
+/*
+ * Built with -mavx2 and only reached once acmd_set_kernels has checked the
+ * CPU. The 256-bit unpack/pack instructions work within 128-bit lanes, which
+ * is harmless here since each unpack is undone by a pack in the same lane.
+ */
+static inline __m256i mix16(__m256i dst, __m256i src, __m256i gain) {
+    __m256i lo = _mm256_mullo_epi16(src, gain);
+    __m256i hi = _mm256_mulhi_epi16(src, gain);
+    __m256i p0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(lo, hi), 15);
+    __m256i p1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(lo, hi), 15);
+    __m256i d0 = _mm256_srai_epi32(_mm256_unpacklo_epi16(dst, dst), 16);
+    __m256i d1 = _mm256_srai_epi32(_mm256_unpackhi_epi16(dst, dst), 16);
+
+    return _mm256_packs_epi32(_mm256_add_epi32(d0, p0), _mm256_add_epi32(d1, p1));
+}
+
+static void mix_avx2(int16_t* dst, const int16_t* src, size_t n, int16_t gain) {
+    __m256i g = _mm256_set1_epi16(gain);
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+
+        _mm256_storeu_si256((__m256i*)(dst + i), mix16(d, s, g));
+    }
+    acmd_kernels_sse2.mix(dst + i, src + i, n - i, gain);
+}
+
+static void mix_gains_avx2(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n) {
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i));
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i));
+        __m256i g = _mm256_loadu_si256((const __m256i*)(gains + i));
+
+        _mm256_storeu_si256((__m256i*)(dst + i), mix16(d, s, g));
+    }
+    acmd_kernels_sse2.mix_gains(dst + i, src + i, gains + i, n - i);
+}
+
+static inline __m256i load4x64(const int16_t* a, const int16_t* b, const int16_t* c, const int16_t* d) {
+    long long q[4];
+
+    memcpy(&q[0], a, 8);
+    memcpy(&q[1], b, 8);
+    memcpy(&q[2], c, 8);
+    memcpy(&q[3], d, 8);
+    return _mm256_set_epi64x(q[3], q[2], q[1], q[0]);
+}
+
+static void resample_avx2(int16_t* dst, const int16_t* src, const uint16_t* pos, const uint8_t* phase, size_t n) {
+    const int16_t* lut = acmd_resample_table;
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        const uint16_t* p = pos + i;
+        const uint8_t* f = phase + i;
+        /* Lanes hold outputs {0, 1 | 4, 5} and {2, 3 | 6, 7}, so the shuffle leaves 0-3 | 4-7 */
+        __m256i a = _mm256_madd_epi16(load4x64(src + p[0], src + p[1], src + p[4], src + p[5]),
+                                      load4x64(lut + f[0] * 4, lut + f[1] * 4, lut + f[4] * 4, lut + f[5] * 4));
+        __m256i b = _mm256_madd_epi16(load4x64(src + p[2], src + p[3], src + p[6], src + p[7]),
+                                      load4x64(lut + f[2] * 4, lut + f[3] * 4, lut + f[6] * 4, lut + f[7] * 4));
+        __m256 af = _mm256_castsi256_ps(a);
+        __m256 bf = _mm256_castsi256_ps(b);
+        __m256i even = _mm256_castps_si256(_mm256_shuffle_ps(af, bf, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m256i odd = _mm256_castps_si256(_mm256_shuffle_ps(af, bf, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m256i sum = _mm256_srai_epi32(_mm256_add_epi32(even, odd), 15);
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(sum, sum), _MM_SHUFFLE(3, 1, 2, 0));
+
+        _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(packed));
+    }
+    acmd_kernels_sse2.resample(dst + i, src, pos + i, phase + i, n - i);
+}
+
+static void adpcm_avx2(int16_t* dst, const int16_t* book, const int16_t* matrix, const int16_t* x) {
+    __m256i accu = _mm256_setzero_si256();
+    __m128i packed;
+    int k;
+
+    for (k = 0; k < 5; k++) {
+        __m256i pair = _mm256_set1_epi32((uint16_t)x[k * 2] | ((uint32_t)(uint16_t)x[k * 2 + 1] << 16));
+
+        accu = _mm256_add_epi32(accu, _mm256_madd_epi16(pair, _mm256_loadu_si256((const __m256i*)(matrix + k * 16))));
+    }
+
+    accu = _mm256_srai_epi32(accu, 11);
+    packed = _mm_packs_epi32(_mm256_castsi256_si128(accu), _mm256_extracti128_si256(accu, 1));
+    _mm_storeu_si128((__m128i*)dst, packed);
+}
+
+static void interleave_avx2(int16_t* dst, const int16_t* left, const int16_t* right, size_t n) {
+    size_t i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m256i l = _mm256_loadu_si256((const __m256i*)(left + i));
+        __m256i r = _mm256_loadu_si256((const __m256i*)(right + i));
+        __m256i lo = _mm256_unpacklo_epi16(l, r); /* 0-3 | 8-11 */
+        __m256i hi = _mm256_unpackhi_epi16(l, r); /* 4-7 | 12-15 */
+
+        _mm256_storeu_si256((__m256i*)(dst + i * 2), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(dst + i * 2 + 16), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    acmd_kernels_sse2.interleave(dst + i * 2, left + i, right + i, n - i);
+}
+
+const struct AcmdKernels acmd_kernels_avx2 = {
+    mix_avx2, mix_gains_avx2, resample_avx2, adpcm_avx2, interleave_avx2,
+};
+#endif
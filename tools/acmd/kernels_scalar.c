@@ -0,0 +1,158 @@
+#include <string.h>
+
+#include "kernels.h"
+
+/* aspMain's four-tap interpolation filter, one row per 1/64 of a sample */
+const int16_t acmd_resample_table[64 * 4] = {
+    (int16_t)0x0C39, (int16_t)0x66AD, (int16_t)0x0D46, (int16_t)0xFFDF,
+    (int16_t)0x0B39, (int16_t)0x6696, (int16_t)0x0E5F, (int16_t)0xFFD8,
+    (int16_t)0x0A44, (int16_t)0x6669, (int16_t)0x0F83, (int16_t)0xFFD0,
+    (int16_t)0x095A, (int16_t)0x6626, (int16_t)0x10B4, (int16_t)0xFFC8,
+    (int16_t)0x087D, (int16_t)0x65CD, (int16_t)0x11F0, (int16_t)0xFFBF,
+    (int16_t)0x07AB, (int16_t)0x655E, (int16_t)0x1338, (int16_t)0xFFB6,
+    (int16_t)0x06E4, (int16_t)0x64D9, (int16_t)0x148C, (int16_t)0xFFAC,
+    (int16_t)0x0628, (int16_t)0x643F, (int16_t)0x15EB, (int16_t)0xFFA1,
+    (int16_t)0x0577, (int16_t)0x638F, (int16_t)0x1756, (int16_t)0xFF96,
+    (int16_t)0x04D1, (int16_t)0x62CB, (int16_t)0x18CB, (int16_t)0xFF8A,
+    (int16_t)0x0435, (int16_t)0x61F3, (int16_t)0x1A4C, (int16_t)0xFF7E,
+    (int16_t)0x03A4, (int16_t)0x6106, (int16_t)0x1BD7, (int16_t)0xFF71,
+    (int16_t)0x031C, (int16_t)0x6007, (int16_t)0x1D6C, (int16_t)0xFF64,
+    (int16_t)0x029F, (int16_t)0x5EF5, (int16_t)0x1F0B, (int16_t)0xFF56,
+    (int16_t)0x022A, (int16_t)0x5DD0, (int16_t)0x20B3, (int16_t)0xFF48,
+    (int16_t)0x01BE, (int16_t)0x5C9A, (int16_t)0x2264, (int16_t)0xFF3A,
+    (int16_t)0x015B, (int16_t)0x5B53, (int16_t)0x241E, (int16_t)0xFF2C,
+    (int16_t)0x0101, (int16_t)0x59FC, (int16_t)0x25E0, (int16_t)0xFF1E,
+    (int16_t)0x00AE, (int16_t)0x5896, (int16_t)0x27A9, (int16_t)0xFF10,
+    (int16_t)0x0063, (int16_t)0x5720, (int16_t)0x297A, (int16_t)0xFF02,
+    (int16_t)0x001F, (int16_t)0x559D, (int16_t)0x2B50, (int16_t)0xFEF4,
+    (int16_t)0xFFE2, (int16_t)0x540D, (int16_t)0x2D2C, (int16_t)0xFEE8,
+    (int16_t)0xFFAC, (int16_t)0x5270, (int16_t)0x2F0D, (int16_t)0xFEDB,
+    (int16_t)0xFF7C, (int16_t)0x50C7, (int16_t)0x30F3, (int16_t)0xFED0,
+    (int16_t)0xFF53, (int16_t)0x4F14, (int16_t)0x32DC, (int16_t)0xFEC6,
+    (int16_t)0xFF2E, (int16_t)0x4D57, (int16_t)0x34C8, (int16_t)0xFEBD,
+    (int16_t)0xFF0F, (int16_t)0x4B91, (int16_t)0x36B6, (int16_t)0xFEB6,
+    (int16_t)0xFEF5, (int16_t)0x49C2, (int16_t)0x38A5, (int16_t)0xFEB0,
+    (int16_t)0xFEDF, (int16_t)0x47ED, (int16_t)0x3A95, (int16_t)0xFEAC,
+    (int16_t)0xFECE, (int16_t)0x4611, (int16_t)0x3C85, (int16_t)0xFEAB,
+    (int16_t)0xFEC0, (int16_t)0x4430, (int16_t)0x3E74, (int16_t)0xFEAC,
+    (int16_t)0xFEB6, (int16_t)0x424A, (int16_t)0x4060, (int16_t)0xFEAF,
+    (int16_t)0xFEAF, (int16_t)0x4060, (int16_t)0x424A, (int16_t)0xFEB6,
+    (int16_t)0xFEAC, (int16_t)0x3E74, (int16_t)0x4430, (int16_t)0xFEC0,
+    (int16_t)0xFEAB, (int16_t)0x3C85, (int16_t)0x4611, (int16_t)0xFECE,
+    (int16_t)0xFEAC, (int16_t)0x3A95, (int16_t)0x47ED, (int16_t)0xFEDF,
+    (int16_t)0xFEB0, (int16_t)0x38A5, (int16_t)0x49C2, (int16_t)0xFEF5,
+    (int16_t)0xFEB6, (int16_t)0x36B6, (int16_t)0x4B91, (int16_t)0xFF0F,
+    (int16_t)0xFEBD, (int16_t)0x34C8, (int16_t)0x4D57, (int16_t)0xFF2E,
+    (int16_t)0xFEC6, (int16_t)0x32DC, (int16_t)0x4F14, (int16_t)0xFF53,
+    (int16_t)0xFED0, (int16_t)0x30F3, (int16_t)0x50C7, (int16_t)0xFF7C,
+    (int16_t)0xFEDB, (int16_t)0x2F0D, (int16_t)0x5270, (int16_t)0xFFAC,
+    (int16_t)0xFEE8, (int16_t)0x2D2C, (int16_t)0x540D, (int16_t)0xFFE2,
+    (int16_t)0xFEF4, (int16_t)0x2B50, (int16_t)0x559D, (int16_t)0x001F,
+    (int16_t)0xFF02, (int16_t)0x297A, (int16_t)0x5720, (int16_t)0x0063,
+    (int16_t)0xFF10, (int16_t)0x27A9, (int16_t)0x5896, (int16_t)0x00AE,
+    (int16_t)0xFF1E, (int16_t)0x25E0, (int16_t)0x59FC, (int16_t)0x0101,
+    (int16_t)0xFF2C, (int16_t)0x241E, (int16_t)0x5B53, (int16_t)0x015B,
+    (int16_t)0xFF3A, (int16_t)0x2264, (int16_t)0x5C9A, (int16_t)0x01BE,
+    (int16_t)0xFF48, (int16_t)0x20B3, (int16_t)0x5DD0, (int16_t)0x022A,
+    (int16_t)0xFF56, (int16_t)0x1F0B, (int16_t)0x5EF5, (int16_t)0x029F,
+    (int16_t)0xFF64, (int16_t)0x1D6C, (int16_t)0x6007, (int16_t)0x031C,
+    (int16_t)0xFF71, (int16_t)0x1BD7, (int16_t)0x6106, (int16_t)0x03A4,
+    (int16_t)0xFF7E, (int16_t)0x1A4C, (int16_t)0x61F3, (int16_t)0x0435,
+    (int16_t)0xFF8A, (int16_t)0x18CB, (int16_t)0x62CB, (int16_t)0x04D1,
+    (int16_t)0xFF96, (int16_t)0x1756, (int16_t)0x638F, (int16_t)0x0577,
+    (int16_t)0xFFA1, (int16_t)0x15EB, (int16_t)0x643F, (int16_t)0x0628,
+    (int16_t)0xFFAC, (int16_t)0x148C, (int16_t)0x64D9, (int16_t)0x06E4,
+    (int16_t)0xFFB6, (int16_t)0x1338, (int16_t)0x655E, (int16_t)0x07AB,
+    (int16_t)0xFFBF, (int16_t)0x11F0, (int16_t)0x65CD, (int16_t)0x087D,
+    (int16_t)0xFFC8, (int16_t)0x10B4, (int16_t)0x6626, (int16_t)0x095A,
+    (int16_t)0xFFD0, (int16_t)0x0F83, (int16_t)0x6669, (int16_t)0x0A44,
+    (int16_t)0xFFD8, (int16_t)0x0E5F, (int16_t)0x6696, (int16_t)0x0B39,
+    (int16_t)0xFFDF, (int16_t)0x0D46, (int16_t)0x66AD, (int16_t)0x0C39,
+};
+
+void acmd_adpcm_matrix(int16_t* matrix, const int16_t* book) {
+    int16_t columns[10][8];
+    int i;
+    int k;
+
+    /* out[i] = book[i] * x0 + book[8 + i] * x1 + 2048 * s[i] + sum(book[8 + j] * s[i - 1 - j]) */
+    memset(columns, 0, sizeof(columns));
+    for (i = 0; i < 8; i++) {
+        columns[0][i] = book[i];
+        columns[1][i] = book[8 + i];
+        columns[2 + i][i] = 2048;
+        for (k = 0; k < i; k++) {
+            columns[2 + k][i] = book[8 + i - 1 - k];
+        }
+    }
+
+    for (k = 0; k < 5; k++) {
+        for (i = 0; i < 8; i++) {
+            matrix[k * 16 + i * 2] = columns[k * 2][i];
+            matrix[k * 16 + i * 2 + 1] = columns[k * 2 + 1][i];
+        }
+    }
+}
+
+static void mix_scalar(int16_t* dst, const int16_t* src, size_t n, int16_t gain) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        dst[i] = acmd_clamp16(dst[i] + ((src[i] * gain) >> 15));
+    }
+}
+
+static void mix_gains_scalar(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        dst[i] = acmd_clamp16(dst[i] + ((src[i] * gains[i]) >> 15));
+    }
+}
+
+static void resample_scalar(int16_t* dst, const int16_t* src, const uint16_t* pos, const uint8_t* phase, size_t n) {
+    size_t i;
+    int k;
+
+    for (i = 0; i < n; i++) {
+        const int16_t* s = src + pos[i];
+        const int16_t* lut = acmd_resample_table + phase[i] * 4;
+        uint32_t accu = 0;
+
+        for (k = 0; k < 4; k++) {
+            accu += (uint32_t)(s[k] * lut[k]);
+        }
+        dst[i] = acmd_clamp16((int32_t)accu >> 15);
+    }
+}
+
+/* Straight from the predictor, as a check on acmd_adpcm_matrix */
+static void adpcm_scalar(int16_t* dst, const int16_t* book, const int16_t* matrix, const int16_t* x) {
+    const int16_t* s = x + 2;
+    int i;
+    int k;
+
+    for (i = 0; i < 8; i++) {
+        uint32_t accu = (uint32_t)s[i] << 11;
+
+        accu += (uint32_t)(book[i] * x[0]);
+        accu += (uint32_t)(book[8 + i] * x[1]);
+        for (k = 0; k < i; k++) {
+            accu += (uint32_t)(book[8 + k] * s[i - 1 - k]);
+        }
+        dst[i] = acmd_clamp16((int32_t)accu >> 11);
+    }
+}
+
+static void interleave_scalar(int16_t* dst, const int16_t* left, const int16_t* right, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        dst[i * 2] = left[i];
+        dst[i * 2 + 1] = right[i];
+    }
+}
+
+const struct AcmdKernels acmd_kernels_scalar = {
+    mix_scalar, mix_gains_scalar, resample_scalar, adpcm_scalar, interleave_scalar,
+};
@@ -0,0 +1,100 @@
+#include "kernels.h"
+
+#ifdef ACMD_HAVE_X86
+#include <emmintrin.h>
+
+/* clamp(dst + (src * gain >> 15)) for eight samples, gain already a vector */
+static inline __m128i mix8(__m128i dst, __m128i src, __m128i gain) {
+    __m128i lo = _mm_mullo_epi16(src, gain);
+    __m128i hi = _mm_mulhi_epi16(src, gain);
+    __m128i p0 = _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 15);
+    __m128i p1 = _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 15);
+    __m128i d0 = _mm_srai_epi32(_mm_unpacklo_epi16(dst, dst), 16);
+    __m128i d1 = _mm_srai_epi32(_mm_unpackhi_epi16(dst, dst), 16);
+
+    return _mm_packs_epi32(_mm_add_epi32(d0, p0), _mm_add_epi32(d1, p1));
+}
+
+static void mix_sse2(int16_t* dst, const int16_t* src, size_t n, int16_t gain) {
+    __m128i g = _mm_set1_epi16(gain);
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+
+        _mm_storeu_si128((__m128i*)(dst + i), mix8(d, s, g));
+    }
+    acmd_kernels_scalar.mix(dst + i, src + i, n - i, gain);
+}
+
+static void mix_gains_sse2(int16_t* dst, const int16_t* src, const int16_t* gains, size_t n) {
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i g = _mm_loadu_si128((const __m128i*)(gains + i));
+
+        _mm_storeu_si128((__m128i*)(dst + i), mix8(d, s, g));
+    }
+    acmd_kernels_scalar.mix_gains(dst + i, src + i, gains + i, n - i);
+}
+
+/* Four taps for two outputs: 64-bit loads of samples and filter rows side by side */
+static inline __m128i taps2(const int16_t* src, const uint16_t* pos, const uint8_t* phase) {
+    __m128i s = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(src + pos[0])),
+                                   _mm_loadl_epi64((const __m128i*)(src + pos[1])));
+    __m128i f = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(acmd_resample_table + phase[0] * 4)),
+                                   _mm_loadl_epi64((const __m128i*)(acmd_resample_table + phase[1] * 4)));
+
+    return _mm_madd_epi16(s, f);
+}
+
+static void resample_sse2(int16_t* dst, const int16_t* src, const uint16_t* pos, const uint8_t* phase, size_t n) {
+    size_t i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128 a = _mm_castsi128_ps(taps2(src, pos + i, phase + i));
+        __m128 b = _mm_castsi128_ps(taps2(src, pos + i + 2, phase + i + 2));
+        __m128i even = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        __m128i odd = _mm_castps_si128(_mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        __m128i sum = _mm_srai_epi32(_mm_add_epi32(even, odd), 15);
+
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packs_epi32(sum, sum));
+    }
+    acmd_kernels_scalar.resample(dst + i, src, pos + i, phase + i, n - i);
+}
+
+static void adpcm_sse2(int16_t* dst, const int16_t* book, const int16_t* matrix, const int16_t* x) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    int k;
+
+    for (k = 0; k < 5; k++) {
+        __m128i pair = _mm_set1_epi32((uint16_t)x[k * 2] | ((uint32_t)(uint16_t)x[k * 2 + 1] << 16));
+
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(pair, _mm_loadu_si128((const __m128i*)(matrix + k * 16))));
+        hi = _mm_add_epi32(hi, _mm_madd_epi16(pair, _mm_loadu_si128((const __m128i*)(matrix + k * 16 + 8))));
+    }
+
+    _mm_storeu_si128((__m128i*)dst, _mm_packs_epi32(_mm_srai_epi32(lo, 11), _mm_srai_epi32(hi, 11)));
+}
+
+static void interleave_sse2(int16_t* dst, const int16_t* left, const int16_t* right, size_t n) {
+    size_t i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m128i l = _mm_loadu_si128((const __m128i*)(left + i));
+        __m128i r = _mm_loadu_si128((const __m128i*)(right + i));
+
+        _mm_storeu_si128((__m128i*)(dst + i * 2), _mm_unpacklo_epi16(l, r));
+        _mm_storeu_si128((__m128i*)(dst + i * 2 + 8), _mm_unpackhi_epi16(l, r));
+    }
+    acmd_kernels_scalar.interleave(dst + i * 2, left + i, right + i, n - i);
+}
+
+const struct AcmdKernels acmd_kernels_sse2 = {
+    mix_sse2, mix_gains_sse2, resample_sse2, adpcm_sse2, interleave_sse2,
+};
+#endif
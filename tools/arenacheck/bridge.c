@@ -0,0 +1,426 @@
+/*
+ * src/28590.c built with ARENA_BINS and ENHANCEMENTS, included whole so its
+ * statics can be checked, and the few libultra and NuSystem calls and game
+ * globals it uses.
+ */
+#include <stdarg.h>
+
+#include "28590.c"
+
+#include "harness.h"
+
+st_unk_0x800DC6E0 D_800DC6E0[ARENA_COUNT];
+s8 D_800BFEE4;
+s8 D_800DAF60[0x4B0];
+const char D_800CCA90 = '\0';
+s8 debug_mode;
+
+bool flag_is_set(u32 index) {
+    return false;
+}
+
+void osSyncPrintf(const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    harness_vlog(fmt, args);
+    va_end(args);
+}
+
+OSIntMask osSetIntMask(OSIntMask mask) {
+    return 1;
+}
+
+void bzero(void* ptr, int size) {
+    __builtin_memset(ptr, 0, size);
+}
+
+NUGfxSwapCfbFunc nuGfxSwapCfbFunc;
+
+void nuGfxSwapCfbFuncSet(NUGfxSwapCfbFunc func) {
+    nuGfxSwapCfbFunc = func;
+}
+
+/* What func_8004E1E0 hands to the heap */
+static unsigned int heap_ranges[4][2];
+static int heap_range_count;
+
+void* func_8004E184(void* start, void* end) {
+    if (heap_range_count < 4) {
+        heap_ranges[heap_range_count][0] = (unsigned long)start;
+        heap_ranges[heap_range_count][1] = (unsigned long)end;
+    }
+    heap_range_count++;
+    return NULL;
+}
+
+/* What func_8004E1E0 hands to the overlay residency cache */
+static unsigned int residency_range[2];
+
+void overlay_residency_init(void* base, u32 size) {
+    residency_range[0] = (unsigned long)base;
+    residency_range[1] = (unsigned long)base + size;
+}
+
+/* nuGfxSwapCfb and a callback the game might set, counting their calls */
+static int swaps_seen[2];
+
+static void cfb_swap(void* task) {
+    swaps_seen[0]++;
+}
+
+static void game_swap(void* task) {
+    swaps_seen[1]++;
+}
+
+int bridge_lowest_bit(unsigned int bits) {
+    return arena_lowest_bit(bits);
+}
+
+int bridge_highest_bit(unsigned int bits) {
+    return arena_highest_bit(bits);
+}
+
+int bridge_size_class(unsigned int size) {
+    return arena_size_class(size);
+}
+
+int bridge_bin_next(const unsigned int nonempty[4], int class) {
+    MGArenaBins bins;
+    int i;
+
+    for (i = 0; i < ARENA_BIN_COUNT / 32; i++) {
+        bins.nonempty[i] = nonempty[i];
+    }
+    return arena_bin_next(&bins, class);
+}
+
+int bridge_bin_count(void) {
+    return ARENA_BIN_COUNT;
+}
+
+void bridge_arena_init(int arena) {
+    func_8004DDE4(arena);
+}
+
+void bridge_arena_add(int arena, unsigned int start, unsigned int end) {
+    func_8004DD70(arena, (st_unk_0x800DC6E0*)(unsigned long)start, end);
+}
+
+unsigned int bridge_alloc(int arena, int size) {
+    return (unsigned long)func_8004DE7C(arena, size);
+}
+
+void bridge_free(int arena, unsigned int ptr) {
+    func_8004E058(arena, (void*)(unsigned long)ptr);
+}
+
+static st_unk_0x800DC6E0* header(unsigned int ptr) {
+    return (st_unk_0x800DC6E0*)((u8*)(unsigned long)ptr - ARENA_HEADER_SIZE);
+}
+
+unsigned int bridge_block_size(unsigned int ptr) {
+    return header(ptr)->unk_0x0;
+}
+
+unsigned int bridge_request_size(int size) {
+    return (size + ARENA_HEADER_SIZE + 7) & ~7;
+}
+
+unsigned int bridge_free_bytes(int arena) {
+    return D_800DC6E0[arena].unk_0x10;
+}
+
+int bridge_largest(int arena) {
+    return D_800DC6E0[arena].unk_0x14;
+}
+
+unsigned int bridge_largest_free(int arena) {
+    st_unk_0x800DC6E0* head = &D_800DC6E0[arena];
+    st_unk_0x800DC6E0* block;
+    unsigned int largest = 0;
+
+    for (block = head->unk_0x8; block != head; block = block->unk_0x8) {
+        if (block->unk_0x4 == 0 && (unsigned int)block->unk_0x0 > largest) {
+            largest = block->unk_0x0;
+        }
+    }
+    return largest;
+}
+
+int bridge_check(int arena, int with_bins, const char** why) {
+    st_unk_0x800DC6E0* head = &D_800DC6E0[arena];
+    MGArenaBins* bins = &arena_bins[arena];
+    st_unk_0x800DC6E0* block;
+    MGArenaFreeBlock *binned, *prev;
+    u32 free_bytes = 0;
+    int free_blocks = 0, in_bins = 0, class, found;
+
+    for (block = head->unk_0x8; block != head; block = block->unk_0x8) {
+        if (block->unk_0x8->unk_0xC != block) {
+            *why = "a block's next doesn't link back to it";
+            return 0;
+        }
+        if (block->unk_0x0 <= 0 || (block->unk_0x0 & 7) != 0) {
+            *why = "a block's size isn't a positive multiple of 8";
+            return 0;
+        }
+        if (block->unk_0x8 != head && (u8*)block + block->unk_0x0 > (u8*)block->unk_0x8) {
+            *why = "the block list isn't in address order, or blocks overlap";
+            return 0;
+        }
+        if (block->unk_0x4 == ARENA_BLOCK_USED) {
+            continue;
+        }
+        if (block->unk_0x4 != 0) {
+            *why = "a block's tag is neither free nor used";
+            return 0;
+        }
+        free_bytes += block->unk_0x0;
+        if (!with_bins || (u32)block->unk_0x0 < ARENA_BIN_MIN) {
+            continue;
+        }
+        free_blocks++;
+        found = 0;
+        class = arena_size_class(block->unk_0x0);
+        for (binned = bins->bins[class]; binned != NULL; binned = binned->bin_next) {
+            found += binned == (MGArenaFreeBlock*)block;
+        }
+        if (found != 1) {
+            *why = found ? "a free block is in its bin twice" : "a free block isn't in the bin for its size";
+            return 0;
+        }
+    }
+    if (head->unk_0xC->unk_0x8 != head) {
+        *why = "the last block doesn't link back to the arena";
+        return 0;
+    }
+    if (free_bytes != (u32)head->unk_0x10) {
+        *why = "unk_0x10 isn't the sum of the free blocks";
+        return 0;
+    }
+    if (!with_bins) {
+        return 1;
+    }
+
+    for (class = 0; class < ARENA_BIN_COUNT; class++) {
+        if ((bins->bins[class] != NULL) != ((bins->nonempty[class >> 5] >> (class & 31)) & 1)) {
+            *why = "a bin's bit in nonempty doesn't say whether it has blocks";
+            return 0;
+        }
+        prev = NULL;
+        for (binned = bins->bins[class]; binned != NULL; binned = binned->bin_next) {
+            if (binned->bin_prev != prev) {
+                *why = "a bin's links don't agree both ways";
+                return 0;
+            }
+            if (!arena_bin_current(bins, binned, class)) {
+                *why = "a bin holds a block that isn't free, on the list, or of its size";
+                return 0;
+            }
+            if (++in_bins > free_blocks) {
+                *why = "the bins hold more blocks than are free";
+                return 0;
+            }
+            prev = binned;
+        }
+    }
+    if (in_bins != free_blocks) {
+        *why = "the bins hold fewer blocks than are free";
+        return 0;
+    }
+    return 1;
+}
+
+void bridge_set_deferred(int arena, int enable) {
+    arena_set_deferred_free(arena, enable);
+}
+
+void bridge_coalesce(int arena) {
+    arena_coalesce(arena);
+}
+
+int bridge_pending(int arena) {
+    return arena_pending[arena];
+}
+
+int bridge_blocks(int arena) {
+    st_unk_0x800DC6E0* head = &D_800DC6E0[arena];
+    st_unk_0x800DC6E0* block;
+    int n = 0;
+
+    for (block = head->unk_0x8; block != head; block = block->unk_0x8) {
+        n++;
+    }
+    return n;
+}
+
+int bridge_unmerged(int arena) {
+    st_unk_0x800DC6E0* head = &D_800DC6E0[arena];
+    st_unk_0x800DC6E0* block;
+    int n = 0;
+
+    for (block = head->unk_0x8; block != head; block = block->unk_0x8) {
+        n += block->unk_0x4 == 0 && block->unk_0x8->unk_0x4 == 0 &&
+             (u8*)block + block->unk_0x0 == (u8*)block->unk_0x8;
+    }
+    return n;
+}
+
+void bridge_free_swapped(int arena, unsigned int ptr) {
+    func_8004E058((s32)ptr, (void*)(unsigned long)arena);
+}
+
+static st_unk_0x800DC6E0* nth_free(int arena, unsigned int pick, u32 min_size) {
+    st_unk_0x800DC6E0* head = &D_800DC6E0[arena];
+    st_unk_0x800DC6E0* block;
+    unsigned int n = 0;
+
+    for (block = head->unk_0x8; block != head; block = block->unk_0x8) {
+        n += block->unk_0x4 == 0 && (u32)block->unk_0x0 >= min_size;
+    }
+    if (n == 0) {
+        return NULL;
+    }
+    pick %= n;
+    for (block = head->unk_0x8;; block = block->unk_0x8) {
+        if (block->unk_0x4 == 0 && (u32)block->unk_0x0 >= min_size && pick-- == 0) {
+            return block;
+        }
+    }
+}
+
+/* Marks the front of a free block used, leaving the rest free */
+static void take_front(st_unk_0x800DC6E0* block, u32 front) {
+    st_unk_0x800DC6E0* rest = (st_unk_0x800DC6E0*)((u8*)block + front);
+
+    rest->unk_0x0 = block->unk_0x0 - front;
+    rest->unk_0x4 = 0;
+    rest->unk_0x8 = block->unk_0x8;
+    rest->unk_0xC = block;
+    block->unk_0x8->unk_0xC = rest;
+    block->unk_0x8 = rest;
+    block->unk_0x0 = front;
+    block->unk_0x4 = ARENA_BLOCK_USED;
+}
+
+unsigned int bridge_bypass(int arena, int kind, unsigned int pick, unsigned int ptr) {
+    st_unk_0x800DC6E0* head = &D_800DC6E0[arena];
+    st_unk_0x800DC6E0* block;
+    u32 front = bridge_request_size(0x20);
+
+    switch (kind) {
+        case BYPASS_TAKE:
+            block = nth_free(arena, pick, ARENA_HEADER_SIZE + 8);
+            if (block == NULL) {
+                return 0;
+            }
+            block->unk_0x4 = ARENA_BLOCK_USED;
+            head->unk_0x10 -= block->unk_0x0;
+            return (unsigned long)&block->unk_0x10;
+
+        case BYPASS_SPLIT:
+            block = nth_free(arena, pick, front + ARENA_BIN_MIN);
+            if (block == NULL) {
+                return 0;
+            }
+            take_front(block, front);
+            head->unk_0x10 -= front;
+            return (unsigned long)&block->unk_0x10;
+
+        case BYPASS_RELEASE:
+            block = header(ptr);
+            block->unk_0x4 = 0;
+            head->unk_0x10 += block->unk_0x0;
+            return 0;
+
+        case BYPASS_SWAP:
+            front = header(ptr)->unk_0x0;
+            block = nth_free(arena, pick, front);
+            if (block == NULL || ((u32)block->unk_0x0 != front && (u32)block->unk_0x0 < front + ARENA_BIN_MIN)) {
+                return 0;
+            }
+            if ((u32)block->unk_0x0 == front) {
+                block->unk_0x4 = ARENA_BLOCK_USED;
+            } else {
+                take_front(block, front);
+            }
+            header(ptr)->unk_0x4 = 0;
+            return (unsigned long)&block->unk_0x10;
+    }
+    return 0;
+}
+
+int bridge_boot(int expansion, unsigned int ranges[4][2], unsigned int residency[2]) {
+    int i;
+
+    heap_range_count = 0;
+    residency_range[0] = residency_range[1] = 0;
+    func_8004E1E0(expansion);
+    for (i = 0; i < heap_range_count && i < 4; i++) {
+        ranges[i][0] = heap_ranges[i][0];
+        ranges[i][1] = heap_ranges[i][1];
+    }
+    residency[0] = residency_range[0];
+    residency[1] = residency_range[1];
+    return heap_range_count;
+}
+
+int bridge_boot_arena_ok(void) {
+    return D_800DC728.unk_0x0 == 0 && D_800DC728.unk_0x4 == -1 && D_800DC728.unk_0x8 == &D_800DC728 &&
+           D_800DC728.unk_0xC == &D_800DC728 && D_800DC728.unk_0x10 == 0 && D_800DC728.unk_0x14 == -1;
+}
+
+unsigned int bridge_frame_heap_size(int expansion) {
+    return expansion ? FRAME_HEAP_SIZE_EXPANSION : FRAME_HEAP_SIZE;
+}
+
+unsigned int bridge_residency_size(void) {
+    return OVERLAY_RESIDENCY_SIZE;
+}
+
+void bridge_frame_init(unsigned int base, unsigned int size) {
+    frame_heap_init((void*)(unsigned long)base, size);
+}
+
+unsigned int bridge_frame_alloc(unsigned int size) {
+    return (unsigned long)frame_alloc(size);
+}
+
+unsigned int bridge_frame_mark(void) {
+    return frame_mark();
+}
+
+void bridge_frame_release(unsigned int mark) {
+    frame_release(mark);
+}
+
+void bridge_frame_stats(unsigned int stats[6]) {
+    MGFrameHeapStats s;
+
+    frame_heap_get_stats(&s);
+    stats[0] = s.size;
+    stats[1] = s.used;
+    stats[2] = s.high_water;
+    stats[3] = s.frames;
+    stats[4] = s.overflows;
+    stats[5] = s.overflow_size;
+}
+
+void bridge_gfx_init(void) {
+    nuGfxSwapCfbFuncSet(cfb_swap);
+}
+
+void bridge_game_sets_swap(void) {
+    nuGfxSwapCfbFuncSet(game_swap);
+}
+
+int bridge_swap(int seen[2]) {
+    if (nuGfxSwapCfbFunc == NULL) {
+        return 0;
+    }
+    nuGfxSwapCfbFunc(NULL);
+    seen[0] = swaps_seen[0];
+    seen[1] = swaps_seen[1];
+    return 1;
+}
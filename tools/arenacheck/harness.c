@@ -0,0 +1,667 @@
+/*
+ * arenacheck: runs src/28590.c's arena allocator, built with ARENA_BINS,
+ * on the host and checks its size class bins against the block lists, and
+ * with ENHANCEMENTS the frame heap and how boot carves it out.
+ *
+ *   arenacheck [-v] [--ops n] [--seed n]
+ *
+ * First the helpers the bins are found with: arena_lowest_bit's de Bruijn
+ * lookup and arena_highest_bit against the compiler's bit scans,
+ * arena_size_class's classes against their layout, and arena_bin_next
+ * against a scan of random bitmaps.
+ *
+ * Then func_8004E1E0, with and without the expansion pak: what it hands to
+ * the heap, where the frame heap and the overlay residency cache start, and
+ * that the frame heap flips at the first swap whether nuGfxInit ran before
+ * or after it. The frame heap
+ * then has to pack and round allocations, hand back what was taken after a
+ * mark, refuse marks above the top or from another frame, including across
+ * the generation wrapping, fail and count allocations that don't fit,
+ * logging once a frame, and chain a swap callback set after it.
+ *
+ * Then func_8004E058's merging: a free between two free blocks, after one
+ * and before one each have to leave a single block where they were;
+ * arena_set_deferred_free has to keep frees apart until arena_coalesce, an
+ * allocation only a merged block fits, or turning it off merges them; and
+ * a free with the arena and pointer swapped has to change nothing.
+ *
+ * Then an arena of two regions takes a mix of allocations, small ones that
+ * split blocks, large ones that take them whole, and frees, in random
+ * order; after each, the bins have to hold exactly the free blocks the
+ * block list does, no two free blocks may be left side by side, unk_0x10
+ * has to be the free bytes and, after an allocation, unk_0x14 the largest
+ * free block. An allocation may only fail if no free block fits, and no
+ * two live allocations may overlap. The same mix runs again with deferred
+ * frees turned on and off every 250 operations.
+ *
+ * Last the same mix runs with blocks taken, split and freed every so often
+ * behind the bins' back, as the allocator routines that are still asm
+ * might, sometimes a free and a take of the same size together so the free
+ * byte count doesn't show it. The bins can't see those until they trip over
+ * them, so only the block list is checked, but nothing may be handed out
+ * that isn't free, no live allocation may be written over, an allocation
+ * still only fails if nothing fits, and unk_0x14 may fall behind but never
+ * claim more than there is.
+ */
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "harness.h"
+
+#define ARENA     0
+#define LIVE_MAX  4096
+
+enum {
+    MIX_PLAIN,    /* frees merge at once */
+    MIX_BYPASS,   /* with edits behind the bins' back */
+    MIX_DEFERRED  /* with deferred frees turned on and off */
+};
+
+typedef struct {
+    unsigned int ptr;
+    int size;
+} Live;
+
+static int verbose;
+static uint32_t rng_state = 1;
+static Live live[LIVE_MAX];
+static int live_count;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return rng_state >> 8;
+}
+
+/* How many times the frame heap has said it was out of memory, or been given a stale mark */
+static int overflows_logged, stale_logged;
+
+void harness_vlog(const char* fmt, va_list args) {
+    overflows_logged += strstr(fmt, "FrameHeap: out of memory") != NULL;
+    stale_logged += strstr(fmt, "FrameHeap: stale mark") != NULL;
+    if (verbose) {
+        vprintf(fmt, args);
+    }
+}
+
+static int fail(const char* what, int op) {
+    printf("  op %d: %s\n", op, what);
+    return 1;
+}
+
+static int check_bits(void) {
+    unsigned int bits, nonempty[4];
+    int i, n, class, want;
+
+    for (i = 0; i < 32; i++) {
+        if (bridge_lowest_bit(1u << i) != i || bridge_highest_bit(1u << i) != i) {
+            printf("  bit %d: lowest %d, highest %d\n", i, bridge_lowest_bit(1u << i), bridge_highest_bit(1u << i));
+            return 1;
+        }
+    }
+    for (n = 0; n < 1000000; n++) {
+        bits = rng() ^ (rng() << 12);
+        bits >>= rng() % 32;
+        if (bits == 0) {
+            continue;
+        }
+        if (bridge_lowest_bit(bits) != __builtin_ctz(bits) || bridge_highest_bit(bits) != 31 - __builtin_clz(bits)) {
+            printf("  %08x: lowest %d, highest %d\n", bits, bridge_lowest_bit(bits), bridge_highest_bit(bits));
+            return 1;
+        }
+    }
+
+    for (n = 0; n < 100000; n++) {
+        for (i = 0; i < 4; i++) {
+            nonempty[i] = rng() % 3 ? 0 : rng() << (rng() % 24);
+        }
+        class = rng() % (bridge_bin_count() + 1);
+        for (want = class; want < bridge_bin_count() && !((nonempty[want >> 5] >> (want & 31)) & 1); want++) {
+        }
+        if (want == bridge_bin_count()) {
+            want = -1;
+        }
+        if (bridge_bin_next(nonempty, class) != want) {
+            printf("  arena_bin_next from %d: %d, not %d\n", class, bridge_bin_next(nonempty, class), want);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * One class per 8 bytes below 0x200; above it, four to each power of two,
+ * each a quarter of it wide, until the last class takes everything left.
+ */
+static int check_classes(void) {
+    int last = bridge_bin_count() - 1, class, prev = 0, log2, want;
+    unsigned long long at;
+    unsigned int size;
+
+    for (size = 0; size < 0x200; size++) {
+        if (bridge_size_class(size) != (int)(size >> 3)) {
+            printf("  size %x: class %d, not %d\n", size, bridge_size_class(size), size >> 3);
+            return 1;
+        }
+    }
+    for (at = 0x200; at <= 0xFFFFFFFF; at += (at >> 6) - 1 + (rng() & 1)) {
+        size = at;
+        class = bridge_size_class(size);
+        log2 = 31 - __builtin_clz(size);
+        want = 64 + (log2 - 9) * 4 + ((size >> (log2 - 2)) & 3);
+        if (want > last) {
+            want = last;
+        }
+        if (class != want || class < prev) {
+            printf("  size %x: class %d, not %d\n", size, class, want);
+            return 1;
+        }
+        prev = class;
+    }
+    if (bridge_size_class(0xFFFFFFF8) != last) {
+        printf("  the largest size isn't in the last class\n");
+        return 1;
+    }
+    return 0;
+}
+
+static void fill(const Live* l) {
+    memset((void*)(uintptr_t)l->ptr, (l->ptr >> 3) & 0xFF, l->size);
+}
+
+static int intact(const Live* l) {
+    const unsigned char* p = (const unsigned char*)(uintptr_t)l->ptr;
+    int i;
+
+    for (i = 0; i < l->size; i++) {
+        if (p[i] != ((l->ptr >> 3) & 0xFF)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void arena_setup(void) {
+    bridge_arena_init(ARENA);
+    bridge_arena_add(ARENA, HARNESS_MEM_BASE, HARNESS_MEM_BASE + 0x60000);
+    bridge_arena_add(ARENA, HARNESS_MEM_BASE + 0x80000, HARNESS_MEM_BASE + HARNESS_MEM_SIZE);
+    live_count = 0;
+}
+
+static int random_size(void) {
+    switch (rng() % 10) {
+        case 0:
+            return 0x4000 + rng() % 0x1C000;
+        case 1:
+        case 2:
+        case 3:
+            return 0x200 + rng() % 0x3E00;
+        default:
+            return 1 + rng() % 0x1F8;
+    }
+}
+
+/* Returns how many checks failed; counts what it did in stats */
+static int run_mix(int ops, int mode, int stats[4]) {
+    const char* why;
+    unsigned int ptr, want;
+    int op, i, size, failures = 0, after_bypass = 0, deferred = 0;
+
+    arena_setup();
+    for (op = 0; op < ops && failures < 10; op++) {
+        if (mode == MIX_DEFERRED && op % 250 == 0) {
+            deferred = !deferred;
+            bridge_set_deferred(ARENA, deferred);
+            if (!deferred && (bridge_pending(ARENA) != 0 || bridge_unmerged(ARENA) != 0)) {
+                failures += fail("turning deferred frees off left blocks unmerged", op);
+            }
+            stats[3]++;
+        }
+        if (mode == MIX_BYPASS && rng() % 40 == 0) {
+            i = rng() % BYPASS_KINDS;
+            if (i == BYPASS_RELEASE || i == BYPASS_SWAP) {
+                if (live_count == 0) {
+                    continue;
+                }
+                size = rng() % live_count;
+                ptr = bridge_bypass(ARENA, i, rng(), live[size].ptr);
+                if (i == BYPASS_RELEASE) {
+                    live[size] = live[--live_count];
+                } else if (ptr != 0) {
+                    /* Over the bin links the bins last saw there */
+                    live[size].ptr = ptr;
+                    live[size].size = bridge_block_size(ptr) - bridge_request_size(0);
+                    fill(&live[size]);
+                }
+            } else if (live_count < LIVE_MAX && (ptr = bridge_bypass(ARENA, i, rng(), 0)) != 0) {
+                live[live_count].ptr = ptr;
+                live[live_count].size = 8;
+                fill(&live[live_count++]);
+            }
+            stats[3]++;
+            after_bypass = 1;
+            continue;
+        }
+
+        if (live_count == 0 || (live_count < LIVE_MAX && rng() % 100 < 55)) {
+            size = random_size();
+            ptr = bridge_alloc(ARENA, size);
+            if (ptr == 0) {
+                if (bridge_largest_free(ARENA) >= bridge_request_size(size)) {
+                    failures += fail("an allocation failed with a block that fits free", op);
+                }
+                stats[2]++;
+            } else {
+                if (bridge_block_size(ptr) < bridge_request_size(size)) {
+                    failures += fail("an allocation's block is smaller than asked for", op);
+                }
+                stats[0]++;
+                live[live_count].ptr = ptr;
+                live[live_count].size = size;
+                fill(&live[live_count++]);
+            }
+            /* A block freed behind the bins' back can go unseen until the next miss */
+            want = bridge_largest_free(ARENA);
+            if ((unsigned int)bridge_largest(ARENA) > want) {
+                failures += fail("unk_0x14 is larger than any free block", op);
+            } else if (mode != MIX_BYPASS && (unsigned int)bridge_largest(ARENA) != want) {
+                failures += fail("unk_0x14 isn't the largest free block", op);
+            }
+        } else {
+            i = rng() % live_count;
+            if (!intact(&live[i])) {
+                failures += fail("a live allocation was overwritten", op);
+            }
+            bridge_free(ARENA, live[i].ptr);
+            live[i] = live[--live_count];
+            stats[1]++;
+        }
+
+        if (!bridge_check(ARENA, mode != MIX_BYPASS, &why)) {
+            failures += fail(why, op);
+            if (after_bypass) {
+                printf("  (after an edit behind the bins' back)\n");
+            }
+        }
+        if (mode == MIX_PLAIN && bridge_unmerged(ARENA) != 0) {
+            failures += fail("a free left two free blocks side by side", op);
+        }
+        after_bypass = 0;
+    }
+    bridge_set_deferred(ARENA, 0);
+
+    for (i = 0; i < live_count; i++) {
+        if (!intact(&live[i])) {
+            failures += fail("a live allocation was overwritten", op);
+        }
+    }
+    return failures;
+}
+
+/*
+ * Frees a run of blocks so the last has free blocks on both sides, then
+ * either side alone; each has to leave one block where the run was.
+ */
+static int check_neighbours(void) {
+    const char* why;
+    unsigned int ptr[8], size;
+    int i, blocks;
+
+    arena_setup();
+    for (i = 0; i < 8; i++) {
+        ptr[i] = bridge_alloc(ARENA, 0x100);
+    }
+    size = bridge_block_size(ptr[0]);
+    for (i = 1; i < 8; i++) {
+        if (ptr[i] != ptr[i - 1] + size) {
+            printf("  the blocks to free aren't side by side\n");
+            return 1;
+        }
+    }
+
+    /* 1 and 3, then 2 between them */
+    bridge_free(ARENA, ptr[1]);
+    bridge_free(ARENA, ptr[3]);
+    blocks = bridge_blocks(ARENA);
+    bridge_free(ARENA, ptr[2]);
+    if (bridge_blocks(ARENA) != blocks - 2 || bridge_block_size(ptr[1]) != 3 * size) {
+        printf("  a free between two free blocks didn't merge all three\n");
+        return 1;
+    }
+    /* 0, with the free run after it */
+    bridge_free(ARENA, ptr[0]);
+    if (bridge_blocks(ARENA) != blocks - 3 || bridge_block_size(ptr[0]) != 4 * size) {
+        printf("  a free before a free block didn't merge with it\n");
+        return 1;
+    }
+    /* 4, with the run before it and 5 still used after */
+    bridge_free(ARENA, ptr[4]);
+    if (bridge_blocks(ARENA) != blocks - 4 || bridge_block_size(ptr[0]) != 5 * size) {
+        printf("  a free after a free block didn't merge with it\n");
+        return 1;
+    }
+    if (!bridge_check(ARENA, 1, &why) || bridge_unmerged(ARENA) != 0) {
+        printf("  %s\n", bridge_unmerged(ARENA) ? "free blocks left side by side" : why);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Frees a scene's worth of blocks with deferred frees on: they stay apart,
+ * in their bins, until arena_coalesce, an allocation nothing but a merged
+ * block fits, or arena_set_deferred_free turning it off merges them.
+ */
+static int check_deferred(void) {
+    const char* why;
+    unsigned int whole;
+    int round, i, n;
+
+    for (round = 0; round < 3; round++) {
+        arena_setup();
+        whole = bridge_largest_free(ARENA);
+        for (n = 0; n < LIVE_MAX && (live[n].ptr = bridge_alloc(ARENA, 1 + rng() % 0x400)) != 0; n++) {
+        }
+        bridge_set_deferred(ARENA, 1);
+        while (n > 0) {
+            i = rng() % n;
+            bridge_free(ARENA, live[i].ptr);
+            live[i] = live[--n];
+        }
+        if (bridge_unmerged(ARENA) == 0 || bridge_pending(ARENA) == 0) {
+            printf("  deferred frees were merged\n");
+            return 1;
+        }
+        if (!bridge_check(ARENA, 1, &why)) {
+            printf("  after deferred frees: %s\n", why);
+            return 1;
+        }
+
+        switch (round) {
+            case 0:
+                bridge_coalesce(ARENA);
+                break;
+            case 1:
+                if (bridge_alloc(ARENA, whole - 0x100) == 0) {
+                    printf("  an allocation only a merged block fits failed\n");
+                    return 1;
+                }
+                break;
+            case 2:
+                bridge_set_deferred(ARENA, 0);
+                break;
+        }
+        if (bridge_pending(ARENA) != 0 || bridge_unmerged(ARENA) != 0 || !bridge_check(ARENA, 1, &why)) {
+            printf("  round %d: %s\n", round, bridge_unmerged(ARENA) ? "free blocks left side by side" : why);
+            return 1;
+        }
+        if (round == 0 && (unsigned int)bridge_largest(ARENA) != whole) {
+            printf("  arena_coalesce left unk_0x14 at %x, not %x\n", bridge_largest(ARENA), whole);
+            return 1;
+        }
+        bridge_set_deferred(ARENA, 0);
+    }
+    return 0;
+}
+
+/* A free with the pointer where the arena goes has to touch nothing */
+static int check_swapped(void) {
+    const char* why;
+    unsigned int ptr, free_bytes;
+    int blocks;
+
+    arena_setup();
+    ptr = bridge_alloc(ARENA, 0x40);
+    bridge_alloc(ARENA, 0x40);
+    free_bytes = bridge_free_bytes(ARENA);
+    blocks = bridge_blocks(ARENA);
+    /* Arena 0 would come through as a NULL pointer, which is refused anyway */
+    bridge_free_swapped(ARENA + 1, ptr);
+    if (bridge_free_bytes(ARENA) != free_bytes || bridge_blocks(ARENA) != blocks || !bridge_check(ARENA, 1, &why)) {
+        printf("  a free with its arguments swapped changed the arena\n");
+        return 1;
+    }
+    bridge_free(ARENA, ptr);
+    if (bridge_free_bytes(ARENA) == free_bytes) {
+        printf("  the block wasn't freed afterwards\n");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * func_8004E1E0 has to take the frame heap off the top of the memory it
+ * hands to the heap, and with the expansion pak the overlay residency
+ * cache above that, before or after nuGfxInit sets nuGfxSwapCfb, and
+ * still chain nuGfxSwapCfb at the first swap.
+ */
+static int check_boot(void) {
+    unsigned int ranges[4][2], residency[2], size, frame, cache;
+    int seen[2], expansion, n;
+
+    for (expansion = 0; expansion <= 1; expansion++) {
+        cache = expansion ? 0x80800000u - bridge_residency_size() : 0;
+        size = bridge_frame_heap_size(expansion);
+        frame = (expansion ? cache : 0x802EA000u) - size;
+        n = bridge_boot(expansion, ranges, residency);
+        if (residency[0] != cache || residency[1] != (expansion ? 0x80800000u : 0)) {
+            printf("  expansion %d: the overlay residency cache is at %08x-%08x\n", expansion, residency[0],
+                   residency[1]);
+            return 1;
+        }
+        if (n != expansion + 1 || ranges[0][0] != 0x8025D800u ||
+            ranges[0][1] != (expansion ? 0x802EA000u : frame) ||
+            (expansion && (ranges[1][0] != 0x80600000u || ranges[1][1] != frame))) {
+            printf("  expansion %d: the heap isn't handed the right ranges\n", expansion);
+            return 1;
+        }
+        if (!bridge_boot_arena_ok()) {
+            printf("  expansion %d: D_800DC728 isn't set up as an arena\n", expansion);
+            return 1;
+        }
+
+        /* nuGfxInit after, on the first boot, and before, on the second */
+        if (!expansion) {
+            bridge_gfx_init();
+        }
+        if (bridge_frame_alloc(0x10) != frame) {
+            printf("  expansion %d: the frame heap doesn't start at %08x\n", expansion, frame);
+            return 1;
+        }
+        if (!bridge_swap(seen) || seen[0] != expansion + 1 || bridge_frame_alloc(0x10) != frame + size / 2) {
+            printf("  expansion %d: a swap didn't flip the frame heap and reach nuGfxSwapCfb\n", expansion);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The frame heap over real memory: allocations, marks and releases, both
+ * halves, a mark from before a swap, the generation wrapping, running out
+ * and the stats, and the swap callback changing under it.
+ */
+static int check_frame_heap(void) {
+    unsigned int base = HARNESS_MEM_BASE, half = 0x800, a, mark, stats[6];
+    int seen[2], chained, frames, i;
+
+    bridge_frame_init(base, 2 * half);
+    bridge_swap(seen);
+    chained = seen[0];
+    bridge_frame_init(base, 2 * half);
+    bridge_frame_stats(stats);
+    if (stats[0] != half || stats[3] != 0) {
+        printf("  frame_heap_init didn't start afresh\n");
+        return 1;
+    }
+
+    /* Which half is current carries over; take it from the first allocation */
+    a = bridge_frame_alloc(0x10);
+    if (a != base && a != base + half) {
+        printf("  the first allocation isn't at the start of a half\n");
+        return 1;
+    }
+    base = a;
+    if (bridge_frame_alloc(3) != base + 0x10 || bridge_frame_alloc(8) != base + 0x18) {
+        printf("  allocations aren't rounded to 8 and packed\n");
+        return 1;
+    }
+    mark = bridge_frame_mark();
+    a = bridge_frame_alloc(0x100);
+    bridge_frame_release(mark);
+    if (bridge_frame_alloc(0x80) != a) {
+        printf("  frame_release didn't hand back what was taken after the mark\n");
+        return 1;
+    }
+    /* A mark above the top, as one taken before a release further down */
+    bridge_frame_release(mark + 0x200);
+    if (stale_logged != 1 || bridge_frame_alloc(8) != a + 0x80) {
+        printf("  a mark above the top was taken\n");
+        return 1;
+    }
+
+    overflows_logged = 0;
+    bridge_frame_stats(stats);
+    if (bridge_frame_alloc(half) != 0 || bridge_frame_alloc(half + 0x100) != 0 || bridge_frame_alloc(0xFFFFFFF8) != 0) {
+        printf("  an allocation past the half didn't fail\n");
+        return 1;
+    }
+    bridge_frame_stats(stats);
+    if (stats[4] != 3 || stats[5] != 0xFFFFFFF8 || overflows_logged != 1 || stats[1] != 0x88 + a - base) {
+        printf("  overflows: %u counted, largest %x, %d logged\n", stats[4], stats[5], overflows_logged);
+        return 1;
+    }
+    if (stats[2] != a + 0x100 - base) {
+        printf("  the high water mark is %x, not %x\n", stats[2], a + 0x100 - base);
+        return 1;
+    }
+
+    /* A swap flips to the other half, empty, and is passed on */
+    mark = bridge_frame_mark();
+    bridge_swap(seen);
+    if (seen[0] != chained + 1) {
+        printf("  frame_heap_init twice chained the swap more than once\n");
+        return 1;
+    }
+    a = bridge_frame_alloc(8);
+    if (a != (base == HARNESS_MEM_BASE ? base + half : HARNESS_MEM_BASE)) {
+        printf("  a swap didn't flip halves\n");
+        return 1;
+    }
+    bridge_frame_release(mark);
+    if (stale_logged != 2 || bridge_frame_alloc(8) != a + 8) {
+        printf("  a mark from before the swap was taken\n");
+        return 1;
+    }
+    overflows_logged = 0;
+    bridge_frame_alloc(half);
+    bridge_swap(seen);
+    bridge_frame_alloc(half + 8);
+    if (overflows_logged != 2 || bridge_frame_alloc(8) != base) {
+        printf("  running out isn't logged once a frame, or the halves don't alternate\n");
+        return 1;
+    }
+
+    /* Round to generation 255, then over the wrap */
+    for (i = 0; i < 256 && (bridge_frame_mark() >> 24) != 255; i++) {
+        bridge_swap(seen);
+    }
+    mark = bridge_frame_mark();
+    bridge_swap(seen);
+    if ((bridge_frame_mark() >> 24) != 0) {
+        printf("  the generation didn't wrap to 0\n");
+        return 1;
+    }
+    bridge_frame_release(mark);
+    a = bridge_frame_alloc(8);
+    mark = bridge_frame_mark();
+    bridge_frame_alloc(8);
+    bridge_frame_release(mark);
+    if (stale_logged != 3 || bridge_frame_alloc(8) != a + 8) {
+        printf("  marks across the generation wrap\n");
+        return 1;
+    }
+
+    /* A callback the game sets afterwards is chained at the next allocation */
+    bridge_frame_stats(stats);
+    frames = stats[3];
+    bridge_game_sets_swap();
+    bridge_frame_alloc(8);
+    chained = seen[0];
+    bridge_swap(seen);
+    bridge_frame_stats(stats);
+    if (seen[1] != 1 || seen[0] != chained || stats[3] != (unsigned int)frames + 1) {
+        printf("  a callback set after frame_heap_init wasn't chained\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int ops = 200000, failures = 0, n, stats[4];
+    void* mem;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (i + 1 < argc && strcmp(argv[i], "--ops") == 0) {
+            ops = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            rng_state = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: arenacheck [-v] [--ops n] [--seed n]\n");
+            return 1;
+        }
+    }
+
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    mem = mmap((void*)(uintptr_t)HARNESS_MEM_BASE, HARNESS_MEM_SIZE, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (mem != (void*)(uintptr_t)HARNESS_MEM_BASE) {
+        fprintf(stderr, "arenacheck: can't map the arenas at %08x\n", HARNESS_MEM_BASE);
+        return 1;
+    }
+
+    n = check_bits();
+    printf("bit scans and arena_bin_next: %s\n", n ? "MISMATCH" : "ok");
+    failures += n;
+    n = check_classes();
+    printf("size classes: %s\n", n ? "MISMATCH" : "ok");
+    failures += n;
+
+    n = check_boot();
+    n += check_frame_heap();
+    printf("func_8004E1E0's carve-up and the frame heap: %s\n", n ? "MISMATCH" : "ok");
+    failures += n;
+
+    n = check_neighbours();
+    n += check_deferred();
+    n += check_swapped();
+    printf("merging with either neighbour and both, deferred frees, a swapped free: %s\n", n ? "MISMATCH" : "ok");
+    failures += n;
+
+    memset(stats, 0, sizeof(stats));
+    n = run_mix(ops, MIX_PLAIN, stats);
+    printf("mixed: %d allocations, %d frees, %d that didn't fit: %s\n", stats[0], stats[1], stats[2],
+           n ? "MISMATCH" : "bins agree with the block list, every free merged");
+    failures += n;
+
+    memset(stats, 0, sizeof(stats));
+    n = run_mix(ops, MIX_BYPASS, stats);
+    printf("edited behind the bins: %d allocations, %d frees, %d edits: %s\n", stats[0], stats[1], stats[3],
+           n ? "MISMATCH" : "nothing handed out twice or written over");
+    failures += n;
+
+    memset(stats, 0, sizeof(stats));
+    n = run_mix(ops, MIX_DEFERRED, stats);
+    printf("deferred frees: %d allocations, %d frees, turned on and off %d times: %s\n", stats[0], stats[1],
+           stats[3], n ? "MISMATCH" : "bins agree with the block list");
+    failures += n;
+
+    printf(failures ? "FAILED\n" : "ok\n");
+    return failures ? 1 : 0;
+}
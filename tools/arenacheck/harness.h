@@ -0,0 +1,106 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <stdarg.h>
+
+/*
+ * Interface between harness.c, which only sees the host C library, and
+ * bridge.c, which includes src/28590.c itself so it can look at the
+ * arenas' bins and call the static helpers behind them. As in
+ * tools/ovlharness the two header sets can't share a translation unit
+ * (bzero and bool clash), so only plain C types cross this boundary.
+ */
+
+/*
+ * Where the arenas' memory is mapped. func_8004DD70 takes a region's end
+ * as an s32, and block addresses cross this interface as unsigned ints,
+ * so it sits well below 2GB.
+ */
+#define HARNESS_MEM_BASE 0x01000000u
+#define HARNESS_MEM_SIZE 0x00200000u
+
+/* Ways bridge_bypass edits an arena's blocks as asm routines might */
+enum {
+    BYPASS_TAKE,    /* marks a free block used, whole */
+    BYPASS_SPLIT,   /* takes the front of a free block, leaving the rest free */
+    BYPASS_RELEASE, /* marks a used block free, without merging it */
+    BYPASS_SWAP,    /* both at once, the same size, so unk_0x10 doesn't move */
+    BYPASS_KINDS
+};
+
+/* bridge.c -> harness.c */
+void harness_vlog(const char* fmt, va_list args);
+
+/* harness.c -> bridge.c */
+int bridge_lowest_bit(unsigned int bits);
+int bridge_highest_bit(unsigned int bits);
+int bridge_size_class(unsigned int size);
+int bridge_bin_next(const unsigned int nonempty[4], int class);
+int bridge_bin_count(void);
+
+/* func_8004DDE4, then func_8004DD70 for each region handed to it */
+void bridge_arena_init(int arena);
+void bridge_arena_add(int arena, unsigned int start, unsigned int end);
+
+unsigned int bridge_alloc(int arena, int size); /* the caller's address, or 0 */
+void bridge_free(int arena, unsigned int ptr);
+unsigned int bridge_block_size(unsigned int ptr); /* header and all */
+unsigned int bridge_request_size(int size);       /* what func_8004DE7C looks for */
+
+unsigned int bridge_free_bytes(int arena); /* unk_0x10 */
+int bridge_largest(int arena);             /* unk_0x14 */
+unsigned int bridge_largest_free(int arena); /* from the block list */
+
+/*
+ * Checks the block list is in address order with its links and the free
+ * byte count right, and with with_bins that the bins hold every free block
+ * big enough to hold their links, once, in the bin for its size, and
+ * nothing else. 1 if so, 0 with *why set if not.
+ */
+int bridge_check(int arena, int with_bins, const char** why);
+
+/* arena_set_deferred_free and arena_coalesce, and what they leave */
+void bridge_set_deferred(int arena, int enable);
+void bridge_coalesce(int arena);
+int bridge_pending(int arena);
+int bridge_blocks(int arena);   /* on the list, used or free */
+int bridge_unmerged(int arena); /* free blocks with a free block right after */
+
+/* func_8004E058 with its arguments the other way round */
+void bridge_free_swapped(int arena, unsigned int ptr);
+
+/*
+ * func_8004E1E0 with func_8004E184 recording the ranges it is handed,
+ * which go in ranges, and overlay_residency_init the one it is, which goes
+ * in residency (0, 0 if none); returns how many ranges the heap got.
+ */
+int bridge_boot(int expansion, unsigned int ranges[4][2], unsigned int residency[2]);
+int bridge_boot_arena_ok(void); /* D_800DC728 set up as func_8004DDE4 would */
+unsigned int bridge_frame_heap_size(int expansion);
+unsigned int bridge_residency_size(void);
+
+void bridge_frame_init(unsigned int base, unsigned int size);
+unsigned int bridge_frame_alloc(unsigned int size); /* the address, or 0 */
+unsigned int bridge_frame_mark(void);
+void bridge_frame_release(unsigned int mark);
+/* size, used, high_water, frames, overflows, overflow_size */
+void bridge_frame_stats(unsigned int stats[6]);
+
+/*
+ * nuGfxInit setting nuGfxSwapCfb, the game setting a callback of its own,
+ * and nuGfxTaskMgr calling whichever is set at a swap. bridge_swap returns
+ * 0 if there is none, else 1 with how many times each of the first two has
+ * been called so far.
+ */
+void bridge_gfx_init(void);
+void bridge_game_sets_swap(void);
+int bridge_swap(int seen[2]);
+
+/*
+ * Edits the pick'th free block and, for BYPASS_RELEASE and BYPASS_SWAP, the
+ * block at ptr without the bins, keeping unk_0x10 as asm would. Returns the
+ * address of a block it made used, or 0 if it did nothing.
+ */
+unsigned int bridge_bypass(int arena, int kind, unsigned int pick, unsigned int ptr);
+
+#endif
@@ -0,0 +1,43 @@
+/*
+ * Forced ahead of src/28590.c and the headers it includes (-include).
+ *
+ * ultratypes.h spells s32 as long, which is 64 bits here, so its guard is
+ * taken and the types are given their N64 widths instead, as
+ * tools/seqrender/hostultra.h does; but without <stdint.h>, as mg_type.h
+ * defines intptr_t and its limits itself.
+ */
+#ifndef HOSTMG_H
+#define HOSTMG_H
+
+#define _ULTRATYPES_H_
+
+typedef unsigned char u8;
+typedef unsigned short u16;
+typedef unsigned int u32;
+typedef unsigned long long u64;
+
+typedef signed char s8;
+typedef short s16;
+typedef int s32;
+typedef long long s64;
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+typedef volatile s8 vs8;
+typedef volatile s16 vs16;
+typedef volatile s32 vs32;
+typedef volatile s64 vs64;
+
+typedef float f32;
+typedef double f64;
+
+typedef unsigned long size_t;
+
+#define TRUE 1
+#define FALSE 0
+#define NULL 0
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * libultra/nusys stand-ins for running nusys's nuaudma.c on the host. PI
+ * reads copy straight out of the harness's ROM image, so every DMA has
+ * landed by the time the callback hands its buffer back; the harness only
+ * counts them.
+ */
+#include <ultra64.h>
+#include <nusys.h>
+#include <nualsgi.h>
+
+#include "harness.h"
+
+u32 nuAuFrameCounter;
+OSPiHandle* nuPiCartHandle;
+
+static NUDMAState* states[HARNESS_VOICES_MAX];
+static ALDMAproc dma_proc;
+
+void* nuAuHeapAlloc(s32 length) {
+    return harness_alloc(length);
+}
+
+void alLink(ALLink* element, ALLink* after) {
+    element->next = after->next;
+    element->prev = after;
+    if (after->next) {
+        after->next->prev = element;
+    }
+    after->next = element;
+}
+
+void alUnlink(ALLink* element) {
+    if (element->next) {
+        element->next->prev = element->prev;
+    }
+    if (element->prev) {
+        element->prev->next = element->next;
+    }
+}
+
+void osCreateMesgQueue(OSMesgQueue* mq, OSMesg* msg, s32 count) {
+}
+
+s32 osPiStartDma(OSIoMesg* mb, s32 priority, s32 direction, u32 devAddr, void* vAddr, u32 nbytes,
+                 OSMesgQueue* mq) {
+    harness_pi_read(devAddr, vAddr, nbytes);
+    return 0;
+}
+
+s32 osEPiStartDma(OSPiHandle* handle, OSIoMesg* mb, s32 direction) {
+    harness_pi_read(mb->devAddr, mb->dramAddr, mb->size);
+    return 0;
+}
+
+u32 osVirtualToPhysical(void* addr) {
+    return harness_physical(addr);
+}
+
+int bridge_cached(void) {
+#ifdef NU_AU_DMA_CACHE
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void bridge_new_voice(int voice) {
+    dma_proc = nuAuDmaNew(&states[voice]);
+}
+
+unsigned int bridge_read(int voice, int rom_addr, int size) {
+    return (u32)dma_proc(rom_addr, size, states[voice]);
+}
+
+void bridge_frame(void) {
+    nuAuCleanDMABuffers();
+}
+
+void bridge_counts(HarnessCounts* counts) {
+#ifdef NU_AU_DMA_CACHE
+    counts->hits = nuAuDmaHitCount;
+    counts->misses = nuAuDmaMissCount;
+    counts->no_buffer = nuAuDmaNoBufCount;
+    counts->prefetches = nuAuDmaPrefetchCount;
+    counts->prefetch_hits = nuAuDmaPrefetchHitCount;
+#else
+    counts->hits = counts->misses = counts->no_buffer = counts->prefetches = counts->prefetch_hits = 0;
+#endif
+}
@@ -0,0 +1,156 @@
+/*
+ * auddma: streams voices' sample reads through nusys's audio DMA callback
+ * (nuaudma.c) on the host, against a random ROM image, and checks that
+ * every read hands back the bytes at its ROM address.
+ *
+ *   auddma[_cache] [--voices n] [--frames n] [--seed n]
+ *
+ * auddma is built from the list code, auddma_cache with NU_AU_DMA_CACHE, so
+ * the same run can be compared across both. nusys's defaults apply:
+ * NU_AU_DMA_BUFFER_NUM buffers of NU_AU_DMA_BUFFER_SIZE bytes.
+ *
+ * Each frame every voice makes two ADPCM-sized reads (9 bytes per 16
+ * samples, 6 to 8 frames of them) of a sample somewhere in ROM, looping
+ * back a third of the way in at its end; now and then a voice moves on to
+ * another sample. The stand-in PI copies at once, so "dmas" is every
+ * transfer started; with the cache, the reads that had to wait for one are
+ * its misses, the others were started ahead of time for a voice.
+ *
+ * "bad" reads got the wrong bytes, "stray" ones an address outside the
+ * buffers altogether (the callback's answer when it has no buffer to give).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "harness.h"
+
+#define ROM_SIZE    0x200000
+#define SAMPLE_MIN  2000        /* bytes */
+#define SAMPLE_MAX  22000
+/* nuaudma.c hands back physical addresses as 32 bits, so the heap sits below 4GB */
+#define ARENA_BASE  ((void*)0x10000000)
+#define ARENA_SIZE  0x1000000
+
+typedef struct {
+    int start;
+    int end;
+    int pos;
+} Voice;
+
+static unsigned char rom[ROM_SIZE];
+static unsigned char* arena;
+static unsigned int arena_used;
+static unsigned int dmas;
+
+void* harness_alloc(int size) {
+    void* ptr = arena + arena_used;
+
+    arena_used += (size + 15) & ~15;
+    if (arena_used > ARENA_SIZE) {
+        fprintf(stderr, "auddma: out of heap\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+void harness_pi_read(unsigned int rom_addr, void* dst, unsigned int size) {
+    if (rom_addr + size > ROM_SIZE) {
+        fprintf(stderr, "auddma: read of 0x%X bytes at 0x%X is past the ROM\n", size, rom_addr);
+        exit(1);
+    }
+    memcpy(dst, rom + rom_addr, size);
+    dmas++;
+}
+
+unsigned int harness_physical(void* addr) {
+    return (unsigned int)(unsigned long)addr;
+}
+
+static void voice_place(Voice* voice) {
+    voice->start = voice->pos = rand() % (ROM_SIZE - SAMPLE_MAX);
+    voice->end = voice->start + SAMPLE_MIN + rand() % (SAMPLE_MAX - SAMPLE_MIN);
+}
+
+int main(int argc, char** argv) {
+    static Voice voices[HARNESS_VOICES_MAX];
+    HarnessCounts counts;
+    int num_voices = 24;
+    unsigned int frames = 3000;
+    unsigned int seed = 5;
+    unsigned int reads = 0, bad = 0, stray = 0;
+    unsigned int frame, i, addr;
+    unsigned char* data;
+    int k, size;
+
+    for (k = 1; k < argc; k++) {
+        if (!strcmp(argv[k], "--voices") && k + 1 < argc) {
+            num_voices = atoi(argv[++k]);
+            if (num_voices < 1 || num_voices > HARNESS_VOICES_MAX) {
+                fprintf(stderr, "auddma: --voices must be 1 to %d\n", HARNESS_VOICES_MAX);
+                return 1;
+            }
+        } else if (!strcmp(argv[k], "--frames") && k + 1 < argc) {
+            frames = strtoul(argv[++k], NULL, 0);
+        } else if (!strcmp(argv[k], "--seed") && k + 1 < argc) {
+            seed = strtoul(argv[++k], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: auddma [--voices n] [--frames n] [--seed n]\n");
+            return 1;
+        }
+    }
+
+    arena = mmap(ARENA_BASE, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+                 -1, 0);
+    if (arena != ARENA_BASE) {
+        perror("auddma: mmap");
+        return 1;
+    }
+
+    /* the ROM and where the samples start are the same for every seed */
+    srand(1);
+    for (i = 0; i < ROM_SIZE; i++) {
+        rom[i] = rand();
+    }
+    for (k = 0; k < num_voices; k++) {
+        bridge_new_voice(k);
+        voice_place(&voices[k]);
+    }
+
+    srand(seed);
+    for (frame = 0; frame < frames; frame++) {
+        for (k = 0; k < num_voices; k++) {
+            Voice* voice = &voices[k];
+
+            for (i = 0; i < 2; i++) {
+                size = 9 * (6 + rand() % 3);
+                if (voice->pos + size > voice->end) {
+                    voice->pos = voice->start + (voice->end - voice->start) / 3;
+                }
+                if (frame % 500 == 0 && rand() % 4 == 0) {
+                    voice_place(voice);
+                }
+
+                addr = bridge_read(k, voice->pos, size);
+                data = (unsigned char*)(unsigned long)addr;
+                reads++;
+                if (data < arena || data + size > arena + arena_used) {
+                    stray++;
+                } else if (memcmp(data, rom + voice->pos, size)) {
+                    bad++;
+                }
+                voice->pos += size;
+            }
+        }
+        bridge_frame();
+    }
+
+    printf("voices %d frames %u reads %u dmas %u bad %u stray %u\n", num_voices, frames, reads, dmas, bad, stray);
+    if (bridge_cached()) {
+        bridge_counts(&counts);
+        printf("hit %u miss %u no buffer %u prefetch %u prefetch hit %u\n", counts.hits, counts.misses,
+               counts.no_buffer, counts.prefetches, counts.prefetch_hits);
+    }
+    return bad != 0;
+}
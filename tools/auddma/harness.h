@@ -0,0 +1,35 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+/*
+ * Interface between harness.c, which only sees the host C library, and
+ * bridge.c, which only sees libultra's and nusys's headers and links against
+ * nusys's nuaudma.c. As in tools/ovlharness the two header sets can't share
+ * a translation unit (bcopy clashes), so only plain C types cross this
+ * boundary.
+ */
+
+#define HARNESS_VOICES_MAX 64
+
+/* What NU_AU_DMA_CACHE counts; all zero when built without it */
+typedef struct {
+    unsigned int hits;
+    unsigned int misses;
+    unsigned int no_buffer;
+    unsigned int prefetches;
+    unsigned int prefetch_hits;
+} HarnessCounts;
+
+/* bridge.c -> harness.c */
+void* harness_alloc(int size);
+void harness_pi_read(unsigned int rom_addr, void* dst, unsigned int size);
+unsigned int harness_physical(void* addr);
+
+/* harness.c -> bridge.c */
+int bridge_cached(void);
+void bridge_new_voice(int voice);
+unsigned int bridge_read(int voice, int rom_addr, int size);
+void bridge_frame(void);
+void bridge_counts(HarnessCounts* counts);
+
+#endif
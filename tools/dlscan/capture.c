@@ -0,0 +1,157 @@
+/*
+ * Reading and writing guParseGbiDL's stream.
+ *
+ * guParseGbiDL sends the root list as the caller sized it, then each list
+ * a G_DL names, up to and including its G_ENDDL, every time it comes to
+ * that G_DL, and the data of each VTX, MTX and MOVEMEM. The same words can
+ * so be in several blocks; they were read from the same RDRAM in the same
+ * frame, so any of them will do to read a command, and a patch goes to
+ * all of them.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlscan.h"
+
+uint32_t dl_word(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+void dl_put_word(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static int has_commands(const DlBlock* b) {
+    return b->type == DL_BLOCK_GBI || b->type == DL_BLOCK_RDP;
+}
+
+static int holds(const DlBlock* b, uint32_t paddr) {
+    return has_commands(b) && b->size >= 8 && paddr >= b->paddr && paddr - b->paddr <= b->size - 8 &&
+           ((paddr - b->paddr) & 7) == 0;
+}
+
+int dl_read_capture(DlCapture* cap, const uint8_t* data, size_t size, const char** error) {
+    size_t at = 0, frame_cap = 0, block_cap = 0;
+    DlFrame* frame = NULL;
+    DlBlock* b;
+    int32_t type, length;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->stream = malloc(size > 0 ? size : 1);
+    memcpy(cap->stream, data, size);
+    cap->size = size;
+
+    while (at < size) {
+        if (size - at < DL_HEADER_SIZE) {
+            *error = "the capture ends inside a block header";
+            goto fail;
+        }
+        length = (int32_t)dl_word(cap->stream + at);
+        type = (int32_t)dl_word(cap->stream + at + 4);
+
+        if (frame == NULL) {
+            if (cap->count == frame_cap) {
+                frame_cap = frame_cap ? frame_cap * 2 : 16;
+                cap->frames = realloc(cap->frames, frame_cap * sizeof(DlFrame));
+            }
+            frame = &cap->frames[cap->count++];
+            memset(frame, 0, sizeof(*frame));
+            block_cap = 0;
+        }
+
+        if (type == DL_BLOCK_READY) {
+            /* Only the header; dataSize is whatever the last block had */
+            frame->ready_size = length;
+            frame->ready_flags = (int32_t)dl_word(cap->stream + at + 8);
+            frame->ready_paddr = dl_word(cap->stream + at + 12);
+            at += DL_HEADER_SIZE;
+            if (frame->count == 0 || frame->blocks[0].type != DL_BLOCK_GBI) {
+                *error = "a frame doesn't start with its display list";
+                goto fail;
+            }
+            frame->root = frame->blocks[0].paddr;
+            frame = NULL;
+            continue;
+        }
+
+        if (length < 0 || (size_t)length > size - at - DL_HEADER_SIZE) {
+            *error = "a block runs past the end of the capture";
+            goto fail;
+        }
+        if (frame->count == block_cap) {
+            block_cap = block_cap ? block_cap * 2 : 64;
+            frame->blocks = realloc(frame->blocks, block_cap * sizeof(DlBlock));
+        }
+        b = &frame->blocks[frame->count++];
+        b->type = type;
+        b->flags = (int32_t)dl_word(cap->stream + at + 8);
+        b->paddr = dl_word(cap->stream + at + 12);
+        b->size = length;
+        b->data = cap->stream + at + DL_HEADER_SIZE;
+        at += DL_HEADER_SIZE + length;
+    }
+
+    if (frame != NULL) {
+        *error = "the capture ends before its last frame's GU_PARSE_READY";
+        goto fail;
+    }
+    return 0;
+
+fail:
+    dl_free_capture(cap);
+    return -1;
+}
+
+int dl_write_capture(const DlCapture* cap, FILE* f) {
+    return fwrite(cap->stream, 1, cap->size, f) == cap->size ? 0 : -1;
+}
+
+void dl_free_capture(DlCapture* cap) {
+    size_t i;
+
+    for (i = 0; i < cap->count; i++) {
+        free(cap->frames[i].blocks);
+    }
+    free(cap->frames);
+    free(cap->stream);
+    memset(cap, 0, sizeof(*cap));
+}
+
+const DlBlock* dl_block(const DlFrame* frame, const DlBlock* hint, uint32_t paddr) {
+    size_t i;
+
+    if (hint != NULL && holds(hint, paddr)) {
+        return hint;
+    }
+    for (i = 0; i < frame->count; i++) {
+        if (holds(&frame->blocks[i], paddr)) {
+            return &frame->blocks[i];
+        }
+    }
+    return NULL;
+}
+
+const uint8_t* dl_find(const DlFrame* frame, uint32_t paddr) {
+    const DlBlock* b = dl_block(frame, NULL, paddr);
+
+    return b != NULL ? b->data + (paddr - b->paddr) : NULL;
+}
+
+int dl_patch(DlFrame* frame, uint32_t paddr, uint32_t w0, uint32_t w1) {
+    int patched = 0;
+    uint8_t* p;
+    size_t i;
+
+    for (i = 0; i < frame->count; i++) {
+        if (holds(&frame->blocks[i], paddr)) {
+            p = frame->blocks[i].data + (paddr - frame->blocks[i].paddr);
+            dl_put_word(p, w0);
+            dl_put_word(p + 4, w1);
+            patched++;
+        }
+    }
+    return patched;
+}
@@ -0,0 +1,240 @@
+#ifndef DLSCAN_H
+#define DLSCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Host library for the display lists guParseGbiDL captures: it reads the
+ * stream that function sends with osWriteHost, walks each frame's lists in
+ * the order the RSP would (G_DL calls and branches, segments from
+ * G_MW_SEGMENT), counts what they ask of the RSP and the RDP, and can turn
+ * the state commands and syncs the RDP doesn't need into no-ops.
+ *
+ * The stream is a run of blocks, each a guDLPrintCB (dataSize, dlType,
+ * flags, paddr as big-endian words) and then dataSize bytes, up to a
+ * GU_PARSE_READY block, which has no data; a capture may hold any number of
+ * those frames. Commands are left big-endian in the blocks, so a capture
+ * is written back byte for byte as it was read apart from what the
+ * optimizer changed.
+ */
+
+/* guDLPrintCB's dlType */
+#define DL_BLOCK_GBI    1
+#define DL_BLOCK_RDP    2
+#define DL_BLOCK_READY  3
+#define DL_BLOCK_MEM    4
+#define DL_BLOCK_ABI    5
+#define DL_BLOCK_STRING 6
+
+#define DL_HEADER_SIZE  16
+#define DL_MAX_DEPTH    10          /* G_DL pushes the RSP (and guParseGbiDL) keep */
+#define DL_SEGMENTS     16
+#define DL_MAX_COMMANDS (1u << 24)  /* per frame, should a branch loop */
+
+/* Which microcode the lists were built for: F3D or F3DEX, or F3DEX2 */
+typedef enum {
+    DL_GBI1,
+    DL_GBI2
+} DlGbi;
+
+typedef struct {
+    int32_t type;
+    int32_t flags;
+    uint32_t paddr;
+    uint32_t size;
+    uint8_t* data;              /* into the capture's copy of the stream */
+} DlBlock;
+
+typedef struct {
+    DlBlock* blocks;
+    size_t count;
+    uint32_t root;              /* the list guParseGbiDL was called on */
+    int32_t ready_size;         /* the READY block's dataSize, whatever it was left at */
+    int32_t ready_flags;
+    uint32_t ready_paddr;
+} DlFrame;
+
+typedef struct {
+    DlFrame* frames;
+    size_t count;
+    uint8_t* stream;
+    size_t size;
+} DlCapture;
+
+/*
+ * What a command does, the same for both GBIs. The RDP's own commands are
+ * passed through by either microcode, so they keep their opcode and are
+ * DL_CMD_RDP.
+ */
+typedef enum {
+    DL_CMD_UNKNOWN,
+    DL_CMD_NOOP,
+    DL_CMD_VTX,
+    DL_CMD_MODIFYVTX,
+    DL_CMD_MTX,
+    DL_CMD_POPMTX,
+    DL_CMD_MOVEMEM,
+    DL_CMD_MOVEWORD,
+    DL_CMD_DL,
+    DL_CMD_ENDDL,
+    DL_CMD_CULLDL,
+    DL_CMD_BRANCH_Z,
+    DL_CMD_TRI1,
+    DL_CMD_TRI2,
+    DL_CMD_QUAD,
+    DL_CMD_LINE3D,
+    DL_CMD_TEXTURE,
+    DL_CMD_GEOMETRYMODE,        /* F3DEX2's, which clears and sets */
+    DL_CMD_SETGEOMETRYMODE,
+    DL_CMD_CLEARGEOMETRYMODE,
+    DL_CMD_SETOTHERMODE_H,
+    DL_CMD_SETOTHERMODE_L,
+    DL_CMD_RDPHALF_1,
+    DL_CMD_RDPHALF_2,
+    DL_CMD_LOAD_UCODE,
+    DL_CMD_RSP_OTHER,           /* reserved and sprite commands, F3DEX2's SPECIAL_* and DMA_IO */
+    DL_CMD_RDP
+} DlKind;
+
+/* RDP opcodes, as in gbi.h */
+enum {
+    DL_RDP_NOOP = 0xC0,
+    DL_RDP_TRI_FILL = 0xC8,     /* to 0xCF, shade, texture and z buffer bits */
+    DL_RDP_TEXRECT = 0xE4,
+    DL_RDP_TEXRECTFLIP = 0xE5,
+    DL_RDP_LOADSYNC = 0xE6,
+    DL_RDP_PIPESYNC = 0xE7,
+    DL_RDP_TILESYNC = 0xE8,
+    DL_RDP_FULLSYNC = 0xE9,
+    DL_RDP_SETKEYGB = 0xEA,
+    DL_RDP_SETKEYR = 0xEB,
+    DL_RDP_SETCONVERT = 0xEC,
+    DL_RDP_SETSCISSOR = 0xED,
+    DL_RDP_SETPRIMDEPTH = 0xEE,
+    DL_RDP_SETOTHERMODE = 0xEF,
+    DL_RDP_LOADTLUT = 0xF0,
+    DL_RDP_SETTILESIZE = 0xF2,
+    DL_RDP_LOADBLOCK = 0xF3,
+    DL_RDP_LOADTILE = 0xF4,
+    DL_RDP_SETTILE = 0xF5,
+    DL_RDP_FILLRECT = 0xF6,
+    DL_RDP_SETFILLCOLOR = 0xF7,
+    DL_RDP_SETFOGCOLOR = 0xF8,
+    DL_RDP_SETBLENDCOLOR = 0xF9,
+    DL_RDP_SETPRIMCOLOR = 0xFA,
+    DL_RDP_SETENVCOLOR = 0xFB,
+    DL_RDP_SETCOMBINE = 0xFC,
+    DL_RDP_SETTIMG = 0xFD,
+    DL_RDP_SETZIMG = 0xFE,
+    DL_RDP_SETCIMG = 0xFF
+};
+
+typedef struct {
+    uint32_t paddr;             /* where the command is */
+    uint32_t w0;
+    uint32_t w1;
+    uint8_t opcode;
+    DlKind kind;
+    int depth;                  /* 0 in the root list */
+} DlCommand;
+
+typedef struct {
+    const DlFrame* frame;
+    DlGbi gbi;
+    uint32_t stack[DL_MAX_DEPTH + 1];
+    int depth;
+    uint32_t segments[DL_SEGMENTS];
+    uint32_t half_1;            /* the last RDPHALF_1's word, G_BRANCH_Z's list */
+    uint32_t commands;
+    const DlBlock* last;        /* where the previous command was found */
+    const char* error;
+} DlWalker;
+
+typedef struct {
+    uint64_t commands;          /* walked, G_DL and G_ENDDL included */
+    uint64_t rdp_commands;      /* what the RDP gets: its own commands, triangles, othermode */
+    uint64_t rdp_bytes;         /* all the RDP is sent, triangles as the RSP would write them */
+    uint64_t noops;
+    uint64_t calls;             /* G_DL, calls and branches */
+    uint64_t returns;
+    int max_depth;
+    uint64_t vertices;
+    uint64_t matrices;
+    uint64_t triangles;
+    uint64_t rectangles;        /* texture and fill */
+    uint64_t texture_loads;     /* LOADBLOCK, LOADTILE and LOADTLUT */
+    uint64_t texture_bytes;     /* what those bring into TMEM */
+    uint64_t pipe_syncs;
+    uint64_t load_syncs;
+    uint64_t tile_syncs;
+    uint64_t full_syncs;
+    uint64_t state_commands;    /* othermode, combine, tiles, colors, images, geometry mode */
+    uint64_t branches_z;
+    uint64_t culls;
+    uint64_t by_opcode[256];
+} DlStats;
+
+typedef struct {
+    uint32_t state;             /* state commands that set what was already set */
+    uint32_t syncs;             /* syncs with nothing to wait for */
+    uint32_t loads;             /* LOADBLOCKs folded into the one before them */
+    uint32_t pinned;            /* commands left alone, reachable from a BRANCH_Z */
+} DlOptStats;
+
+/*
+ * Reads a whole stream, which the capture keeps. Returns 0, or -1 with
+ * *error set.
+ */
+int dl_read_capture(DlCapture* cap, const uint8_t* data, size_t size, const char** error);
+int dl_write_capture(const DlCapture* cap, FILE* f);
+void dl_free_capture(DlCapture* cap);
+
+uint32_t dl_word(const uint8_t* p);
+void dl_put_word(uint8_t* p, uint32_t value);
+
+/* The block holding the command at paddr, trying hint first, or NULL */
+const DlBlock* dl_block(const DlFrame* frame, const DlBlock* hint, uint32_t paddr);
+
+/* The command at paddr in the frame's GBI blocks, or NULL */
+const uint8_t* dl_find(const DlFrame* frame, uint32_t paddr);
+
+/* Writes w0 and w1 at paddr in each block that holds it; returns how many did */
+int dl_patch(DlFrame* frame, uint32_t paddr, uint32_t w0, uint32_t w1);
+
+DlKind dl_kind(DlGbi gbi, uint8_t opcode);
+const char* dl_name(DlGbi gbi, uint8_t opcode);
+
+/* What the segmented address w1 is in the frame, as the microcode would see it */
+uint32_t dl_address(const DlWalker* walker, uint32_t w1);
+
+void dl_walk_init(DlWalker* walker, const DlFrame* frame, DlGbi gbi, uint32_t start);
+
+/*
+ * Steps to the next command. Returns 1 with it in *cmd, 0 once the root
+ * list has ended, or -1 with walker->error set. G_BRANCH_Z is walked as not
+ * taken and G_CULLDL as not culling; the caller can follow the other way
+ * with a copy of the walker and dl_walk_branch.
+ */
+int dl_walk_next(DlWalker* walker, DlCommand* cmd);
+
+/* Has the walker take the G_BRANCH_Z it has just stepped over */
+void dl_walk_branch(DlWalker* walker);
+
+/* Counts what the frame's lists do; returns 0, or -1 with *error set */
+int dl_stats(const DlFrame* frame, DlGbi gbi, DlStats* stats, const char** error);
+void dl_add_stats(DlStats* total, const DlStats* stats);
+
+/*
+ * Turns each state command the RDP already has, and each sync with nothing
+ * behind it to wait for, into a G_SPNOOP, and folds pairs of LOADBLOCKs
+ * that load one run of texels into one. A command is only changed if that
+ * holds every time the frame walks it, and every list keeps its length and
+ * address, so the capture stays one the game could have sent. Returns 0;
+ * 1 with *error saying why, if the frame had to be left as it was; or -1
+ * with *error set.
+ */
+int dl_optimize(DlFrame* frame, DlGbi gbi, DlOptStats* stats, const char** error);
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * dlscan: reads display lists captured with guParseGbiDL and says what each
+ * frame asks of the RSP and the RDP; with -o, trims what the RDP doesn't
+ * need and writes the lists back as a capture of the same shape.
+ *
+ *   dlscan [--gbi2] [--opcodes] [--list file] [-o trimmed] capture
+ *
+ * The capture is what guParseGbiDL sends to the host, kept as it comes,
+ * any number of frames of it. --gbi2 reads the lists as F3DEX2's; F3D's
+ * and F3DEX's are the default. --opcodes adds how often each command was
+ * walked, over all the frames, and --list writes each command walked, in
+ * the order the RSP would come to it, indented by how deep the list is.
+ *
+ * With -o each frame is printed twice, as it was and as trimmed, and the
+ * trimmed capture is written out; running dlscan --list on both and
+ * diffing the two shows each command that was taken out or changed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlscan.h"
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    uint8_t* data;
+    long len;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(len > 0 ? len : 1);
+    if (fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: dlscan [--gbi2] [--opcodes] [--list file] [-o trimmed] capture\n"
+                    "  --gbi2     the lists are F3DEX2's (default F3D and F3DEX)\n"
+                    "  --opcodes  count each command, over all the frames\n"
+                    "  --list     write each command walked to file\n"
+                    "  -o         trim state and syncs the RDP doesn't need, write the capture to trimmed\n");
+}
+
+static void print_header(void) {
+    printf("%-9s | %8s | %8s %8s | %7s %6s | %6s %8s | %5s %5s %5s %5s | %6s | %6s %5s\n", "frame", "commands",
+           "RDP", "RDP KB", "tris", "rects", "loads", "tex KB", "pipe", "load", "tile", "full", "state", "calls",
+           "depth");
+}
+
+static void print_stats(const char* label, const DlStats* s) {
+    printf("%-9s | %8llu | %8llu %8.1f | %7llu %6llu | %6llu %8.1f | %5llu %5llu %5llu %5llu | %6llu | %6llu %5d\n",
+           label, (unsigned long long)s->commands, (unsigned long long)s->rdp_commands, s->rdp_bytes / 1024.0,
+           (unsigned long long)s->triangles, (unsigned long long)s->rectangles,
+           (unsigned long long)s->texture_loads, s->texture_bytes / 1024.0, (unsigned long long)s->pipe_syncs,
+           (unsigned long long)s->load_syncs, (unsigned long long)s->tile_syncs, (unsigned long long)s->full_syncs,
+           (unsigned long long)s->state_commands, (unsigned long long)s->calls, s->max_depth);
+}
+
+static int list_frame(FILE* f, const DlFrame* frame, size_t index, DlGbi gbi, const char** error) {
+    DlWalker walker;
+    DlCommand cmd;
+    int r;
+
+    fprintf(f, "frame %zu, list at %08X\n", index, frame->root);
+    dl_walk_init(&walker, frame, gbi, frame->root);
+    while ((r = dl_walk_next(&walker, &cmd)) > 0) {
+        fprintf(f, "%08X %*s%-20s %08X %08X\n", cmd.paddr, cmd.depth * 2, "", dl_name(gbi, cmd.opcode), cmd.w0,
+                cmd.w1);
+    }
+    if (r < 0) {
+        *error = walker.error;
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    const char* in_path = NULL;
+    const char* out_path = NULL;
+    const char* list_path = NULL;
+    const char* error = NULL;
+    DlGbi gbi = DL_GBI1;
+    int opcodes = 0;
+    DlStats stats, total, trimmed_total;
+    DlOptStats opt, opt_total;
+    DlCapture cap;
+    uint8_t* data;
+    FILE* list = NULL;
+    FILE* out;
+    char label[32];
+    size_t size, i, untrimmed = 0;
+    int a, r;
+
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--gbi2")) {
+            gbi = DL_GBI2;
+        } else if (!strcmp(argv[a], "--opcodes")) {
+            opcodes = 1;
+        } else if (!strcmp(argv[a], "--list") && a + 1 < argc) {
+            list_path = argv[++a];
+        } else if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out_path = argv[++a];
+        } else if (argv[a][0] != '-' && in_path == NULL) {
+            in_path = argv[a];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (in_path == NULL) {
+        usage();
+        return 1;
+    }
+
+    data = read_file(in_path, &size);
+    if (data == NULL) {
+        fprintf(stderr, "dlscan: can't read %s\n", in_path);
+        return 1;
+    }
+    if (dl_read_capture(&cap, data, size, &error) < 0) {
+        fprintf(stderr, "dlscan: %s: %s\n", in_path, error);
+        free(data);
+        return 1;
+    }
+    free(data);
+
+    if (list_path != NULL && (list = fopen(list_path, "w")) == NULL) {
+        fprintf(stderr, "dlscan: can't write %s\n", list_path);
+        dl_free_capture(&cap);
+        return 1;
+    }
+
+    memset(&total, 0, sizeof(total));
+    memset(&trimmed_total, 0, sizeof(trimmed_total));
+    memset(&opt_total, 0, sizeof(opt_total));
+    printf("%s: %zu frames, %s\n\n", in_path, cap.count, gbi == DL_GBI2 ? "F3DEX2" : "F3D/F3DEX");
+    print_header();
+
+    for (i = 0; i < cap.count; i++) {
+        if (list != NULL && list_frame(list, &cap.frames[i], i, gbi, &error) < 0) {
+            goto frame_error;
+        }
+        if (dl_stats(&cap.frames[i], gbi, &stats, &error) < 0) {
+            goto frame_error;
+        }
+        dl_add_stats(&total, &stats);
+        snprintf(label, sizeof(label), "%zu", i);
+        print_stats(label, &stats);
+
+        if (out_path != NULL) {
+            r = dl_optimize(&cap.frames[i], gbi, &opt, &error);
+            if (r < 0) {
+                goto frame_error;
+            }
+            if (r > 0) {
+                dl_add_stats(&trimmed_total, &stats);
+                printf("  left as it was: %s\n", error);
+                untrimmed++;
+                continue;
+            }
+            if (dl_stats(&cap.frames[i], gbi, &stats, &error) < 0) {
+                goto frame_error;
+            }
+            dl_add_stats(&trimmed_total, &stats);
+            opt_total.state += opt.state;
+            opt_total.syncs += opt.syncs;
+            opt_total.loads += opt.loads;
+            opt_total.pinned += opt.pinned;
+            print_stats("  trimmed", &stats);
+        }
+    }
+
+    printf("\n");
+    print_header();
+    print_stats("total", &total);
+    if (out_path != NULL) {
+        print_stats("  trimmed", &trimmed_total);
+        printf("\n%u state commands and %u syncs made no-ops, %u LOADBLOCKs folded into the one before, %u commands "
+               "after a G_BRANCH_Z left alone, %zu frames not trimmed; RDP commands %.1f%% fewer\n",
+               opt_total.state, opt_total.syncs, opt_total.loads, opt_total.pinned, untrimmed,
+               total.rdp_commands ? 100.0 * (total.rdp_commands - trimmed_total.rdp_commands) / total.rdp_commands
+                                  : 0.0);
+    }
+
+    if (opcodes) {
+        printf("\n%-20s %10s %8s\n", "command", "walked", "share");
+        for (a = 0; a < 256; a++) {
+            if (total.by_opcode[a] != 0) {
+                printf("%-20s %10llu %7.2f%%", dl_name(gbi, a), (unsigned long long)total.by_opcode[a],
+                       100.0 * total.by_opcode[a] / total.commands);
+                if (out_path != NULL) {
+                    printf(" %10llu trimmed", (unsigned long long)trimmed_total.by_opcode[a]);
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    if (list != NULL) {
+        fclose(list);
+    }
+    if (out_path != NULL) {
+        out = fopen(out_path, "wb");
+        if (out == NULL || dl_write_capture(&cap, out) < 0) {
+            fprintf(stderr, "dlscan: can't write %s\n", out_path);
+            if (out != NULL) {
+                fclose(out);
+            }
+            dl_free_capture(&cap);
+            return 1;
+        }
+        fclose(out);
+    }
+    dl_free_capture(&cap);
+    return 0;
+
+frame_error:
+    fprintf(stderr, "dlscan: %s, frame %zu: %s\n", in_path, i, error);
+    if (list != NULL) {
+        fclose(list);
+    }
+    dl_free_capture(&cap);
+    return 1;
+}
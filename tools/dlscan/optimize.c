@@ -0,0 +1,562 @@
+/*
+ * Trimming a frame's lists.
+ *
+ * The frame is walked once, keeping what is known of the state the RDP and
+ * the microcode hold (othermode bit by bit, the combiner, colors, images,
+ * scissor and the rest of the RDP's registers, each tile's descriptor and
+ * size, the geometry mode bit by bit, G_TEXTURE), all of it unknown to
+ * begin with. Each time a command is walked it is noted whether it changed
+ * any of that; one that never did, however often the frame came to it,
+ * becomes a G_SPNOOP. Images are compared as the addresses the microcode
+ * makes of them, so a segment moving in between counts.
+ *
+ * A PIPESYNC, LOADSYNC or TILESYNC goes the same way when nothing has been
+ * drawn or loaded since the last one of its kind; the RDP has nothing left
+ * for it to wait on. Loads are counted as drawing, as they go down the
+ * same pipe; a FULLSYNC is kept and counts as each of the others.
+ *
+ * Two LOADBLOCKs are folded into one when the second loads the texels
+ * right after the first's, in RDRAM and in TMEM: 8- or 16-bit texels from
+ * s = 0, the same line stride, and the first load ending on an even line,
+ * so the RDP's odd-line swap falls on the same words. Only syncs, SETTILE,
+ * SETTIMG and no-ops may come between them; the SETTIMG and SETTILE for
+ * the second stay, so the state afterwards is the same bar the load tile's
+ * size, which now covers both.
+ *
+ * G_CULLDL and G_BRANCH_Z are walked as not culling and not taken, as the
+ * walker does. Whatever was known is forgotten where a list holding one
+ * returns, as the other way would come back there too, and every command
+ * a taken G_BRANCH_Z could reach is left alone.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "dlscan.h"
+
+#define TILES           8
+#define MERGE_REACH     8       /* commands looked at past a LOADBLOCK */
+#define MAX_BRANCHES    64      /* taken G_BRANCH_Zs followed at once */
+#define TMEM_BYTES      4096
+#define MAX_TEXELS      2048    /* a LOADBLOCK's lrs is 11 bits */
+
+typedef struct {
+    uint32_t paddr;
+    uint32_t runs;              /* times the walk came to it */
+    uint32_t redundant;         /* times it changed nothing */
+    uint8_t opcode;
+    uint8_t used;
+    uint8_t pinned;
+    uint8_t folded;             /* taken out by a merge */
+    int32_t merge;              /* into merges, the LOADBLOCK it starts; -1 none, -2 not every time */
+} Site;
+
+typedef struct {
+    Site* sites;
+    uint32_t mask;
+    uint32_t count;
+} Sites;
+
+typedef struct {
+    uint32_t load;              /* the first LOADBLOCK */
+    uint32_t w1;                /* it, loading both */
+    uint32_t between[MERGE_REACH + 1]; /* the commands after it, the second LOADBLOCK last */
+    int count;
+} Merge;
+
+typedef struct {
+    uint32_t known_h, h;        /* othermode's high word, bit by bit */
+    uint32_t known_l, l;
+    uint8_t known[256];         /* the RDP's registers set whole, by opcode */
+    uint32_t w0[256];
+    uint32_t w1[256];
+    uint8_t tile_known[TILES];
+    uint32_t tile_w0[TILES], tile_w1[TILES];
+    uint8_t size_known[TILES];
+    uint32_t size_w0[TILES], size_w1[TILES];
+    uint32_t known_geometry, geometry;
+    uint8_t texture_known;
+    uint32_t texture_w0, texture_w1;
+    uint8_t drawn_pipe;         /* drawn or loaded since the last sync of each kind */
+    uint8_t drawn_load;
+    uint8_t drawn_tile;
+    uint8_t uncertain[DL_MAX_DEPTH + 1]; /* the list at that depth had a CULLDL or BRANCH_Z */
+} State;
+
+static uint32_t hash(uint32_t paddr) {
+    return (paddr >> 3) * 0x9E3779B1u;
+}
+
+static Site* site(Sites* t, uint32_t paddr) {
+    Site* old;
+    uint32_t i, n;
+
+    if ((t->count + 1) * 2 > t->mask + 1) {
+        old = t->sites;
+        n = t->mask + 1;
+        t->mask = n * 2 - 1;
+        t->sites = calloc(n * 2, sizeof(Site));
+        t->count = 0;
+        for (i = 0; i < n; i++) {
+            if (old[i].used) {
+                *site(t, old[i].paddr) = old[i];
+            }
+        }
+        free(old);
+    }
+
+    for (i = hash(paddr) & t->mask;; i = (i + 1) & t->mask) {
+        if (!t->sites[i].used) {
+            t->sites[i].used = 1;
+            t->sites[i].paddr = paddr;
+            t->sites[i].merge = -1;
+            t->count++;
+            return &t->sites[i];
+        }
+        if (t->sites[i].paddr == paddr) {
+            return &t->sites[i];
+        }
+    }
+}
+
+static void forget(State* s) {
+    s->known_h = s->known_l = 0;
+    memset(s->known, 0, sizeof(s->known));
+    memset(s->tile_known, 0, sizeof(s->tile_known));
+    memset(s->size_known, 0, sizeof(s->size_known));
+    s->known_geometry = 0;
+    s->texture_known = 0;
+    s->drawn_pipe = s->drawn_load = s->drawn_tile = 1;
+}
+
+static void drawn(State* s) {
+    s->drawn_pipe = s->drawn_load = s->drawn_tile = 1;
+}
+
+/* Sets the bits in mask to value; returns whether they were all known to be that */
+static int set_bits(uint32_t* known, uint32_t* bits, uint32_t mask, uint32_t value) {
+    int same = (*known & mask) == mask && (*bits & mask) == (value & mask);
+
+    *bits = (*bits & ~mask) | (value & mask);
+    *known |= mask;
+    return same;
+}
+
+static int set_words(uint8_t* known, uint32_t* w0, uint32_t* w1, uint32_t v0, uint32_t v1) {
+    int same = *known && *w0 == v0 && *w1 == v1;
+
+    *known = 1;
+    *w0 = v0;
+    *w1 = v1;
+    return same;
+}
+
+static uint32_t field_mask(uint32_t shift, uint32_t length) {
+    if (length >= 32) {
+        return 0xFFFFFFFF;
+    }
+    return ((1u << length) - 1) << shift;
+}
+
+/* Whether the command set anything that wasn't already so; updates s either way */
+static int changes(State* s, const DlWalker* walker, const DlCommand* cmd) {
+    uint32_t shift, length, mask, t;
+
+    switch (cmd->kind) {
+        case DL_CMD_SETOTHERMODE_H:
+        case DL_CMD_SETOTHERMODE_L:
+            if (walker->gbi == DL_GBI2) {
+                length = (cmd->w0 & 0xFF) + 1;
+                shift = 32 - ((cmd->w0 >> 8) & 0xFF) - length;
+            } else {
+                shift = (cmd->w0 >> 8) & 0xFF;
+                length = cmd->w0 & 0xFF;
+            }
+            mask = field_mask(shift, length);
+            if (cmd->kind == DL_CMD_SETOTHERMODE_H) {
+                return !set_bits(&s->known_h, &s->h, mask & 0x00FFFFFF, cmd->w1);
+            }
+            return !set_bits(&s->known_l, &s->l, mask, cmd->w1);
+
+        case DL_CMD_GEOMETRYMODE:
+            /* Clears the low bits w0 doesn't have, then sets w1's */
+            mask = (~cmd->w0 & 0x00FFFFFF) | cmd->w1;
+            return !set_bits(&s->known_geometry, &s->geometry, mask, cmd->w1);
+        case DL_CMD_SETGEOMETRYMODE:
+            return !set_bits(&s->known_geometry, &s->geometry, cmd->w1, 0xFFFFFFFF);
+        case DL_CMD_CLEARGEOMETRYMODE:
+            return !set_bits(&s->known_geometry, &s->geometry, cmd->w1, 0);
+        case DL_CMD_TEXTURE:
+            return !set_words(&s->texture_known, &s->texture_w0, &s->texture_w1, cmd->w0, cmd->w1);
+
+        case DL_CMD_RDP:
+            break;
+        default:
+            return 1;
+    }
+
+    switch (cmd->opcode) {
+        case DL_RDP_SETOTHERMODE:
+            /* Both words, the high one under the opcode */
+            return !(set_bits(&s->known_h, &s->h, 0x00FFFFFF, cmd->w0) &
+                     set_bits(&s->known_l, &s->l, 0xFFFFFFFF, cmd->w1));
+        case DL_RDP_SETTILE:
+            t = (cmd->w1 >> 24) & 7;
+            return !set_words(&s->tile_known[t], &s->tile_w0[t], &s->tile_w1[t], cmd->w0, cmd->w1);
+        case DL_RDP_SETTILESIZE:
+            t = (cmd->w1 >> 24) & 7;
+            return !set_words(&s->size_known[t], &s->size_w0[t], &s->size_w1[t], cmd->w0, cmd->w1);
+        case DL_RDP_SETTIMG:
+        case DL_RDP_SETZIMG:
+        case DL_RDP_SETCIMG:
+            return !set_words(&s->known[cmd->opcode], &s->w0[cmd->opcode], &s->w1[cmd->opcode], cmd->w0,
+                              dl_address(walker, cmd->w1));
+        case DL_RDP_SETCOMBINE:
+        case DL_RDP_SETENVCOLOR:
+        case DL_RDP_SETPRIMCOLOR:
+        case DL_RDP_SETBLENDCOLOR:
+        case DL_RDP_SETFOGCOLOR:
+        case DL_RDP_SETFILLCOLOR:
+        case DL_RDP_SETSCISSOR:
+        case DL_RDP_SETPRIMDEPTH:
+        case DL_RDP_SETCONVERT:
+        case DL_RDP_SETKEYR:
+        case DL_RDP_SETKEYGB:
+            return !set_words(&s->known[cmd->opcode], &s->w0[cmd->opcode], &s->w1[cmd->opcode], cmd->w0,
+                              cmd->w1);
+        default:
+            return 1;
+    }
+}
+
+/*
+ * If the LOADBLOCK at cmd and the one a few commands on can be one, the
+ * merge that does it; it has to be the same each time the frame gets there.
+ */
+static int find_merge(const State* s, const DlWalker* walker, const DlCommand* cmd, Merge* m) {
+    uint32_t tile = (cmd->w1 >> 24) & 7;
+    uint32_t img_w0, img_addr = 0, tile_w0 = 0, tile_w1 = 0, siz, texels, texels2, bytes, words, dxt;
+    uint32_t w0, w1, paddr;
+    const uint8_t* p;
+    int have_img = 0, have_tile = 0;
+
+    if (!s->known[DL_RDP_SETTIMG] || !s->tile_known[tile] || (cmd->w0 & 0x00FFFFFF) != 0) {
+        return 0;
+    }
+    img_w0 = s->w0[DL_RDP_SETTIMG];
+    siz = (img_w0 >> 19) & 3;
+    if ((siz != 1 && siz != 2) || ((s->tile_w0[tile] >> 19) & 3) != siz) {
+        return 0;
+    }
+    texels = ((cmd->w1 >> 12) & 0xFFF) + 1;
+    dxt = cmd->w1 & 0xFFF;
+    bytes = texels << (siz - 1);
+    words = bytes / 8;
+    if (bytes % 8 != 0 || (words * dxt) % 4096 != 0) {
+        return 0;
+    }
+
+    m->load = cmd->paddr;
+    m->count = 0;
+    for (paddr = cmd->paddr + 8; m->count <= MERGE_REACH; paddr += 8) {
+        p = dl_find(walker->frame, paddr);
+        if (p == NULL || dl_kind(walker->gbi, p[0]) != DL_CMD_RDP) {
+            return 0;
+        }
+        w0 = dl_word(p);
+        w1 = dl_word(p + 4);
+        m->between[m->count++] = paddr;
+        switch (w0 >> 24) {
+            case DL_RDP_NOOP:
+            case DL_RDP_PIPESYNC:
+            case DL_RDP_LOADSYNC:
+            case DL_RDP_TILESYNC:
+                continue;
+            case DL_RDP_SETTIMG:
+                have_img = 1;
+                img_addr = dl_address(walker, w1);
+                if (w0 != img_w0) {
+                    return 0;
+                }
+                continue;
+            case DL_RDP_SETTILE:
+                if (((w1 >> 24) & 7) == tile) {
+                    have_tile = 1;
+                    tile_w0 = w0;
+                    tile_w1 = w1;
+                }
+                continue;
+            case DL_RDP_LOADBLOCK:
+                break;
+            default:
+                return 0;
+        }
+
+        /* The second load: the next texels, to the next words of TMEM */
+        texels2 = ((w1 >> 12) & 0xFFF) + 1;
+        if (!have_img || !have_tile || ((w1 >> 24) & 7) != tile || (w0 & 0x00FFFFFF) != 0 ||
+            (w1 & 0xFFF) != dxt || img_addr != s->w1[DL_RDP_SETTIMG] + bytes ||
+            tile_w1 != s->tile_w1[tile] || (tile_w0 & ~0x1FFu) != (s->tile_w0[tile] & ~0x1FFu) ||
+            (tile_w0 & 0x1FF) != (s->tile_w0[tile] & 0x1FF) + words || texels + texels2 > MAX_TEXELS ||
+            (s->tile_w0[tile] & 0x1FF) * 8 + bytes + (texels2 << (siz - 1)) > TMEM_BYTES) {
+            return 0;
+        }
+        m->w1 = (cmd->w1 & ~(0xFFFu << 12)) | ((texels + texels2 - 1) << 12);
+        return 1;
+    }
+    return 0;
+}
+
+static int same_merge(const Merge* a, const Merge* b) {
+    return a->load == b->load && a->w1 == b->w1 && a->count == b->count &&
+           !memcmp(a->between, b->between, a->count * sizeof(a->between[0]));
+}
+
+/*
+ * Marks each command a taken G_BRANCH_Z could come to, down to where the
+ * list holding it returns, following the G_BRANCH_Zs on the way both ways.
+ * Returns 1 if one of those ways goes somewhere the capture doesn't have.
+ */
+static int pin_branch(Sites* sites, const DlWalker* from, const char** error) {
+    DlWalker* work = malloc(MAX_BRANCHES * sizeof(DlWalker));
+    DlWalker* w;
+    DlCommand cmd;
+    uint32_t walked = 0;
+    int n = 1, depth = from->depth, r = 0;
+
+    work[0] = *from;
+    dl_walk_branch(&work[0]);
+    while (n > 0 && r >= 0) {
+        w = &work[--n];
+        while (w->depth >= depth) {
+            if (dl_find(w->frame, w->stack[w->depth]) == NULL) {
+                free(work);
+                return 1;
+            }
+            if ((r = dl_walk_next(w, &cmd)) <= 0) {
+                break;
+            }
+            site(sites, cmd.paddr)->pinned = 1;
+            if (++walked == DL_MAX_COMMANDS) {
+                w->error = "too many ways through the G_BRANCH_Zs to follow";
+                r = -1;
+                break;
+            }
+            if (cmd.kind == DL_CMD_BRANCH_Z) {
+                if (n + 2 > MAX_BRANCHES) {
+                    w->error = "G_BRANCH_Zs too deep inside each other to follow";
+                    r = -1;
+                    break;
+                }
+                work[n + 1] = *w;
+                work[n] = *w;
+                dl_walk_branch(&work[n]);
+                n += 2;
+                break;
+            }
+        }
+    }
+    if (r < 0) {
+        *error = w->error;
+    }
+    free(work);
+    return r < 0 ? -1 : 0;
+}
+
+int dl_optimize(DlFrame* frame, DlGbi gbi, DlOptStats* stats, const char** error) {
+    Merge* merges = NULL;
+    Sites sites;
+    DlWalker walker;
+    DlCommand cmd;
+    State state;
+    Merge m;
+    Site* at;
+    Site* other;
+    size_t merge_count = 0, merge_cap = 0;
+    uint32_t i;
+    int j, redundant, pinning, r;
+
+    memset(stats, 0, sizeof(*stats));
+    sites.mask = 1023;
+    sites.count = 0;
+    sites.sites = calloc(sites.mask + 1, sizeof(Site));
+    memset(&state, 0, sizeof(state));
+    forget(&state);
+    dl_walk_init(&walker, frame, gbi, frame->root);
+
+    while ((r = dl_walk_next(&walker, &cmd)) > 0) {
+        at = site(&sites, cmd.paddr);
+        at->opcode = cmd.opcode;
+        at->runs++;
+        redundant = 0;
+
+        switch (cmd.kind) {
+            case DL_CMD_DL:
+                if (((cmd.w0 >> 16) & 0xFF) == 0) {
+                    state.uncertain[walker.depth] = 0;
+                }
+                break;
+            case DL_CMD_ENDDL:
+                if (state.uncertain[cmd.depth]) {
+                    state.uncertain[cmd.depth] = 0;
+                    forget(&state);
+                }
+                break;
+            case DL_CMD_CULLDL:
+                state.uncertain[cmd.depth] = 1;
+                break;
+            case DL_CMD_BRANCH_Z:
+                state.uncertain[cmd.depth] = 1;
+                pinning = pin_branch(&sites, &walker, error);
+                if (pinning != 0) {
+                    r = pinning < 0 ? -2 : -3;
+                }
+                break;
+            case DL_CMD_TRI1:
+            case DL_CMD_TRI2:
+            case DL_CMD_QUAD:
+            case DL_CMD_LINE3D:
+                drawn(&state);
+                break;
+            case DL_CMD_SETOTHERMODE_H:
+            case DL_CMD_SETOTHERMODE_L:
+            case DL_CMD_GEOMETRYMODE:
+            case DL_CMD_SETGEOMETRYMODE:
+            case DL_CMD_CLEARGEOMETRYMODE:
+            case DL_CMD_TEXTURE:
+                redundant = !changes(&state, &walker, &cmd);
+                break;
+            case DL_CMD_RDP:
+                switch (cmd.opcode) {
+                    case DL_RDP_PIPESYNC:
+                        redundant = !state.drawn_pipe;
+                        state.drawn_pipe = 0;
+                        break;
+                    case DL_RDP_LOADSYNC:
+                        redundant = !state.drawn_load;
+                        state.drawn_load = 0;
+                        break;
+                    case DL_RDP_TILESYNC:
+                        redundant = !state.drawn_tile;
+                        state.drawn_tile = 0;
+                        break;
+                    case DL_RDP_FULLSYNC:
+                        state.drawn_pipe = state.drawn_load = state.drawn_tile = 0;
+                        break;
+                    case DL_RDP_LOADBLOCK:
+                        if (at->merge != -2) {
+                            if (!find_merge(&state, &walker, &cmd, &m)) {
+                                at->merge = -2;
+                            } else if (at->merge == -1) {
+                                if (merge_count == merge_cap) {
+                                    merge_cap = merge_cap ? merge_cap * 2 : 64;
+                                    merges = realloc(merges, merge_cap * sizeof(Merge));
+                                }
+                                merges[merge_count] = m;
+                                at->merge = merge_count++;
+                            } else if (!same_merge(&merges[at->merge], &m)) {
+                                at->merge = -2;
+                            }
+                        }
+                        /* fallthrough */
+                    case DL_RDP_LOADTILE:
+                    case DL_RDP_LOADTLUT:
+                        /* A load sets its tile's size */
+                        state.size_known[(cmd.w1 >> 24) & 7] = 0;
+                        drawn(&state);
+                        break;
+                    case DL_RDP_TEXRECT:
+                    case DL_RDP_TEXRECTFLIP:
+                    case DL_RDP_FILLRECT:
+                        drawn(&state);
+                        break;
+                    default:
+                        if (cmd.opcode >= DL_RDP_TRI_FILL && cmd.opcode < DL_RDP_TRI_FILL + 8) {
+                            drawn(&state);
+                        } else {
+                            redundant = !changes(&state, &walker, &cmd);
+                        }
+                        break;
+                }
+                break;
+            case DL_CMD_UNKNOWN:
+            case DL_CMD_RSP_OTHER:
+            case DL_CMD_LOAD_UCODE:
+                /* Could be anything, or another microcode's */
+                forget(&state);
+                break;
+            default:
+                break;
+        }
+
+        if (redundant) {
+            at->redundant++;
+        }
+        if (r < 0) {
+            break;
+        }
+    }
+
+    if (r < 0) {
+        if (r == -1) {
+            *error = walker.error;
+        } else if (r == -3) {
+            /* guParseGbiDL doesn't follow them */
+            *error = "a G_BRANCH_Z goes to a list the capture doesn't have";
+        }
+        free(sites.sites);
+        free(merges);
+        return r == -3 ? 1 : -1;
+    }
+
+    /* Merges first, with what they take out kept from counting twice */
+    for (i = 0; i < merge_count; i++) {
+        at = site(&sites, merges[i].load);
+        if (at->merge != (int32_t)i || at->pinned || at->folded) {
+            continue;
+        }
+        for (j = 0; j < merges[i].count; j++) {
+            other = site(&sites, merges[i].between[j]);
+            if (other->runs != at->runs || other->pinned || other->folded) {
+                break;
+            }
+        }
+        if (j < merges[i].count) {
+            continue;
+        }
+        dl_patch(frame, merges[i].load, dl_word(dl_find(frame, merges[i].load)), merges[i].w1);
+        for (j = 0; j < merges[i].count; j++) {
+            other = site(&sites, merges[i].between[j]);
+            if (other->opcode == DL_RDP_LOADBLOCK || other->opcode == DL_RDP_LOADSYNC) {
+                other->folded = 1;
+                dl_patch(frame, merges[i].between[j], 0, 0);
+            }
+        }
+        /* The first can't go into another now, nor be taken out */
+        at->folded = 1;
+        stats->loads++;
+    }
+
+    for (i = 0; i <= sites.mask; i++) {
+        at = &sites.sites[i];
+        if (!at->used) {
+            continue;
+        }
+        if (at->pinned) {
+            stats->pinned++;
+            continue;
+        }
+        if (at->folded || at->runs == 0 || at->redundant != at->runs) {
+            continue;
+        }
+        dl_patch(frame, at->paddr, 0, 0);
+        if (at->opcode == DL_RDP_PIPESYNC || at->opcode == DL_RDP_LOADSYNC || at->opcode == DL_RDP_TILESYNC) {
+            stats->syncs++;
+        } else {
+            stats->state++;
+        }
+    }
+
+    free(sites.sites);
+    free(merges);
+    return 0;
+}
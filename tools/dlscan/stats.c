@@ -0,0 +1,199 @@
+/*
+ * What a frame's lists ask of the RSP and the RDP.
+ *
+ * RDP bytes are what the microcode would put in the RDP's FIFO: 8 for each
+ * of the RDP's own commands and for the RDPSETOTHERMODE a SETOTHERMODE_H
+ * or _L turns into, 16 for a texture rectangle, and for a triangle 32 with
+ * 64 more for shade, 64 for texture and 16 for z, as the geometry mode and
+ * G_TEXTURE have it. A LINE3D is counted as the two triangles it is drawn
+ * with. Texture bytes are what the loads read from RDRAM, in the SETTIMG
+ * size that was last set; a LOADTLUT's entries are 16 bits.
+ */
+#include <string.h>
+
+#include "dlscan.h"
+
+#define GEOM_ZBUFFER 0x00000001 /* G_ZBUFFER */
+#define GEOM_SHADE   0x00000004 /* G_SHADE */
+
+/* The texture size in the RDP's fields, times two for the 4-bit one */
+static uint64_t texel_bytes_x2(uint32_t siz) {
+    return siz == 0 ? 1 : 2u << (siz - 1);
+}
+
+static uint32_t triangle_bytes(uint8_t rdp_opcode) {
+    return 32 + (rdp_opcode & 0x04 ? 64 : 0) + (rdp_opcode & 0x02 ? 64 : 0) + (rdp_opcode & 0x01 ? 16 : 0);
+}
+
+int dl_stats(const DlFrame* frame, DlGbi gbi, DlStats* stats, const char** error) {
+    uint32_t geometry = 0, siz = 2, uls, ult, lrs, lrt, n;
+    uint8_t triangle = DL_RDP_TRI_FILL;
+    int texture = 0;
+    DlWalker walker;
+    DlCommand cmd;
+    int r;
+
+    memset(stats, 0, sizeof(*stats));
+    dl_walk_init(&walker, frame, gbi, frame->root);
+
+    while ((r = dl_walk_next(&walker, &cmd)) > 0) {
+        stats->commands++;
+        stats->by_opcode[cmd.opcode]++;
+        if (cmd.depth > stats->max_depth) {
+            stats->max_depth = cmd.depth;
+        }
+
+        switch (cmd.kind) {
+            case DL_CMD_NOOP:
+                stats->noops++;
+                break;
+            case DL_CMD_VTX:
+                /* F3D's length is 16n, F3DEX's 16n - 1 */
+                stats->vertices += gbi == DL_GBI2 ? (cmd.w0 >> 12) & 0xFF : ((cmd.w0 & 0x3FF) + 1) / 16;
+                break;
+            case DL_CMD_MTX:
+                stats->matrices++;
+                break;
+            case DL_CMD_DL:
+                stats->calls++;
+                break;
+            case DL_CMD_ENDDL:
+                stats->returns++;
+                break;
+            case DL_CMD_CULLDL:
+                stats->culls++;
+                break;
+            case DL_CMD_BRANCH_Z:
+                stats->branches_z++;
+                break;
+            case DL_CMD_TRI1:
+            case DL_CMD_TRI2:
+            case DL_CMD_QUAD:
+            case DL_CMD_LINE3D:
+                n = cmd.kind == DL_CMD_TRI1 ? 1 : 2;
+                triangle = DL_RDP_TRI_FILL | (geometry & GEOM_SHADE ? 0x04 : 0) | (texture ? 0x02 : 0) |
+                           (geometry & GEOM_ZBUFFER ? 0x01 : 0);
+                stats->triangles += n;
+                stats->rdp_commands += n;
+                stats->rdp_bytes += n * triangle_bytes(triangle);
+                break;
+            case DL_CMD_TEXTURE:
+                texture = gbi == DL_GBI2 ? (cmd.w0 >> 1) & 0x7F : cmd.w0 & 0xFF;
+                stats->state_commands++;
+                break;
+            case DL_CMD_GEOMETRYMODE:
+                geometry = (geometry & (cmd.w0 | 0xFF000000)) | cmd.w1;
+                stats->state_commands++;
+                break;
+            case DL_CMD_SETGEOMETRYMODE:
+                geometry |= cmd.w1;
+                stats->state_commands++;
+                break;
+            case DL_CMD_CLEARGEOMETRYMODE:
+                geometry &= ~cmd.w1;
+                stats->state_commands++;
+                break;
+            case DL_CMD_SETOTHERMODE_H:
+            case DL_CMD_SETOTHERMODE_L:
+                stats->state_commands++;
+                stats->rdp_commands++;
+                stats->rdp_bytes += 8;
+                break;
+            case DL_CMD_RDP:
+                stats->rdp_commands++;
+                stats->rdp_bytes += 8;
+                switch (cmd.opcode) {
+                    case DL_RDP_TEXRECT:
+                    case DL_RDP_TEXRECTFLIP:
+                        stats->rdp_bytes += 8;
+                        stats->rectangles++;
+                        break;
+                    case DL_RDP_FILLRECT:
+                        stats->rectangles++;
+                        break;
+                    case DL_RDP_PIPESYNC:
+                        stats->pipe_syncs++;
+                        break;
+                    case DL_RDP_LOADSYNC:
+                        stats->load_syncs++;
+                        break;
+                    case DL_RDP_TILESYNC:
+                        stats->tile_syncs++;
+                        break;
+                    case DL_RDP_FULLSYNC:
+                        stats->full_syncs++;
+                        break;
+                    case DL_RDP_SETTIMG:
+                        siz = (cmd.w0 >> 19) & 3;
+                        stats->state_commands++;
+                        break;
+                    case DL_RDP_LOADBLOCK:
+                        uls = (cmd.w0 >> 12) & 0xFFF;
+                        lrs = (cmd.w1 >> 12) & 0xFFF;
+                        stats->texture_loads++;
+                        stats->texture_bytes += lrs >= uls ? (lrs - uls + 1) * texel_bytes_x2(siz) / 2 : 0;
+                        break;
+                    case DL_RDP_LOADTILE:
+                    case DL_RDP_LOADTLUT:
+                        /* 10.2 corners */
+                        uls = (cmd.w0 >> 14) & 0x3FF;
+                        ult = (cmd.w0 >> 2) & 0x3FF;
+                        lrs = (cmd.w1 >> 14) & 0x3FF;
+                        lrt = (cmd.w1 >> 2) & 0x3FF;
+                        stats->texture_loads++;
+                        if (lrs >= uls && lrt >= ult) {
+                            stats->texture_bytes += (uint64_t)(lrs - uls + 1) * (lrt - ult + 1) *
+                                                    (cmd.opcode == DL_RDP_LOADTLUT ? 4 : texel_bytes_x2(siz)) / 2;
+                        }
+                        break;
+                    default:
+                        if (cmd.opcode >= DL_RDP_TRI_FILL && cmd.opcode < DL_RDP_TRI_FILL + 8) {
+                            stats->triangles++;
+                            stats->rdp_bytes += triangle_bytes(cmd.opcode) - 8;
+                        } else if (cmd.opcode >= DL_RDP_SETKEYGB) {
+                            stats->state_commands++;
+                        }
+                        break;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (r < 0) {
+        *error = walker.error;
+        return -1;
+    }
+    return 0;
+}
+
+void dl_add_stats(DlStats* total, const DlStats* stats) {
+    int i;
+
+    total->commands += stats->commands;
+    total->rdp_commands += stats->rdp_commands;
+    total->rdp_bytes += stats->rdp_bytes;
+    total->noops += stats->noops;
+    total->calls += stats->calls;
+    total->returns += stats->returns;
+    if (stats->max_depth > total->max_depth) {
+        total->max_depth = stats->max_depth;
+    }
+    total->vertices += stats->vertices;
+    total->matrices += stats->matrices;
+    total->triangles += stats->triangles;
+    total->rectangles += stats->rectangles;
+    total->texture_loads += stats->texture_loads;
+    total->texture_bytes += stats->texture_bytes;
+    total->pipe_syncs += stats->pipe_syncs;
+    total->load_syncs += stats->load_syncs;
+    total->tile_syncs += stats->tile_syncs;
+    total->full_syncs += stats->full_syncs;
+    total->state_commands += stats->state_commands;
+    total->branches_z += stats->branches_z;
+    total->culls += stats->culls;
+    for (i = 0; i < 256; i++) {
+        total->by_opcode[i] += stats->by_opcode[i];
+    }
+}
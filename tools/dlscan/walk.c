@@ -0,0 +1,215 @@
+/*
+ * Decoding and walking: the two GBIs' opcodes, and the RSP's way through a
+ * frame's lists.
+ *
+ * The walk is guParseGbiDL's: a stack of DL_MAX_DEPTH + 1 list pointers, a
+ * G_DL with G_DL_PUSH calling and one with G_DL_NOPUSH replacing the list
+ * on top, G_ENDDL popping, and the segment table filled in by
+ * G_MW_SEGMENT as it goes. Unlike guParseGbiDL it also takes the F3DEX2
+ * opcodes and stops on lists nested too deep rather than printing.
+ */
+#include <string.h>
+
+#include "dlscan.h"
+
+#define DL_PUSH       0         /* G_DL_PUSH; G_DL_NOPUSH is 1 */
+#define MW_SEGMENT    6         /* G_MW_SEGMENT */
+
+static const char* rdp_names[64] = {
+    "NOOP", NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    "TRI_FILL", "TRI_FILL_ZBUFF", "TRI_TXTR", "TRI_TXTR_ZBUFF",
+    "TRI_SHADE", "TRI_SHADE_ZBUFF", "TRI_SHADE_TXTR", "TRI_SHADE_TXTR_ZBUFF",
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    NULL, NULL, NULL, NULL, "TEXRECT", "TEXRECTFLIP", "RDPLOADSYNC", "RDPPIPESYNC",
+    "RDPTILESYNC", "RDPFULLSYNC", "SETKEYGB", "SETKEYR", "SETCONVERT", "SETSCISSOR", "SETPRIMDEPTH",
+    "RDPSETOTHERMODE",
+    "LOADTLUT", NULL, "SETTILESIZE", "LOADBLOCK", "LOADTILE", "SETTILE", "FILLRECT", "SETFILLCOLOR",
+    "SETFOGCOLOR", "SETBLENDCOLOR", "SETPRIMCOLOR", "SETENVCOLOR", "SETCOMBINE", "SETTIMG", "SETZIMG", "SETCIMG",
+};
+
+/* F3D and F3DEX: DMA commands from 0, immediates down from 0xBF */
+static const struct {
+    uint8_t opcode;
+    DlKind kind;
+    const char* name;
+} gbi1_ops[] = {
+    { 0x00, DL_CMD_NOOP, "SPNOOP" },
+    { 0x01, DL_CMD_MTX, "MTX" },
+    { 0x02, DL_CMD_RSP_OTHER, "RESERVED0" },
+    { 0x03, DL_CMD_MOVEMEM, "MOVEMEM" },
+    { 0x04, DL_CMD_VTX, "VTX" },
+    { 0x05, DL_CMD_RSP_OTHER, "RESERVED1" },
+    { 0x06, DL_CMD_DL, "DL" },
+    { 0x07, DL_CMD_RSP_OTHER, "RESERVED2" },
+    { 0x08, DL_CMD_RSP_OTHER, "RESERVED3" },
+    { 0x09, DL_CMD_RSP_OTHER, "SPRITE2D_BASE" },
+    { 0xAF, DL_CMD_LOAD_UCODE, "LOAD_UCODE" },
+    { 0xB0, DL_CMD_BRANCH_Z, "BRANCH_Z" },
+    { 0xB1, DL_CMD_TRI2, "TRI2" },
+    { 0xB2, DL_CMD_MODIFYVTX, "MODIFYVTX" },
+    { 0xB3, DL_CMD_RDPHALF_2, "RDPHALF_2" },
+    { 0xB4, DL_CMD_RDPHALF_1, "RDPHALF_1" },
+    { 0xB5, DL_CMD_LINE3D, "LINE3D" },
+    { 0xB6, DL_CMD_CLEARGEOMETRYMODE, "CLEARGEOMETRYMODE" },
+    { 0xB7, DL_CMD_SETGEOMETRYMODE, "SETGEOMETRYMODE" },
+    { 0xB8, DL_CMD_ENDDL, "ENDDL" },
+    { 0xB9, DL_CMD_SETOTHERMODE_L, "SETOTHERMODE_L" },
+    { 0xBA, DL_CMD_SETOTHERMODE_H, "SETOTHERMODE_H" },
+    { 0xBB, DL_CMD_TEXTURE, "TEXTURE" },
+    { 0xBC, DL_CMD_MOVEWORD, "MOVEWORD" },
+    { 0xBD, DL_CMD_POPMTX, "POPMTX" },
+    { 0xBE, DL_CMD_CULLDL, "CULLDL" },
+    { 0xBF, DL_CMD_TRI1, "TRI1" },
+};
+
+/* F3DEX2: geometry from 0, the rest of the RSP's from 0xD3 to 0xE3 and 0xF1 */
+static const struct {
+    uint8_t opcode;
+    DlKind kind;
+    const char* name;
+} gbi2_ops[] = {
+    { 0x00, DL_CMD_NOOP, "NOOP" },
+    { 0x01, DL_CMD_VTX, "VTX" },
+    { 0x02, DL_CMD_MODIFYVTX, "MODIFYVTX" },
+    { 0x03, DL_CMD_CULLDL, "CULLDL" },
+    { 0x04, DL_CMD_BRANCH_Z, "BRANCH_Z" },
+    { 0x05, DL_CMD_TRI1, "TRI1" },
+    { 0x06, DL_CMD_TRI2, "TRI2" },
+    { 0x07, DL_CMD_QUAD, "QUAD" },
+    { 0x08, DL_CMD_LINE3D, "LINE3D" },
+    { 0xD3, DL_CMD_RSP_OTHER, "SPECIAL_3" },
+    { 0xD4, DL_CMD_RSP_OTHER, "SPECIAL_2" },
+    { 0xD5, DL_CMD_RSP_OTHER, "SPECIAL_1" },
+    { 0xD6, DL_CMD_RSP_OTHER, "DMA_IO" },
+    { 0xD7, DL_CMD_TEXTURE, "TEXTURE" },
+    { 0xD8, DL_CMD_POPMTX, "POPMTX" },
+    { 0xD9, DL_CMD_GEOMETRYMODE, "GEOMETRYMODE" },
+    { 0xDA, DL_CMD_MTX, "MTX" },
+    { 0xDB, DL_CMD_MOVEWORD, "MOVEWORD" },
+    { 0xDC, DL_CMD_MOVEMEM, "MOVEMEM" },
+    { 0xDD, DL_CMD_LOAD_UCODE, "LOAD_UCODE" },
+    { 0xDE, DL_CMD_DL, "DL" },
+    { 0xDF, DL_CMD_ENDDL, "ENDDL" },
+    { 0xE0, DL_CMD_NOOP, "SPNOOP" },
+    { 0xE1, DL_CMD_RDPHALF_1, "RDPHALF_1" },
+    { 0xE2, DL_CMD_SETOTHERMODE_L, "SETOTHERMODE_L" },
+    { 0xE3, DL_CMD_SETOTHERMODE_H, "SETOTHERMODE_H" },
+    { 0xF1, DL_CMD_RDPHALF_2, "RDPHALF_2" },
+};
+
+#define LOOKUP(table, op, field, none)                                       \
+    do {                                                                     \
+        size_t i_;                                                           \
+        for (i_ = 0; i_ < sizeof(table) / sizeof(table[0]); i_++) {          \
+            if (table[i_].opcode == (op)) {                                  \
+                return table[i_].field;                                      \
+            }                                                                \
+        }                                                                    \
+        return none;                                                         \
+    } while (0)
+
+DlKind dl_kind(DlGbi gbi, uint8_t opcode) {
+    if (gbi == DL_GBI2) {
+        if ((opcode >= 0xD3 && opcode <= 0xE3) || opcode == 0xF1 || opcode < 0xC0) {
+            LOOKUP(gbi2_ops, opcode, kind, DL_CMD_UNKNOWN);
+        }
+    } else if (opcode < 0xC0) {
+        LOOKUP(gbi1_ops, opcode, kind, DL_CMD_UNKNOWN);
+    }
+    return rdp_names[opcode - 0xC0] != NULL ? DL_CMD_RDP : DL_CMD_UNKNOWN;
+}
+
+const char* dl_name(DlGbi gbi, uint8_t opcode) {
+    if (gbi == DL_GBI2) {
+        if ((opcode >= 0xD3 && opcode <= 0xE3) || opcode == 0xF1 || opcode < 0xC0) {
+            LOOKUP(gbi2_ops, opcode, name, "?");
+        }
+    } else if (opcode < 0xC0) {
+        LOOKUP(gbi1_ops, opcode, name, "?");
+    }
+    return rdp_names[opcode - 0xC0] != NULL ? rdp_names[opcode - 0xC0] : "?";
+}
+
+uint32_t dl_address(const DlWalker* walker, uint32_t w1) {
+    /* VERSION_J's guParseGbiDL and the microcode only look at four bits */
+    return walker->segments[(w1 >> 24) & 0x0F] + (w1 & 0x00FFFFFF);
+}
+
+void dl_walk_init(DlWalker* walker, const DlFrame* frame, DlGbi gbi, uint32_t start) {
+    memset(walker, 0, sizeof(*walker));
+    walker->frame = frame;
+    walker->gbi = gbi;
+    walker->stack[0] = start;
+}
+
+int dl_walk_next(DlWalker* walker, DlCommand* cmd) {
+    const DlBlock* b;
+    const uint8_t* p;
+    uint32_t index, offset;
+
+    if (walker->error != NULL) {
+        return -1;
+    }
+    if (walker->depth < 0) {
+        return 0;
+    }
+    if (walker->commands >= DL_MAX_COMMANDS) {
+        walker->error = "the frame runs on and on; does a branch loop?";
+        return -1;
+    }
+
+    cmd->paddr = walker->stack[walker->depth];
+    b = dl_block(walker->frame, walker->last, cmd->paddr);
+    if (b == NULL) {
+        walker->error = "a list runs past what the capture holds of it";
+        return -1;
+    }
+    walker->last = b;
+    p = b->data + (cmd->paddr - b->paddr);
+    cmd->w0 = dl_word(p);
+    cmd->w1 = dl_word(p + 4);
+    cmd->opcode = cmd->w0 >> 24;
+    cmd->kind = dl_kind(walker->gbi, cmd->opcode);
+    cmd->depth = walker->depth;
+    walker->stack[walker->depth] += 8;
+    walker->commands++;
+
+    switch (cmd->kind) {
+        case DL_CMD_MOVEWORD:
+            if (walker->gbi == DL_GBI2) {
+                index = (cmd->w0 >> 16) & 0xFF;
+                offset = cmd->w0 & 0xFFFF;
+            } else {
+                index = cmd->w0 & 0xFF;
+                offset = (cmd->w0 >> 8) & 0xFFFF;
+            }
+            if (index == MW_SEGMENT) {
+                walker->segments[(offset >> 2) & 0x0F] = cmd->w1;
+            }
+            break;
+        case DL_CMD_RDPHALF_1:
+            walker->half_1 = cmd->w1;
+            break;
+        case DL_CMD_ENDDL:
+            walker->depth--;
+            break;
+        case DL_CMD_DL:
+            if (((cmd->w0 >> 16) & 0xFF) == DL_PUSH) {
+                if (walker->depth == DL_MAX_DEPTH) {
+                    walker->error = "display lists nested too deep";
+                    return -1;
+                }
+                walker->depth++;
+            }
+            walker->stack[walker->depth] = dl_address(walker, cmd->w1);
+            break;
+        default:
+            break;
+    }
+    return 1;
+}
+
+void dl_walk_branch(DlWalker* walker) {
+    walker->stack[walker->depth] = dl_address(walker, walker->half_1);
+}
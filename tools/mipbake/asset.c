@@ -0,0 +1,105 @@
+/*
+ * The GuMipMapBaked asset, big-endian as the N64 reads it:
+ *
+ *   0   magic         "MIPB"
+ *   4   fmt, siz      bytes
+ *   6   level         the last tile set up
+ *   7   err           what guLoadTextureBlockMipMap returned, 0 or 1
+ *   8   length        texels, as the runtime counts them
+ *   12  tile[8]       w, s, t, addr, 16 bits each
+ *   76  size          bytes of texels
+ *   80  texels        tbuf from the start, as far as the LOADBLOCK reads
+ *
+ * The header is a multiple of 8 bytes, so texels are as aligned as the
+ * asset is, and LOADBLOCK needs them 8-byte aligned.
+ */
+#include <string.h>
+
+#include "mipbake.h"
+
+static void put16(uint8_t* p, uint32_t value) {
+    p[0] = value >> 8;
+    p[1] = value;
+}
+
+static void put32(uint8_t* p, uint32_t value) {
+    p[0] = value >> 24;
+    p[1] = value >> 16;
+    p[2] = value >> 8;
+    p[3] = value;
+}
+
+static uint32_t get16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+size_t mip_asset_size(const MipChain* mc) {
+    return MIP_ASSET_HEADER_SIZE + mc->load_size;
+}
+
+int mip_pack_asset(const MipChain* mc, int fmt, int siz, uint8_t* out, const char** error) {
+    size_t n;
+    int l;
+
+    for (l = 0; l <= mc->level; l++) {
+        if (mc->tiles[l].w > 0xFFFF || mc->tiles[l].addr > 0xFFFF) {
+            *error = "a tile is too big for the asset's 16-bit fields";
+            return -1;
+        }
+    }
+
+    memset(out, 0, MIP_ASSET_HEADER_SIZE);
+    put32(out, MIP_ASSET_MAGIC);
+    out[4] = fmt;
+    out[5] = siz;
+    out[6] = mc->level;
+    out[7] = mc->err;
+    put32(out + 8, mc->length);
+    for (l = 0; l <= mc->level; l++) {
+        put16(out + 12 + l * 8, mc->tiles[l].w);
+        put16(out + 14 + l * 8, mc->tiles[l].s);
+        put16(out + 16 + l * 8, mc->tiles[l].t);
+        put16(out + 18 + l * 8, mc->tiles[l].addr);
+    }
+    put32(out + 76, mc->load_size);
+
+    /* What the LOADBLOCK reads past what was written is the zeroed tbuf */
+    n = mc->size < mc->load_size ? mc->size : mc->load_size;
+    memcpy(out + MIP_ASSET_HEADER_SIZE, mc->tmem, n);
+    memset(out + MIP_ASSET_HEADER_SIZE + n, 0, mc->load_size - n);
+    return 0;
+}
+
+int mip_unpack_asset(const uint8_t* data, size_t size, MipChain* mc, int* fmt, int* siz, const char** error) {
+    int l;
+
+    memset(mc, 0, sizeof(*mc));
+    if (size < MIP_ASSET_HEADER_SIZE || get32(data) != MIP_ASSET_MAGIC) {
+        *error = "not a baked mipmap";
+        return -1;
+    }
+    *fmt = data[4];
+    *siz = data[5];
+    mc->level = data[6];
+    mc->err = data[7];
+    mc->length = get32(data + 8);
+    mc->load_size = get32(data + 76);
+    if (mc->level > MIP_MAX_LEVEL || mc->load_size != size - MIP_ASSET_HEADER_SIZE) {
+        *error = "the asset's header doesn't match its size";
+        return -1;
+    }
+    for (l = 0; l <= mc->level; l++) {
+        mc->tiles[l].w = get16(data + 12 + l * 8);
+        mc->tiles[l].s = get16(data + 14 + l * 8);
+        mc->tiles[l].t = get16(data + 16 + l * 8);
+        mc->tiles[l].addr = get16(data + 18 + l * 8);
+    }
+    mc->tmem = (uint8_t*)data + MIP_ASSET_HEADER_SIZE;
+    mc->size = mc->load_size;
+    mc->capacity = 0;
+    return 0;
+}
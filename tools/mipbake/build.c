@@ -0,0 +1,193 @@
+/*
+ * The fast builder. Each level is fetched from tbuf once, through the same
+ * TMEM addressing get3x3 uses, into a plane per channel; the filter runs
+ * over whole rows of those with the kernel set; and the results are packed
+ * and stored in the order the runtime stores them, which matters where a
+ * level's last row or column spills into the next and 4-bit texels are
+ * ORed in.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+#include "mipbake.h"
+
+#define MAX_CHANNELS 4
+
+/* The texel get3x3 would fetch at s, t of the tile */
+static int fetch(const MipChain* mc, const MipTile* tile, unsigned int s, unsigned int t, int shift, int siz,
+                 int txlsize) {
+    int bank = (((s & (0x3 << (shift - 1))) >> (shift - 1)) ^ ((t & 0x1) << 1)) << 1;
+    int row = (((t * tile->w + s) * txlsize) >> 1) / MIP_TRAM_LSIZE;
+    const uint8_t* p = mc->tmem + tile->addr + row * MIP_TRAM_LSIZE + bank;
+
+    switch (siz) {
+        case MIP_SIZ_4b:
+            return s & 1 ? p[(s & 2) >> 1] & 0x0F : p[(s & 2) >> 1] >> 4;
+        case MIP_SIZ_8b:
+            return p[s & 1];
+        default:
+            return (p[0] << 8) | p[1];
+    }
+}
+
+/* How many channels a format is filtered in, or 0 if the runtime returns 2 */
+static int channels(int fmt, int siz) {
+    switch (fmt) {
+        case MIP_FMT_RGBA:
+            return siz == MIP_SIZ_16b ? 4 : 0;
+        case MIP_FMT_CI:
+        case MIP_FMT_I:
+            return siz == MIP_SIZ_4b || siz == MIP_SIZ_8b ? 1 : 0;
+        case MIP_FMT_IA:
+            return siz != MIP_SIZ_32b ? 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+static void unpack(int fmt, int siz, int texel, uint16_t* c) {
+    switch (fmt) {
+        case MIP_FMT_RGBA:
+            c[0] = (texel >> 11) & 0x1F;
+            c[1] = (texel >> 6) & 0x1F;
+            c[2] = (texel >> 1) & 0x1F;
+            c[3] = texel & 1;
+            break;
+        case MIP_FMT_IA:
+            if (siz == MIP_SIZ_4b) {
+                c[0] = (texel >> 1) & 7;
+                c[1] = texel & 1;
+            } else if (siz == MIP_SIZ_8b) {
+                c[0] = (texel >> 4) & 0xF;
+                c[1] = texel & 0xF;
+            } else {
+                c[0] = (texel >> 8) & 0xFF;
+                c[1] = texel & 0xFF;
+            }
+            break;
+        default:
+            c[0] = texel;
+            break;
+    }
+}
+
+static int pack(int fmt, int siz, const uint16_t* c) {
+    switch (fmt) {
+        case MIP_FMT_RGBA:
+            return ((c[0] & 0x1F) << 11) | ((c[1] & 0x1F) << 6) | ((c[2] & 0x1F) << 1) | c[3];
+        case MIP_FMT_IA:
+            if (siz == MIP_SIZ_4b) {
+                return ((c[0] & 7) << 1) | (c[1] & 1);
+            }
+            if (siz == MIP_SIZ_8b) {
+                return (c[1] & 0xF) | ((c[0] & 0xF) << 4);
+            }
+            return (c[0] << 8) | c[1];
+        default:
+            return c[0];
+    }
+}
+
+/* The row or column the filter takes from, for the texel at n past the edge */
+static int edge(int n, int size, int clamp, int inside) {
+    if (n < 0 || n >= size) {
+        return clamp ? inside : (n < 0 ? size - 1 : 0);
+    }
+    return n;
+}
+
+int mip_build(const MipImage* im, const MipKernels* k, MipChain* mc, const char** error) {
+    uint16_t* planes = NULL;
+    uint16_t* sums = NULL;
+    uint16_t* out = NULL;
+    int txlsize, shift, nc, r, c, s, t, x, w, h, texel, trip, n;
+    uint16_t value[MAX_CHANNELS];
+    size_t taddr, saddr, area;
+    unsigned int tempaddr;
+    const MipTile* prev;
+
+    if (mip_start(im, mc, error) < 0) {
+        return -1;
+    }
+    nc = channels(im->fmt, im->siz);
+
+    while ((r = mip_next_level(im, mc, &txlsize, &shift, error)) > 0) {
+        if (nc == 0) {
+            *error = "the runtime can't filter this format (it returns 2)";
+            r = -1;
+            break;
+        }
+        prev = &mc->tiles[mc->level - 1];
+        w = prev->s;
+        h = prev->t;
+        n = (w + 1) / 2;
+
+        /* The first level filters the top one, the largest, so this is enough for all */
+        if (planes == NULL) {
+            area = (size_t)w * h;
+            planes = malloc(area * nc * sizeof(uint16_t));
+            sums = malloc((w + 2 + MIP_KERNEL_SLACK) * sizeof(uint16_t));
+            out = malloc((size_t)n * nc * sizeof(uint16_t));
+            if (planes == NULL || sums == NULL || out == NULL) {
+                *error = "out of memory";
+                r = -1;
+                break;
+            }
+            memset(sums, 0, (w + 2 + MIP_KERNEL_SLACK) * sizeof(uint16_t));
+        }
+        area = (size_t)w * h;
+
+        for (t = 0; t < h; t++) {
+            for (s = 0; s < w; s++) {
+                unpack(im->fmt, im->siz, fetch(mc, prev, s, t, shift, im->siz, txlsize), value);
+                for (c = 0; c < nc; c++) {
+                    planes[c * area + (size_t)t * w + s] = value[c];
+                }
+            }
+        }
+
+        taddr = mc->tiles[mc->level].addr;
+        for (t = 0; t < h; t += 2) {
+            const uint16_t* plane;
+            int above = edge(t - 1, h, im->cft, t), below = edge(t + 1, h, im->cft, t);
+
+            for (c = 0; c < nc; c++) {
+                plane = planes + c * area;
+                k->rows(sums + 1, plane + (size_t)above * w, plane + (size_t)t * w, plane + (size_t)below * w, w);
+                sums[0] = sums[1 + edge(-1, w, im->cfs, 0)];
+                sums[w + 1] = sums[1 + edge(w, w, im->cfs, w - 1)];
+                k->columns(out + c * n, sums, n);
+            }
+
+            trip = (t & 2) << 1;
+            tempaddr = 0;
+            for (x = 0; x < n; x++) {
+                for (c = 0; c < nc; c++) {
+                    value[c] = out[c * n + x];
+                }
+                texel = pack(im->fmt, im->siz, value);
+                saddr = taddr + ((tempaddr >> 1) ^ trip);
+                if (im->siz == MIP_SIZ_4b) {
+                    mip_or(mc, saddr, x & 1 ? texel : texel << 4);
+                } else if (im->siz == MIP_SIZ_8b) {
+                    mip_put(mc, saddr, texel);
+                } else {
+                    mip_put(mc, saddr, texel >> 8);
+                    mip_put(mc, saddr + 1, texel);
+                }
+                tempaddr += txlsize;
+            }
+            taddr += (mc->tiles[mc->level].w * txlsize) >> 1;
+        }
+    }
+
+    free(planes);
+    free(sums);
+    free(out);
+    if (r < 0) {
+        return -1;
+    }
+    mip_finish(im, mc);
+    return 0;
+}
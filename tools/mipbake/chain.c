@@ -0,0 +1,236 @@
+/*
+ * What both builders share: checking the image, the top level's copy into
+ * tbuf, each level's place and size, and picking a kernel set.
+ *
+ * The top level is copied as the runtime copies it, a line at a time with
+ * the bytes of odd lines' words swapped and lines padded to TMEM's, 4-bit
+ * tiles that start on an odd texel shifted by a nibble. The level loop's
+ * bookkeeping is the runtime's too, down to keeping the level TMEM ran out
+ * on: stuffDisplayList still sets a tile up for it.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "kernels.h"
+#include "mipbake.h"
+
+/* sizeParams' shift and tsize (texel size in nibbles), by siz */
+static const int size_shift[4] = { 3, 2, 1, 0 };
+static const int size_nibbles[4] = { 1, 2, 4, 8 };
+
+int mip_start(const MipImage* im, MipChain* mc, const char** error) {
+    int txlsize, im_bytes, tr_bytes, start_unaligned, end_unaligned, h, b, flip;
+    size_t iaddr, taddr, last;
+
+    memset(mc, 0, sizeof(*mc));
+    if (im->fmt < MIP_FMT_RGBA || im->fmt > MIP_FMT_I || im->siz < MIP_SIZ_4b || im->siz > MIP_SIZ_32b) {
+        *error = "no such texel format";
+        return -1;
+    }
+    if (im->w < 1 || im->h < 1 || im->s < 0 || im->t < 0 || im->lsize < 1 || im->addr < 0) {
+        *error = "the tile or image is empty";
+        return -1;
+    }
+
+    txlsize = size_nibbles[im->siz];
+    iaddr = (size_t)im->t * im->lsize + ((im->s * txlsize) >> 1);
+    start_unaligned = (im->s & 1) && im->siz == MIP_SIZ_4b;
+    end_unaligned = ((im->s + im->w) & 1) && im->siz == MIP_SIZ_4b;
+    im_bytes = (im->w * txlsize + 1) >> 1;
+    tr_bytes = im_bytes / MIP_TRAM_LSIZE * MIP_TRAM_LSIZE;
+    if (im_bytes > tr_bytes) {
+        tr_bytes += MIP_TRAM_LSIZE;
+    }
+
+    last = iaddr + (size_t)(im->h - 1) * im->lsize + im_bytes;
+    if (last > im->base_size) {
+        *error = "the tile runs past the end of the image";
+        return -1;
+    }
+
+    /* Levels past the top fit in TMEM, or aren't built; a row and a bit more may spill past each */
+    mc->capacity = (size_t)im->addr + (size_t)im->h * tr_bytes + 2 * MIP_TRAM_SIZE + 64;
+    mc->tmem = calloc(mc->capacity, 1);
+    if (mc->tmem == NULL) {
+        *error = "out of memory";
+        return -1;
+    }
+
+    taddr = im->addr;
+    for (h = 0; h < im->h; h++) {
+        const uint8_t* line = im->base + iaddr;
+
+        flip = (h & 1) << 2;
+        if (start_unaligned) {
+            for (b = 0; b < im_bytes; b++) {
+                mip_put(mc, taddr + (b ^ flip), ((line[b] & 0x0F) << 4) | ((line[b + 1] & 0xF0) >> 4));
+            }
+            if (!end_unaligned) {
+                mip_put(mc, taddr + ((b - 1) ^ flip), mc->tmem[taddr + ((b - 1) ^ flip)] & 0xF0);
+            }
+        } else {
+            for (b = 0; b < im_bytes; b++) {
+                mip_put(mc, taddr + (b ^ flip), line[b]);
+            }
+            if (end_unaligned) {
+                mip_put(mc, taddr + ((b - 1) ^ flip), mc->tmem[taddr + ((b - 1) ^ flip)] & 0xF0);
+            }
+        }
+        for (b = im_bytes; b < tr_bytes; b++) {
+            mip_put(mc, taddr + (b ^ flip), 0);
+        }
+        iaddr += im->lsize;
+        taddr += tr_bytes;
+    }
+
+    mc->tiles[0].s = im->w;
+    mc->tiles[0].t = im->h;
+    mc->tiles[0].w = (tr_bytes / txlsize) << 1;
+    mc->tiles[0].addr = im->addr;
+    mc->length = mc->tiles[0].w * mc->tiles[0].t;
+    mc->level = 0;
+    return 0;
+}
+
+int mip_next_level(const MipImage* im, MipChain* mc, int* txlsize, int* shift, const char** error) {
+    int ntexels, level;
+    MipTile* tile;
+
+    *txlsize = size_nibbles[im->siz];
+    *shift = size_shift[im->siz];
+    ntexels = (MIP_TRAM_LSIZE / *txlsize) << 1;
+
+    if (mc->tiles[mc->level].s <= 1 && mc->tiles[mc->level].t <= 1) {
+        return 0;
+    }
+    if (mc->level == MIP_MAX_LEVEL) {
+        *error = "the chain has more levels than the runtime's mipmap[] holds";
+        return -1;
+    }
+
+    level = ++mc->level;
+    tile = &mc->tiles[level];
+    tile->addr = mc->tiles[level - 1].addr + (mc->tiles[level - 1].w * *txlsize * mc->tiles[level - 1].t >> 1);
+    tile->s = mc->tiles[0].s >> level;
+    tile->t = mc->tiles[0].t >> level;
+    if (tile->s == 0) {
+        tile->s = 1;
+    }
+    if (tile->t == 0) {
+        tile->t = 1;
+    }
+    tile->w = (tile->s + (ntexels - 1)) >> (*shift + 1) << (*shift + 1);
+
+    mc->length += tile->w * tile->t;
+    if ((mc->length * *txlsize >> 1) >= MIP_TRAM_SIZE) {
+        mc->err = 1;
+        mc->length -= tile->w * tile->t;
+        return 0;
+    }
+    return 1;
+}
+
+void mip_finish(const MipImage* im, MipChain* mc) {
+    /* The LOADBLOCK's lrs, 4-bit texels being loaded as 8-bit pairs */
+    uint32_t lrs = im->siz == MIP_SIZ_4b ? mc->length / 2 : mc->length;
+    size_t bytes = im->siz == MIP_SIZ_4b ? 1 : size_nibbles[im->siz] / 2;
+
+    mc->load_size = ((lrs + 1) * bytes + 7) & ~(size_t)7;
+}
+
+void mip_free_chain(MipChain* mc) {
+    if (mc->capacity != 0) {
+        free(mc->tmem);
+    }
+    mc->tmem = NULL;
+}
+
+int mip_same_chain(const MipChain* a, const MipChain* b, const char** error) {
+    size_t i, n;
+    int l;
+
+    if (a->level != b->level || a->length != b->length || a->err != b->err || a->load_size != b->load_size) {
+        *error = "the levels differ";
+        return 0;
+    }
+    for (l = 0; l <= a->level; l++) {
+        if (a->tiles[l].w != b->tiles[l].w || a->tiles[l].s != b->tiles[l].s || a->tiles[l].t != b->tiles[l].t ||
+            a->tiles[l].addr != b->tiles[l].addr) {
+            *error = "a tile differs";
+            return 0;
+        }
+    }
+    n = a->size > b->size ? a->size : b->size;
+    for (i = 0; i < n; i++) {
+        if ((i < a->size ? a->tmem[i] : 0) != (i < b->size ? b->tmem[i] : 0)) {
+            *error = "the texels differ";
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static const MipKernels* const kernel_sets[MIP_KERNELS_COUNT] = {
+    &mip_kernels_scalar,
+#ifdef MIP_HAVE_X86
+    &mip_kernels_sse2,
+    &mip_kernels_avx2,
+#else
+    NULL,
+    NULL,
+#endif
+};
+
+static const char* const kernel_names[MIP_KERNELS_COUNT] = { "scalar", "sse2", "avx2" };
+
+static int cpu_supports(MipKernelLevel level) {
+    if (level == MIP_KERNELS_SCALAR) {
+        return 1;
+    }
+    if (level >= MIP_KERNELS_COUNT || kernel_sets[level] == NULL) {
+        return 0;
+    }
+#ifdef MIP_HAVE_X86
+    __builtin_cpu_init();
+    if (level == MIP_KERNELS_SSE2) {
+        return __builtin_cpu_supports("sse2");
+    }
+    if (level == MIP_KERNELS_AVX2) {
+        return __builtin_cpu_supports("avx2");
+    }
+#endif
+    return 0;
+}
+
+MipKernelLevel mip_best_kernels(void) {
+    int level;
+
+    for (level = MIP_KERNELS_COUNT - 1; level > MIP_KERNELS_SCALAR; level--) {
+        if (cpu_supports((MipKernelLevel)level)) {
+            return (MipKernelLevel)level;
+        }
+    }
+    return MIP_KERNELS_SCALAR;
+}
+
+const char* mip_kernels_name(MipKernelLevel level) {
+    return level < MIP_KERNELS_COUNT ? kernel_names[level] : "?";
+}
+
+const MipKernels* mip_kernels(MipKernelLevel level) {
+    return cpu_supports(level) ? kernel_sets[level] : NULL;
+}
+
+MipKernelLevel mip_kernels_from_env(void) {
+    const char* name = getenv("MIP_KERNELS");
+    int level;
+
+    if (name != NULL) {
+        for (level = 0; level < MIP_KERNELS_COUNT; level++) {
+            if (strcmp(name, kernel_names[level]) == 0 && cpu_supports((MipKernelLevel)level)) {
+                return (MipKernelLevel)level;
+            }
+        }
+    }
+    return mip_best_kernels();
+}
@@ -0,0 +1,35 @@
+#ifndef MIPBAKE_KERNELS_H
+#define MIPBAKE_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The filter, one channel at a time: the 3x3 1-2-1 kernel is a 1-2-1 pass
+ * down the rows then one across. Channels are at most 8 bits, so a column
+ * sum is at most 1020 and a whole one 4080, and 16-bit lanes never carry.
+ * Every set produces exactly what the scalar set does.
+ */
+struct MipKernels {
+    /* dst[x] = a[x] + 2 * b[x] + c[x] */
+    void (*rows)(uint16_t* dst, const uint16_t* a, const uint16_t* b, const uint16_t* c, size_t n);
+
+    /*
+     * dst[k] = (src[2k] + 2 * src[2k + 1] + src[2k + 2] + 8) >> 4, src being
+     * a row of column sums with the texel before the first and the one
+     * after the last in front and behind. src has MIP_KERNEL_SLACK more
+     * entries than it reads to spare.
+     */
+    void (*columns)(uint16_t* dst, const uint16_t* src, size_t n);
+};
+
+#define MIP_KERNEL_SLACK 32
+
+extern const struct MipKernels mip_kernels_scalar;
+#if defined(__x86_64__) || defined(__i386__)
+extern const struct MipKernels mip_kernels_sse2;
+extern const struct MipKernels mip_kernels_avx2;
+#define MIP_HAVE_X86 1
+#endif
+
+#endif
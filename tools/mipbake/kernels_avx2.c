@@ -0,0 +1,58 @@
+#include "kernels.h"
+
+#ifdef MIP_HAVE_X86
+#include <immintrin.h>
+
+/*
+ * Built with -mavx2 and only reached once mip_kernels has checked the CPU.
+ * The packs work within 128-bit lanes, leaving the quarters of each result
+ * as 0, 2, 1, 3; one permute puts them back in order.
+ */
+static void rows_avx2(uint16_t* dst, const uint16_t* a, const uint16_t* b, const uint16_t* c, size_t n) {
+    size_t x;
+
+    for (x = 0; x + 16 <= n; x += 16) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(a + x));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(b + x));
+        __m256i vc = _mm256_loadu_si256((const __m256i*)(c + x));
+
+        _mm256_storeu_si256((__m256i*)(dst + x),
+                            _mm256_add_epi16(_mm256_add_epi16(va, vc), _mm256_add_epi16(vb, vb)));
+    }
+    mip_kernels_sse2.rows(dst + x, a + x, b + x, c + x, n - x);
+}
+
+static inline __m256i evens(__m256i lo, __m256i hi) {
+    __m256i mask = _mm256_set1_epi32(0xFFFF);
+
+    return _mm256_packs_epi32(_mm256_and_si256(lo, mask), _mm256_and_si256(hi, mask));
+}
+
+static inline __m256i odds(__m256i lo, __m256i hi) {
+    return _mm256_packs_epi32(_mm256_srli_epi32(lo, 16), _mm256_srli_epi32(hi, 16));
+}
+
+static void columns_avx2(uint16_t* dst, const uint16_t* src, size_t n) {
+    __m256i round = _mm256_set1_epi16(8);
+    size_t k;
+
+    for (k = 0; k + 16 <= n; k += 16) {
+        const uint16_t* p = src + 2 * k;
+        __m256i a = _mm256_loadu_si256((const __m256i*)p);
+        __m256i b = _mm256_loadu_si256((const __m256i*)(p + 16));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(p + 2));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(p + 18));
+        __m256i mid = odds(a, b);
+        __m256i sum = _mm256_add_epi16(_mm256_add_epi16(evens(a, b), evens(c, d)), _mm256_add_epi16(mid, mid));
+
+        sum = _mm256_srli_epi16(_mm256_add_epi16(sum, round), 4);
+        _mm256_storeu_si256((__m256i*)(dst + k), _mm256_permute4x64_epi64(sum, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    mip_kernels_sse2.columns(dst + k, src + 2 * k, n - k);
+}
+
+const struct MipKernels mip_kernels_avx2 = {
+    rows_avx2,
+    columns_avx2,
+};
+#endif
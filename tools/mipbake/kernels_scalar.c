@@ -0,0 +1,22 @@
+#include "kernels.h"
+
+static void rows_scalar(uint16_t* dst, const uint16_t* a, const uint16_t* b, const uint16_t* c, size_t n) {
+    size_t x;
+
+    for (x = 0; x < n; x++) {
+        dst[x] = a[x] + 2 * b[x] + c[x];
+    }
+}
+
+static void columns_scalar(uint16_t* dst, const uint16_t* src, size_t n) {
+    size_t k;
+
+    for (k = 0; k < n; k++) {
+        dst[k] = (src[2 * k] + 2 * src[2 * k + 1] + src[2 * k + 2] + 8) >> 4;
+    }
+}
+
+const struct MipKernels mip_kernels_scalar = {
+    rows_scalar,
+    columns_scalar,
+};
@@ -0,0 +1,52 @@
+#include "kernels.h"
+
+#ifdef MIP_HAVE_X86
+#include <emmintrin.h>
+
+static void rows_sse2(uint16_t* dst, const uint16_t* a, const uint16_t* b, const uint16_t* c, size_t n) {
+    size_t x;
+
+    for (x = 0; x + 8 <= n; x += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + x));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + x));
+        __m128i vc = _mm_loadu_si128((const __m128i*)(c + x));
+
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_add_epi16(_mm_add_epi16(va, vc), _mm_add_epi16(vb, vb)));
+    }
+    mip_kernels_scalar.rows(dst + x, a + x, b + x, c + x, n - x);
+}
+
+/* Sums are below 0x8000, so packing with signed saturation only narrows */
+static inline __m128i evens(__m128i lo, __m128i hi) {
+    __m128i mask = _mm_set1_epi32(0xFFFF);
+
+    return _mm_packs_epi32(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+}
+
+static inline __m128i odds(__m128i lo, __m128i hi) {
+    return _mm_packs_epi32(_mm_srli_epi32(lo, 16), _mm_srli_epi32(hi, 16));
+}
+
+static void columns_sse2(uint16_t* dst, const uint16_t* src, size_t n) {
+    __m128i round = _mm_set1_epi16(8);
+    size_t k;
+
+    for (k = 0; k + 8 <= n; k += 8) {
+        const uint16_t* p = src + 2 * k;
+        __m128i a = _mm_loadu_si128((const __m128i*)p);
+        __m128i b = _mm_loadu_si128((const __m128i*)(p + 8));
+        __m128i c = _mm_loadu_si128((const __m128i*)(p + 2));
+        __m128i d = _mm_loadu_si128((const __m128i*)(p + 10));
+        __m128i mid = odds(a, b);
+        __m128i sum = _mm_add_epi16(_mm_add_epi16(evens(a, b), evens(c, d)), _mm_add_epi16(mid, mid));
+
+        _mm_storeu_si128((__m128i*)(dst + k), _mm_srli_epi16(_mm_add_epi16(sum, round), 4));
+    }
+    mip_kernels_scalar.columns(dst + k, src + 2 * k, n - k);
+}
+
+const struct MipKernels mip_kernels_sse2 = {
+    rows_sse2,
+    columns_sse2,
+};
+#endif
@@ -0,0 +1,197 @@
+/*
+ * mipbake: builds the mipmap guLoadTextureBlockMipMap would build from a
+ * texture, ahead of time, and writes it as a GuMipMapBaked asset for
+ * guLoadTextureBlockMipMapBaked to load.
+ *
+ *   mipbake --format f --size WxH [--tile s,t,w,h] [--lsize n] [--addr n]
+ *           [--clamp-s] [--clamp-t] -o asset texture
+ *
+ * The texture is raw texels as the ROM holds them, WxH of format f: rgba16,
+ * ci4, ci8, ia4, ia8, ia16, i4 or i8. --tile takes part of it, as Image's
+ * s, t, w and h do, and --lsize, --addr and the clamps are Image's lsize
+ * and addr and the call's cfs and cft (wrap is the default). The chain is
+ * built with the fastest kernel set the CPU has (or MIP_KERNELS's) and
+ * with the runtime's own loop, and nothing is written unless the two
+ * agree byte for byte.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mipbake.h"
+
+static const struct {
+    const char* name;
+    int fmt, siz;
+} formats[] = {
+    { "rgba16", MIP_FMT_RGBA, MIP_SIZ_16b }, { "ci4", MIP_FMT_CI, MIP_SIZ_4b },  { "ci8", MIP_FMT_CI, MIP_SIZ_8b },
+    { "ia4", MIP_FMT_IA, MIP_SIZ_4b },       { "ia8", MIP_FMT_IA, MIP_SIZ_8b },  { "ia16", MIP_FMT_IA, MIP_SIZ_16b },
+    { "i4", MIP_FMT_I, MIP_SIZ_4b },         { "i8", MIP_FMT_I, MIP_SIZ_8b },
+};
+
+static void usage(void) {
+    fprintf(stderr, "usage: mipbake --format f --size WxH [--tile s,t,w,h] [--lsize n] [--addr n]\n"
+                    "               [--clamp-s] [--clamp-t] -o asset texture\n"
+                    "  --format   rgba16, ci4, ci8, ia4, ia8, ia16, i4 or i8\n"
+                    "  --size     the texture's width and height in texels\n"
+                    "  --tile     the part of it to mipmap (default all of it)\n"
+                    "  --lsize    bytes from one line to the next (default as packed as it goes)\n"
+                    "  --addr     where in tbuf the top level goes (default 0)\n"
+                    "  --clamp-s  clamp the filter at the sides rather than wrap\n"
+                    "  --clamp-t  clamp it at the top and bottom\n");
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    uint8_t* data;
+    long len;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    /* 8 bytes to spare, for the byte past a line a 4-bit tile at an odd s reads */
+    data = calloc(len > 0 ? len + 8 : 8, 1);
+    if (fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+int main(int argc, char** argv) {
+    const char* in_path = NULL;
+    const char* out_path = NULL;
+    const char* error = NULL;
+    const char* format = NULL;
+    int width = 0, height = 0, tile = 0, lsize = 0, a;
+    size_t f, size;
+    MipImage im;
+    MipChain fast, ref;
+    MipKernelLevel level;
+    uint8_t *data, *asset;
+    FILE* out;
+
+    memset(&im, 0, sizeof(im));
+    for (a = 1; a < argc; a++) {
+        if (!strcmp(argv[a], "--format") && a + 1 < argc) {
+            format = argv[++a];
+        } else if (!strcmp(argv[a], "--size") && a + 1 < argc) {
+            if (sscanf(argv[++a], "%dx%d", &width, &height) != 2) {
+                usage();
+                return 1;
+            }
+        } else if (!strcmp(argv[a], "--tile") && a + 1 < argc) {
+            if (sscanf(argv[++a], "%d,%d,%d,%d", &im.s, &im.t, &im.w, &im.h) != 4) {
+                usage();
+                return 1;
+            }
+            tile = 1;
+        } else if (!strcmp(argv[a], "--lsize") && a + 1 < argc) {
+            lsize = strtol(argv[++a], NULL, 0);
+        } else if (!strcmp(argv[a], "--addr") && a + 1 < argc) {
+            im.addr = strtol(argv[++a], NULL, 0);
+        } else if (!strcmp(argv[a], "--clamp-s")) {
+            im.cfs = 1;
+        } else if (!strcmp(argv[a], "--clamp-t")) {
+            im.cft = 1;
+        } else if (!strcmp(argv[a], "-o") && a + 1 < argc) {
+            out_path = argv[++a];
+        } else if (argv[a][0] != '-' && in_path == NULL) {
+            in_path = argv[a];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (in_path == NULL || out_path == NULL || format == NULL || width < 1 || height < 1) {
+        usage();
+        return 1;
+    }
+    for (f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        if (!strcmp(format, formats[f].name)) {
+            break;
+        }
+    }
+    if (f == sizeof(formats) / sizeof(formats[0])) {
+        fprintf(stderr, "mipbake: no format %s, or not one the runtime filters\n", format);
+        return 1;
+    }
+
+    im.fmt = formats[f].fmt;
+    im.siz = formats[f].siz;
+    im.lsize = lsize ? lsize : (width * (4 << im.siz) + 7) / 8;
+    if (!tile) {
+        im.w = width;
+        im.h = height;
+    }
+
+    data = read_file(in_path, &size);
+    if (data == NULL) {
+        fprintf(stderr, "mipbake: can't read %s\n", in_path);
+        return 1;
+    }
+    if (size < (size_t)im.lsize * height) {
+        fprintf(stderr, "mipbake: %s is smaller than %dx%d %s texels\n", in_path, width, height, format);
+        free(data);
+        return 1;
+    }
+    im.base = data;
+    im.base_size = size;
+
+    level = mip_kernels_from_env();
+    if (mip_build(&im, mip_kernels(level), &fast, &error) < 0) {
+        fprintf(stderr, "mipbake: %s: %s\n", in_path, error);
+        mip_free_chain(&fast);
+        free(data);
+        return 1;
+    }
+    if (mip_build_runtime(&im, &ref, &error) < 0 || !mip_same_chain(&fast, &ref, &error)) {
+        fprintf(stderr, "mipbake: %s: the %s build doesn't match the runtime's (%s); nothing written\n", in_path,
+                mip_kernels_name(level), error);
+        mip_free_chain(&fast);
+        mip_free_chain(&ref);
+        free(data);
+        return 1;
+    }
+    mip_free_chain(&ref);
+
+    size = mip_asset_size(&fast);
+    asset = malloc(size);
+    if (asset == NULL || mip_pack_asset(&fast, im.fmt, im.siz, asset, &error) < 0) {
+        fprintf(stderr, "mipbake: %s: %s\n", in_path, asset == NULL ? "out of memory" : error);
+        free(asset);
+        mip_free_chain(&fast);
+        free(data);
+        return 1;
+    }
+
+    out = fopen(out_path, "wb");
+    if (out == NULL || fwrite(asset, 1, size, out) != size) {
+        fprintf(stderr, "mipbake: can't write %s\n", out_path);
+        if (out != NULL) {
+            fclose(out);
+        }
+        free(asset);
+        mip_free_chain(&fast);
+        free(data);
+        return 1;
+    }
+    fclose(out);
+
+    printf("%s: %dx%d %s, %d tiles, %u texels, %zu bytes of texels\n", out_path, im.w, im.h, format,
+           fast.level + 1, fast.length, fast.load_size);
+    if (fast.err) {
+        printf("  TMEM ran out at tile %d; guLoadTextureBlockMipMap returns 1 for this one too\n", fast.level);
+    }
+
+    free(asset);
+    mip_free_chain(&fast);
+    free(data);
+    return 0;
+}
@@ -0,0 +1,135 @@
+#ifndef MIPBAKE_H
+#define MIPBAKE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Host library for mipmaps guLoadTextureBlockMipMap would build: it builds
+ * the same TMEM image the runtime leaves in tbuf, byte for byte, and packs
+ * it with what the runtime's stuffDisplayList needs into the GuMipMapBaked
+ * asset guLoadTextureBlockMipMapBaked loads (GU_MIPMAP_BAKED in gu.h).
+ *
+ * There are two builders. mip_build_runtime is libultra's
+ * guLoadTextureBlockMipMap itself, built for the host with its 16-bit
+ * stores made big-endian (runtime.c), so tbuf is in the N64's order. mip_build
+ * fetches each texel of a level once and runs the 1-2-1 filter as two
+ * integer passes over planes of it, with a kernel set picked for the CPU;
+ * the float sums are of small integers and exact, so (int)(sum/16.0 + 0.5)
+ * is (sum + 8) >> 4 and the two agree exactly. mipbench checks that they do.
+ */
+
+/* Image's fmt and siz, as in gbi.h */
+#define MIP_FMT_RGBA 0
+#define MIP_FMT_YUV  1
+#define MIP_FMT_CI   2
+#define MIP_FMT_IA   3
+#define MIP_FMT_I    4
+
+#define MIP_SIZ_4b  0
+#define MIP_SIZ_8b  1
+#define MIP_SIZ_16b 2
+#define MIP_SIZ_32b 3
+
+#define MIP_TRAM_SIZE 4096 /* TRAM_SIZE */
+#define MIP_TRAM_LSIZE 8   /* TRAM_LSIZE and TRAM_WSIZE */
+#define MIP_MAX_LEVEL 7    /* the last of the runtime's mipmap[] */
+
+#define MIP_ASSET_MAGIC       0x4D495042 /* GU_MIPMAP_MAGIC, "MIPB" */
+#define MIP_ASSET_HEADER_SIZE 80
+
+/* What guLoadTextureBlockMipMap is given: Image's fields, and cfs and cft */
+typedef struct {
+    const uint8_t* base; /* the whole image, with 8 bytes after it to spare */
+    size_t base_size;
+    int fmt, siz;
+    int lsize;           /* bytes from one line of the image to the next */
+    int addr;            /* where in tbuf the top level goes */
+    int w, h;            /* the tile */
+    int s, t;            /* and where it is in the image */
+    int cfs, cft;        /* FILTER_CLAMP or FILTER_WRAP, each way */
+} MipImage;
+
+/* The runtime's struct Tile */
+typedef struct {
+    int w; /* line width in texels, padded to TMEM's lines */
+    int s, t;
+    int addr;
+} MipTile;
+
+typedef struct {
+    uint8_t* tmem;    /* tbuf as the call leaves it, if it was zeroed */
+    size_t capacity;  /* 0 if tmem isn't the chain's own */
+    size_t size;      /* bytes of it written */
+    size_t load_size; /* bytes the LOADBLOCK reads, in whole 64-bit words */
+    MipTile tiles[MIP_MAX_LEVEL + 1];
+    int level;        /* the last tile stuffDisplayList sets up */
+    uint32_t length;  /* texels, as the runtime counts them */
+    int err;          /* 0, or 1 when TMEM ran out */
+} MipChain;
+
+typedef enum {
+    MIP_KERNELS_SCALAR,
+    MIP_KERNELS_SSE2,
+    MIP_KERNELS_AVX2,
+    MIP_KERNELS_COUNT
+} MipKernelLevel;
+
+typedef struct MipKernels MipKernels;
+
+/* The best set the CPU has, its name, and the set itself or NULL */
+MipKernelLevel mip_best_kernels(void);
+const char* mip_kernels_name(MipKernelLevel level);
+const MipKernels* mip_kernels(MipKernelLevel level);
+
+/* The one MIP_KERNELS names, if the CPU has it, otherwise the best */
+MipKernelLevel mip_kernels_from_env(void);
+
+/*
+ * Each builds the chain; returns 0, or -1 with *error set when the runtime
+ * would return 2 or the image is one it can't take. mc is freed with
+ * mip_free_chain either way.
+ */
+int mip_build_runtime(const MipImage* im, MipChain* mc, const char** error);
+int mip_build(const MipImage* im, const MipKernels* kernels, MipChain* mc, const char** error);
+void mip_free_chain(MipChain* mc);
+
+/* Whether two builds left the same chain; if not, says where in *error */
+int mip_same_chain(const MipChain* a, const MipChain* b, const char** error);
+
+/*
+ * The asset: a big-endian GuMipMapBaked header then the texels the LOADBLOCK
+ * reads. mip_asset_size says how big; mip_pack_asset fills out with it.
+ * mip_unpack_asset reads one back into the chain's tiles, level, length,
+ * err, load_size and tmem, which is left pointing into data. Both return
+ * 0, or -1 with *error set.
+ */
+size_t mip_asset_size(const MipChain* mc);
+int mip_pack_asset(const MipChain* mc, int fmt, int siz, uint8_t* out, const char** error);
+int mip_unpack_asset(const uint8_t* data, size_t size, MipChain* mc, int* fmt, int* siz, const char** error);
+
+/*
+ * Loads the asset with guLoadTextureBlockMipMapBaked and the image with
+ * guLoadTextureBlockMipMap: 1 if they return the same, stuff the same
+ * display list and the asset's texels are the TMEM image the runtime
+ * leaves, 0 with *error set if not, -1 if the image is one it can't take.
+ */
+int mip_check_baked(const MipImage* im, const uint8_t* asset, size_t size, const char** error);
+
+/* Shared by the builders */
+int mip_start(const MipImage* im, MipChain* mc, const char** error);
+int mip_next_level(const MipImage* im, MipChain* mc, int* txlsize, int* shift, const char** error);
+void mip_finish(const MipImage* im, MipChain* mc);
+
+static inline void mip_put(MipChain* mc, size_t at, uint8_t value) {
+    mc->tmem[at] = value;
+    if (at >= mc->size) {
+        mc->size = at + 1;
+    }
+}
+
+static inline void mip_or(MipChain* mc, size_t at, uint8_t value) {
+    mip_put(mc, at, mc->tmem[at] | value);
+}
+
+#endif
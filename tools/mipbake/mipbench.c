@@ -0,0 +1,256 @@
+/*
+ * mipbench: checks each kernel set's builds against the runtime's own
+ * guLoadTextureBlockMipMap, built from libultra's source, and times them.
+ *
+ *   mipbench [--cases n] [--rounds n] [--seed n]
+ *
+ * Every format the runtime filters is built from random texels at random
+ * sizes (odd ones, 1-wide ones and ones that run out of TMEM included),
+ * from tiles at random places in the image, wrapped and clamped, with each
+ * kernel set and with mip_build_runtime; the chains have to match byte for
+ * byte, the asset packed from each has to read back as the reference, and
+ * guLoadTextureBlockMipMapBaked has to stuff the same display list from it,
+ * loading the same TMEM image, as guLoadTextureBlockMipMap does.
+ * Then a few texture shapes a scene would load are built over and over
+ * with each.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mipbake.h"
+
+static const struct {
+    const char* name;
+    int fmt, siz;
+} formats[] = {
+    { "rgba16", MIP_FMT_RGBA, MIP_SIZ_16b }, { "ci4", MIP_FMT_CI, MIP_SIZ_4b },  { "ci8", MIP_FMT_CI, MIP_SIZ_8b },
+    { "ia4", MIP_FMT_IA, MIP_SIZ_4b },       { "ia8", MIP_FMT_IA, MIP_SIZ_8b },  { "ia16", MIP_FMT_IA, MIP_SIZ_16b },
+    { "i4", MIP_FMT_I, MIP_SIZ_4b },         { "i8", MIP_FMT_I, MIP_SIZ_8b },
+};
+
+#define FORMATS (int)(sizeof(formats) / sizeof(formats[0]))
+
+static const struct {
+    int format;
+    int w, h;
+} shapes[] = {
+    { 0, 32, 32 }, { 0, 64, 16 }, { 1, 64, 64 }, { 2, 32, 64 }, { 4, 64, 32 }, { 5, 32, 32 }, { 7, 64, 32 },
+};
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void) {
+    rng_state = rng_state * 1103515245 + 12345;
+    return rng_state >> 8;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* An image for the tile, at a random place in a random-sized one */
+static uint8_t* random_image(MipImage* im, int format, int w, int h) {
+    int bits = 4 << formats[format].siz;
+    int width, height, i;
+    uint8_t* data;
+
+    memset(im, 0, sizeof(*im));
+    im->fmt = formats[format].fmt;
+    im->siz = formats[format].siz;
+    im->w = w;
+    im->h = h;
+    im->s = rng() % 4 ? 0 : rng() % 5;
+    im->t = rng() % 4 ? 0 : rng() % 3;
+    im->cfs = rng() & 1;
+    im->cft = rng() & 1;
+    im->addr = rng() % 4 ? 0 : (rng() % 32) * 8;
+    width = im->s + w + (rng() % 3);
+    height = im->t + h;
+    im->lsize = (width * bits + 7) / 8 + (rng() % 4 ? 0 : rng() % 8);
+    im->base_size = (size_t)im->lsize * height;
+
+    data = malloc(im->base_size + 8);
+    for (i = 0; i < (int)im->base_size + 8; i++) {
+        data[i] = rng();
+    }
+    im->base = data;
+    return data;
+}
+
+/*
+ * Whether the asset reads back as what the LOADBLOCK of ref's chain would
+ * see, and guLoadTextureBlockMipMapBaked loads it as the runtime loads the
+ * image: 1 if so, 0 if not, -1 if the chain is too big to pack.
+ */
+static int check_asset(const MipChain* fast, const MipChain* ref, const MipImage* im, const char** error) {
+    size_t size = mip_asset_size(fast);
+    uint8_t* asset = malloc(size);
+    MipChain back;
+    size_t i;
+    int fmt, siz, ok;
+
+    if (mip_pack_asset(fast, im->fmt, im->siz, asset, error) < 0) {
+        free(asset);
+        return -1;
+    }
+    if (mip_unpack_asset(asset, size, &back, &fmt, &siz, error) < 0) {
+        free(asset);
+        return 0;
+    }
+    ok = fmt == im->fmt && siz == im->siz && back.level == ref->level && back.length == ref->length &&
+         back.err == ref->err && back.load_size == ref->load_size &&
+         !memcmp(back.tiles, ref->tiles, sizeof(back.tiles[0]) * (ref->level + 1));
+    for (i = 0; ok && i < back.load_size; i++) {
+        ok = back.tmem[i] == (i < ref->size ? ref->tmem[i] : 0);
+    }
+    if (!ok) {
+        *error = "the asset doesn't read back as the chain";
+    } else if (mip_check_baked(im, asset, size, error) != 1) {
+        ok = 0;
+    }
+    free(asset);
+    return ok;
+}
+
+static int check_kernels(MipKernelLevel level, int cases) {
+    const MipKernels* k = mip_kernels(level);
+    int failures = 0, built = 0, refused = 0, ran_out = 0, unpacked = 0, format, n, w, h, r, f, a = 1;
+    const char *error, *ref_error;
+    MipChain fast, ref;
+    MipImage im;
+    uint8_t* data;
+
+    for (n = 0; n < cases; n++) {
+        format = n % FORMATS;
+        switch (rng() % 4) {
+            case 0:
+                w = 1 << (rng() % 9);
+                h = 1 << (rng() % 9);
+                break;
+            case 1:
+                w = 1 + rng() % 3;
+                h = 1 + rng() % 80;
+                break;
+            default:
+                w = 1 + rng() % 80;
+                h = 1 + rng() % 80;
+                break;
+        }
+        data = random_image(&im, format, w, h);
+
+        r = mip_build_runtime(&im, &ref, &ref_error);
+        f = mip_build(&im, k, &fast, &error);
+        if (r != f) {
+            printf("  %s %dx%d at %d,%d: the runtime's loop %s, this one %s\n", formats[format].name, w, h, im.s,
+                   im.t, r < 0 ? ref_error : "built it", f < 0 ? error : "built it");
+            failures++;
+        } else if (r < 0) {
+            refused++;
+        } else if (!mip_same_chain(&fast, &ref, &error) || (a = check_asset(&fast, &ref, &im, &error)) == 0) {
+            printf("  %s %dx%d at %d,%d%s%s: %s\n", formats[format].name, w, h, im.s, im.t, im.cfs ? " clamp-s" : "",
+                   im.cft ? " clamp-t" : "", error);
+            failures++;
+        } else {
+            built++;
+            ran_out += ref.err;
+            unpacked += a < 0;
+        }
+        mip_free_chain(&fast);
+        mip_free_chain(&ref);
+        free(data);
+    }
+
+    printf("%-6s kernels: %s (%d built, %d of them out of TMEM, %d too big to pack; %d the runtime can't)\n",
+           mip_kernels_name(level), failures ? "MISMATCH" : "match the runtime's loop", built, ran_out, unpacked,
+           refused);
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    int cases = 4000, rounds = 1000, failures = 0, level, i, n;
+    const char* error;
+    double start, ref_time[sizeof(shapes) / sizeof(shapes[0])], t;
+    MipChain mc;
+    MipImage im;
+    uint8_t* images[sizeof(shapes) / sizeof(shapes[0])];
+    uint32_t seed;
+
+    for (i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--cases") == 0) {
+            cases = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--rounds") == 0) {
+            rounds = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            rng_state = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: mipbench [--cases n] [--rounds n] [--seed n]\n");
+            return 1;
+        }
+    }
+    if (cases < 1 || rounds < 1) {
+        fprintf(stderr, "mipbench: at least one case and one round\n");
+        return 1;
+    }
+
+    seed = rng_state;
+    for (level = 0; level < MIP_KERNELS_COUNT; level++) {
+        if (mip_kernels((MipKernelLevel)level) == NULL) {
+            printf("%-6s kernels: not supported here\n", mip_kernels_name((MipKernelLevel)level));
+            continue;
+        }
+        /* The same cases for each set */
+        rng_state = seed;
+        failures += check_kernels((MipKernelLevel)level, cases);
+    }
+
+    printf("\n%d builds of each, microseconds per chain\n%-12s %9s", rounds, "texture", "runtime");
+    for (level = 0; level < MIP_KERNELS_COUNT; level++) {
+        if (mip_kernels((MipKernelLevel)level) != NULL) {
+            printf(" %9s", mip_kernels_name((MipKernelLevel)level));
+        }
+    }
+    printf("\n");
+
+    for (i = 0; i < (int)(sizeof(shapes) / sizeof(shapes[0])); i++) {
+        char label[32];
+
+        images[i] = random_image(&im, shapes[i].format, shapes[i].w, shapes[i].h);
+        im.s = im.t = im.addr = 0;
+        snprintf(label, sizeof(label), "%dx%d %s", shapes[i].w, shapes[i].h, formats[shapes[i].format].name);
+
+        start = now();
+        for (n = 0; n < rounds; n++) {
+            if (mip_build_runtime(&im, &mc, &error) < 0) {
+                fprintf(stderr, "mipbench: %s: %s\n", label, error);
+                return 1;
+            }
+            mip_free_chain(&mc);
+        }
+        ref_time[i] = (now() - start) / rounds;
+        printf("%-12s %9.2f", label, ref_time[i] * 1e6);
+
+        for (level = 0; level < MIP_KERNELS_COUNT; level++) {
+            const MipKernels* k = mip_kernels((MipKernelLevel)level);
+
+            if (k == NULL) {
+                continue;
+            }
+            start = now();
+            for (n = 0; n < rounds; n++) {
+                mip_build(&im, k, &mc, &error);
+                mip_free_chain(&mc);
+            }
+            t = (now() - start) / rounds;
+            printf(" %9.2f", t * 1e6);
+        }
+        printf("\n");
+        free(images[i]);
+    }
+
+    return failures ? 1 : 0;
+}
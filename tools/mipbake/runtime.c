@@ -0,0 +1,159 @@
+/*
+ * guLoadTextureBlockMipMap itself, from libultra's loadtextureblockmipmap.c.
+ * The Makefile builds it from a copy, loadtextureblockmipmap_be.c, that
+ * differs in two ways only. Its two 16-bit stores go through BESTORE, so
+ * tbuf gets the N64's byte order. tbuf's addresses are cast to long rather
+ * than int, so they keep all 64 bits. Everything else is the runtime's:
+ * the top level's copy, get3x3, the float kernel and its statics, which
+ * this file reads the chain back from. It's built with GU_MIPMAP_BAKED, so
+ * guLoadTextureBlockMipMapBaked can be checked against it too.
+ */
+#define BESTORE(p, v) ((p)[0] = (v) >> 8, (p)[1] = (v))
+
+#include "loadtextureblockmipmap_be.c"
+
+#include <stdlib.h>
+
+#include "mipbake.h"
+
+/* stuffDisplayList's texture image; only the TMEM image is kept */
+u32 osVirtualToPhysical(void* addr) {
+    return 0;
+}
+
+int mip_build_runtime(const MipImage* im, MipChain* mc, const char** error) {
+    Gfx gfx[4 + 2 * (MM_MAX_LEVEL + 1)];
+    Gfx* gl = gfx;
+    MipChain levels;
+    Image image;
+    size_t i;
+    int l, r, txl, sh;
+
+    /* Checks the image and sizes tbuf as the other builders do */
+    if (mip_start(im, mc, error) < 0) {
+        return -1;
+    }
+    for (i = 0; i < mc->capacity; i++) {
+        mc->tmem[i] = 0;
+    }
+    mc->size = 0;
+
+    /* The runtime would index past mipmap[] where the bookkeeping says so */
+    levels = *mc;
+    while ((r = mip_next_level(im, &levels, &txl, &sh, error)) > 0) {
+    }
+    if (r < 0) {
+        return -1;
+    }
+
+    image.base = (unsigned char*)im->base;
+    image.fmt = im->fmt;
+    image.siz = im->siz;
+    image.xsize = image.ysize = 0;
+    image.lsize = im->lsize;
+    image.addr = im->addr;
+    image.w = im->w;
+    image.h = im->h;
+    image.s = im->s;
+    image.t = im->t;
+
+    /* errNo is only ever set, never cleared */
+    errNo = 0;
+    r = guLoadTextureBlockMipMap(&gl, mc->tmem, &image, 0, 0, G_TX_WRAP, G_TX_WRAP, 0, 0, 0, 0, im->cfs, im->cft);
+    if (r == 2) {
+        *error = "the runtime doesn't support the format (it returns 2)";
+        return -1;
+    }
+
+    for (l = 0; l <= level; l++) {
+        mc->tiles[l].w = mipmap[l].w;
+        mc->tiles[l].s = mipmap[l].s;
+        mc->tiles[l].t = mipmap[l].t;
+        mc->tiles[l].addr = mipmap[l].addr;
+    }
+    mc->level = level;
+    mc->length = length;
+    mc->err = r;
+    for (i = mc->capacity; i > 0 && mc->tmem[i - 1] == 0; i--) {
+    }
+    mc->size = i;
+    mip_finish(im, mc);
+    return 0;
+}
+
+static u32 be16(const uint8_t* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static u32 be32(const uint8_t* p) {
+    return ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+int mip_check_baked(const MipImage* im, const uint8_t* asset, size_t size, const char** error) {
+    Gfx gfx[4 + 2 * (MM_MAX_LEVEL + 1)], baked_gfx[4 + 2 * (MM_MAX_LEVEL + 1)];
+    Gfx *gl = gfx, *baked_gl = baked_gfx;
+    GuMipMapBaked* mm;
+    uint8_t* texels;
+    MipChain mc;
+    Image image;
+    size_t i;
+    int r, baked_r, ok;
+
+    if (mip_start(im, &mc, error) < 0) {
+        return -1;
+    }
+    for (i = 0; i < mc.capacity; i++) {
+        mc.tmem[i] = 0;
+    }
+
+    /* The header as the N64 reads it; the texels are already in its order */
+    mm = malloc(sizeof(GuMipMapBaked) + size - MIP_ASSET_HEADER_SIZE);
+    mm->magic = be32(asset);
+    mm->fmt = asset[4];
+    mm->siz = asset[5];
+    mm->level = asset[6];
+    mm->err = asset[7];
+    mm->length = be32(asset + 8);
+    for (i = 0; i <= MM_MAX_LEVEL; i++) {
+        mm->tile[i].w = be16(asset + 12 + i * 8);
+        mm->tile[i].s = be16(asset + 14 + i * 8);
+        mm->tile[i].t = be16(asset + 16 + i * 8);
+        mm->tile[i].addr = be16(asset + 18 + i * 8);
+    }
+    mm->size = be32(asset + 76);
+    texels = (uint8_t*)(mm + 1);
+    for (i = 0; i < size - MIP_ASSET_HEADER_SIZE; i++) {
+        texels[i] = asset[MIP_ASSET_HEADER_SIZE + i];
+    }
+
+    image.base = (unsigned char*)im->base;
+    image.fmt = im->fmt;
+    image.siz = im->siz;
+    image.xsize = image.ysize = 0;
+    image.lsize = im->lsize;
+    image.addr = im->addr;
+    image.w = im->w;
+    image.h = im->h;
+    image.s = im->s;
+    image.t = im->t;
+
+    /* A tile, palette, clamps, masks and shifts other than the defaults */
+    errNo = 0;
+    r = guLoadTextureBlockMipMap(&gl, mc.tmem, &image, 2, 1, G_TX_CLAMP, G_TX_MIRROR, 5, 4, 1, 2, im->cfs, im->cft);
+    errNo = 0;
+    baked_r = guLoadTextureBlockMipMapBaked(&baked_gl, mm, 2, 1, G_TX_CLAMP, G_TX_MIRROR, 5, 4, 1, 2);
+
+    ok = r == baked_r && gl - gfx == baked_gl - baked_gfx && mm->size <= mc.capacity;
+    for (i = 0; ok && i < (size_t)(gl - gfx); i++) {
+        ok = gfx[i].words.w0 == baked_gfx[i].words.w0 && gfx[i].words.w1 == baked_gfx[i].words.w1;
+    }
+    for (i = 0; ok && i < mm->size; i++) {
+        ok = mc.tmem[i] == texels[i];
+    }
+    if (!ok) {
+        *error = "the baked load doesn't stuff what the runtime does";
+    }
+    free(mm);
+    mip_free_chain(&mc);
+    return ok;
+}
@@ -0,0 +1,272 @@
+/*
+ * libultra/nusys stand-ins for running src/overlay_manager.c on the host.
+ * Nothing here touches hardware: data moves immediately and each call only
+ * charges its modelled cost to the harness clock. PI completions are held
+ * back until the clock reaches them, so polling sees the same ordering the
+ * PI manager would give.
+ */
+#include "ultra64.h"
+#include "overlay_manager.h"
+#include "harness.h"
+
+#define PENDING_MAX 64
+
+typedef struct {
+    HarnessTicks done;
+    OSMesgQueue* queue;
+    OSMesg msg;
+} PendingDma;
+
+u32 D_8012CFC0[64];
+s32 D_800B67F0;
+u8 D_800FC858[64];
+s8 D_800D2930[64];
+s8 debug_mode;
+
+OSPiHandle* nuPiCartHandle;
+
+static PendingDma pending[PENDING_MAX];
+static int pending_count;
+
+void func_80080DCC(void) {
+}
+
+void func_801FD624(void) {
+}
+
+bool flag_is_set(u32 index) {
+    return index == 0x4D && harness_quiet();
+}
+
+void osSyncPrintf(const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    harness_vlog(fmt, args);
+    va_end(args);
+}
+
+void bzero(void* ptr, int size) {
+    __builtin_memset(ptr, 0, size);
+    harness_mem_bytes(size, 0);
+}
+
+void bcopy(const void* src, void* dst, int size) {
+    __builtin_memmove(dst, src, size);
+    harness_mem_bytes(size, 1);
+}
+
+u32 osGetCount(void) {
+    return (u32)harness_now();
+}
+
+u32 osVirtualToPhysical(void* addr) {
+    return harness_physical(addr);
+}
+
+static u32 dcache_lines(void* addr, s32 size) {
+    u32 start = harness_physical(addr) & ~DCACHE_LINEMASK;
+    u32 end = (harness_physical(addr) + size + DCACHE_LINEMASK) & ~DCACHE_LINEMASK;
+
+    return (end - start) / DCACHE_LINESIZE;
+}
+
+void osWritebackDCacheAll(void) {
+    harness_dcache_lines(DCACHE_SIZE / DCACHE_LINESIZE, 1);
+}
+
+/* Like the real routines, sizes of a whole cache or more become index ops over every line */
+void osWritebackDCache(void* addr, s32 size) {
+    if (size <= 0) {
+        return;
+    }
+    if (size >= DCACHE_SIZE) {
+        harness_dcache_lines(DCACHE_SIZE / DCACHE_LINESIZE, 1);
+    } else {
+        harness_dcache_lines(dcache_lines(addr, size), 0);
+    }
+}
+
+void osInvalDCache(void* addr, s32 size) {
+    osWritebackDCache(addr, size);
+}
+
+void osInvalICache(void* addr, s32 size) {
+    u32 start;
+    u32 end;
+
+    if (size <= 0) {
+        return;
+    }
+    if (size >= ICACHE_SIZE) {
+        harness_icache_lines(ICACHE_SIZE / ICACHE_LINESIZE, 1);
+        return;
+    }
+    start = harness_physical(addr) & ~ICACHE_LINEMASK;
+    end = (harness_physical(addr) + size + ICACHE_LINEMASK) & ~ICACHE_LINEMASK;
+    harness_icache_lines((end - start) / ICACHE_LINESIZE, 0);
+}
+
+/* Same 16KB blocking as nusys */
+void nuPiReadRom(u32 rom_addr, void* buf_ptr, u32 size) {
+    u32 read_size;
+
+    osInvalDCache(buf_ptr, size);
+
+    while (size != 0) {
+        read_size = size > 0x4000 ? 0x4000 : size;
+        harness_wait_until(harness_pi_read(rom_addr, buf_ptr, read_size));
+        rom_addr += read_size;
+        buf_ptr = (u8*)buf_ptr + read_size;
+        size -= read_size;
+    }
+}
+
+void osCreateMesgQueue(OSMesgQueue* mq, OSMesg* msg, s32 count) {
+    mq->mtqueue = NULL;
+    mq->fullqueue = NULL;
+    mq->validCount = 0;
+    mq->first = 0;
+    mq->msgCount = count;
+    mq->msg = msg;
+}
+
+s32 osSendMesg(OSMesgQueue* mq, OSMesg msg, s32 flag) {
+    if (mq->validCount >= mq->msgCount) {
+        return -1;
+    }
+    mq->msg[(mq->first + mq->validCount) % mq->msgCount] = msg;
+    mq->validCount++;
+    return 0;
+}
+
+static void deliver_due(void) {
+    int i;
+
+    while (pending_count != 0 && pending[0].done <= harness_now()) {
+        osSendMesg(pending[0].queue, pending[0].msg, OS_MESG_NOBLOCK);
+        for (i = 1; i < pending_count; i++) {
+            pending[i - 1] = pending[i];
+        }
+        pending_count--;
+    }
+}
+
+s32 osRecvMesg(OSMesgQueue* mq, OSMesg* msg, s32 flag) {
+    int i;
+
+    deliver_due();
+
+    while (mq->validCount == 0) {
+        if (flag == OS_MESG_NOBLOCK) {
+            return -1;
+        }
+        for (i = 0; i < pending_count && pending[i].queue != mq; i++) {
+        }
+        if (i == pending_count) {
+            /* Nothing will ever arrive; a real thread would hang here */
+            return -1;
+        }
+        harness_wait_until(pending[i].done);
+        deliver_due();
+    }
+
+    if (msg != NULL) {
+        *msg = mq->msg[mq->first];
+    }
+    mq->first = (mq->first + 1) % mq->msgCount;
+    mq->validCount--;
+    return 0;
+}
+
+s32 osEPiStartDma(OSPiHandle* handle, OSIoMesg* mb, s32 direction) {
+    if (pending_count == PENDING_MAX) {
+        return -1;
+    }
+    pending[pending_count].done = harness_pi_read(mb->devAddr, mb->dramAddr, mb->size);
+    pending[pending_count].queue = mb->hdr.retQueue;
+    pending[pending_count].msg = (OSMesg)mb;
+    pending_count++;
+    return 0;
+}
+
+int bridge_enhanced(void) {
+#ifdef ENHANCEMENTS
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+void bridge_set_overlay(int index, unsigned int rom_start, unsigned int rom_end, void* start, void* data, void* bss,
+                        void* end, signed char* modules) {
+    MGOverlayInfo* overlay = &overlays[index];
+
+    overlay->active = false;
+    overlay->unk_0x4 = modules;
+    overlay->rom_start_addr = rom_start;
+    overlay->rom_end_addr = rom_end;
+    overlay->overlay_start_addr = start;
+    overlay->data_start_addr = data;
+    overlay->bss_start_addr = bss;
+    overlay->overlay_end_addr = end;
+    overlay->constructor = harness_constructor;
+    overlay->destructor = harness_constructor;
+}
+
+void bridge_init(void) {
+    func_80025D8C();
+}
+
+int bridge_load(int set) {
+    return load_overlay(set);
+}
+
+void bridge_unload(int set) {
+    unload_overlay(set);
+}
+
+int bridge_prefetch(int set) {
+#ifdef ENHANCEMENTS
+    return overlay_prefetch(set);
+#else
+    return 0;
+#endif
+}
+
+/* 0 if refused, 1 if pending, 2 if it already completed */
+int bridge_load_async(int set) {
+#ifdef ENHANCEMENTS
+    s32 state;
+
+    if (!load_overlay_async(set, NULL, NULL)) {
+        return 0;
+    }
+    state = overlay_load_poll();
+    return (state == OVERLAY_LOAD_IDLE || state == OVERLAY_LOAD_COMPLETE) ? 2 : 1;
+#else
+    return load_overlay(set) ? 2 : 0;
+#endif
+}
+
+int bridge_poll(void) {
+#ifdef ENHANCEMENTS
+    return overlay_load_poll() == OVERLAY_LOAD_COMPLETE;
+#else
+    return 0;
+#endif
+}
+
+void bridge_frame(void) {
+    D_800B67F0++;
+}
+
+void bridge_rdp(int module) {
+    D_8012CFC0[module & 0x3F] = D_800B67F0;
+}
+
+void bridge_residency_init(void* base, unsigned int size) {
+#ifdef ENHANCEMENTS
+    overlay_residency_init(base, size);
+#endif
+}
@@ -0,0 +1,526 @@
+/*
+ * ovlharness: replays module set transitions through src/overlay_manager.c
+ * on the host, against a memory-mapped ROM image.
+ *
+ *   ovlharness[_enh] [options] <rom.z64> <layout> <sequence>
+ *
+ * ovlharness is built from the matching code, ovlharness_enh with
+ * ENHANCEMENTS, so the same sequence can be compared across both.
+ *
+ * Layout: one line per set,
+ *   <index> <rom_start> <rom_end> <vram_start> <data_start> <bss_start> <vram_end> [module...]
+ * or "table <rom_offset> [vram_delta]" to read the 17 MGOverlayInfo entries
+ * (and their module lists, at vram - vram_delta) straight out of the ROM.
+ *
+ * Sequence: one command per line, sets given as logical numbers (0x100+):
+ *   load <set>       load_overlay
+ *   unload <set>     unload_overlay
+ *   async <set>      load_overlay_async, completed by the polls in "frame"
+ *   prefetch <set>   overlay_prefetch
+ *   rdp <module>     the module issued an RDP request this frame
+ *   frame [count]    poll, then sleep to the next vblank
+ *   drain            run frames until the pending async load completes
+ *
+ * Only the stubs charge time: PI transfers, bzero/bcopy, cache maintenance
+ * lines and a fixed constructor/destructor cost. CPU work inside the overlay
+ * manager itself (e.g. decoding packed sets) is not modelled; tools/ovlpack's
+ * ovlbench covers that.
+ */
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "harness.h"
+
+#define SET_COUNT     17
+#define MODULE_COUNT  64
+#define RDRAM_BASE    0x80000000u
+#define RDRAM_SIZE    0x800000u
+#define RESIDENCY_SIZE 0x100000u
+
+typedef struct {
+    double pi_ticks_per_byte;
+    double pi_overhead;
+    double bzero_ticks_per_byte;
+    double copy_ticks_per_byte;
+    double dcache_line_ticks;
+    double icache_line_ticks;
+    double call_ticks;
+    double frame_ticks;
+} Model;
+
+typedef struct {
+    unsigned int loads;
+    unsigned int rejects;
+    HarnessTicks total;
+    HarnessTicks min;
+    HarnessTicks max;
+    unsigned long long bytes;
+} SetStats;
+
+static Model model;
+static int verbose;
+
+static const unsigned char* rom;
+static size_t rom_size;
+static unsigned char* rdram;
+
+static HarnessTicks now;
+static HarnessTicks pi_free;
+static double charge_carry;
+
+static unsigned long long pi_bytes;
+static unsigned int pi_requests;
+static HarnessTicks pi_busy;
+static unsigned int dcache_full;
+static unsigned long long dcache_lines;
+static unsigned int icache_full;
+static unsigned long long icache_lines;
+static unsigned long long mem_bytes;
+
+static signed char modules[SET_COUNT][MODULE_COUNT + 1];
+static unsigned int set_rom_size[SET_COUNT];
+static SetStats stats[SET_COUNT];
+
+static unsigned long frame_index;
+static unsigned int frames;
+static unsigned int hitches;
+static int async_set = -1;
+static HarnessTicks async_start;
+
+HarnessTicks harness_now(void) {
+    return now;
+}
+
+void harness_charge(double ticks) {
+    charge_carry += ticks;
+    now += (HarnessTicks)charge_carry;
+    charge_carry -= (HarnessTicks)charge_carry;
+}
+
+void harness_wait_until(HarnessTicks when) {
+    if (when > now) {
+        now = when;
+    }
+}
+
+HarnessTicks harness_pi_read(unsigned int rom_addr, void* dst, unsigned int size) {
+    HarnessTicks start = pi_free > now ? pi_free : now;
+    HarnessTicks length = (HarnessTicks)(model.pi_overhead + size * model.pi_ticks_per_byte);
+
+    if ((size_t)rom_addr + size > rom_size) {
+        fprintf(stderr, "ovlharness: PI read 0x%X+0x%X is past the end of the ROM\n", rom_addr, size);
+        exit(1);
+    }
+    memcpy(dst, rom + rom_addr, size);
+
+    pi_free = start + length;
+    pi_busy += length;
+    pi_bytes += size;
+    pi_requests++;
+    return pi_free;
+}
+
+void harness_dcache_lines(unsigned int lines, int full) {
+    dcache_full += full;
+    dcache_lines += lines;
+    harness_charge(lines * model.dcache_line_ticks);
+}
+
+void harness_icache_lines(unsigned int lines, int full) {
+    icache_full += full;
+    icache_lines += lines;
+    harness_charge(lines * model.icache_line_ticks);
+}
+
+void harness_mem_bytes(unsigned int bytes, int is_copy) {
+    mem_bytes += bytes;
+    harness_charge(bytes * (is_copy ? model.copy_ticks_per_byte : model.bzero_ticks_per_byte));
+}
+
+void harness_constructor(void) {
+    harness_charge(model.call_ticks);
+}
+
+void harness_vlog(const char* fmt, va_list args) {
+    if (verbose) {
+        vprintf(fmt, args);
+    }
+}
+
+int harness_quiet(void) {
+    return !verbose;
+}
+
+unsigned int harness_physical(void* addr) {
+    return (unsigned int)((unsigned char*)addr - rdram);
+}
+
+static void* vram_to_host(unsigned int vram) {
+    if (vram < RDRAM_BASE || vram > RDRAM_BASE + RDRAM_SIZE) {
+        fprintf(stderr, "ovlharness: vram 0x%08X is outside RDRAM\n", vram);
+        exit(1);
+    }
+    return rdram + (vram - RDRAM_BASE);
+}
+
+static unsigned int read32(size_t offset) {
+    if (offset + 4 > rom_size) {
+        fprintf(stderr, "ovlharness: table read past the end of the ROM\n");
+        exit(1);
+    }
+    return (unsigned int)rom[offset] << 24 | (unsigned int)rom[offset + 1] << 16 | (unsigned int)rom[offset + 2] << 8 |
+           rom[offset + 3];
+}
+
+static void set_overlay(int index, unsigned int rom_start, unsigned int rom_end, unsigned int start,
+                        unsigned int data, unsigned int bss, unsigned int end) {
+    set_rom_size[index] = rom_end - rom_start;
+    bridge_set_overlay(index, rom_start, rom_end, vram_to_host(start), vram_to_host(data), vram_to_host(bss),
+                       vram_to_host(end), modules[index]);
+}
+
+/* The MGOverlayInfo array as the game has it in ROM */
+static void load_table(size_t table, unsigned int vram_delta) {
+    size_t entry;
+    size_t list;
+    int index;
+    int i;
+
+    for (index = 0; index < SET_COUNT; index++) {
+        entry = table + index * 0x28;
+        list = read32(entry + 0x4) - vram_delta;
+        for (i = 0; i < MODULE_COUNT && list + i < rom_size && rom[list + i] != 0xFF; i++) {
+            modules[index][i] = rom[list + i];
+        }
+        modules[index][i] = -1;
+        set_overlay(index, read32(entry + 0x8), read32(entry + 0xC), read32(entry + 0x10), read32(entry + 0x14),
+                    read32(entry + 0x18), read32(entry + 0x1C));
+    }
+}
+
+static void load_layout(const char* path) {
+    FILE* f = fopen(path, "r");
+    char line[512];
+    int line_no = 0;
+
+    if (f == NULL) {
+        fprintf(stderr, "ovlharness: can't open %s\n", path);
+        exit(1);
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char* cursor = line;
+        char* next;
+        unsigned long fields[7];
+        int count = 0;
+        int index;
+
+        line_no++;
+        if (strchr(line, '#') != NULL) {
+            *strchr(line, '#') = '\0';
+        }
+        if (strncmp(line, "table", 5) == 0) {
+            unsigned long table = strtoul(line + 5, &next, 0);
+            unsigned long delta = strtoul(next, NULL, 0);
+
+            load_table(table, delta != 0 ? (unsigned int)delta : 0x80024C00u);
+            continue;
+        }
+
+        while (count < 7) {
+            fields[count] = strtoul(cursor, &next, 0);
+            if (next == cursor) {
+                break;
+            }
+            cursor = next;
+            count++;
+        }
+        if (count == 0) {
+            continue;
+        }
+        if (count != 7 || fields[0] >= SET_COUNT) {
+            fprintf(stderr, "ovlharness: %s:%d: bad layout line\n", path, line_no);
+            exit(1);
+        }
+
+        index = (int)fields[0];
+        count = 0;
+        while (count < MODULE_COUNT) {
+            unsigned long module = strtoul(cursor, &next, 0);
+
+            if (next == cursor) {
+                break;
+            }
+            modules[index][count++] = (signed char)(module & 0x3F);
+            cursor = next;
+        }
+        modules[index][count] = -1;
+
+        set_overlay(index, fields[1], fields[2], fields[3], fields[4], fields[5], fields[6]);
+    }
+
+    fclose(f);
+}
+
+static void record(int set, HarnessTicks latency) {
+    SetStats* s = &stats[set & 0xFF];
+
+    if (s->loads == 0 || latency < s->min) {
+        s->min = latency;
+    }
+    if (latency > s->max) {
+        s->max = latency;
+    }
+    s->total += latency;
+    s->bytes += set_rom_size[set & 0xFF];
+    s->loads++;
+}
+
+static void frame(void) {
+    if (async_set >= 0 && bridge_poll()) {
+        record(async_set, now - async_start);
+        async_set = -1;
+    }
+
+    frame_index++;
+    if (now > (HarnessTicks)(frame_index * model.frame_ticks)) {
+        hitches++;
+        frame_index = (unsigned long)(now / model.frame_ticks) + 1;
+    }
+    harness_wait_until((HarnessTicks)(frame_index * model.frame_ticks));
+    frames++;
+    bridge_frame();
+}
+
+static int parse_set(const char* arg) {
+    long set = strtol(arg, NULL, 0);
+
+    if (set < 0x100 || set >= 0x100 + SET_COUNT) {
+        fprintf(stderr, "ovlharness: bad module set 0x%lX\n", set);
+        exit(1);
+    }
+    return (int)set;
+}
+
+static void replay(const char* path) {
+    FILE* f = fopen(path, "r");
+    char line[256];
+    char cmd[32];
+    char arg[64];
+    int line_no = 0;
+    HarnessTicks start;
+    int fields;
+    int i;
+
+    if (f == NULL) {
+        fprintf(stderr, "ovlharness: can't open %s\n", path);
+        exit(1);
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        if (strchr(line, '#') != NULL) {
+            *strchr(line, '#') = '\0';
+        }
+        arg[0] = '\0';
+        fields = sscanf(line, "%31s %63s", cmd, arg);
+        if (fields <= 0) {
+            continue;
+        }
+
+        if (strcmp(cmd, "load") == 0) {
+            int set = parse_set(arg);
+
+            start = now;
+            if (bridge_load(set)) {
+                record(set, now - start);
+            } else {
+                stats[set & 0xFF].rejects++;
+            }
+        } else if (strcmp(cmd, "unload") == 0) {
+            bridge_unload(parse_set(arg));
+        } else if (strcmp(cmd, "async") == 0) {
+            int set = parse_set(arg);
+
+            start = now;
+            switch (bridge_load_async(set)) {
+                case 0:
+                    stats[set & 0xFF].rejects++;
+                    break;
+                case 1:
+                    async_set = set;
+                    async_start = start;
+                    break;
+                default:
+                    record(set, now - start);
+                    break;
+            }
+        } else if (strcmp(cmd, "prefetch") == 0) {
+            bridge_prefetch(parse_set(arg));
+        } else if (strcmp(cmd, "rdp") == 0) {
+            bridge_rdp((int)strtol(arg, NULL, 0));
+        } else if (strcmp(cmd, "frame") == 0) {
+            int count = fields > 1 ? atoi(arg) : 1;
+
+            for (i = 0; i < count; i++) {
+                frame();
+            }
+        } else if (strcmp(cmd, "drain") == 0) {
+            for (i = 0; i < 600 && async_set >= 0; i++) {
+                frame();
+            }
+        } else {
+            fprintf(stderr, "ovlharness: %s:%d: unknown command %s\n", path, line_no, cmd);
+            exit(1);
+        }
+    }
+
+    fclose(f);
+}
+
+static double ms(HarnessTicks ticks) {
+    return ticks * 1000.0 / HARNESS_COUNTER_HZ;
+}
+
+static void report(void) {
+    unsigned int loads = 0;
+    unsigned int rejects = 0;
+    HarnessTicks total = 0;
+    int i;
+
+    printf("%s build\n", bridge_enhanced() ? "ENHANCEMENTS" : "matching");
+    printf("%-5s %6s %7s %9s %9s %9s %10s %8s\n", "set", "loads", "rejects", "avg ms", "min ms", "max ms", "bytes",
+           "MB/s");
+    for (i = 0; i < SET_COUNT; i++) {
+        SetStats* s = &stats[i];
+
+        if (s->loads == 0 && s->rejects == 0) {
+            continue;
+        }
+        printf("0x%03X %6u %7u %9.3f %9.3f %9.3f %10llu %8.2f\n", 0x100 + i, s->loads, s->rejects,
+               s->loads ? ms(s->total) / s->loads : 0.0, ms(s->min), ms(s->max), s->bytes,
+               s->total ? s->bytes / (ms(s->total) * 1000.0) : 0.0);
+        loads += s->loads;
+        rejects += s->rejects;
+        total += s->total;
+    }
+
+    printf("\nloads %u, conflict rejections %u, total load latency %.3f ms\n", loads, rejects, ms(total));
+    printf("PI: %llu bytes in %u requests, busy %.3f ms (%.2f MB/s while busy)\n", pi_bytes, pi_requests, ms(pi_busy),
+           pi_busy ? pi_bytes / (ms(pi_busy) * 1000.0) : 0.0);
+    printf("D-cache: %u whole-cache ops, %llu lines; I-cache: %u whole-cache ops, %llu lines\n", dcache_full,
+           dcache_lines, icache_full, icache_lines);
+    printf("bzero/bcopy: %llu bytes\n", mem_bytes);
+    printf("frames %u, over budget %u, simulated time %.3f ms\n", frames, hitches, ms(now));
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: ovlharness [options] <rom.z64> <layout> <sequence>\n"
+                    "  --pi-bw N        PI bandwidth, bytes/s (default 5000000)\n"
+                    "  --pi-overhead N  per-request PI setup, usec (default 0)\n"
+                    "  --bzero N        bzero cost, ticks/byte (default 0.5)\n"
+                    "  --copy N         bcopy cost, ticks/byte (default 1)\n"
+                    "  --line N         cost per cache line op, ticks (default 2)\n"
+                    "  --call N         constructor/destructor cost, usec (default 0)\n"
+                    "  --fps N          frame rate for \"frame\" (default 60)\n"
+                    "  --expansion      give the top 1MB of an 8MB RDRAM to the residency cache\n"
+                    "  -v               print the overlay manager's log\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    const char* paths[3];
+    int path_count = 0;
+    int expansion = 0;
+    struct stat st;
+    int fd;
+    int i;
+
+    model.pi_ticks_per_byte = HARNESS_COUNTER_HZ / 5000000.0;
+    model.pi_overhead = 0.0;
+    model.bzero_ticks_per_byte = 0.5;
+    model.copy_ticks_per_byte = 1.0;
+    model.dcache_line_ticks = 2.0;
+    model.icache_line_ticks = 2.0;
+    model.call_ticks = 0.0;
+    model.frame_ticks = HARNESS_COUNTER_HZ / 60.0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-v") == 0) {
+            verbose = 1;
+        } else if (strcmp(argv[i], "--expansion") == 0) {
+            expansion = 1;
+        } else if (strncmp(argv[i], "--", 2) == 0 && i + 1 < argc) {
+            double value = strtod(argv[i + 1], NULL);
+
+            if (strcmp(argv[i], "--pi-bw") == 0 && value > 0.0) {
+                model.pi_ticks_per_byte = HARNESS_COUNTER_HZ / value;
+            } else if (strcmp(argv[i], "--pi-overhead") == 0) {
+                model.pi_overhead = value * HARNESS_COUNTER_HZ / 1e6;
+            } else if (strcmp(argv[i], "--bzero") == 0) {
+                model.bzero_ticks_per_byte = value;
+            } else if (strcmp(argv[i], "--copy") == 0) {
+                model.copy_ticks_per_byte = value;
+            } else if (strcmp(argv[i], "--line") == 0) {
+                model.dcache_line_ticks = value;
+                model.icache_line_ticks = value;
+            } else if (strcmp(argv[i], "--call") == 0) {
+                model.call_ticks = value * HARNESS_COUNTER_HZ / 1e6;
+            } else if (strcmp(argv[i], "--fps") == 0 && value > 0.0) {
+                model.frame_ticks = HARNESS_COUNTER_HZ / value;
+            } else {
+                usage();
+            }
+            i++;
+        } else if (path_count < 3) {
+            paths[path_count++] = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (path_count != 3) {
+        usage();
+    }
+
+    fd = open(paths[0], O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "ovlharness: can't open %s: %s\n", paths[0], strerror(errno));
+        return 1;
+    }
+    rom_size = st.st_size;
+    rom = mmap(NULL, rom_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (rom == MAP_FAILED) {
+        fprintf(stderr, "ovlharness: can't map %s: %s\n", paths[0], strerror(errno));
+        return 1;
+    }
+    close(fd);
+
+    /* overlay_manager.c round-trips addresses through u32, so RDRAM has to live below 4GB */
+    rdram = mmap(NULL, RDRAM_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (rdram == MAP_FAILED) {
+        fprintf(stderr, "ovlharness: can't map RDRAM: %s\n", strerror(errno));
+        return 1;
+    }
+
+    /* Sets the layout doesn't mention are empty and own no modules */
+    for (i = 0; i < SET_COUNT; i++) {
+        modules[i][0] = -1;
+        set_overlay(i, 0, 0, RDRAM_BASE, RDRAM_BASE, RDRAM_BASE, RDRAM_BASE);
+    }
+    load_layout(paths[1]);
+    bridge_init();
+
+    if (expansion) {
+        bridge_residency_init(rdram + RDRAM_SIZE - RESIDENCY_SIZE, RESIDENCY_SIZE);
+    }
+
+    replay(paths[2]);
+    report();
+    return 0;
+}
@@ -0,0 +1,45 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+#include <stdarg.h>
+
+/*
+ * Interface between harness.c, which only sees the host C library, and
+ * bridge.c, which only sees libultra's headers and links against
+ * src/overlay_manager.c. The two header sets can't share a translation unit
+ * (bzero/bcopy/bool clash), so only plain C types cross this boundary.
+ */
+
+/* Times are in osGetCount ticks (OS_CPU_COUNTER, 46.875MHz) */
+typedef unsigned long long HarnessTicks;
+
+#define HARNESS_COUNTER_HZ 46875000.0
+
+/* bridge.c -> harness.c */
+HarnessTicks harness_now(void);
+void harness_charge(double ticks);
+void harness_wait_until(HarnessTicks when);
+HarnessTicks harness_pi_read(unsigned int rom_addr, void* dst, unsigned int size);
+void harness_dcache_lines(unsigned int lines, int full);
+void harness_icache_lines(unsigned int lines, int full);
+void harness_mem_bytes(unsigned int bytes, int is_copy);
+void harness_constructor(void);
+void harness_vlog(const char* fmt, va_list args);
+int harness_quiet(void);
+unsigned int harness_physical(void* addr);
+
+/* harness.c -> bridge.c */
+int bridge_enhanced(void);
+void bridge_set_overlay(int index, unsigned int rom_start, unsigned int rom_end, void* start, void* data, void* bss,
+                        void* end, signed char* modules);
+void bridge_init(void);
+int bridge_load(int set);
+void bridge_unload(int set);
+int bridge_prefetch(int set);
+int bridge_load_async(int set);
+int bridge_poll(void);
+void bridge_frame(void);
+void bridge_rdp(int module);
+void bridge_residency_init(void* base, unsigned int size);
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * ovlbench: compares raw and packed module set load times.
+ *
+ * Load time is modelled rather than measured: PI DMA runs at a fixed
+ * bandwidth in OVERLAY_DMA_BLOCK_SIZE blocks with up to OVERLAY_DMA_DEPTH
+ * blocks queued, and the VR4300 decode cost is charged per Yaz0 token.
+ * The decoder is replayed with the same "wait for 4 bytes unless this is the
+ * last block" rule as overlay_yaz0_decode, so the overlap of decode and DMA
+ * matches the loader's. Host decode throughput is reported for reference.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "yaz0.h"
+
+typedef struct {
+    double pi_bandwidth; /* bytes per second */
+    double cpu_hz;
+    double literal_cycles;
+    double match_cycles;
+    double copy_cycles; /* per byte copied by a match */
+    size_t block_size;
+    int depth;
+} Model;
+
+typedef struct {
+    size_t src;
+    size_t dst;
+    size_t dst_end;
+    uint8_t group;
+    int group_bits;
+} SimStream;
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    uint8_t* data;
+    long len;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(len > 0 ? len : 1);
+    if (fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+/* Mirrors overlay_yaz0_decode; returns the VR4300 cycles spent */
+static double sim_decode(const Model* model, SimStream* s, const uint8_t* blob, size_t limit, int last) {
+    double cycles = 0.0;
+    uint32_t length;
+
+    while (s->dst < s->dst_end && s->src < limit) {
+        if (!last && limit - s->src < 4) {
+            break;
+        }
+        if (s->group_bits == 0) {
+            s->group = blob[s->src++];
+            s->group_bits = 8;
+        }
+        if (s->group & 0x80) {
+            s->src++;
+            s->dst++;
+            cycles += model->literal_cycles;
+        } else {
+            length = blob[s->src] >> 4;
+            s->src += 2;
+            length = length == 0 ? blob[s->src++] + 0x12u : length + 2;
+            if (length > s->dst_end - s->dst) {
+                length = (uint32_t)(s->dst_end - s->dst);
+            }
+            s->dst += length;
+            cycles += model->match_cycles + model->copy_cycles * length;
+        }
+        s->group <<= 1;
+        s->group_bits--;
+    }
+
+    return cycles;
+}
+
+/* Seconds from the first DMA to the last byte being usable */
+static double sim_load(const Model* model, const uint8_t* blob, size_t size, size_t raw_size, int packed) {
+    size_t blocks = (size + model->block_size - 1) / model->block_size;
+    double* reap = calloc(blocks ? blocks : 1, sizeof(double));
+    double pi_free = 0.0;
+    double cpu = 0.0;
+    double issue;
+    double done;
+    size_t arrived;
+    size_t i;
+    SimStream s;
+
+    s.src = YAZ0_HEADER_SIZE;
+    s.dst = 0;
+    s.dst_end = raw_size;
+    s.group = 0;
+    s.group_bits = 0;
+
+    for (i = 0; i < blocks; i++) {
+        issue = (i < (size_t)model->depth) ? 0.0 : reap[i - model->depth];
+        done = (pi_free > issue ? pi_free : issue) +
+               (double)(i + 1 == blocks ? size - i * model->block_size : model->block_size) / model->pi_bandwidth;
+        pi_free = done;
+
+        reap[i] = cpu > done ? cpu : done;
+        cpu = reap[i];
+
+        if (packed) {
+            arrived = (i + 1) * model->block_size;
+            if (arrived > size) {
+                arrived = size;
+            }
+            cpu += sim_decode(model, &s, blob, arrived, arrived == size) / model->cpu_hz;
+        }
+    }
+
+    free(reap);
+    return cpu;
+}
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double host_decode_rate(const uint8_t* blob, size_t size, size_t raw_size) {
+    uint8_t* out = malloc(raw_size ? raw_size : 1);
+    double start = now();
+    double elapsed;
+    long iterations = 0;
+
+    do {
+        yaz0_decode(blob, size, out, raw_size);
+        iterations++;
+        elapsed = now() - start;
+    } while (elapsed < 0.1);
+
+    free(out);
+    return (double)raw_size * iterations / elapsed;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: ovlbench [options] <raw.bin>...\n"
+                    "  --pi-bw N      PI bandwidth in bytes/s (default 5000000)\n"
+                    "  --cpu-hz N     CPU clock (default 93750000)\n"
+                    "  --lit N        cycles per literal token (default 12)\n"
+                    "  --match N      cycles per match token (default 30)\n"
+                    "  --copy N       cycles per byte copied by a match (default 3)\n"
+                    "  --block N      DMA block size (default 0x4000)\n"
+                    "  --depth N      DMA blocks kept in flight (default 8)\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    Model model = { 5000000.0, 93750000.0, 12.0, 30.0, 3.0, 0x4000, 8 };
+    double total_raw = 0.0;
+    double total_packed = 0.0;
+    size_t total_raw_bytes = 0;
+    size_t total_packed_bytes = 0;
+    int files = 0;
+    int i;
+
+    printf("%-32s %9s %9s %6s %9s %9s %7s %10s\n", "file", "raw", "packed", "ratio", "raw ms", "pack ms", "speedup",
+           "host MB/s");
+
+    for (i = 1; i < argc; i++) {
+        uint8_t* raw;
+        uint8_t* packed;
+        size_t raw_size;
+        size_t packed_size;
+        double raw_time;
+        double packed_time;
+
+        if (strncmp(argv[i], "--", 2) == 0) {
+            if (i + 1 >= argc) {
+                usage();
+            }
+            if (strcmp(argv[i], "--pi-bw") == 0) {
+                model.pi_bandwidth = strtod(argv[++i], NULL);
+            } else if (strcmp(argv[i], "--cpu-hz") == 0) {
+                model.cpu_hz = strtod(argv[++i], NULL);
+            } else if (strcmp(argv[i], "--lit") == 0) {
+                model.literal_cycles = strtod(argv[++i], NULL);
+            } else if (strcmp(argv[i], "--match") == 0) {
+                model.match_cycles = strtod(argv[++i], NULL);
+            } else if (strcmp(argv[i], "--copy") == 0) {
+                model.copy_cycles = strtod(argv[++i], NULL);
+            } else if (strcmp(argv[i], "--block") == 0) {
+                model.block_size = strtoul(argv[++i], NULL, 0);
+            } else if (strcmp(argv[i], "--depth") == 0) {
+                model.depth = atoi(argv[++i]);
+            } else {
+                usage();
+            }
+            if (model.block_size == 0 || model.depth <= 0 || model.pi_bandwidth <= 0.0 || model.cpu_hz <= 0.0) {
+                usage();
+            }
+            continue;
+        }
+
+        raw = read_file(argv[i], &raw_size);
+        if (raw == NULL) {
+            fprintf(stderr, "ovlbench: can't read %s\n", argv[i]);
+            return 1;
+        }
+
+        packed = calloc(1, YAZ0_BOUND(raw_size));
+        packed_size = yaz0_encode(raw, raw_size, packed);
+
+        raw_time = sim_load(&model, raw, raw_size, raw_size, 0);
+        packed_time = sim_load(&model, packed, packed_size, raw_size, 1);
+
+        printf("%-32s %9zu %9zu %5.1f%% %9.3f %9.3f %6.2fx %10.1f\n", argv[i], raw_size, packed_size,
+               100.0 * packed_size / (raw_size ? raw_size : 1), raw_time * 1e3, packed_time * 1e3,
+               packed_time > 0.0 ? raw_time / packed_time : 0.0,
+               host_decode_rate(packed, packed_size, raw_size) / 1e6);
+
+        total_raw += raw_time;
+        total_packed += packed_time;
+        total_raw_bytes += raw_size;
+        total_packed_bytes += packed_size;
+        files++;
+
+        free(raw);
+        free(packed);
+    }
+
+    if (files == 0) {
+        usage();
+    }
+
+    printf("%-32s %9zu %9zu %5.1f%% %9.3f %9.3f %6.2fx\n", "total", total_raw_bytes, total_packed_bytes,
+           100.0 * total_packed_bytes / (total_raw_bytes ? total_raw_bytes : 1), total_raw * 1e3, total_packed * 1e3,
+           total_packed > 0.0 ? total_raw / total_packed : 0.0);
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * ovlpack: packs a module set's ROM image (text+data) as a Yaz0 stream that
+ * the ENHANCEMENTS overlay loader can decode while the DMA is still running.
+ *
+ * The loader stages the packed image at the end of the set's VRAM footprint,
+ * (end - packed_size) & ~0xF, and decodes forwards in place, so a set is only
+ * packed when the decoder can never catch up with input it has not read yet.
+ * Otherwise the raw image is written and the loader takes the plain path.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "yaz0.h"
+
+/* PI DMA lengths are kept a multiple of this */
+#define PACK_ALIGN 8
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    uint8_t* data;
+    long len;
+
+    if (f == NULL) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc(len > 0 ? len : 1);
+    if (fread(data, 1, len, f) != (size_t)len) {
+        free(data);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = len;
+    return data;
+}
+
+/* Smallest footprint for which (footprint - packed_size) & ~0xF leaves enough room */
+static size_t min_footprint(size_t packed_size, size_t distance) {
+    size_t gap = distance > YAZ0_HEADER_SIZE ? distance - YAZ0_HEADER_SIZE : 0;
+
+    return packed_size + ((gap + 0xF) & ~(size_t)0xF);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: ovlpack [-f footprint] <in.bin> <out.bin>\n"
+                    "  -f  size of the set's whole VRAM footprint (text+data+bss, overlay_end - overlay_start).\n"
+                    "      Defaults to the image size, i.e. no bss to stage into.\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    const char* in_path = NULL;
+    const char* out_path = NULL;
+    size_t footprint = 0;
+    uint8_t* raw;
+    uint8_t* packed;
+    size_t raw_size;
+    size_t packed_size;
+    size_t stage;
+    size_t distance;
+    const uint8_t* out;
+    size_t out_size;
+    FILE* f;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) {
+            footprint = strtoul(argv[++i], NULL, 0);
+        } else if (in_path == NULL) {
+            in_path = argv[i];
+        } else if (out_path == NULL) {
+            out_path = argv[i];
+        } else {
+            usage();
+        }
+    }
+    if (out_path == NULL) {
+        usage();
+    }
+
+    raw = read_file(in_path, &raw_size);
+    if (raw == NULL) {
+        fprintf(stderr, "ovlpack: can't read %s\n", in_path);
+        return 1;
+    }
+    if (footprint == 0) {
+        footprint = raw_size;
+    }
+
+    packed = calloc(1, YAZ0_BOUND(raw_size) + PACK_ALIGN);
+    packed_size = yaz0_encode(raw, raw_size, packed);
+    packed_size = (packed_size + PACK_ALIGN - 1) & ~(size_t)(PACK_ALIGN - 1);
+    distance = yaz0_inplace_distance(packed, packed_size);
+
+    out = packed;
+    out_size = packed_size;
+
+    if (packed_size >= raw_size) {
+        fprintf(stderr, "ovlpack: %s: doesn't compress, keeping it raw\n", in_path);
+        out = raw;
+        out_size = raw_size;
+    } else if (footprint < min_footprint(packed_size, distance)) {
+        fprintf(stderr, "ovlpack: %s: needs 0x%zX bytes of footprint to decode in place, has 0x%zX; keeping it raw\n",
+                in_path, min_footprint(packed_size, distance), footprint);
+        out = raw;
+        out_size = raw_size;
+    } else {
+        stage = (footprint - packed_size) & ~(size_t)0xF;
+        printf("%s: 0x%zX -> 0x%zX (%.1f%%), staged at +0x%zX\n", in_path, raw_size, packed_size,
+               100.0 * packed_size / raw_size, stage);
+    }
+
+    f = fopen(out_path, "wb");
+    if (f == NULL || fwrite(out, 1, out_size, f) != out_size) {
+        fprintf(stderr, "ovlpack: can't write %s\n", out_path);
+        return 1;
+    }
+    fclose(f);
+
+    free(raw);
+    free(packed);
+    return 0;
+}
@@ -0,0 +1,294 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "yaz0.h"
+
+#define HASH_BITS 15
+#define HASH_SIZE (1 << HASH_BITS)
+#define MAX_CHAIN 256
+
+typedef struct {
+    const uint8_t* src;
+    size_t size;
+    size_t inserted;
+    int32_t* head;
+    int32_t* prev;
+} Matcher;
+
+static uint32_t hash3(const uint8_t* p) {
+    return (((uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void matcher_advance(Matcher* m, size_t pos) {
+    uint32_t h;
+
+    for (; m->inserted < pos; m->inserted++) {
+        if (m->inserted + YAZ0_MIN_MATCH > m->size) {
+            continue;
+        }
+        h = hash3(m->src + m->inserted);
+        m->prev[m->inserted] = m->head[h];
+        m->head[h] = (int32_t)m->inserted;
+    }
+}
+
+static uint32_t matcher_find(Matcher* m, size_t pos, uint32_t* dist) {
+    size_t max_len = m->size - pos;
+    uint32_t best = 0;
+    int32_t cand;
+    int chain = MAX_CHAIN;
+
+    if (max_len < YAZ0_MIN_MATCH) {
+        return 0;
+    }
+    if (max_len > YAZ0_MAX_MATCH) {
+        max_len = YAZ0_MAX_MATCH;
+    }
+
+    matcher_advance(m, pos);
+
+    for (cand = m->head[hash3(m->src + pos)]; cand >= 0 && pos - (size_t)cand <= YAZ0_WINDOW && chain-- > 0;
+         cand = m->prev[cand]) {
+        const uint8_t* a = m->src + cand;
+        const uint8_t* b = m->src + pos;
+        uint32_t len;
+
+        if (a[best] != b[best]) {
+            continue;
+        }
+        for (len = 0; len < max_len && a[len] == b[len]; len++) {
+        }
+        if (len > best) {
+            best = len;
+            *dist = (uint32_t)(pos - (size_t)cand);
+            if (best == max_len) {
+                break;
+            }
+        }
+    }
+
+    return best >= YAZ0_MIN_MATCH ? best : 0;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+size_t yaz0_encode(const uint8_t* src, size_t size, uint8_t* dst) {
+    Matcher m;
+    size_t pos = 0;
+    size_t out = YAZ0_HEADER_SIZE;
+    size_t group_pos = 0;
+    uint8_t group_mask = 0;
+    uint32_t len;
+    uint32_t dist = 0;
+    uint32_t next_len;
+    uint32_t next_dist;
+
+    m.src = src;
+    m.size = size;
+    m.inserted = 0;
+    m.head = malloc(sizeof(int32_t) * HASH_SIZE);
+    m.prev = malloc(sizeof(int32_t) * (size + 1));
+    memset(m.head, 0xFF, sizeof(int32_t) * HASH_SIZE);
+
+    memcpy(dst, "Yaz0", 4);
+    put32(dst + 4, (uint32_t)size);
+    memset(dst + 8, 0, 8);
+
+    while (pos < size) {
+        if (group_mask == 0) {
+            group_pos = out++;
+            dst[group_pos] = 0;
+            group_mask = 0x80;
+        }
+
+        len = matcher_find(&m, pos, &dist);
+
+        /* One step of lazy matching: a literal now can buy a longer match */
+        if (len != 0 && len < YAZ0_MAX_MATCH && pos + 1 < size) {
+            next_len = matcher_find(&m, pos + 1, &next_dist);
+            if (next_len > len + 1) {
+                len = 0;
+            }
+        }
+
+        if (len == 0) {
+            dst[group_pos] |= group_mask;
+            dst[out++] = src[pos++];
+        } else {
+            dist--;
+            if (len >= 0x12) {
+                dst[out++] = dist >> 8;
+                dst[out++] = dist;
+                dst[out++] = len - 0x12;
+            } else {
+                dst[out++] = ((len - 2) << 4) | (dist >> 8);
+                dst[out++] = dist;
+            }
+            pos += len;
+        }
+
+        group_mask >>= 1;
+    }
+
+    free(m.head);
+    free(m.prev);
+    return out;
+}
+
+uint32_t yaz0_decoded_size(const uint8_t* src) {
+    return (uint32_t)src[4] << 24 | (uint32_t)src[5] << 16 | (uint32_t)src[6] << 8 | src[7];
+}
+
+int yaz0_walk(const uint8_t* src, size_t src_size, Yaz0TokenFunc func, void* user) {
+    size_t in = YAZ0_HEADER_SIZE;
+    size_t out = 0;
+    size_t out_size = yaz0_decoded_size(src);
+    uint8_t group = 0;
+    int group_bits = 0;
+    uint32_t length;
+
+    while (out < out_size) {
+        if (group_bits == 0) {
+            if (in >= src_size) {
+                return -1;
+            }
+            group = src[in++];
+            group_bits = 8;
+        }
+
+        if (group & 0x80) {
+            if (in >= src_size) {
+                return -1;
+            }
+            in++;
+            out++;
+            if (func != NULL) {
+                func(user, in - YAZ0_HEADER_SIZE, out, 0, 1);
+            }
+        } else {
+            if (in + 2 > src_size) {
+                return -1;
+            }
+            if ((size_t)(((src[in] & 0xF) << 8) | src[in + 1]) + 1 > out) {
+                return -1;
+            }
+            length = src[in] >> 4;
+            in += 2;
+            if (length == 0) {
+                if (in >= src_size) {
+                    return -1;
+                }
+                length = src[in++] + 0x12;
+            } else {
+                length += 2;
+            }
+            if (out + length > out_size) {
+                return -1;
+            }
+            out += length;
+            if (func != NULL) {
+                func(user, in - YAZ0_HEADER_SIZE, out, 1, length);
+            }
+        }
+
+        group <<= 1;
+        group_bits--;
+    }
+
+    return 0;
+}
+
+int yaz0_decode(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size) {
+    const uint8_t* in = src + YAZ0_HEADER_SIZE;
+    const uint8_t* in_end = src + src_size;
+    uint8_t* out = dst;
+    uint8_t* out_end;
+    const uint8_t* copy;
+    uint8_t group = 0;
+    int group_bits = 0;
+    uint32_t length;
+
+    if (src_size < YAZ0_HEADER_SIZE || memcmp(src, "Yaz0", 4) != 0 || yaz0_decoded_size(src) > dst_size) {
+        return -1;
+    }
+    out_end = dst + yaz0_decoded_size(src);
+
+    while (out < out_end) {
+        if (group_bits == 0) {
+            if (in >= in_end) {
+                return -1;
+            }
+            group = *in++;
+            group_bits = 8;
+        }
+
+        if (group & 0x80) {
+            if (in >= in_end) {
+                return -1;
+            }
+            *out++ = *in++;
+        } else {
+            if (in + 2 > in_end) {
+                return -1;
+            }
+            copy = out - ((((in[0] & 0xF) << 8) | in[1]) + 1);
+            length = in[0] >> 4;
+            in += 2;
+            if (length == 0) {
+                if (in >= in_end) {
+                    return -1;
+                }
+                length = *in++ + 0x12;
+            } else {
+                length += 2;
+            }
+            if (copy < dst || length > (size_t)(out_end - out)) {
+                return -1;
+            }
+            while (length-- != 0) {
+                *out++ = *copy++;
+            }
+        }
+
+        group <<= 1;
+        group_bits--;
+    }
+
+    return 0;
+}
+
+static void inplace_token(void* user, size_t in_pos, size_t out_pos, int is_match, uint32_t length) {
+    size_t* distance = user;
+
+    if (out_pos > in_pos && out_pos - in_pos > *distance) {
+        *distance = out_pos - in_pos;
+    }
+}
+
+size_t yaz0_inplace_distance(const uint8_t* src, size_t src_size) {
+    size_t distance = 0;
+
+    yaz0_walk(src, src_size, inplace_token, &distance);
+    return distance;
+}
+
+static void stats_token(void* user, size_t in_pos, size_t out_pos, int is_match, uint32_t length) {
+    Yaz0Stats* stats = user;
+
+    if (is_match) {
+        stats->matches++;
+        stats->match_bytes += length;
+    } else {
+        stats->literals++;
+    }
+}
+
+void yaz0_stats(const uint8_t* src, size_t src_size, Yaz0Stats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    yaz0_walk(src, src_size, stats_token, stats);
+}
@@ -0,0 +1,39 @@
+#ifndef YAZ0_H
+#define YAZ0_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define YAZ0_HEADER_SIZE 0x10
+#define YAZ0_WINDOW      0x1000
+#define YAZ0_MIN_MATCH   3
+#define YAZ0_MAX_MATCH   0x111
+
+/* Worst case output size of yaz0_encode */
+#define YAZ0_BOUND(size) (YAZ0_HEADER_SIZE + (size) + ((size) + 7) / 8)
+
+typedef struct {
+    uint32_t literals;
+    uint32_t matches;
+    uint32_t match_bytes;
+} Yaz0Stats;
+
+/* Called by yaz0_walk after every token: bytes of payload consumed (group
+ * headers included) and bytes of output produced so far. */
+typedef void (*Yaz0TokenFunc)(void* user, size_t in_pos, size_t out_pos, int is_match, uint32_t length);
+
+size_t yaz0_encode(const uint8_t* src, size_t size, uint8_t* dst);
+int yaz0_decode(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
+uint32_t yaz0_decoded_size(const uint8_t* src);
+
+/* Replays the token stream without producing output. Returns 0 on success. */
+int yaz0_walk(const uint8_t* src, size_t src_size, Yaz0TokenFunc func, void* user);
+
+/* Smallest distance from the start of the destination at which the payload
+ * (the stream after the header) can be staged so that decoding forwards in
+ * place never overwrites input that has not been read yet. */
+size_t yaz0_inplace_distance(const uint8_t* src, size_t src_size);
+
+void yaz0_stats(const uint8_t* src, size_t src_size, Yaz0Stats* stats);
+
+#endif
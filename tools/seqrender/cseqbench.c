@@ -0,0 +1,504 @@
+/*
+ * cseqbench: reads one compressed sequence three ways and checks they
+ * agree event for event, then times them:
+ *
+ *   literal     the same sequence with no backup sections, through alCSeqNew
+ *   compressed  with backup sections, through alCSeqNew
+ *   cached      with backup sections, through AL_CSEQ_TRACK_CACHE's
+ *               alCSeqNewCached, which decodes each track once
+ *
+ *   cseqbench [--tracks n] [--bars n] [--loops n] [--seed n] [--write file]
+ *
+ * The sequence is made up here: each track repeats a few one bar patterns,
+ * some of them transposed, between a loop start and a loop end, which is
+ * the shape that gives the compressor's backups most to do. Events per
+ * second are the best of a few whole plays, loops included; a seek is an
+ * alCSeqNewMarker three quarters of the way in plus the alCSeqSetLoc, after
+ * which the rest is played and checked too. --write saves the compressed
+ * sequence, header big-endian, as seqrender reads it.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "cseqbench.h"
+
+#define RUNS        5
+#define MAX_TRACKS  16
+#define PATTERNS    4
+#define BAR_TICKS   384         /* 4/4 at 96 ticks per quarter note */
+#define DIVISION    96
+#define MAX_TRACK   0x40000
+
+#define ARENA       ((void*)0x10000000)
+#define ARENA_SIZE  0x1000000u
+#define SEQ_SIZE    0x400000u   /* the rest of the arena is heap */
+
+typedef struct {
+    uint8_t bytes[MAX_TRACK];
+    uint32_t len;
+    uint32_t target;            /* where the loop end jumps back to */
+    uint32_t loop_end;          /* its six byte record */
+    uint8_t status;             /* for running status */
+} Track;
+
+typedef struct {
+    uint8_t bytes[MAX_TRACK];
+    uint8_t no_source[MAX_TRACK];       /* the loop counts change as the track plays */
+    uint32_t len;
+    uint32_t backups;
+} Packed;
+
+typedef struct {
+    uint16_t tick;
+    uint8_t status;             /* channel added when played */
+    uint8_t byte1, byte2;
+    uint32_t duration;
+} PatternEvent;
+
+typedef struct {
+    PatternEvent events[16];
+    int count;
+} Pattern;
+
+static uint32_t rng = 1;
+
+static uint32_t random_next(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void put(Track* t, uint8_t byte) {
+    if (t->len >= MAX_TRACK) {
+        fprintf(stderr, "cseqbench: track too long, use fewer --bars\n");
+        exit(1);
+    }
+    t->bytes[t->len++] = byte;
+}
+
+static void put_varlen(Track* t, uint32_t value) {
+    uint8_t groups[5];
+    int n = 0;
+
+    do {
+        groups[n++] = value & 0x7F;
+        value >>= 7;
+    } while (value);
+    while (n > 1) {
+        put(t, groups[--n] | 0x80);
+    }
+    put(t, groups[0]);
+}
+
+static void put_meta(Track* t, uint32_t delta, uint8_t type) {
+    put_varlen(t, delta);
+    put(t, 0xFF);
+    put(t, type);
+    t->status = 0;
+}
+
+static void put_event(Track* t, uint32_t delta, const PatternEvent* e, int channel, int transpose) {
+    uint8_t status = e->status | channel;
+
+    put_varlen(t, delta);
+    if (status != t->status || random_next() % 2) {
+        put(t, status);
+        t->status = status;
+    }
+    switch (e->status) {
+        case 0x90:
+            put(t, e->byte1 + transpose);
+            put(t, e->byte2);
+            put_varlen(t, e->duration);
+            break;
+        case 0xD0:
+            put(t, e->byte1);
+            break;
+        default:
+            put(t, e->byte1);
+            put(t, e->byte2);
+            break;
+    }
+}
+
+static void make_pattern(Pattern* p) {
+    int i;
+
+    p->count = 6 + random_next() % 11;
+    for (i = 0; i < p->count; i++) {
+        PatternEvent* e = &p->events[i];
+        uint32_t kind = random_next() % 16;
+
+        e->tick = (random_next() % 16) * (BAR_TICKS / 16);
+        if (kind < 11) {
+            e->status = 0x90;
+            e->byte1 = 36 + random_next() % 48;
+            e->byte2 = 1 + random_next() % 127;
+            /* now and then long enough that the duration's first byte is 0xFE */
+            e->duration = (random_next() % 32 == 0) ? 16200 : 12 + random_next() % 180;
+        } else if (kind < 14) {
+            e->status = 0xB0;
+            e->byte1 = 1 + random_next() % 10;
+            e->byte2 = random_next() % 128;
+        } else if (kind < 15) {
+            e->status = 0xE0;
+            e->byte1 = random_next() % 128;
+            e->byte2 = random_next() % 128;
+        } else {
+            e->status = 0xD0;
+            e->byte1 = random_next() % 128;
+        }
+    }
+    /* in time order, which a bubble sort is fine for at 16 */
+    for (i = 1; i < p->count; i++) {
+        int j;
+
+        for (j = i; j > 0 && p->events[j - 1].tick > p->events[j].tick; j--) {
+            PatternEvent swap = p->events[j];
+            p->events[j] = p->events[j - 1];
+            p->events[j - 1] = swap;
+        }
+    }
+}
+
+static void put_bar(Track* t, const Pattern* p, uint32_t bar, uint32_t* tick, int channel, int transpose) {
+    int i;
+
+    for (i = 0; i < p->count; i++) {
+        uint32_t at = bar * BAR_TICKS + p->events[i].tick;
+
+        put_event(t, at - *tick, &p->events[i], channel, transpose);
+        *tick = at;
+    }
+}
+
+static void make_track(Track* t, int index, int bars, int loops) {
+    Pattern patterns[PATTERNS];
+    uint32_t tick = 0;
+    int channel = index % 16;
+    int bar = 0;
+    int i;
+
+    t->len = 0;
+    t->status = 0;
+    for (i = 0; i < PATTERNS; i++) {
+        make_pattern(&patterns[i]);
+    }
+
+    if (index == 0) {
+        put_meta(t, 0, 0x51);   /* 120 bpm */
+        put(t, 0x07);
+        put(t, 0xA1);
+        put(t, 0x20);
+    }
+    put_varlen(t, 0);
+    put(t, 0xC0 | channel);
+    put(t, random_next() % 128);
+    t->status = 0xC0 | channel;
+
+    put_bar(t, &patterns[0], bar++, &tick, channel, 0);
+
+    put_meta(t, bar * BAR_TICKS - tick, 0x2E);
+    put(t, 0);
+    put(t, 0xFF);
+    tick = bar * BAR_TICKS;
+    t->target = t->len;
+
+    for (i = 0; i < bars; i++) {
+        int transpose = (random_next() % 4 == 0) ? (int)(random_next() % 5) - 2 : 0;
+
+        put_bar(t, &patterns[random_next() % PATTERNS], bar++, &tick, channel, transpose);
+    }
+
+    put_meta(t, bar * BAR_TICKS - tick, 0x2D);
+    tick = bar * BAR_TICKS;
+    t->loop_end = t->len;
+    put(t, loops);
+    put(t, loops);
+    for (i = 0; i < 4; i++) {
+        put(t, 0);      /* the offset, which depends on how the track packs */
+    }
+
+    put_bar(t, &patterns[0], bar++, &tick, channel, 0);
+    put_meta(t, bar * BAR_TICKS - tick, 0x2F);
+}
+
+static void emit(Packed* p, uint8_t byte) {
+    if (p->len >= MAX_TRACK) {
+        fprintf(stderr, "cseqbench: packed track too long\n");
+        exit(1);
+    }
+    p->no_source[p->len] = 0;
+    p->bytes[p->len++] = byte;
+}
+
+/* The longest earlier stretch of p that reads back as t->bytes[at, end) */
+static uint32_t find_backup(const Packed* p, const Track* t, uint32_t at, uint32_t end, uint32_t* from) {
+    uint32_t best = 0;
+    uint32_t start = p->len > 0xFFFF ? p->len - 0xFFFF : 0;
+    uint32_t j, n;
+
+    if (end - at > 255) {
+        end = at + 255;
+    }
+    for (j = start; j < p->len; j++) {
+        if (((p->len - j) >> 8) == 0xFE) {
+            continue;   /* would read as an escaped 0xFE */
+        }
+        for (n = 0; at + n < end && j + n < p->len && !p->no_source[j + n] && p->bytes[j + n] == t->bytes[at + n];
+             n++) {
+        }
+        if (n > best) {
+            best = n;
+            *from = j;
+        }
+    }
+    return best;
+}
+
+/*
+ * Packs a track as the sequence compressor would: literal bytes, 0xFE
+ * doubled, and with backups (0xFE, distance, length) in place of anything
+ * found earlier. No backup runs into the loop target or the loop end's
+ * record, which cseq.c reads in place.
+ */
+static void pack_track(Packed* p, const Track* t, int backups) {
+    uint32_t target = 0;
+    uint32_t offset;
+    uint32_t at = 0;
+    uint32_t end, len, from = 0;
+    int i;
+
+    p->len = 0;
+    p->backups = 0;
+
+    while (at < t->len) {
+        if (at == t->target) {
+            target = p->len;
+        }
+        if (at == t->loop_end) {
+            emit(p, t->bytes[at]);
+            emit(p, t->bytes[at + 1]);
+            p->no_source[p->len - 2] = p->no_source[p->len - 1] = 1;
+            offset = p->len + 4 - target;
+            for (i = 3; i >= 0; i--) {
+                emit(p, offset >> (i * 8));
+            }
+            at += 6;
+            continue;
+        }
+
+        end = at < t->target ? t->target : at < t->loop_end ? t->loop_end : t->len;
+        len = backups ? find_backup(p, t, at, end, &from) : 0;
+        if (len > 4) {
+            offset = p->len - from;
+            emit(p, 0xFE);
+            emit(p, offset >> 8);
+            emit(p, offset);
+            emit(p, len);
+            p->backups++;
+            at += len;
+        } else {
+            emit(p, t->bytes[at]);
+            if (t->bytes[at] == 0xFE) {
+                emit(p, 0xFE);
+            }
+            at++;
+        }
+    }
+}
+
+/* Header, as alCSeqNew reads it on this host, then the tracks */
+static uint32_t build_seq(uint8_t* out, Track* tracks, int count, int backups, uint32_t* packed_backups,
+                          int big_endian) {
+    static Packed packed;
+    uint32_t header[17] = { 0 };
+    uint32_t len = sizeof(header);
+    int i, j;
+
+    *packed_backups = 0;
+    for (i = 0; i < count; i++) {
+        pack_track(&packed, &tracks[i], backups);
+        header[i] = len;
+        memcpy(out + len, packed.bytes, packed.len);
+        len += packed.len;
+        *packed_backups += packed.backups;
+    }
+    header[16] = DIVISION;
+
+    for (i = 0; i < 17; i++) {
+        if (big_endian) {
+            for (j = 0; j < 4; j++) {
+                out[i * 4 + j] = header[i] >> (24 - j * 8);
+            }
+        } else {
+            memcpy(out + i * 4, &header[i], 4);
+        }
+    }
+    return len;
+}
+
+typedef struct {
+    const char* name;
+    const uint8_t* seq;
+    uint32_t size;
+    int cached;
+    int32_t cache_bytes;
+    double open_us;
+    double events_per_sec;
+    double seek_us;
+    PlayResult play;
+    PlayResult rest;
+} Mode;
+
+static void run_mode(Mode* mode, uint8_t* arena, uint32_t seek_ticks) {
+    uint8_t* heap = arena + SEQ_SIZE;
+    PlayResult result;
+    uint64_t start, ns;
+    int i;
+
+    mode->open_us = 0;
+    mode->events_per_sec = 0;
+    mode->seek_us = 0;
+
+    for (i = 0; i < RUNS; i++) {
+        /* fresh each time, since playing writes the loop counts back */
+        memcpy(arena, mode->seq, mode->size);
+        start = now_ns();
+        mode->cache_bytes = cseq_open(arena, mode->cached, heap, ARENA_SIZE - SEQ_SIZE);
+        ns = now_ns() - start;
+        if (i == 0 || ns / 1000.0 < mode->open_us) {
+            mode->open_us = ns / 1000.0;
+        }
+
+        start = now_ns();
+        cseq_play(UINT32_MAX, &result);
+        ns = now_ns() - start;
+        if (result.events * 1e9 / ns > mode->events_per_sec) {
+            mode->events_per_sec = result.events * 1e9 / ns;
+        }
+        mode->play = result;
+
+        memcpy(arena, mode->seq, mode->size);
+        cseq_open(arena, mode->cached, heap, ARENA_SIZE - SEQ_SIZE);
+        start = now_ns();
+        cseq_seek(seek_ticks);
+        ns = now_ns() - start;
+        if (i == 0 || ns / 1000.0 < mode->seek_us) {
+            mode->seek_us = ns / 1000.0;
+        }
+        cseq_play(UINT32_MAX, &mode->rest);
+    }
+}
+
+int main(int argc, char** argv) {
+    static Track tracks[MAX_TRACKS];
+    static uint8_t literal[SEQ_SIZE], compressed[SEQ_SIZE];
+    const char* write_path = NULL;
+    int count = 8, bars = 64, loops = 3;
+    uint32_t seed;
+    uint32_t literal_size, compressed_size, backups;
+    uint8_t* arena;
+    Mode modes[3];
+    int failed = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--tracks") && i + 1 < argc) {
+            count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--bars") && i + 1 < argc) {
+            bars = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--loops") && i + 1 < argc) {
+            loops = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            rng = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--write") && i + 1 < argc) {
+            write_path = argv[++i];
+        } else {
+            fprintf(stderr, "usage: cseqbench [--tracks n] [--bars n] [--loops n] [--seed n] [--write file]\n");
+            return 1;
+        }
+    }
+    if (count < 1 || count > MAX_TRACKS || bars < 1 || loops < 0 || loops > 254 || rng == 0) {
+        fprintf(stderr, "cseqbench: --tracks is 1 to %d, --bars at least 1, --loops 0 to 254, --seed nonzero\n",
+                MAX_TRACKS);
+        return 1;
+    }
+
+    /* cseq.c keeps track pointers as 32-bit addresses */
+    arena = mmap(ARENA, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (arena != ARENA) {
+        fprintf(stderr, "cseqbench: can't map the arena at %p\n", ARENA);
+        return 1;
+    }
+
+    seed = rng;
+    for (i = 0; i < count; i++) {
+        make_track(&tracks[i], i, bars, loops);
+    }
+    literal_size = build_seq(literal, tracks, count, 0, &backups, 0);
+    compressed_size = build_seq(compressed, tracks, count, 1, &backups, 0);
+
+    if (write_path) {
+        static uint8_t out[SEQ_SIZE];
+        uint32_t unused;
+        FILE* f = fopen(write_path, "wb");
+
+        build_seq(out, tracks, count, 1, &unused, 1);
+        if (f == NULL || fwrite(out, 1, compressed_size, f) != compressed_size || fclose(f) != 0) {
+            fprintf(stderr, "cseqbench: can't write %s\n", write_path);
+            return 1;
+        }
+    }
+
+    modes[0] = (Mode){ "literal", literal, literal_size, 0, 0, 0, 0, 0, { 0 }, { 0 } };
+    modes[1] = (Mode){ "compressed", compressed, compressed_size, 0, 0, 0, 0, 0, { 0 }, { 0 } };
+    modes[2] = (Mode){ "cached", compressed, compressed_size, 1, 0, 0, 0, 0, { 0 }, { 0 } };
+
+    /* three quarters through, by a first play of the literal sequence */
+    memcpy(arena, literal, literal_size);
+    cseq_open(arena, 0, arena + SEQ_SIZE, ARENA_SIZE - SEQ_SIZE);
+    cseq_play(UINT32_MAX, &modes[0].play);
+
+    printf("%d tracks, %d bars looped %d times, seed %u\n", count, bars, loops, seed);
+    printf("%u bytes literal, %u compressed with %u backups; %u events, %u ticks, seek to %u\n\n", literal_size,
+           compressed_size, backups, modes[0].play.events, modes[0].play.ticks, modes[0].play.ticks / 4 * 3);
+    printf("%-10s | %9s %9s | %10s %6s | %9s %6s | %s\n", "", "open", "decoded", "events/s", "", "seek", "",
+           "events");
+
+    for (i = 0; i < 3; i++) {
+        run_mode(&modes[i], arena, modes[0].play.ticks / 4 * 3);
+    }
+    for (i = 0; i < 3; i++) {
+        int same = modes[i].play.hash == modes[0].play.hash && modes[i].play.events == modes[0].play.events &&
+                   modes[i].rest.hash == modes[0].rest.hash && modes[i].rest.events == modes[0].rest.events;
+        char decoded[16] = "-";
+
+        if (modes[i].cached) {
+            if (modes[i].cache_bytes < 0) {
+                strcpy(decoded, "failed");
+            } else {
+                snprintf(decoded, sizeof(decoded), "%d", modes[i].cache_bytes);
+            }
+        }
+        printf("%-10s | %7.1fus %9s | %10.0f %5.2fx | %7.1fus %5.2fx | %s\n", modes[i].name, modes[i].open_us,
+               decoded, modes[i].events_per_sec, modes[i].events_per_sec / modes[1].events_per_sec,
+               modes[i].seek_us, modes[1].seek_us / modes[i].seek_us, same ? "identical" : "MISMATCH");
+        if (!same || modes[i].cache_bytes < 0) {
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,29 @@
+#ifndef CSEQBENCH_H
+#define CSEQBENCH_H
+
+/*
+ * Between cseqbench.c and cseqplay.c, which is built against cseq.c with
+ * AL_CSEQ_TRACK_CACHE. As with render.h, nothing here may pull in libultra.
+ */
+#include <stdint.h>
+
+typedef struct {
+    uint64_t hash;              /* over every event's type, data and time, in order */
+    uint32_t events;
+    uint32_t ticks;             /* where the sequence got to */
+} PlayResult;
+
+/*
+ * Starts the one sequence cseqplay.c plays, with alCSeqNewCached if cached
+ * (its tracks decoded into heap) or alCSeqNew. seq needs a 32-bit address.
+ * Returns the heap bytes the decoded tracks took, or -1 if they couldn't be.
+ */
+int32_t cseq_open(uint8_t* seq, int cached, uint8_t* heap, uint32_t heap_size);
+
+/* Plays up to events events, or to the end of the sequence */
+void cseq_play(uint32_t events, PlayResult* result);
+
+/* alCSeqNewMarker at ticks, then alCSeqSetLoc to it */
+void cseq_seek(uint32_t ticks);
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * The libultra side of cseqbench: an ALCSeq read event by event, as
+ * ALCSPlayer reads it, with nothing behind it.
+ */
+#include <ultra64.h>
+#include <libaudio.h>
+
+#include "cseqbench.h"
+
+static ALHeap heap;
+static ALCSeq seq;
+
+static void play_hash(PlayResult* result, u32 value) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        result->hash ^= (value >> (i * 8)) & 0xFF;
+        result->hash *= 0x100000001B3ull;
+    }
+}
+
+int32_t cseq_open(uint8_t* data, int cached, uint8_t* base, uint32_t size) {
+    alHeapInit(&heap, base, size);
+    if (!cached) {
+        alCSeqNew(&seq, data);
+        return 0;
+    }
+    if (!alCSeqNewCached(&seq, data, &heap)) {
+        return -1;
+    }
+    return heap.cur - heap.base;
+}
+
+void cseq_play(uint32_t events, PlayResult* result) {
+    ALEvent evt;
+
+    result->hash = 0xCBF29CE484222325ull;
+    result->events = 0;
+
+    while (result->events < events && seq.validTracks) {
+        alCSeqNextEvent(&seq, &evt);
+        result->events++;
+
+        play_hash(result, evt.type);
+        play_hash(result, alCSeqGetTicks(&seq));
+        switch (evt.type) {
+            case AL_SEQ_MIDI_EVT:
+                play_hash(result, (evt.msg.midi.status << 16) | (evt.msg.midi.byte1 << 8) | evt.msg.midi.byte2);
+                if ((evt.msg.midi.status & 0xF0) == AL_MIDI_NoteOn) {
+                    play_hash(result, evt.msg.midi.duration);
+                }
+                break;
+            case AL_TEMPO_EVT:
+                play_hash(result, (evt.msg.tempo.byte1 << 16) | (evt.msg.tempo.byte2 << 8) | evt.msg.tempo.byte3);
+                break;
+        }
+    }
+    result->ticks = alCSeqGetTicks(&seq);
+}
+
+void cseq_seek(uint32_t ticks) {
+    ALCSeqMarker marker;
+
+    alCSeqNewMarker(&seq, &marker, ticks);
+    alCSeqSetLoc(&seq, &marker);
+}
@@ -0,0 +1,262 @@
+/*
+ * envbench: checks AL_ENV_RATE_TABLE's fixed point _getRate against env.c's
+ * float one across the envelope mixer's range, then times both.
+ *
+ *   envbench [--random n] [--calls n] [--seed n]
+ *
+ * The sweep takes every count of samples from 1 to 256 and then steps of a
+ * sixteenth up to 2^22, and at each every pair of volumes up to 32 and then
+ * steps of a sixteenth up to 0x7fff; --random adds that many pairs and
+ * counts picked at random from the whole range. Where the float version's
+ * rate^8 doesn't fit ratem (tgt/vol over a handful of samples) its cast
+ * overflows, so those are only checked for the table's saturating. It
+ * exits with 1 if any rate is off by more than a ratel unit or any of those
+ * doesn't saturate.
+ *
+ * The error is in ratel units, ratem:ratel as one 16.16 number scaled to a
+ * rate of 1. The volume error is how far apart _getVol puts the two ramps
+ * halfway through, for ramps of up to 2^15 samples; past that a ratel unit
+ * compounds over so many steps that the float version's own rounding takes
+ * it as far from the exact ramp, which is printed alongside. The
+ * timing is the best of a few runs over envelopes picked at random, in ns
+ * and, on x86, TSC ticks per call.
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "envbench.h"
+
+#define RUNS       5
+#define MAX_VOL    0x7fff
+#define MAX_COUNT  (1 << 22)
+#define CALL_SET   4096
+#define VOL_COUNT  (1 << 15)
+#define TOLERANCE  1.0        /* in ratel units */
+
+typedef int16_t (*RateFunc)(int32_t vol, int32_t tgt, int32_t count, uint16_t* ratel);
+
+typedef struct {
+    uint64_t checked;
+    uint64_t saturated;         /* the float version overflowed; the table should give 0x7fff */
+    uint64_t exact;
+    uint64_t off_by[3];         /* by up to 1, up to 2, more */
+    double max_diff;
+    int32_t worst[3];           /* vol, tgt and count for max_diff */
+    double max_vol;             /* ramps of up to VOL_COUNT samples */
+    int32_t worst_vol[3];
+    double max_drift;           /* how far off the exact ramp the float version itself gets */
+    uint64_t failed;            /* off by more than TOLERANCE, or not saturated */
+} Sweep;
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static uint64_t now_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/* Steps of a sixteenth above first, every value below it */
+static int next_step(int value, int first) {
+    return value < first ? value + 1 : value + (value >> 4);
+}
+
+static void check(Sweep* sweep, int32_t vol, int32_t tgt, int32_t count) {
+    uint16_t float_l, table_l;
+    int16_t float_m, table_m;
+    uint32_t float_rate, table_rate;
+    double diff;
+    double log_rate = 8.0 * log2((double)tgt / (double)vol) / count;
+    double half_float, half_table, exact;
+
+    /* The float version's log table is off log2 by under 0.1 */
+    if (8.0 * (log2((double)tgt / (double)vol) + 0.1) / count >= 15.0) {
+        if (log_rate - 8.0 * 0.2 / count >= 15.0) {
+            sweep->saturated++;
+            table_m = env_rate_table(vol, tgt, count, &table_l);
+            if (table_m != 0x7fff || table_l != 0xffff) {
+                sweep->failed++;
+            }
+        }
+        return;
+    }
+
+    float_m = env_rate_float(vol, tgt, count, &float_l);
+    table_m = env_rate_table(vol, tgt, count, &table_l);
+    float_rate = ((uint32_t)(uint16_t)float_m << 16) | float_l;
+    table_rate = ((uint32_t)(uint16_t)table_m << 16) | table_l;
+    diff = fabs((double)float_rate - (double)table_rate);
+    if (float_rate > 0x10000) {
+        diff = diff * 0x10000 / float_rate;
+    }
+
+    sweep->checked++;
+    if (diff == 0) {
+        sweep->exact++;
+    } else {
+        sweep->off_by[diff <= 1 ? 0 : diff <= 2 ? 1 : 2]++;
+    }
+    if (diff > TOLERANCE) {
+        sweep->failed++;
+    }
+    if (diff > sweep->max_diff) {
+        sweep->max_diff = diff;
+        sweep->worst[0] = vol;
+        sweep->worst[1] = tgt;
+        sweep->worst[2] = count;
+    }
+
+    if (count > VOL_COUNT) {
+        return;
+    }
+    half_float = env_vol(vol, count / 2, float_m, float_l);
+    half_table = env_vol(vol, count / 2, table_m, table_l);
+    exact = vol * pow((double)tgt / (double)vol, (double)(count / 2 / 8 * 8) / count);
+    if (exact <= MAX_VOL && fabs(half_float - exact) > sweep->max_drift) {
+        sweep->max_drift = fabs(half_float - exact);
+    }
+    if (half_float <= MAX_VOL && half_table <= MAX_VOL && fabs(half_float - half_table) > sweep->max_vol) {
+        sweep->max_vol = fabs(half_float - half_table);
+        sweep->worst_vol[0] = vol;
+        sweep->worst_vol[1] = tgt;
+        sweep->worst_vol[2] = count;
+    }
+}
+
+static void sweep_grid(Sweep* sweep) {
+    int32_t vol, tgt, count;
+
+    for (count = 1; count <= MAX_COUNT; count = next_step(count, 256)) {
+        for (vol = 1; vol <= MAX_VOL; vol = next_step(vol, 32)) {
+            for (tgt = 1; tgt <= MAX_VOL; tgt = next_step(tgt, 32)) {
+                check(sweep, vol, tgt, count);
+            }
+        }
+    }
+}
+
+static int32_t random_count(void) {
+    /* Spread over the octaves, not the values */
+    int shift = rng() % 22;
+
+    return (1 << shift) + (int32_t)(rng() & ((1u << shift) - 1));
+}
+
+static void sweep_random(Sweep* sweep, uint32_t pairs) {
+    uint32_t i;
+
+    for (i = 0; i < pairs; i++) {
+        check(sweep, 1 + rng() % MAX_VOL, 1 + rng() % MAX_VOL, random_count());
+    }
+}
+
+static void print_sweep(const char* name, const Sweep* sweep) {
+    printf("%-8s %10llu rates: %5.1f%% exact, %5.2f%% off by up to 1, %5.3f%% up to 2, %llu more;\n",
+           name, (unsigned long long)sweep->checked, 100.0 * sweep->exact / sweep->checked,
+           100.0 * sweep->off_by[0] / sweep->checked, 100.0 * sweep->off_by[1] / sweep->checked,
+           (unsigned long long)sweep->off_by[2]);
+    printf("%-8s %10s        at most %.2f (vol %d, tgt %d, count %d), %.2f in volume halfway (vol %d, tgt %d, "
+           "count %d);\n",
+           "", "", sweep->max_diff, sweep->worst[0], sweep->worst[1], sweep->worst[2], sweep->max_vol,
+           sweep->worst_vol[0], sweep->worst_vol[1], sweep->worst_vol[2]);
+    printf("%-8s %10s        the float version %.2f off the exact ramp; %llu saturated, %llu wrong\n", "", "",
+           sweep->max_drift, (unsigned long long)sweep->saturated, (unsigned long long)sweep->failed);
+}
+
+typedef struct {
+    int32_t vol, tgt, count;
+} Call;
+
+/* Returns ns per call, best of RUNS, and the ticks that run took */
+static double time_rate(RateFunc rate, const Call* calls, uint32_t total, double* ticks, uint32_t* sink) {
+    uint64_t start, start_ticks, ns;
+    double best = 0;
+    uint16_t ratel;
+    uint32_t i;
+    int run;
+
+    for (run = 0; run < RUNS; run++) {
+        start_ticks = now_ticks();
+        start = now_ns();
+        for (i = 0; i < total; i++) {
+            const Call* call = &calls[i % CALL_SET];
+
+            *sink += (uint16_t)rate(call->vol, call->tgt, call->count, &ratel);
+            *sink += ratel;
+        }
+        ns = now_ns() - start;
+        if (run == 0 || (double)ns / total < best) {
+            best = (double)ns / total;
+            *ticks = (double)(now_ticks() - start_ticks) / total;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    static Call calls[CALL_SET];
+    uint32_t random_pairs = 4000000;
+    uint32_t total = 20000000;
+    uint32_t seed = 1;
+    Sweep grid, random;
+    double float_ns, table_ns, float_ticks, table_ticks;
+    uint32_t sink = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--random") && i + 1 < argc) {
+            random_pairs = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--calls") && i + 1 < argc) {
+            total = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: envbench [--random n] [--calls n] [--seed n]\n");
+            return 1;
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    memset(&grid, 0, sizeof(grid));
+    memset(&random, 0, sizeof(random));
+    sweep_grid(&grid);
+    sweep_random(&random, random_pairs);
+    print_sweep("grid", &grid);
+    print_sweep("random", &random);
+
+    /* Envelopes as a sequence player's: a few ms to a few s at 32kHz, voices at any volume */
+    for (i = 0; i < CALL_SET; i++) {
+        calls[i].vol = 1 + rng() % MAX_VOL;
+        calls[i].tgt = 1 + rng() % MAX_VOL;
+        calls[i].count = 64 + rng() % 96000;
+    }
+    float_ns = time_rate(env_rate_float, calls, total, &float_ticks, &sink);
+    table_ns = time_rate(env_rate_table, calls, total, &table_ticks, &sink);
+    printf("\n%u calls, seed %u (%08x)\n", total, seed, sink);
+    printf("float    %7.2f ns/call %8.1f ticks/call\n", float_ns, float_ticks);
+    printf("table    %7.2f ns/call %8.1f ticks/call  %.2fx\n", table_ns, table_ticks, float_ns / table_ns);
+
+    return grid.failed || random.failed;
+}
@@ -0,0 +1,22 @@
+#ifndef ENVBENCH_H
+#define ENVBENCH_H
+
+/*
+ * Between envbench.c and envrate.c, which is built twice against env.c, as
+ * it is and with AL_ENV_RATE_TABLE. As with render.h, nothing here may pull
+ * in libultra.
+ */
+#include <stdint.h>
+
+/*
+ * env.c's _getRate: the ratem returned and the ratel stored that take a
+ * voice from vol to tgt in count samples. Volumes are the envelope
+ * mixer's, 0 to 0x7fff.
+ */
+int16_t env_rate_float(int32_t vol, int32_t tgt, int32_t count, uint16_t* ratel);
+int16_t env_rate_table(int32_t vol, int32_t tgt, int32_t count, uint16_t* ratel);
+
+/* env.c's _getVol, the same in both builds: where the ramp is after samples */
+float env_vol(float vol, int32_t samples, int16_t ratem, uint16_t ratel);
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * The libultra side of envbench: env.c's rate helpers, which are static, so
+ * env.c is included here whole.
+ *
+ * Built twice, as env_rate_float against env.c as it is and as
+ * env_rate_table with AL_ENV_RATE_TABLE; the Makefile renames env.c's own
+ * symbols in the second so both can be linked together.
+ */
+#include "env.c"
+
+#include "envbench.h"
+
+#ifdef AL_ENV_RATE_TABLE
+
+int16_t env_rate_table(int32_t vol, int32_t tgt, int32_t count, uint16_t* ratel) {
+    return _getRate(vol, tgt, count, ratel);
+}
+
+#else
+
+int16_t env_rate_float(int32_t vol, int32_t tgt, int32_t count, uint16_t* ratel) {
+    return _getRate(vol, tgt, count, ratel);
+}
+
+float env_vol(float vol, int32_t samples, int16_t ratem, uint16_t ratel) {
+    return _getVol(vol, samples, ratem, ratel);
+}
+
+#endif
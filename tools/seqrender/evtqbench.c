@@ -0,0 +1,140 @@
+/*
+ * evtqbench: runs the same sequence player event mix through libultra's
+ * delta-list event queue as it is and with AL_EVTQ_WHEEL's timing wheel
+ * over it, checks that both hand out exactly the same events in the same
+ * order, and times them at a range of polyphonies.
+ *
+ *   evtqbench [--pops n] [--seed n] [--poly n]...
+ *
+ * Throughput is the best of three runs without per-call timing, in ns per
+ * post, pop, flush or search, simulation included. The tail latencies come from a
+ * separate run that times every call, so they include the clock's own
+ * overhead.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "evtqbench.h"
+
+#define MAX_POLYS 16
+#define RUNS      3
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* The time at or under which fraction of the calls finished */
+static unsigned percentile(const uint32_t* hist, uint64_t calls, double fraction) {
+    uint64_t want = (uint64_t)(calls * fraction);
+    uint64_t seen = 0;
+    unsigned ns;
+
+    for (ns = 0; ns < MIX_HIST_NS - 1; ns++) {
+        seen += hist[ns];
+        if (seen >= want) {
+            break;
+        }
+    }
+    return ns;
+}
+
+typedef void (*MixFunc)(const MixConfig* config, MixResult* result);
+
+/* Returns ns per queue operation, best of RUNS; result is the last run's */
+static double time_mix(MixFunc mix, const MixConfig* config, MixResult* result) {
+    double best = 0;
+    uint64_t start;
+    double ns;
+    int i;
+
+    for (i = 0; i < RUNS; i++) {
+        start = now_ns();
+        mix(config, result);
+        ns = (double)(now_ns() - start) /
+             (double)(result->posts + result->pops + result->flushes + result->searches);
+        if (i == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    static const int default_polys[] = { 8, 24, 64, 256, 1024 };
+    int polys[MAX_POLYS];
+    int num_polys = 0;
+    MixConfig config = { 0, 2000000, 1, NULL, NULL, NULL, NULL };
+    static uint32_t hist[6][MIX_HIST_NS];
+    MixResult list, wheel, tail;
+    double list_ns, wheel_ns;
+    int failed = 0;
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--pops") && i + 1 < argc) {
+            config.pops = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            config.seed = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--poly") && i + 1 < argc && num_polys < MAX_POLYS) {
+            polys[num_polys] = atoi(argv[++i]);
+            if (polys[num_polys] < 1 || polys[num_polys] > MIX_MAX_VOICES) {
+                fprintf(stderr, "evtqbench: --poly must be 1 to %d\n", MIX_MAX_VOICES);
+                return 1;
+            }
+            num_polys++;
+        } else {
+            fprintf(stderr, "usage: evtqbench [--pops n] [--seed n] [--poly n]...\n");
+            return 1;
+        }
+    }
+    if (num_polys == 0) {
+        num_polys = sizeof(default_polys) / sizeof(default_polys[0]);
+        memcpy(polys, default_polys, sizeof(default_polys));
+    }
+
+    printf("%u events per run, seed %u\n\n", config.pops, config.seed);
+    printf("%6s %7s %6s | %7s %7s %6s | %9s %10s | %9s %10s | %11s %12s | %s\n", "poly", "depth", "max", "list",
+           "wheel", "", "list post", "wheel post", "list pop", "wheel pop", "list search", "wheel search", "order");
+    printf("%6s %7s %6s | %7s %7s %6s | %9s %10s | %9s %10s | %11s %12s |\n", "", "avg", "depth", "ns/op", "ns/op",
+           "", "p99.9 ns", "p99.9 ns", "p99.9 ns", "p99.9 ns", "p99 ns", "p99 ns");
+
+    for (i = 0; i < num_polys; i++) {
+        config.polyphony = polys[i];
+        config.clock = NULL;
+        list_ns = time_mix(evtq_mix_list, &config, &list);
+        wheel_ns = time_mix(evtq_mix_wheel, &config, &wheel);
+
+        memset(hist, 0, sizeof(hist));
+        config.clock = now_ns;
+        config.post_ns = hist[0];
+        config.pop_ns = hist[2];
+        config.search_ns = hist[4];
+        evtq_mix_list(&config, &tail);
+        config.post_ns = hist[1];
+        config.pop_ns = hist[3];
+        config.search_ns = hist[5];
+        evtq_mix_wheel(&config, &tail);
+
+        if (list.hash != wheel.hash || list.pops != wheel.pops || list.posts != wheel.posts ||
+            list.dropped != wheel.dropped || list.searches != wheel.searches) {
+            failed = 1;
+        }
+
+        printf("%6d %7.1f %6u | %7.1f %7.1f %5.2fx | %9u %10u | %9u %10u | %11u %12u | %s\n", polys[i],
+               (double)list.depth_sum / (double)(list.pops ? list.pops : 1), list.depth_max, list_ns, wheel_ns,
+               list_ns / wheel_ns, percentile(hist[0], list.posts, 0.999), percentile(hist[1], wheel.posts, 0.999),
+               percentile(hist[2], list.pops, 0.999), percentile(hist[3], wheel.pops, 0.999),
+               percentile(hist[4], list.searches, 0.99), percentile(hist[5], wheel.searches, 0.99),
+               (list.hash == wheel.hash && list.pops == wheel.pops) ? "identical" : "MISMATCH");
+        if (list.dropped) {
+            printf("       (%llu posts dropped with the queue full, by both)\n", (unsigned long long)list.dropped);
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,38 @@
+#ifndef EVTQBENCH_H
+#define EVTQBENCH_H
+
+/*
+ * Between evtqbench.c and evtqmix.c, which is built once against each event
+ * queue backend. As with render.h, nothing here may pull in libultra.
+ */
+#include <stdint.h>
+
+#define MIX_MAX_VOICES 2048
+#define MIX_MAX_EVENTS (4 * MIX_MAX_VOICES + 64)
+#define MIX_HIST_NS    4096     /* per-call times at or past this land in the last bucket */
+
+typedef struct {
+    int polyphony;              /* voices the simulated player keeps sounding at most */
+    uint32_t pops;              /* events to hand out */
+    uint32_t seed;
+    uint64_t (*clock)(void);    /* if set, each post and pop is timed into the histograms */
+    uint32_t* post_ns;          /* MIX_HIST_NS buckets of 1ns */
+    uint32_t* pop_ns;
+    uint32_t* search_ns;        /* tempo changes and note kill checks */
+} MixConfig;
+
+typedef struct {
+    uint64_t hash;              /* over every (delta, type, payload) handed out, in order */
+    uint64_t posts;
+    uint64_t pops;
+    uint64_t flushes;
+    uint64_t searches;          /* tempo changes and note kill checks */
+    uint64_t dropped;           /* posts refused with the queue full */
+    uint64_t depth_sum;         /* queued events, summed at each pop */
+    uint32_t depth_max;
+} MixResult;
+
+void evtq_mix_list(const MixConfig* config, MixResult* result);
+void evtq_mix_wheel(const MixConfig* config, MixResult* result);
+
+#endif
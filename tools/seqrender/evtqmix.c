@@ -0,0 +1,480 @@
+/*
+ * The libultra side of evtqbench: a sequence player's traffic through an
+ * ALEventQueue, without the synthesizer behind it.
+ *
+ * Built twice, as evtq_mix_list against event.c as it is and as
+ * evtq_mix_wheel against event.c with AL_EVTQ_WHEEL, whose symbols the
+ * Makefile renames so both can be linked together.
+ *
+ * The mix follows what ALSeqPlayer posts: the next sequence event, often at
+ * the same time as the last one (chords); for each note an envelope event at
+ * the end of its attack and a note end on a tick boundary, so many events
+ * share a time; oscillator events that repost themselves while their voice
+ * sounds; a volume event each frame; now and then a flush of every pending
+ * envelope event, an end-of-queue post, a loop point far ahead and an event
+ * posted late, with a negative delta.
+ *
+ * It also searches and edits the queue as the players do: before a new
+ * note, whether a sounding voice still needs killing (seqplayer.c's
+ * __voiceNeedsNoteKill); a voice released in its attack, whose envelope
+ * events go; and every so often a tempo change that rescales every pending
+ * note end (csplayer.c's). Both sides run the players' own walks, the
+ * wheel's with the __alEvtqUnlink and __alEvtqChanged calls they make
+ * under AL_EVTQ_WHEEL.
+ */
+#include <ultra64.h>
+#include <libaudio.h>
+
+#include "evtqbench.h"
+
+#ifndef EVTQ_MIX
+#define EVTQ_MIX evtq_mix_list
+#endif
+
+#define TICK_US   5208  /* 120 bpm at 96 ticks per quarter note */
+#define FRAME_US  16000
+#define TEMPO_FRAMES 32 /* frames between tempo changes */
+
+static ALEventListItem items[MIX_MAX_EVENTS];
+static ALVoice voices[MIX_MAX_VOICES];
+static u32 generation[MIX_MAX_VOICES];
+static u8 sounding[MIX_MAX_VOICES];
+#ifdef AL_EVTQ_WHEEL
+static ALEvtqWheel wheel;
+#endif
+
+#ifndef AL_EVTQ_WHEEL
+/* render.c's, which evtqbench doesn't link; the wheel's build shares them */
+void alLink(ALLink* ln, ALLink* to) {
+    ln->next = to->next;
+    ln->prev = to;
+    if (to->next) {
+        to->next->prev = ln;
+    }
+    to->next = ln;
+}
+
+void alUnlink(ALLink* ln) {
+    if (ln->next) {
+        ln->next->prev = ln->prev;
+    }
+    if (ln->prev) {
+        ln->prev->next = ln->next;
+    }
+}
+
+OSIntMask osSetIntMask(OSIntMask mask) {
+    return mask;
+}
+#endif
+
+/* csplayer.c's __CSPRepostEvent */
+static void mix_repost(ALEventQueue* evtq, ALEventListItem* item) {
+    ALLink* node;
+    ALEventListItem* nextItem;
+
+    for (node = &evtq->allocList; node != 0; node = node->next) {
+        if (!node->next) {
+            alLink((ALLink*)item, node);
+            break;
+        } else {
+            nextItem = (ALEventListItem*)node->next;
+            if (item->delta < nextItem->delta) {
+                nextItem->delta -= item->delta;
+                alLink((ALLink*)item, node);
+                break;
+            }
+            item->delta -= nextItem->delta;
+        }
+    }
+}
+
+/* csplayer.c's tempo change, on note ends */
+static void mix_retime(ALEventQueue* evtq, s32 oldUspt, s32 uspt) {
+    ALMicroTime tempDelta, curDelta = 0;
+    ALEventListItem *thisNode, *nextNode, *firstTemp = 0;
+    u32 ticks;
+
+    thisNode = (ALEventListItem*)evtq->allocList.next;
+    while (thisNode) {
+        curDelta += thisNode->delta;
+        nextNode = (ALEventListItem*)thisNode->node.next;
+        if (thisNode->evt.type == AL_NOTE_END_EVT) {
+#ifdef AL_EVTQ_WHEEL
+            __alEvtqChanged(evtq);
+#endif
+            alUnlink((ALLink*)thisNode);
+
+            if (firstTemp) {
+                alLink((ALLink*)thisNode, (ALLink*)firstTemp);
+            } else {
+                thisNode->node.next = 0;
+                thisNode->node.prev = 0;
+                firstTemp = thisNode;
+            }
+            tempDelta = curDelta;
+            if (nextNode) {
+                curDelta -= thisNode->delta;
+                nextNode->delta += thisNode->delta;
+            }
+            thisNode->delta = tempDelta;
+        }
+        thisNode = nextNode;
+    }
+
+    thisNode = firstTemp;
+    while (thisNode) {
+        nextNode = (ALEventListItem*)thisNode->node.next;
+        ticks = thisNode->delta / oldUspt;
+        thisNode->delta = ticks * uspt;
+        mix_repost(evtq, thisNode);
+        thisNode = nextNode;
+    }
+}
+
+/* seqplayer.c's __voiceNeedsNoteKill */
+static s32 mix_needs_kill(ALEventQueue* evtq, ALVoice* voice, ALMicroTime killTime) {
+    ALLink* thisNode;
+    ALLink* nextNode;
+    ALEventListItem* thisItem;
+    ALMicroTime itemTime = 0;
+    s32 needsNoteKill = TRUE;
+
+    thisNode = evtq->allocList.next;
+    while (thisNode != 0) {
+        nextNode = thisNode->next;
+        thisItem = (ALEventListItem*)thisNode;
+        itemTime += thisItem->delta;
+
+        if (thisItem->evt.type == AL_NOTE_END_EVT && thisItem->evt.msg.note.voice == voice) {
+            if (itemTime > killTime) {
+#ifdef AL_EVTQ_WHEEL
+                __alEvtqUnlink(evtq, thisItem);
+#endif
+                if ((ALEventListItem*)nextNode) {
+                    ((ALEventListItem*)nextNode)->delta += thisItem->delta;
+                }
+                alUnlink(thisNode);
+                alLink(thisNode, &evtq->freeList);
+            } else {
+                needsNoteKill = FALSE;
+            }
+            break;
+        }
+        thisNode = nextNode;
+    }
+    return needsNoteKill;
+}
+
+/* seqplayer.c's release in the attack phase, dropping the voice's envelope events */
+static s32 mix_release_envelope(ALEventQueue* evtq, ALVoice* voice) {
+    ALLink* thisNode;
+    ALLink* nextNode;
+    ALEventListItem *thisItem, *nextItem;
+    s32 dropped = 0;
+
+    thisNode = evtq->allocList.next;
+    while (thisNode != 0) {
+        nextNode = thisNode->next;
+        thisItem = (ALEventListItem*)thisNode;
+        nextItem = (ALEventListItem*)nextNode;
+        if (thisItem->evt.type == AL_SEQP_ENV_EVT && thisItem->evt.msg.vol.voice == voice) {
+#ifdef AL_EVTQ_WHEEL
+            __alEvtqUnlink(evtq, thisItem);
+#endif
+            if (nextItem) {
+                nextItem->delta += thisItem->delta;
+            }
+            alUnlink(thisNode);
+            alLink(thisNode, &evtq->freeList);
+            dropped++;
+        }
+        thisNode = nextNode;
+    }
+    return dropped;
+}
+
+typedef struct {
+    ALEventQueue queue;
+    const MixConfig* config;
+    MixResult* result;
+    u32 rng;
+    u32 depth;
+    s32 uspt;
+    s32 events;
+    s32 live;
+} Mix;
+
+static u32 mix_random(Mix* mix) {
+    mix->rng ^= mix->rng << 13;
+    mix->rng ^= mix->rng >> 17;
+    mix->rng ^= mix->rng << 5;
+    return mix->rng;
+}
+
+static void mix_hash(Mix* mix, u32 value) {
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        mix->result->hash ^= (value >> (i * 8)) & 0xFF;
+        mix->result->hash *= 0x100000001B3ull;
+    }
+}
+
+static void mix_time(u32* hist, u64 ns) {
+    hist[ns < MIX_HIST_NS ? ns : MIX_HIST_NS - 1]++;
+}
+
+static void mix_post(Mix* mix, s16 type, s32 voice, ALMicroTime delta) {
+    ALEvent evt;
+    u64 start = 0;
+
+    if (!mix->queue.freeList.next) {
+        mix->result->dropped++;
+        return;
+    }
+
+    evt.type = type;
+    switch (type) {
+        case AL_NOTE_END_EVT:
+            evt.msg.note.voice = &voices[voice];
+            break;
+        case AL_SEQP_ENV_EVT:
+            evt.msg.vol.voice = &voices[voice];
+            evt.msg.vol.delta = delta;
+            evt.msg.vol.vol = 0;
+            break;
+        case AL_VIB_OSC_EVT:
+            evt.msg.osc.vs = (void*)&voices[voice];
+            evt.msg.osc.oscState = (void*)(uintptr_t)generation[voice];
+            evt.msg.osc.chan = 0;
+            break;
+        default:
+            evt.msg.spvol.vol = 0x7FFF;
+            break;
+    }
+
+    if (mix->config->clock) {
+        start = mix->config->clock();
+    }
+    alEvtqPostEvent(&mix->queue, &evt, delta);
+    if (mix->config->clock) {
+        mix_time(mix->config->post_ns, mix->config->clock() - start);
+    }
+
+    mix->result->posts++;
+    mix->depth++;
+}
+
+static void mix_flush_envelopes(Mix* mix) {
+    ALLink* node;
+
+    alEvtqFlushType(&mix->queue, AL_SEQP_ENV_EVT);
+    mix->result->flushes++;
+
+    mix->depth = mix->events;
+    for (node = mix->queue.freeList.next; node != 0; node = node->next) {
+        mix->depth--;
+    }
+}
+
+static u64 mix_search_start(Mix* mix) {
+    return mix->config->clock ? mix->config->clock() : 0;
+}
+
+static void mix_search_end(Mix* mix, u64 start) {
+    if (mix->config->clock) {
+        mix_time(mix->config->search_ns, mix->config->clock() - start);
+    }
+    mix->result->searches++;
+}
+
+/* A sounding voice cut short, as a new note on its key would */
+static void mix_kill(Mix* mix) {
+    int v = mix_random(mix) % mix->config->polyphony;
+    ALMicroTime killTime = (mix_random(mix) % 32) * TICK_US;
+    u64 start;
+    s32 killed;
+
+    if (!sounding[v]) {
+        return;
+    }
+    start = mix_search_start(mix);
+    killed = mix_needs_kill(&mix->queue, &voices[v], killTime);
+    mix_search_end(mix, start);
+
+    mix_hash(mix, killed);
+    if (killed) {
+        sounding[v] = 0;
+        mix->live--;
+        mix->depth--;
+    }
+}
+
+/* A sounding voice released before its envelope events come due */
+static void mix_release(Mix* mix) {
+    int v = mix_random(mix) % mix->config->polyphony;
+    u64 start;
+    s32 dropped;
+
+    if (!sounding[v]) {
+        return;
+    }
+    start = mix_search_start(mix);
+    dropped = mix_release_envelope(&mix->queue, &voices[v]);
+    mix_search_end(mix, start);
+
+    mix_hash(mix, dropped);
+    mix->depth -= dropped;
+}
+
+static void mix_tempo(Mix* mix) {
+    s32 oldUspt = mix->uspt;
+    u64 start;
+
+    mix->uspt = (oldUspt == TICK_US) ? TICK_US * 3 / 4 : TICK_US;
+    start = mix_search_start(mix);
+    mix_retime(&mix->queue, oldUspt, mix->uspt);
+    mix_search_end(mix, start);
+}
+
+/* The next sequence event: a note (or a chord of them), then the one after */
+static void mix_sequence(Mix* mix) {
+    int notes = 1 + mix_random(mix) % 4;
+    int i, v;
+
+    if (mix_random(mix) % 2 == 0) {
+        mix_kill(mix);
+    }
+    if (mix_random(mix) % 4 == 0) {
+        mix_release(mix);
+    }
+
+    for (i = 0; i < notes && mix->live < mix->config->polyphony; i++, mix->live++) {
+        v = mix_random(mix) % mix->config->polyphony;
+        while (sounding[v]) {
+            v = (v + 1) % mix->config->polyphony;
+        }
+        sounding[v] = 1;
+        generation[v]++;
+
+        mix_post(mix, AL_SEQP_ENV_EVT, v, (mix_random(mix) % 4) * (TICK_US / 2));
+        mix_post(mix, AL_NOTE_END_EVT, v, (1 + mix_random(mix) % 64) * TICK_US);
+        if (mix_random(mix) % 4 == 0) {
+            mix_post(mix, AL_VIB_OSC_EVT, v, 8000 + mix_random(mix) % 8000);
+        }
+    }
+
+    mix_post(mix, AL_SEQ_REF_EVT, 0, (mix_random(mix) % 3 == 0) ? 0 : (1 + mix_random(mix) % 8) * TICK_US);
+}
+
+void EVTQ_MIX(const MixConfig* config, MixResult* result) {
+    Mix mix;
+    ALEvent evt;
+    ALMicroTime delta;
+    u64 start = 0;
+    u32 frames = 0;
+    s32 streams;
+    s32 voice;
+    u32 gen;
+    u32 n;
+
+    bzero(result, sizeof(*result));
+    bzero(voices, sizeof(voices));
+    bzero(generation, sizeof(generation));
+    bzero(sounding, sizeof(sounding));
+    result->hash = 0xCBF29CE484222325ull;
+
+    mix.config = config;
+    mix.result = result;
+    mix.rng = config->seed ? config->seed : 1;
+    mix.depth = 0;
+    mix.uspt = TICK_US;
+    mix.live = 0;
+    mix.events = 4 * config->polyphony + 64;
+    alEvtqNew(&mix.queue, items, mix.events);
+#ifdef AL_EVTQ_WHEEL
+    alEvtqNewWheel(&mix.queue, &wheel);
+#endif
+
+    /* one sequence keeps ~40 notes going; more voices take more of them */
+    mix_post(&mix, AL_SEQP_VOL_EVT, 0, 0);
+    for (streams = 1 + config->polyphony / 32; streams > 0; streams--) {
+        mix_post(&mix, AL_SEQ_REF_EVT, 0, 0);
+    }
+
+    for (n = 0; n < config->pops; n++) {
+        result->depth_sum += mix.depth;
+        if (mix.depth > result->depth_max) {
+            result->depth_max = mix.depth;
+        }
+
+        if (config->clock) {
+            start = config->clock();
+        }
+        delta = alEvtqNextEvent(&mix.queue, &evt);
+        if (config->clock) {
+            mix_time(config->pop_ns, config->clock() - start);
+        }
+        if (evt.type == -1) {
+            break;
+        }
+        result->pops++;
+        mix.depth--;
+
+        voice = -1;
+        gen = 0;
+        switch (evt.type) {
+            case AL_NOTE_END_EVT:
+                voice = evt.msg.note.voice - voices;
+                break;
+            case AL_SEQP_ENV_EVT:
+                voice = evt.msg.vol.voice - voices;
+                break;
+            case AL_VIB_OSC_EVT:
+                voice = (ALVoice*)evt.msg.osc.vs - voices;
+                gen = (u32)(uintptr_t)evt.msg.osc.oscState;
+                break;
+        }
+        mix_hash(&mix, delta);
+        mix_hash(&mix, evt.type);
+        mix_hash(&mix, voice);
+        mix_hash(&mix, gen);
+
+        switch (evt.type) {
+            case AL_SEQ_REF_EVT:
+                mix_sequence(&mix);
+                break;
+            case AL_NOTE_END_EVT:
+                sounding[voice] = 0;
+                mix.live--;
+                break;
+            case AL_VIB_OSC_EVT:
+                if (sounding[voice] && generation[voice] == gen) {
+                    mix_post(&mix, AL_VIB_OSC_EVT, voice, 8000 + mix_random(&mix) % 8000);
+                }
+                break;
+            case AL_SEQP_VOL_EVT:
+                frames++;
+                mix_post(&mix, AL_SEQP_VOL_EVT, 0, FRAME_US);
+                if (frames % 64 == 0) {
+                    mix_flush_envelopes(&mix);
+                }
+                if (frames % TEMPO_FRAMES == 0) {
+                    mix_tempo(&mix);
+                }
+                if (frames % 256 == 0) {
+                    mix_post(&mix, AL_SEQ_END_EVT, 0, AL_EVTQ_END);
+                }
+                if (frames % 128 == 0) {
+                    /* a loop point tens of seconds out, past AL_EVTQ_WHEEL's level 1 */
+                    mix_post(&mix, AL_SEQP_LOOP_EVT, 0, 20000000 + mix_random(&mix) % 20000000);
+                }
+                if (frames % 512 == 0) {
+                    /* a late event, which the list puts at the head */
+                    mix_post(&mix, AL_SEQP_PRIORITY_EVT, 0, -(s32)(mix_random(&mix) % TICK_US));
+                }
+                break;
+        }
+    }
+}
@@ -0,0 +1,238 @@
+/*
+ * fxbench: pulls each AL_FX_* effect through reverb.c as it is and
+ * through its AL_FX_FUSED path, runs both command lists in the Acmd
+ * interpreter, checks that they leave the same output and the same delay
+ * line, and counts what each asks of the RSP per frame.
+ *
+ *   fxbench [--frames n] [--rate hz] [--frame samples] [--seed n]
+ *
+ * A frame is split into pulls of up to 160 samples (AL_MAX_RSP_SAMPLES),
+ * as alAudioFrame does; the input is noise. Commands leave out the four
+ * that load the aux buses ahead of the effect. DMA is the bytes LOADBUFF
+ * and SAVEBUFF move between RDRAM and DMEM, DMEM the bytes DMEMMOVE copies
+ * within it. The times are the best of a few runs, per frame: "build" is
+ * alFxPull writing the list, "run" the interpreter running it. The
+ * interpreter doesn't do POLEF, so the rooms' low-pass sections aren't
+ * filtered in either.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include "fxbench.h"
+#include "render.h"
+
+#define RUNS           3
+#define MAX_PULL       160
+#define MAX_COMMANDS   1024
+#define FX_COUNT       6        /* AL_FX_NONE to AL_FX_ECHO */
+#define ALIGN(x, a)    (((x) + (a) - 1) & ~((a) - 1))
+
+#define ARENA          ((void*)0x10000000)
+#define ARENA_SIZE     0x1000000u
+#define HEAP_SIZE      0x400000u
+#define INPUT_SAMPLES  0x40000u
+
+typedef uint32_t (*OpenFunc)(int fx, uint32_t output_rate, uint8_t* heap, uint32_t heap_size, const int16_t* input,
+                             uint32_t input_samples);
+typedef uint32_t (*PullFunc)(int32_t count, uint64_t* cmds);
+
+typedef struct {
+    uint64_t commands;
+    uint64_t loads;             /* LOADBUFF */
+    uint64_t saves;             /* SAVEBUFF */
+    uint64_t setbuffs;          /* SETBUFF */
+    uint64_t dma_bytes;
+    uint64_t dmem_bytes;
+    double build_ns;
+    double run_ns;
+} Tally;
+
+static AcmdState acmd_list, acmd_fused;
+static uint64_t cmds_list[MAX_COMMANDS], cmds_fused[MAX_COMMANDS];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void tally(Tally* t, const uint64_t* cmds, uint32_t n) {
+    const AcmdWord* w = (const AcmdWord*)cmds;
+    uint32_t count = 0;
+    uint32_t i;
+
+    for (i = FX_SOURCE_COMMANDS; i < n; i++) {
+        switch (w[i].w0 >> 24) {
+            case ACMD_SETBUFF:
+                t->setbuffs++;
+                if (!((w[i].w0 >> 16) & 0x8)) {     /* A_AUX sets the other buffers */
+                    count = w[i].w1 & 0xFFFF;
+                }
+                break;
+            case ACMD_LOADBUFF:
+                t->loads++;
+                t->dma_bytes += ALIGN(count, 8);
+                break;
+            case ACMD_SAVEBUFF:
+                t->saves++;
+                t->dma_bytes += ALIGN(count, 8);
+                break;
+            case ACMD_DMEMMOVE:
+                t->dmem_bytes += ALIGN(w[i].w1 & 0xFFFF, 16);
+                break;
+        }
+        t->commands++;
+    }
+}
+
+/*
+ * Pulls frames frames through both paths, checking each pull's output and
+ * the delay lines at the end; returns the first frame they differ at, or -1
+ */
+static int compare(int fx, uint32_t rate, uint32_t frame, int frames, uint8_t* arena, const int16_t* input,
+                   Tally* list, Tally* fused) {
+    uint32_t list_length, fused_length;
+    int16_t *list_delay, *fused_delay;
+    uint32_t n_list, n_fused, done;
+    int32_t count;
+    int f;
+
+    fx_open_list(fx, rate, arena, HEAP_SIZE, input, INPUT_SAMPLES);
+    fx_open_fused(fx, rate, arena + HEAP_SIZE, HEAP_SIZE, input, INPUT_SAMPLES);
+    acmd_init(&acmd_list, arena, ARENA_SIZE);
+    acmd_init(&acmd_fused, arena, ARENA_SIZE);
+
+    for (f = 0; f < frames; f++) {
+        for (done = 0; done < frame; done += count) {
+            count = frame - done < MAX_PULL ? frame - done : MAX_PULL;
+            n_list = fx_pull_list(count, cmds_list);
+            n_fused = fx_pull_fused(count, cmds_fused);
+            tally(list, cmds_list, n_list);
+            tally(fused, cmds_fused, n_fused);
+            acmd_run(&acmd_list, (const AcmdWord*)cmds_list, n_list);
+            acmd_run(&acmd_fused, (const AcmdWord*)cmds_fused, n_fused);
+            if (memcmp(acmd_list.dmem.u8 + FX_AUX_L_OUT + ACMD_DMEM_BASE,
+                       acmd_fused.dmem.u8 + FX_AUX_L_OUT + ACMD_DMEM_BASE, count * 2)) {
+                return f;
+            }
+        }
+    }
+
+    list_delay = fx_delay_list(&list_length);
+    fused_delay = fx_delay_fused(&fused_length);
+    if (list_length != fused_length || memcmp(list_delay, fused_delay, list_length * 2)) {
+        return frames;
+    }
+    return -1;
+}
+
+/* ns per frame for building and for running the lists, best of RUNS */
+static void time_path(OpenFunc open, PullFunc pull, int fx, uint32_t rate, uint32_t frame, int frames,
+                      uint8_t* arena, const int16_t* input, Tally* t) {
+    uint64_t build, run, start;
+    uint32_t n, done;
+    int32_t count;
+    int r, f;
+
+    for (r = 0; r < RUNS; r++) {
+        open(fx, rate, arena, HEAP_SIZE, input, INPUT_SAMPLES);
+        acmd_init(&acmd_list, arena, ARENA_SIZE);
+        build = run = 0;
+        for (f = 0; f < frames; f++) {
+            for (done = 0; done < frame; done += count) {
+                count = frame - done < MAX_PULL ? frame - done : MAX_PULL;
+                start = now_ns();
+                n = pull(count, cmds_list);
+                build += now_ns() - start;
+                start = now_ns();
+                acmd_run(&acmd_list, (const AcmdWord*)cmds_list, n);
+                run += now_ns() - start;
+            }
+        }
+        if (r == 0 || (double)build / frames < t->build_ns) {
+            t->build_ns = (double)build / frames;
+        }
+        if (r == 0 || (double)run / frames < t->run_ns) {
+            t->run_ns = (double)run / frames;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t rate = 32000, frame = 0, seed = 1;
+    int frames = 2000;
+    Tally list, fused;
+    uint8_t* arena;
+    int16_t* input;
+    int failed = 0;
+    uint32_t i;
+    int fx, at;
+
+    for (i = 1; i < (uint32_t)argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < (uint32_t)argc) {
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--rate") && i + 1 < (uint32_t)argc) {
+            rate = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--frame") && i + 1 < (uint32_t)argc) {
+            frame = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < (uint32_t)argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: fxbench [--frames n] [--rate hz] [--frame samples] [--seed n]\n");
+            return 1;
+        }
+    }
+    if (frame == 0) {
+        frame = ((rate + 59) / 60 + 15) & ~15u;     /* as seqrender's */
+    }
+
+    /* libultra keeps the delay line and the DMA addresses as 32 bits */
+    arena = mmap(ARENA, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (arena != ARENA) {
+        fprintf(stderr, "fxbench: can't map the arena at %p\n", ARENA);
+        return 1;
+    }
+    input = (int16_t*)(arena + 2 * HEAP_SIZE);
+    srand(seed);
+    for (i = 0; i < INPUT_SAMPLES * 2; i++) {
+        input[i] = (int16_t)((rand() & 0x3FFF) - 0x2000);
+    }
+
+    printf("%d frames of %u samples at %u Hz, seed %u\n\n", frames, frame, rate, seed);
+    printf("%-9s | %13s | %11s %11s | %13s | %11s | %13s | %13s | %s\n", "", "commands", "loads", "saves",
+           "DMA bytes", "DMEM bytes", "build ns", "run ns", "output and");
+    printf("%-9s | %6s %6s | %5s %5s %5s %5s | %6s %6s | %5s %5s | %6s %6s | %6s %6s | %s\n", "fx", "list", "fused",
+           "list", "fused", "list", "fused", "list", "fused", "list", "fused", "list", "fused", "list", "fused",
+           "delay line");
+
+    for (fx = 0; fx < FX_COUNT; fx++) {
+        memset(&list, 0, sizeof(list));
+        memset(&fused, 0, sizeof(fused));
+        at = compare(fx, rate, frame, frames, arena, input, &list, &fused);
+        time_path(fx_open_list, fx_pull_list, fx, rate, frame, frames, arena, input, &list);
+        time_path(fx_open_fused, fx_pull_fused, fx, rate, frame, frames, arena + HEAP_SIZE, input, &fused);
+
+        printf("%-9s | %6.1f %6.1f | %5.1f %5.1f %5.1f %5.1f | %6.0f %6.0f | %5.0f %5.0f | %6.0f %6.0f | %6.0f "
+               "%6.0f | ",
+               render_fx_name(fx), (double)list.commands / frames, (double)fused.commands / frames,
+               (double)list.loads / frames, (double)fused.loads / frames, (double)list.saves / frames,
+               (double)fused.saves / frames, (double)list.dma_bytes / frames, (double)fused.dma_bytes / frames,
+               (double)list.dmem_bytes / frames, (double)fused.dmem_bytes / frames, list.build_ns, fused.build_ns,
+               list.run_ns, fused.run_ns);
+        if (at < 0) {
+            printf("identical\n");
+        } else if (at < frames) {
+            printf("OUTPUT DIFFERS at frame %d\n", at);
+            failed = 1;
+        } else {
+            printf("DELAY LINE DIFFERS\n");
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
@@ -0,0 +1,37 @@
+#ifndef FXBENCH_H
+#define FXBENCH_H
+
+/*
+ * Between fxbench.c and fxpull.c, which is built twice: as fx_*_list
+ * against reverb.c as it is and as fx_*_fused against reverb.c with
+ * AL_FX_FUSED. As with render.h, nothing here may pull in libultra.
+ */
+#include <stdint.h>
+
+/* What the source filter ahead of the effect puts in the aux buses each pull */
+#define FX_SOURCE_COMMANDS 4
+
+/* AL_AUX_L_OUT, where alFxPull leaves its output in DMEM */
+#define FX_AUX_L_OUT 1728
+
+/*
+ * Sets up an AL_FX_* effect, as alFxNew does for the synthesizer, at
+ * output_rate in heap. Each pull's aux input is read from input, which has
+ * to hold input_samples samples for the left bus followed by as many for
+ * the right. All of these need 32-bit addresses in the interpreter's RDRAM
+ * image. Returns the heap bytes the effect took.
+ */
+uint32_t fx_open_list(int fx, uint32_t output_rate, uint8_t* heap, uint32_t heap_size, const int16_t* input,
+                      uint32_t input_samples);
+uint32_t fx_open_fused(int fx, uint32_t output_rate, uint8_t* heap, uint32_t heap_size, const int16_t* input,
+                       uint32_t input_samples);
+
+/* One alFxPull of count samples into cmds; returns the commands written, the source's first */
+uint32_t fx_pull_list(int32_t count, uint64_t* cmds);
+uint32_t fx_pull_fused(int32_t count, uint64_t* cmds);
+
+/* Where the effect's delay line is, and its length in samples */
+int16_t* fx_delay_list(uint32_t* length);
+int16_t* fx_delay_fused(uint32_t* length);
+
+#endif
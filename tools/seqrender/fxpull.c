@@ -0,0 +1,77 @@
+/*
+ * The libultra side of fxbench: one ALFx, pulled on its own with a source
+ * filter that only loads the aux buses.
+ *
+ * Built twice, as fx_*_list against reverb.c as it is and as fx_*_fused
+ * against reverb.c with AL_FX_FUSED, whose symbols the Makefile renames so
+ * both can be linked together. alFxNew is the same for both.
+ */
+#include <ultra64.h>
+#include <libaudio.h>
+
+#include "synthInternals.h"
+#include "fxbench.h"
+
+#if FX_AUX_L_OUT != AL_AUX_L_OUT
+#error FX_AUX_L_OUT has to match AL_AUX_L_OUT
+#endif
+
+#ifdef AL_FX_FUSED
+#define FX_OPEN  fx_open_fused
+#define FX_PULL  fx_pull_fused
+#define FX_DELAY fx_delay_fused
+#else
+#define FX_OPEN  fx_open_list
+#define FX_PULL  fx_pull_list
+#define FX_DELAY fx_delay_list
+#endif
+
+static ALHeap heap;
+static ALFx fx;
+static ALFilter source;
+static const s16* input;
+static s32 input_samples;
+static s32 input_pos;
+
+static Acmd* source_pull(void* filter, s16* outp, s32 outCount, s32 sampleOffset, Acmd* p) {
+    Acmd* ptr = p;
+
+    if (input_pos + outCount > input_samples) {
+        input_pos = 0;
+    }
+    aSetBuffer(ptr++, 0, AL_AUX_L_OUT, 0, outCount << 1);
+    aLoadBuffer(ptr++, osVirtualToPhysical((void*)&input[input_pos]));
+    aSetBuffer(ptr++, 0, AL_AUX_R_OUT, 0, outCount << 1);
+    aLoadBuffer(ptr++, osVirtualToPhysical((void*)&input[input_samples + input_pos]));
+    input_pos += outCount;
+    return ptr;
+}
+
+uint32_t FX_OPEN(int type, uint32_t output_rate, uint8_t* base, uint32_t size, const int16_t* in,
+                 uint32_t in_samples) {
+    ALSynConfig config;
+
+    alHeapInit(&heap, base, size);
+    config.fxType = type;
+    config.outputRate = output_rate;
+    config.params = NULL;
+    alFxNew(&fx, &config, &heap);
+
+    alFilterNew(&source, source_pull, NULL, AL_AUXBUS);
+    fx.filter.source = &source;
+    input = in;
+    input_samples = in_samples;
+    input_pos = 0;
+    return heap.cur - heap.base;
+}
+
+uint32_t FX_PULL(int32_t count, uint64_t* cmds) {
+    Acmd* end = alFxPull(&fx, NULL, count, 0, (Acmd*)cmds);
+
+    return end - (Acmd*)cmds;
+}
+
+int16_t* FX_DELAY(uint32_t* length) {
+    *length = fx.length;
+    return fx.base;
+}
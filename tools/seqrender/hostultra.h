@@ -0,0 +1,50 @@
+/*
+ * Forced ahead of everything built against libultra's headers (-include).
+ *
+ * ultratypes.h spells s32 as long, which is 64 bits here, so its guard is
+ * taken and the types are given their N64 widths instead. alGlobals is
+ * redirected to a per-thread slot so every worker runs its own synthesizer;
+ * sl.c, which defines it, is replaced by render.c.
+ */
+#ifndef HOSTULTRA_H
+#define HOSTULTRA_H
+
+#define _ULTRATYPES_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef int64_t s64;
+
+typedef volatile u8 vu8;
+typedef volatile u16 vu16;
+typedef volatile u32 vu32;
+typedef volatile u64 vu64;
+
+typedef volatile s8 vs8;
+typedef volatile s16 vs16;
+typedef volatile s32 vs32;
+typedef volatile s64 vs64;
+
+typedef float f32;
+typedef double f64;
+
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+
+#define alGlobals (*render_globals())
+
+#endif
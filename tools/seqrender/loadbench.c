@@ -0,0 +1,272 @@
+/*
+ * loadbench: pulls groups of voices through load.c's ADPCM decoder as it
+ * is and with AL_ADPCM_SHARE, runs both command lists in the Acmd
+ * interpreter, checks that every pull leaves the same samples and every
+ * voice the same state, and counts what each asks of the DMA callback.
+ *
+ *   loadbench [--frames n] [--frame samples] [--seed n]
+ *
+ * Each voice plays one made-up wavetable of noise frames, looped or not,
+ * at a pitch, and is pulled as its resampler would pull it: a frame is
+ * split into slices of up to 160 samples (AL_MAX_RSP_SAMPLES), as
+ * alAudioFrame does, and each slice asks the voices in turn for as many
+ * samples as their pitch takes. Between slices the decoder's part of DMEM
+ * is scribbled over, as the effect does. DMAs and DMA bytes are the DMA
+ * callback's calls and the bytes they asked for; shared are the pulls
+ * that took the voice before's decode, reused the fetches served from
+ * one already made in the slice, and saved the bytes the two didn't ask
+ * for.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "loadbench.h"
+#include "acmd.h"
+
+#define MAX_PULL       160
+#define MAX_COMMANDS   256
+#define WAVE_FRAMES    4096     /* 9 bytes and 16 samples each */
+#define ORDER          2
+#define NPREDICTORS    2
+#define UNITY_PITCH    0x8000
+#define DECODER_DMEM   768      /* from LOAD_DECODER_OUT up to the main bus */
+
+#define ARENA          ((void*)0x10000000)
+#define ARENA_SIZE     0x1000000u
+#define HEAP_SIZE      0x100000u
+#define LIST_HEAP      0x400000u
+#define SHARE_HEAP     0x800000u
+
+typedef struct {
+    float ratio;
+    float bend;                 /* the ratio from halfway on */
+    int start;                  /* frame */
+    int looped;
+} VoiceSetup;
+
+typedef struct {
+    const char* name;
+    int voices;
+    VoiceSetup setup[LOAD_MAX_VOICES];
+} Scenario;
+
+typedef struct {
+    uint64_t pulls;
+    uint64_t commands;
+    uint64_t decodes;           /* ADPCM */
+} Tally;
+
+static const Scenario scenarios[] = {
+    { "unison", 8, { { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 1, 1, 0, 1 },
+                     { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 1, 1, 0, 1 } } },
+    { "one-shot", 8, { { 1, 1, 0, 0 }, { 1, 1, 0, 0 }, { 1, 1, 0, 0 }, { 1, 1, 0, 0 },
+                       { 1.5f, 1.5f, 0, 0 }, { 1.5f, 1.5f, 0, 0 }, { 1.5f, 1.5f, 0, 0 }, { 1.5f, 1.5f, 0, 0 } } },
+    { "layered", 8, { { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 0.5f, 0.5f, 0, 1 }, { 0.5f, 0.5f, 0, 1 },
+                      { 2, 2, 0, 1 }, { 2, 2, 0, 1 }, { 0.75f, 0.75f, 0, 1 }, { 0.75f, 0.75f, 0, 1 } } },
+    { "bend", 8, { { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 1, 1, 0, 1 }, { 1, 1, 0, 1 },
+                   { 1, 1.06f, 0, 1 }, { 1, 1.06f, 0, 1 }, { 1, 1.06f, 0, 1 }, { 1, 0.94f, 0, 1 } } },
+    { "detuned", 8, { { 1, 1, 0, 1 }, { 1.003f, 1.003f, 0, 1 }, { 1.006f, 1.006f, 0, 1 }, { 1.009f, 1.009f, 0, 1 },
+                      { 1.012f, 1.012f, 0, 1 }, { 1.015f, 1.015f, 0, 1 }, { 1.018f, 1.018f, 0, 1 },
+                      { 1.021f, 1.021f, 0, 1 } } },
+    { "staggered", 8, { { 1, 1, 0, 1 }, { 1, 1, 1, 1 }, { 1, 1, 2, 1 }, { 1, 1, 3, 1 },
+                        { 1, 1, 4, 1 }, { 1, 1, 5, 1 }, { 1, 1, 6, 1 }, { 1, 1, 7, 1 } } },
+};
+
+static AcmdState acmd_list, acmd_share;
+static uint64_t cmds_list[MAX_COMMANDS], cmds_share[MAX_COMMANDS];
+static void* globals;
+
+/* alGlobals, per hostultra.h; each side of loadpull.c points it at its own */
+void** render_globals(void) {
+    return &globals;
+}
+
+static uint32_t rng_state;
+
+static uint32_t rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void tally(Tally* t, const uint64_t* cmds, uint32_t n) {
+    const AcmdWord* w = (const AcmdWord*)cmds;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        if ((w[i].w0 >> 24) == ACMD_ADPCM) {
+            t->decodes++;
+        }
+    }
+    t->commands += n;
+    t->pulls++;
+}
+
+/* The resampler's samples in for count out at ratio, as alResamplePull works them out */
+static int32_t in_count(float ratio, float* delta, int32_t count) {
+    float fin;
+    int32_t in;
+
+    ratio = (float)(int32_t)(ratio * UNITY_PITCH) / UNITY_PITCH;
+    fin = *delta + ratio * (float)count;
+    in = (int32_t)fin;
+    *delta = fin - (float)in;
+    return in;
+}
+
+/*
+ * Plays the scenario through both sides, checking each pull's output and
+ * each voice's state at the end; returns the frame they first differ at,
+ * frames if only the states do, or -1
+ */
+static int compare(const Scenario* s, const LoadWave* looped, const LoadWave* one_shot, uint32_t frame, int frames,
+                   uint8_t* arena, Tally* list, Tally* share) {
+    float delta[LOAD_MAX_VOICES];
+    uint32_t n_list, n_share, done, time = 0;
+    int16_t outp_list, outp_share;
+    int32_t count, in;
+    float ratio;
+    int f, v;
+
+    memset(arena + LIST_HEAP, 0, HEAP_SIZE);
+    memset(arena + SHARE_HEAP, 0, HEAP_SIZE);
+    load_open_list(arena + LIST_HEAP, HEAP_SIZE, s->voices);
+    load_open_share(arena + SHARE_HEAP, HEAP_SIZE, s->voices);
+    acmd_init(&acmd_list, arena, ARENA_SIZE);
+    acmd_init(&acmd_share, arena, ARENA_SIZE);
+    memset(delta, 0, sizeof(delta));
+
+    for (f = 0; f < frames; f++) {
+        for (v = 0; v < s->voices; v++) {
+            if (s->setup[v].start == f) {
+                load_start_list(v, s->setup[v].looped ? looped : one_shot);
+                load_start_share(v, s->setup[v].looped ? looped : one_shot);
+            }
+        }
+        for (done = 0; done < frame; done += count, time += count) {
+            count = frame - done < MAX_PULL ? frame - done : MAX_PULL;
+            for (v = 0; v < s->voices; v++) {
+                if (s->setup[v].start > f) {
+                    continue;
+                }
+                ratio = f < frames / 2 ? s->setup[v].ratio : s->setup[v].bend;
+                in = in_count(ratio, &delta[v], count);
+                outp_list = outp_share = LOAD_DECODER_OUT;
+                n_list = load_pull_list(v, in, time, &outp_list, cmds_list);
+                n_share = load_pull_share(v, in, time, &outp_share, cmds_share);
+                tally(list, cmds_list, n_list);
+                tally(share, cmds_share, n_share);
+                acmd_run(&acmd_list, (const AcmdWord*)cmds_list, n_list);
+                acmd_run(&acmd_share, (const AcmdWord*)cmds_share, n_share);
+                if (outp_list != outp_share ||
+                    memcmp(acmd_list.dmem.u8 + ACMD_DMEM_BASE + outp_list,
+                           acmd_share.dmem.u8 + ACMD_DMEM_BASE + outp_share, in * 2)) {
+                    return f;
+                }
+            }
+            memset(acmd_list.dmem.u8 + ACMD_DMEM_BASE + LOAD_DECODER_OUT, 0xA5, DECODER_DMEM);
+            memset(acmd_share.dmem.u8 + ACMD_DMEM_BASE + LOAD_DECODER_OUT, 0x5A, DECODER_DMEM);
+        }
+    }
+
+    for (v = 0; v < s->voices; v++) {
+        if (memcmp(load_state_list(v), load_state_share(v), 16 * sizeof(int16_t))) {
+            return frames;
+        }
+    }
+    return -1;
+}
+
+int main(int argc, char** argv) {
+    uint32_t frame = 544, seed = 1;
+    int frames = 600;
+    LoadWave looped, one_shot;
+    LoadCounts list_counts, share_counts;
+    Tally list, share;
+    uint8_t *arena, *data;
+    int16_t *book, *loop_state;
+    int failed = 0;
+    uint32_t i;
+    int s, at;
+
+    for (i = 1; i < (uint32_t)argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < (uint32_t)argc) {
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--frame") && i + 1 < (uint32_t)argc) {
+            frame = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < (uint32_t)argc) {
+            seed = strtoul(argv[++i], NULL, 0);
+        } else {
+            fprintf(stderr, "usage: loadbench [--frames n] [--frame samples] [--seed n]\n");
+            return 1;
+        }
+    }
+    rng_state = seed ? seed : 1;
+
+    /* libultra keeps the wavetable, its book and the states as 32-bit addresses */
+    arena = mmap(ARENA, ARENA_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (arena != ARENA) {
+        fprintf(stderr, "loadbench: can't map the arena at %p\n", ARENA);
+        return 1;
+    }
+
+    /* Noise frames at modest scales, so the predictors don't run away */
+    data = arena;
+    for (i = 0; i < WAVE_FRAMES * 9; i++) {
+        data[i] = (i % 9 == 0) ? ((6 + rng() % 5) << 4) | (rng() % NPREDICTORS) : rng();
+    }
+    book = (int16_t*)(arena + WAVE_FRAMES * 9 + 16);
+    for (i = 0; i < ORDER * NPREDICTORS * 8; i++) {
+        book[i] = (int16_t)(rng() % 4096) - 2048;
+    }
+    loop_state = book + ORDER * NPREDICTORS * 8;
+    for (i = 0; i < 16; i++) {
+        loop_state[i] = (int16_t)(rng() % 6000) - 3000;
+    }
+    one_shot.data = data;
+    one_shot.len = WAVE_FRAMES * 9;
+    one_shot.book = book;
+    one_shot.order = ORDER;
+    one_shot.npredictors = NPREDICTORS;
+    one_shot.looped = 0;
+    looped = one_shot;
+    looped.looped = 1;
+    looped.loop_start = 1000;
+    looped.loop_end = WAVE_FRAMES * 16 - 40;
+    looped.loop_state = loop_state;
+
+    printf("%d frames of %u samples, seed %u\n\n", frames, frame, seed);
+    printf("%-10s | %6s | %13s | %15s | %15s | %15s | %6s %6s %9s | %s\n", "", "", "DMAs", "DMA bytes",
+           "commands", "decodes", "", "", "", "output and");
+    printf("%-10s | %6s | %6s %6s | %7s %7s | %7s %7s | %7s %7s | %6s %6s %9s | %s\n", "voices", "pulls", "list",
+           "share", "list", "share", "list", "share", "list", "share", "shared", "reused", "saved", "state");
+
+    for (s = 0; s < (int)(sizeof(scenarios) / sizeof(scenarios[0])); s++) {
+        memset(&list, 0, sizeof(list));
+        memset(&share, 0, sizeof(share));
+        at = compare(&scenarios[s], &looped, &one_shot, frame, frames, arena, &list, &share);
+        load_counts_list(&list_counts);
+        load_counts_share(&share_counts);
+
+        printf("%-10s | %6llu | %6u %6u | %7u %7u | %7llu %7llu | %7llu %7llu | %6u %6u %8.1f%% | ", scenarios[s].name,
+               (unsigned long long)list.pulls, list_counts.dmas, share_counts.dmas, list_counts.dma_bytes,
+               share_counts.dma_bytes, (unsigned long long)list.commands, (unsigned long long)share.commands,
+               (unsigned long long)list.decodes, (unsigned long long)share.decodes, share_counts.shared,
+               share_counts.reused,
+               list_counts.dma_bytes ? 100.0 * share_counts.saved_bytes / list_counts.dma_bytes : 0.0);
+        if (at < 0) {
+            printf("identical\n");
+        } else if (at < frames) {
+            printf("OUTPUT DIFFERS at frame %d\n", at);
+            failed = 1;
+        } else {
+            printf("STATE DIFFERS\n");
+            failed = 1;
+        }
+    }
+
+    return failed;
+}
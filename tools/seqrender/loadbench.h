@@ -0,0 +1,63 @@
+#ifndef LOADBENCH_H
+#define LOADBENCH_H
+
+/*
+ * Between loadbench.c and loadpull.c, which is built twice: as load_*_list
+ * against load.c as it is and as load_*_share against load.c with
+ * AL_ADPCM_SHARE. As with render.h, nothing here may pull in libultra.
+ */
+#include <stdint.h>
+
+#define LOAD_MAX_VOICES 16
+
+/* AL_DECODER_OUT, where the resampler has the decoder start its output */
+#define LOAD_DECODER_OUT 320
+
+/* One ADPCM wavetable; data, book and loop_state need 32-bit addresses */
+typedef struct {
+    const uint8_t* data;
+    uint32_t len;
+    const int16_t* book;
+    int32_t order;
+    int32_t npredictors;
+    int looped;
+    uint32_t loop_start;
+    uint32_t loop_end;
+    const int16_t* loop_state;
+} LoadWave;
+
+typedef struct {
+    uint32_t dmas;              /* calls to the DMA callback */
+    uint32_t dma_bytes;
+    uint32_t shared;            /* the rest only from the shared side */
+    uint32_t reused;
+    uint32_t saved_bytes;
+} LoadCounts;
+
+/*
+ * Sets up voices decoders in heap, as alSynNew does, each of them stopped.
+ * The heap needs a 32-bit address too.
+ */
+void load_open_list(uint8_t* heap, uint32_t heap_size, int voices);
+void load_open_share(uint8_t* heap, uint32_t heap_size, int voices);
+
+/* Starts voice on wave from the top, as a note on does */
+void load_start_list(int voice, const LoadWave* wave);
+void load_start_share(int voice, const LoadWave* wave);
+
+/*
+ * One alAdpcmPull of count samples for voice into cmds, in the slice
+ * starting at time; *outp is where the output starts, before and after.
+ * Returns the commands written.
+ */
+uint32_t load_pull_list(int voice, int32_t count, uint32_t time, int16_t* outp, uint64_t* cmds);
+uint32_t load_pull_share(int voice, int32_t count, uint32_t time, int16_t* outp, uint64_t* cmds);
+
+/* Where voice's ADPCM state is, 16 samples */
+const int16_t* load_state_list(int voice);
+const int16_t* load_state_share(int voice);
+
+void load_counts_list(LoadCounts* counts);
+void load_counts_share(LoadCounts* counts);
+
+#endif
@@ -0,0 +1,150 @@
+/*
+ * The libultra side of loadbench: ADPCM decoders pulled on their own, as the
+ * resampler above each would pull it, with a DMA callback that counts.
+ *
+ * Built twice, as load_*_list against load.c as it is and as load_*_share
+ * against load.c with AL_ADPCM_SHARE; the Makefile renames load.c's
+ * symbols in both so they can be linked together.
+ */
+#include <ultra64.h>
+#include <libaudio.h>
+
+#include "synthInternals.h"
+#include "loadbench.h"
+
+#if LOAD_DECODER_OUT != AL_DECODER_OUT
+#error LOAD_DECODER_OUT has to match AL_DECODER_OUT
+#endif
+
+#ifdef AL_ADPCM_SHARE
+#define LOAD_OPEN   load_open_share
+#define LOAD_START  load_start_share
+#define LOAD_PULL   load_pull_share
+#define LOAD_STATE  load_state_share
+#define LOAD_COUNTS load_counts_share
+#else
+#define LOAD_OPEN   load_open_list
+#define LOAD_START  load_start_list
+#define LOAD_PULL   load_pull_list
+#define LOAD_STATE  load_state_list
+#define LOAD_COUNTS load_counts_list
+#endif
+
+#define MAX_WAVES 4
+
+static ALGlobals globals;
+static ALHeap heap;
+static ALLoadFilter filters[LOAD_MAX_VOICES];
+static ALWaveTable tables[MAX_WAVES];
+static const LoadWave* waves[MAX_WAVES];
+static int wave_count;
+static LoadCounts counts;
+
+static s32 dma_proc(s32 addr, s32 len, void* state) {
+    counts.dmas++;
+    counts.dma_bytes += len;
+    return addr;
+}
+
+/* The one ALWaveTable for wave, so voices on the same wave play the same table */
+static ALWaveTable* table_for(const LoadWave* wave) {
+    ALWaveTable* t;
+    ALADPCMBook* book;
+    ALADPCMloop* loop;
+    s32 size = wave->order * wave->npredictors * 8 * sizeof(s16);
+    int i;
+
+    for (i = 0; i < wave_count; i++) {
+        if (waves[i] == wave) {
+            return &tables[i];
+        }
+    }
+
+    book = alHeapAlloc(&heap, 1, sizeof(ALADPCMBook) + size);
+    book->order = wave->order;
+    book->npredictors = wave->npredictors;
+    alCopy((void*)wave->book, book->book, size);
+    loop = NULL;
+    if (wave->looped) {
+        loop = alHeapAlloc(&heap, 1, sizeof(ALADPCMloop));
+        loop->start = wave->loop_start;
+        loop->end = wave->loop_end;
+        loop->count = -1;
+        alCopy((void*)wave->loop_state, loop->state, sizeof(ADPCM_STATE));
+    }
+
+    t = &tables[wave_count];
+    waves[wave_count++] = wave;
+    t->base = (u8*)wave->data;
+    t->len = wave->len;
+    t->type = AL_ADPCM_WAVE;
+    t->flags = 0;
+    t->waveInfo.adpcmWave.loop = loop;
+    t->waveInfo.adpcmWave.book = book;
+    return t;
+}
+
+void LOAD_OPEN(uint8_t* base, uint32_t size, int voices) {
+    ALLoadFilter* f;
+    int i;
+
+    alHeapInit(&heap, base, size);
+    wave_count = 0;
+    counts.dmas = counts.dma_bytes = 0;
+
+    /* As alLoadNew, which comes with the rest of drvrnew.c */
+    for (i = 0; i < voices; i++) {
+        f = &filters[i];
+        alFilterNew((ALFilter*)f, alAdpcmPull, alLoadParam, AL_ADPCM);
+        f->state = alHeapAlloc(&heap, 1, sizeof(ADPCM_STATE));
+        f->lstate = alHeapAlloc(&heap, 1, sizeof(ADPCM_STATE));
+        f->dma = dma_proc;
+        f->dmaState = NULL;
+        f->table = NULL;
+        f->lastsam = 0;
+        f->first = 1;
+        f->memin = 0;
+#ifdef AL_ADPCM_SHARE
+        f->twin = 0;
+        f->twinGen = 0;
+        f->gen = 0;
+#endif
+    }
+
+    /* And alSynNew's part */
+#ifdef AL_ADPCM_SHARE
+    globals.drvr.loadShare = alHeapAlloc(&heap, 1, sizeof(ALLoadShare));
+    bzero(globals.drvr.loadShare, sizeof(ALLoadShare));
+    globals.drvr.loadShare->time = -1;
+#endif
+}
+
+void LOAD_START(int voice, const LoadWave* wave) {
+    alLoadParam(&filters[voice], AL_FILTER_SET_WAVETABLE, table_for(wave));
+    alLoadParam(&filters[voice], AL_FILTER_RESET, NULL);
+}
+
+uint32_t LOAD_PULL(int voice, int32_t count, uint32_t time, int16_t* outp, uint64_t* cmds) {
+    Acmd* end;
+
+    alGlobals = &globals;
+    globals.drvr.curSamples = time;
+    end = alAdpcmPull(&filters[voice], outp, count, 0, (Acmd*)cmds);
+    return end - (Acmd*)cmds;
+}
+
+const int16_t* LOAD_STATE(int voice) {
+    return (const int16_t*)filters[voice].state;
+}
+
+void LOAD_COUNTS(LoadCounts* c) {
+#ifdef AL_ADPCM_SHARE
+    ALSynLoadStats stats;
+
+    alSynGetLoadStats(&globals.drvr, &stats);
+    counts.shared = stats.shared;
+    counts.reused = stats.reused;
+    counts.saved_bytes = stats.savedBytes;
+#endif
+    *c = counts;
+}
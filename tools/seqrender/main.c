@@ -0,0 +1,485 @@
+/*
+ * seqrender: renders sequences offline through libultra's synthesizer and
+ * sequence players, one worker thread per core.
+ *
+ *   seqrender [options] <bank.ctl> <bank.tbl> <seq>...
+ *   seqrender [options] -l <jobs>
+ *
+ * A job list has one render per line: <ctl> <tbl> <seq> [out.wav]. Blank
+ * lines and lines starting with # are skipped. Sequences starting with MThd
+ * play through ALSeqPlayer, anything else is taken as a compressed sequence
+ * for ALCSPlayer.
+ *
+ * Every worker has its own arena, heap, ALGlobals and Acmd interpreter, so
+ * the only thing shared is the read-only bank and sequence files. Each frame
+ * is alAudioFrame's command list run through tools/acmd; ACMD_KERNELS picks
+ * the kernels as for acmdbench.
+ *
+ * Options:
+ *   -j <n>       workers (default: one per online CPU)
+ *   -o <dir>     where <seq>.wav files go (default: .)
+ *   -n           render without writing anything, for timing
+ *   -b <n>       bank index in the .ctl (default 0)
+ *   -r <hz>      output rate (default 32000)
+ *   -v <n>       voices (default 24)
+ *   -p <n>       physical voices, fewer than -v to make the synthesizer steal (default: -v)
+ *   -f <fx>      none, smallroom, bigroom, chorus, flange or echo (default smallroom)
+ *   -t <s>       stop sequences that loop after this long (default 600)
+ *   -T <s>       render this long after a sequence stops (default 2)
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "render.h"
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
+
+#define MAX_WORKERS 64
+
+typedef struct {
+    char* path;
+    uint8_t* data;
+    size_t size;
+} File;
+
+typedef struct {
+    size_t ctl; /* indices into files[], which grows while jobs are added */
+    size_t tbl;
+    size_t seq;
+    char* out;
+    double wall;
+    RenderResult result;
+} Job;
+
+typedef struct {
+    void* arena;
+    AcmdState* acmd;
+    pthread_t thread;
+} Worker;
+
+typedef struct {
+    FILE* file;
+    uint32_t samples;
+} WavSink;
+
+static File* files;
+static size_t file_count;
+static Job* jobs;
+static size_t job_count;
+static size_t next_job;
+static size_t jobs_done;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static RenderJob config = {
+    .bank = 0,
+    .output_rate = 32000,
+    .voices = 24,
+    .fx = 1, /* AL_FX_SMALLROOM */
+};
+static double max_seconds = 600;
+static double tail_seconds = 2;
+static const char* out_dir = ".";
+static int no_output;
+
+static double now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* xmalloc(size_t size) {
+    void* ptr = malloc(size);
+
+    if (ptr == NULL) {
+        fprintf(stderr, "seqrender: out of memory\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+/* Banks are usually shared by many sequences, so each path is read once */
+static size_t load_file(const char* path) {
+    FILE* f;
+    File* file;
+    long size;
+    size_t i;
+
+    for (i = 0; i < file_count; i++) {
+        if (strcmp(files[i].path, path) == 0) {
+            return i;
+        }
+    }
+
+    if ((f = fopen(path, "rb")) == NULL || fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < 0 ||
+        fseek(f, 0, SEEK_SET) != 0) {
+        fprintf(stderr, "seqrender: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    files = realloc(files, (file_count + 1) * sizeof(File));
+    if (files == NULL) {
+        fprintf(stderr, "seqrender: out of memory\n");
+        exit(1);
+    }
+    file = &files[file_count++];
+    file->path = strdup(path);
+    file->size = size;
+    file->data = xmalloc(size + 1);
+    if (fread(file->data, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "seqrender: %s: short read\n", path);
+        exit(1);
+    }
+    fclose(f);
+    return file_count - 1;
+}
+
+static void add_job(const char* ctl, const char* tbl, const char* seq, const char* out) {
+    Job* job;
+
+    jobs = realloc(jobs, (job_count + 1) * sizeof(Job));
+    if (jobs == NULL) {
+        fprintf(stderr, "seqrender: out of memory\n");
+        exit(1);
+    }
+    job = &jobs[job_count++];
+    memset(job, 0, sizeof(*job));
+    job->ctl = load_file(ctl);
+    job->tbl = load_file(tbl);
+    job->seq = load_file(seq);
+
+    if (out != NULL) {
+        job->out = strdup(out);
+    } else {
+        const char* base = strrchr(seq, '/');
+        const char* dot;
+        size_t len;
+
+        base = base != NULL ? base + 1 : seq;
+        dot = strrchr(base, '.');
+        len = dot != NULL && dot != base ? (size_t)(dot - base) : strlen(base);
+        job->out = xmalloc(strlen(out_dir) + len + 6);
+        sprintf(job->out, "%s/%.*s.wav", out_dir, (int)len, base);
+    }
+}
+
+static void read_job_list(const char* path) {
+    char line[4096];
+    FILE* f = fopen(path, "r");
+    int lineno = 0;
+
+    if (f == NULL) {
+        fprintf(stderr, "seqrender: %s: %s\n", path, strerror(errno));
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char ctl[1024], tbl[1024], seq[1024], out[1024];
+        int n;
+
+        lineno++;
+        n = sscanf(line, "%1023s %1023s %1023s %1023s", ctl, tbl, seq, out);
+        if (n <= 0 || ctl[0] == '#') {
+            continue;
+        }
+        if (n < 3) {
+            fprintf(stderr, "seqrender: %s:%d: expected <ctl> <tbl> <seq> [out.wav]\n", path, lineno);
+            exit(1);
+        }
+        add_job(ctl, tbl, seq, n == 4 ? out : NULL);
+    }
+    fclose(f);
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    put16(p, v);
+    put16(p + 2, v >> 16);
+}
+
+static int write_wav_header(FILE* f, uint32_t rate, uint32_t samples) {
+    uint8_t h[44];
+
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + samples * 4);
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, 1);
+    put16(h + 22, 2);
+    put32(h + 24, rate);
+    put32(h + 28, rate * 4);
+    put16(h + 32, 4);
+    put16(h + 34, 16);
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, samples * 4);
+    return fwrite(h, 1, sizeof(h), f) == sizeof(h) ? 0 : -1;
+}
+
+static int wav_sink(void* user, const int16_t* samples, uint32_t count) {
+    WavSink* sink = user;
+    uint8_t buf[4096 * 4];
+    uint32_t i;
+
+    if (sink->file == NULL) {
+        return 0;
+    }
+    while (count > 0) {
+        uint32_t n = count < 4096 ? count : 4096;
+
+        for (i = 0; i < n * 2; i++) {
+            put16(buf + i * 2, samples[i]);
+        }
+        if (fwrite(buf, 4, n, sink->file) != n) {
+            return -1;
+        }
+        sink->samples += n;
+        samples += n * 2;
+        count -= n;
+    }
+    return 0;
+}
+
+static void report(const Job* job) {
+    double seconds = (double)job->result.samples / config.output_rate;
+
+    if (job->result.error != NULL) {
+        printf("[%zu/%zu] %s: %s\n", jobs_done, job_count, files[job->seq].path, job->result.error);
+    } else {
+        printf("[%zu/%zu] %s: %.2fs audio in %.3fs wall, %.1fx realtime%s (%s, %u commands/frame, %u KB heap)\n",
+               jobs_done, job_count, files[job->seq].path, seconds, job->wall, seconds / job->wall,
+               job->result.ended ? "" : ", cut at -t", job->result.compressed ? "csp" : "seqp",
+               job->result.max_commands, job->result.heap_used / 1024);
+        if (job->result.voice_steals != 0 || job->result.voice_fails != 0) {
+            printf("        %u voices stolen, %u allocations failed\n", job->result.voice_steals,
+                   job->result.voice_fails);
+        }
+        if (job->result.adpcm_pulls != 0) {
+            printf("        %u of %u ADPCM pulls shared, %u DMAs, %u reused, %u KB not fetched\n",
+                   job->result.adpcm_shared, job->result.adpcm_pulls, job->result.dma_fetches,
+                   job->result.dma_reused, job->result.dma_saved / 1024);
+        }
+        if (job->result.profile != NULL) {
+            fputs(job->result.profile, stdout);
+        }
+    }
+    fflush(stdout);
+}
+
+static void* worker_main(void* arg) {
+    Worker* worker = arg;
+
+    for (;;) {
+        RenderJob rj = config;
+        WavSink sink = { NULL, 0 };
+        Job* job;
+        double start;
+
+        pthread_mutex_lock(&lock);
+        job = next_job < job_count ? &jobs[next_job++] : NULL;
+        pthread_mutex_unlock(&lock);
+        if (job == NULL) {
+            break;
+        }
+
+        rj.ctl = files[job->ctl].data;
+        rj.ctl_size = files[job->ctl].size;
+        rj.tbl = files[job->tbl].data;
+        rj.tbl_size = files[job->tbl].size;
+        rj.seq = files[job->seq].data;
+        rj.seq_size = files[job->seq].size;
+
+        if (!no_output) {
+            if ((sink.file = fopen(job->out, "wb")) == NULL || write_wav_header(sink.file, rj.output_rate, 0) != 0) {
+                job->result.error = strerror(errno);
+                goto finished;
+            }
+        }
+
+        start = now();
+        render_sequence(worker->arena, worker->acmd, &rj, wav_sink, &sink, &job->result);
+        job->wall = now() - start;
+
+        if (sink.file != NULL) {
+            if (fseek(sink.file, 0, SEEK_SET) != 0 || write_wav_header(sink.file, rj.output_rate, sink.samples) != 0) {
+                job->result.error = "write failed";
+            }
+            if (fclose(sink.file) != 0 && job->result.error == NULL) {
+                job->result.error = "write failed";
+            }
+        }
+
+    finished:
+        pthread_mutex_lock(&lock);
+        jobs_done++;
+        report(job);
+        pthread_mutex_unlock(&lock);
+    }
+    return NULL;
+}
+
+/* See render.h for why each arena has to land on a 16MB boundary below 2GB */
+static void* map_arena(uintptr_t* next) {
+    for (; *next + RENDER_ARENA_SIZE <= RENDER_ARENA_LIMIT; *next += RENDER_ARENA_SIZE) {
+        void* want = (void*)*next;
+        void* got = mmap(want, RENDER_ARENA_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+        if (got == want) {
+            *next += RENDER_ARENA_SIZE;
+            return got;
+        }
+        if (got != MAP_FAILED) {
+            munmap(got, RENDER_ARENA_SIZE);
+        }
+    }
+    return NULL;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: seqrender [-j workers] [-o dir] [-n] [-b bank] [-r rate] [-v voices] [-p voices]\n"
+                    "                 [-f fx] [-t max_seconds] [-T tail_seconds] (<ctl> <tbl> <seq>... | -l <jobs>)\n");
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    Worker workers[MAX_WORKERS];
+    const char* list = NULL;
+    uintptr_t next_arena = RENDER_ARENA_FIRST;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int worker_count = cpus > 0 ? (int)cpus : 1;
+    double total_audio = 0;
+    double total_wall = 0;
+    double start;
+    int failed = 0;
+    size_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:o:nb:r:v:p:f:t:T:l:")) != -1) {
+        switch (opt) {
+            case 'j':
+                worker_count = atoi(optarg);
+                break;
+            case 'o':
+                out_dir = optarg;
+                break;
+            case 'n':
+                no_output = 1;
+                break;
+            case 'b':
+                config.bank = atoi(optarg);
+                break;
+            case 'r':
+                config.output_rate = atoi(optarg);
+                break;
+            case 'v':
+                config.voices = atoi(optarg);
+                break;
+            case 'p':
+                config.pvoices = atoi(optarg);
+                break;
+            case 'f':
+                if ((config.fx = render_fx_from_name(optarg)) < 0) {
+                    fprintf(stderr, "seqrender: unknown effect %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                max_seconds = atof(optarg);
+                break;
+            case 'T':
+                tail_seconds = atof(optarg);
+                break;
+            case 'l':
+                list = optarg;
+                break;
+            default:
+                usage();
+        }
+    }
+
+    if (list != NULL) {
+        if (optind != argc) {
+            usage();
+        }
+        read_job_list(list);
+    } else {
+        if (argc - optind < 3) {
+            usage();
+        }
+        for (i = optind + 2; i < (size_t)argc; i++) {
+            add_job(argv[optind], argv[optind + 1], argv[i], NULL);
+        }
+    }
+
+    if (config.output_rate < 8000 || config.output_rate > 48000 || config.voices <= 0 || config.pvoices < 0 ||
+        max_seconds <= 0 || tail_seconds < 0) {
+        usage();
+    }
+    if (config.pvoices == 0 || config.pvoices > config.voices) {
+        config.pvoices = config.voices;
+    }
+    /* One video frame's worth per alAudioFrame, as the game runs it */
+    config.frame_samples = ((config.output_rate + 59) / 60 + 15) & ~15u;
+    config.max_samples = (uint32_t)(max_seconds * config.output_rate);
+    config.tail_samples = (uint32_t)(tail_seconds * config.output_rate);
+
+    if (worker_count < 1) {
+        worker_count = 1;
+    }
+    if (worker_count > MAX_WORKERS) {
+        worker_count = MAX_WORKERS;
+    }
+    if ((size_t)worker_count > job_count) {
+        worker_count = (int)job_count;
+    }
+
+    printf("seqrender: %zu sequences on %d workers, %u Hz, %d voices, fx %s, %s kernels\n", job_count,
+           worker_count, config.output_rate, config.voices, render_fx_name(config.fx),
+           acmd_kernels_name(acmd_kernels_from_env()));
+
+    for (i = 0; i < (size_t)worker_count; i++) {
+        workers[i].arena = map_arena(&next_arena);
+        workers[i].acmd = aligned_alloc(64, (sizeof(AcmdState) + 63) & ~(size_t)63);
+        if (workers[i].arena == NULL || workers[i].acmd == NULL) {
+            fprintf(stderr, "seqrender: can't map an arena for worker %zu\n", i);
+            return 1;
+        }
+    }
+
+    start = now();
+    for (i = 0; i < (size_t)worker_count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0) {
+            fprintf(stderr, "seqrender: can't start worker %zu\n", i);
+            return 1;
+        }
+    }
+    for (i = 0; i < (size_t)worker_count; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    total_wall = now() - start;
+
+    for (i = 0; i < job_count; i++) {
+        if (jobs[i].result.error != NULL) {
+            failed++;
+        } else {
+            total_audio += (double)jobs[i].result.samples / config.output_rate;
+        }
+    }
+    printf("seqrender: %.2fs audio in %.3fs wall, %.1fx realtime overall", total_audio, total_wall,
+           total_wall > 0 ? total_audio / total_wall : 0);
+    if (failed != 0) {
+        printf(", %d failed", failed);
+    }
+    printf("\n");
+    return failed != 0;
+}
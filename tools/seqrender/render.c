@@ -0,0 +1,726 @@
+/*
+ * The libultra side of seqrender: loads a bank into a worker's arena, drives
+ * alAudioFrame through ALSeqPlayer or ALCSPlayer, and runs each frame's
+ * command list through the Acmd interpreter.
+ *
+ * Built with hostultra.h forced in, so it sees only libultra's headers.
+ */
+#include <ultra64.h>
+#include <libaudio.h>
+#ifdef AL_PROFILE
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#endif
+
+#include "render.h"
+
+#define AL_HEAP_RESERVE  0x100000 /* synthesizer, players and their events */
+#define RENDER_COMMANDS  0x4000
+#define LOADED_OBJECTS   4096
+#define SOUND_INDEX_SIZE 0x20000 /* with SOUND_INDEX=on; comes out of AL_HEAP_RESERVE */
+
+enum {
+    OBJ_INSTRUMENT,
+    OBJ_SOUND,
+    OBJ_ENVELOPE,
+    OBJ_KEYMAP,
+    OBJ_WAVETABLE,
+    OBJ_BOOK,
+    OBJ_LOOP
+};
+
+typedef struct {
+    u32 offset;
+    u32 kind;
+    void* object;
+} LoadedObject;
+
+typedef struct {
+    ALHeap* heap;
+    const u8* ctl;
+    u32 ctl_size;
+    u8* tbl;
+    u32 tbl_size;
+    u8* swapped; /* one bit per RAW16 sample already made host-endian */
+    LoadedObject* objects;
+    const char* error;
+} BankLoader;
+
+static __thread ALGlobals* worker_globals;
+
+/* alGlobals, per hostultra.h */
+ALGlobals** render_globals(void) {
+    return &worker_globals;
+}
+
+/* sl.c's, against the per-thread alGlobals */
+void alInit(ALGlobals* g, ALSynConfig* c) {
+    if (!alGlobals) {
+        alGlobals = g;
+        alSynNew(&alGlobals->drvr, c);
+    }
+}
+
+void alClose(ALGlobals* glob) {
+    if (alGlobals) {
+        alSynDelete(&glob->drvr);
+        alGlobals = 0;
+    }
+}
+
+void alLink(ALLink* ln, ALLink* to) {
+    ln->next = to->next;
+    ln->prev = to;
+    if (to->next) {
+        to->next->prev = ln;
+    }
+    to->next = ln;
+}
+
+void alUnlink(ALLink* ln) {
+    if (ln->next) {
+        ln->next->prev = ln->prev;
+    }
+    if (ln->prev) {
+        ln->prev->next = ln->next;
+    }
+}
+
+/* There is nothing to mask and no TLB: addresses pass through unchanged */
+OSIntMask osSetIntMask(OSIntMask mask) {
+    return mask;
+}
+
+u32 osVirtualToPhysical(void* addr) {
+    return (u32)(uintptr_t)addr;
+}
+
+#ifdef AL_PROFILE
+static __thread char profile_text[2048];
+static __thread size_t profile_length;
+
+/* The worker's CPU time, at the N64's 46.875MHz count rate */
+u32 osGetCount(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (u32)(((u64)ts.tv_sec * 1000000000u + ts.tv_nsec) * 3 / 64);
+}
+
+/* alProfileDump's lines, collected for the job's report */
+void osSyncPrintf(const char* fmt, ...) {
+    va_list args;
+    int n;
+
+    if (profile_length >= sizeof(profile_text)) {
+        return;
+    }
+    va_start(args, fmt);
+    n = vsnprintf(profile_text + profile_length, sizeof(profile_text) - profile_length, fmt, args);
+    va_end(args);
+    if (n > 0) {
+        profile_length += n;
+    }
+}
+#endif
+
+/* The whole .tbl already sits in the arena, so a "DMA" is just its address */
+static s32 dma_proc(s32 addr, s32 len, void* state) {
+    return addr;
+}
+
+static ALDMAproc dma_new(void* state) {
+    return dma_proc;
+}
+
+static u16 be16(const u8* p) {
+    return (p[0] << 8) | p[1];
+}
+
+static u32 be32(const u8* p) {
+    return ((u32)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void* loader_alloc(BankLoader* l, s32 size) {
+    void* ptr = alHeapAlloc(l->heap, 1, size);
+
+    if (ptr == NULL && l->error == NULL) {
+        l->error = "arena full";
+    }
+    return ptr;
+}
+
+static const u8* loader_at(BankLoader* l, u32 offset, u32 size) {
+    if (offset >= l->ctl_size || size > l->ctl_size - offset) {
+        if (l->error == NULL) {
+            l->error = "bank offset out of range";
+        }
+        return NULL;
+    }
+    return l->ctl + offset;
+}
+
+/* Banks share envelopes, keymaps and wavetables between sounds, so every object is loaded once */
+static LoadedObject* loader_find(BankLoader* l, u32 offset, u32 kind) {
+    u32 i = ((offset * 2654435761u) ^ kind) & (LOADED_OBJECTS - 1);
+    u32 probes;
+
+    for (probes = 0; probes < LOADED_OBJECTS; probes++) {
+        LoadedObject* o = &l->objects[i];
+
+        if (o->object == NULL || (o->offset == offset && o->kind == kind)) {
+            return o;
+        }
+        i = (i + 1) & (LOADED_OBJECTS - 1);
+    }
+    l->error = "too many bank objects";
+    return NULL;
+}
+
+static void* loader_remember(LoadedObject* o, u32 offset, u32 kind, void* object) {
+    if (object != NULL) {
+        o->offset = offset;
+        o->kind = kind;
+        o->object = object;
+    }
+    return object;
+}
+
+static void swap_raw16(BankLoader* l, u32 start, u32 len) {
+    u32 i;
+
+    if (l->swapped == NULL) {
+        l->swapped = loader_alloc(l, (l->tbl_size / 2 + 7) / 8);
+        if (l->swapped == NULL) {
+            return;
+        }
+        bzero(l->swapped, (l->tbl_size / 2 + 7) / 8);
+    }
+    for (i = start / 2; i < (start + len) / 2; i++) {
+        if (!(l->swapped[i / 8] & (1 << (i % 8)))) {
+            u8 t = l->tbl[i * 2];
+
+            l->tbl[i * 2] = l->tbl[i * 2 + 1];
+            l->tbl[i * 2 + 1] = t;
+            l->swapped[i / 8] |= 1 << (i % 8);
+        }
+    }
+}
+
+static ALEnvelope* load_envelope(BankLoader* l, u32 offset) {
+    LoadedObject* o = loader_find(l, offset, OBJ_ENVELOPE);
+    const u8* p = loader_at(l, offset, 14);
+    ALEnvelope* env;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    if ((env = loader_alloc(l, sizeof(ALEnvelope))) == NULL) {
+        return NULL;
+    }
+    env->attackTime = be32(p);
+    env->decayTime = be32(p + 4);
+    env->releaseTime = be32(p + 8);
+    env->attackVolume = p[12];
+    env->decayVolume = p[13];
+    return loader_remember(o, offset, OBJ_ENVELOPE, env);
+}
+
+static ALKeyMap* load_keymap(BankLoader* l, u32 offset) {
+    LoadedObject* o = loader_find(l, offset, OBJ_KEYMAP);
+    const u8* p = loader_at(l, offset, 6);
+    ALKeyMap* keymap;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    if ((keymap = loader_alloc(l, sizeof(ALKeyMap))) == NULL) {
+        return NULL;
+    }
+    keymap->velocityMin = p[0];
+    keymap->velocityMax = p[1];
+    keymap->keyMin = p[2];
+    keymap->keyMax = p[3];
+    keymap->keyBase = p[4];
+    keymap->detune = (s8)p[5];
+    return loader_remember(o, offset, OBJ_KEYMAP, keymap);
+}
+
+/* The RSP reads the book straight from DRAM, so it's stored host-endian like all sample data */
+static ALADPCMBook* load_book(BankLoader* l, u32 offset) {
+    LoadedObject* o = loader_find(l, offset, OBJ_BOOK);
+    const u8* p = loader_at(l, offset, 8);
+    ALADPCMBook* book;
+    u32 entries;
+    u32 i;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    if (be32(p) > 16 || be32(p + 4) > 16) {
+        l->error = "bad ADPCM book";
+        return NULL;
+    }
+    entries = be32(p) * be32(p + 4) * 8;
+    if ((p = loader_at(l, offset, 8 + entries * 2)) == NULL) {
+        return NULL;
+    }
+    if ((book = loader_alloc(l, sizeof(ALADPCMBook) + entries * 2)) == NULL) {
+        return NULL;
+    }
+    book->order = be32(p);
+    book->npredictors = be32(p + 4);
+    for (i = 0; i < entries; i++) {
+        book->book[i] = (s16)be16(p + 8 + i * 2);
+    }
+    return loader_remember(o, offset, OBJ_BOOK, book);
+}
+
+static void* load_loop(BankLoader* l, u32 offset, int adpcm) {
+    LoadedObject* o = loader_find(l, offset, OBJ_LOOP);
+    const u8* p = loader_at(l, offset, adpcm ? 12 + 32 : 12);
+    ALRawLoop* loop;
+    u32 i;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    if ((loop = loader_alloc(l, adpcm ? sizeof(ALADPCMloop) : sizeof(ALRawLoop))) == NULL) {
+        return NULL;
+    }
+    loop->start = be32(p);
+    loop->end = be32(p + 4);
+    loop->count = be32(p + 8);
+    if (adpcm) {
+        for (i = 0; i < 16; i++) {
+            ((ALADPCMloop*)loop)->state[i] = (s16)be16(p + 12 + i * 2);
+        }
+    }
+    return loader_remember(o, offset, OBJ_LOOP, loop);
+}
+
+static ALWaveTable* load_wavetable(BankLoader* l, u32 offset) {
+    LoadedObject* o = loader_find(l, offset, OBJ_WAVETABLE);
+    const u8* p = loader_at(l, offset, 0x14);
+    ALWaveTable* w;
+    u32 base;
+    u32 len;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    base = be32(p);
+    len = be32(p + 4);
+    if (base > l->tbl_size || len > l->tbl_size - base) {
+        l->error = "wave data outside the .tbl";
+        return NULL;
+    }
+    if ((w = loader_alloc(l, sizeof(ALWaveTable))) == NULL) {
+        return NULL;
+    }
+    w->base = l->tbl + base;
+    w->len = len;
+    w->type = p[8];
+    w->flags = 1;
+    if (w->type == AL_ADPCM_WAVE) {
+        w->waveInfo.adpcmWave.loop = NULL;
+        if (be32(p + 0xC) != 0 && (w->waveInfo.adpcmWave.loop = load_loop(l, be32(p + 0xC), TRUE)) == NULL) {
+            return NULL;
+        }
+        if ((w->waveInfo.adpcmWave.book = load_book(l, be32(p + 0x10))) == NULL) {
+            return NULL;
+        }
+    } else if (w->type == AL_RAW16_WAVE) {
+        w->waveInfo.rawWave.loop = NULL;
+        if (be32(p + 0xC) != 0 && (w->waveInfo.rawWave.loop = load_loop(l, be32(p + 0xC), FALSE)) == NULL) {
+            return NULL;
+        }
+        swap_raw16(l, base, len);
+    } else {
+        l->error = "unknown wave type";
+        return NULL;
+    }
+    return loader_remember(o, offset, OBJ_WAVETABLE, w);
+}
+
+static ALSound* load_sound(BankLoader* l, u32 offset) {
+    LoadedObject* o = loader_find(l, offset, OBJ_SOUND);
+    const u8* p = loader_at(l, offset, 0xF);
+    ALSound* s;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    if ((s = loader_alloc(l, sizeof(ALSound))) == NULL) {
+        return NULL;
+    }
+    if ((s->envelope = load_envelope(l, be32(p))) == NULL || (s->keyMap = load_keymap(l, be32(p + 4))) == NULL ||
+        (s->wavetable = load_wavetable(l, be32(p + 8))) == NULL) {
+        return NULL;
+    }
+    s->samplePan = p[0xC];
+    s->sampleVolume = p[0xD];
+    s->flags = 1;
+    return loader_remember(o, offset, OBJ_SOUND, s);
+}
+
+static ALInstrument* load_instrument(BankLoader* l, u32 offset) {
+    LoadedObject* o = loader_find(l, offset, OBJ_INSTRUMENT);
+    const u8* p = loader_at(l, offset, 0x10);
+    ALInstrument* inst;
+    s32 count;
+    s32 i;
+
+    if (o == NULL || p == NULL) {
+        return NULL;
+    }
+    if (o->object != NULL) {
+        return o->object;
+    }
+    count = (s16)be16(p + 0xE);
+    if (count < 0 || (p = loader_at(l, offset, 0x10 + count * 4)) == NULL) {
+        l->error = l->error ? l->error : "bad sound count";
+        return NULL;
+    }
+    if ((inst = loader_alloc(l, sizeof(ALInstrument) + count * sizeof(ALSound*))) == NULL) {
+        return NULL;
+    }
+    inst->volume = p[0];
+    inst->pan = p[1];
+    inst->priority = p[2];
+    inst->flags = 1;
+    inst->tremType = p[4];
+    inst->tremRate = p[5];
+    inst->tremDepth = p[6];
+    inst->tremDelay = p[7];
+    inst->vibType = p[8];
+    inst->vibRate = p[9];
+    inst->vibDepth = p[10];
+    inst->vibDelay = p[11];
+    inst->bendRange = (s16)be16(p + 0xC);
+    inst->soundCount = count;
+    for (i = 0; i < count; i++) {
+        if ((inst->soundArray[i] = load_sound(l, be32(p + 0x10 + i * 4))) == NULL) {
+            return NULL;
+        }
+    }
+    return loader_remember(o, offset, OBJ_INSTRUMENT, inst);
+}
+
+/*
+ * alBnkfNew patches a 32-bit big-endian .ctl in place, which only works on
+ * the N64 itself; this builds the same tree with host pointers instead.
+ */
+static ALBank* load_bank(BankLoader* l, s32 index) {
+    const u8* p = loader_at(l, 0, 4);
+    ALBank* bank;
+    u32 offset;
+    s32 count;
+    s32 i;
+
+    if (p == NULL) {
+        return NULL;
+    }
+    if (be16(p) != AL_BANK_VERSION) {
+        l->error = "not a bank file";
+        return NULL;
+    }
+    if (index < 0 || index >= (s16)be16(p + 2)) {
+        l->error = "no such bank";
+        return NULL;
+    }
+    if ((p = loader_at(l, 4 + index * 4, 4)) == NULL) {
+        return NULL;
+    }
+    offset = be32(p);
+    if ((p = loader_at(l, offset, 0xC)) == NULL) {
+        return NULL;
+    }
+    count = (s16)be16(p);
+    if (count < 0 || (p = loader_at(l, offset, 0xC + count * 4)) == NULL) {
+        l->error = l->error ? l->error : "bad instrument count";
+        return NULL;
+    }
+    if ((bank = loader_alloc(l, sizeof(ALBank) + count * sizeof(ALInstrument*))) == NULL) {
+        return NULL;
+    }
+    bank->instCount = count;
+    bank->flags = 1;
+    bank->pad = 0;
+    bank->sampleRate = be32(p + 4);
+    bank->percussion = NULL;
+    if (be32(p + 8) != 0 && (bank->percussion = load_instrument(l, be32(p + 8))) == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < count; i++) {
+        bank->instArray[i] = NULL;
+        if (be32(p + 0xC + i * 4) != 0 && (bank->instArray[i] = load_instrument(l, be32(p + 0xC + i * 4))) == NULL) {
+            return NULL;
+        }
+    }
+    return bank;
+}
+
+static void* arena_copy(ALHeap* heap, const void* src, size_t size) {
+    void* dst = alHeapAlloc(heap, 1, size);
+
+    if (dst != NULL) {
+        bcopy(src, dst, size);
+    }
+    return dst;
+}
+
+static const char* fx_names[] = { "none", "smallroom", "bigroom", "chorus", "flange", "echo" };
+
+const char* render_fx_name(int fx) {
+    return fx >= AL_FX_NONE && fx <= AL_FX_ECHO ? fx_names[fx] : "?";
+}
+
+int render_fx_from_name(const char* name) {
+    int fx;
+
+    for (fx = AL_FX_NONE; fx <= AL_FX_ECHO; fx++) {
+        const char* a = fx_names[fx];
+        const char* b = name;
+
+        while (*a != '\0' && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return fx;
+        }
+    }
+    return -1;
+}
+
+int render_sequence(void* arena, AcmdState* acmd, const RenderJob* job, RenderSink sink, void* user,
+                    RenderResult* result) {
+    ALGlobals globals;
+    ALSynConfig syn;
+    ALSeqpConfig seqp;
+    ALHeap heap;
+    BankLoader loader;
+    ALBank* bank;
+    ALSeqPlayer* player = NULL;
+    ALCSPlayer* cplayer = NULL;
+#ifdef AL_HEAP_MARK
+    ALHeapMark mark;
+    ALHeapReport report;
+#endif
+#ifdef AL_PROFILE
+    ALProfile profile;
+#endif
+    Acmd* cmds;
+    s16* out;
+    u8* seq;
+    u32 tail = 0;
+    int started = FALSE;
+
+    bzero(result, sizeof(*result));
+    bzero(&loader, sizeof(loader));
+    alHeapInit(&heap, arena, RENDER_ARENA_SIZE);
+
+    /* Sample data and sequences go in the arena too: the RSP and cseq.c both hold them as 32-bit addresses */
+    loader.heap = &heap;
+    loader.ctl = job->ctl;
+    loader.ctl_size = job->ctl_size;
+    loader.tbl_size = job->tbl_size;
+    loader.objects = alHeapAlloc(&heap, LOADED_OBJECTS, sizeof(LoadedObject));
+    loader.tbl = arena_copy(&heap, job->tbl, job->tbl_size);
+    seq = arena_copy(&heap, job->seq, job->seq_size);
+    cmds = alHeapAlloc(&heap, RENDER_COMMANDS, sizeof(Acmd));
+    out = alHeapAlloc(&heap, job->frame_samples, 4);
+    if (loader.objects == NULL || loader.tbl == NULL || seq == NULL || cmds == NULL || out == NULL ||
+        RENDER_ARENA_SIZE - (heap.cur - heap.base) < AL_HEAP_RESERVE) {
+        result->error = "bank, table and sequence don't fit in the arena";
+        goto done;
+    }
+    bzero(loader.objects, LOADED_OBJECTS * sizeof(LoadedObject));
+    if ((bank = load_bank(&loader, job->bank)) == NULL) {
+        result->error = loader.error;
+        goto done;
+    }
+
+    syn.maxVVoices = job->voices;
+    syn.maxPVoices = job->pvoices;
+    syn.maxUpdates = 128;
+    syn.maxFXbusses = 1;
+    syn.dmaproc = dma_new;
+    syn.heap = &heap;
+    syn.outputRate = job->output_rate;
+    syn.fxType = job->fx;
+    syn.params = NULL;
+    alInit(&globals, &syn);
+#ifdef AL_PROFILE
+    /* The budget is the frame's own length, as on the console */
+    alProfileInit(&profile, OS_USEC_TO_CYCLES((u64)job->frame_samples * 1000000 / job->output_rate));
+    alSynSetProfile(&globals.drvr, &profile);
+#endif
+
+    seqp.maxVoices = job->voices;
+    seqp.maxEvents = 64;
+    seqp.maxChannels = 16;
+    seqp.debugFlags = 0;
+    seqp.heap = &heap;
+    seqp.initOsc = NULL;
+    seqp.updateOsc = NULL;
+    seqp.stopOsc = NULL;
+#ifdef AL_SEQP_SOUND_INDEX
+    seqp.soundIndexSize = SOUND_INDEX_SIZE;
+#endif
+#ifdef AL_HEAP_MARK
+    /* The player and its sequence are all a scene change would tear down */
+    alHeapMark(&heap, &mark);
+#endif
+
+    if (job->seq_size >= 4 && seq[0] == 'M' && seq[1] == 'T' && seq[2] == 'h' && seq[3] == 'd') {
+        ALSeq* s = alHeapAlloc(&heap, 1, sizeof(ALSeq));
+
+        player = alHeapAlloc(&heap, 1, sizeof(ALSeqPlayer));
+        if (s == NULL || player == NULL) {
+            result->error = "arena full";
+            goto close;
+        }
+        alSeqNew(s, seq, job->seq_size);
+        alSeqpNew(player, &seqp);
+        alSeqpSetBank(player, bank);
+        alSeqpSetSeq(player, s);
+        alSeqpPlay(player);
+    } else {
+        ALCSeq* s = alHeapAlloc(&heap, 1, sizeof(ALCSeq));
+        s32 i;
+
+        cplayer = alHeapAlloc(&heap, 1, sizeof(ALCSPlayer));
+        if (s == NULL || cplayer == NULL) {
+            result->error = "arena full";
+            goto close;
+        }
+        if (job->seq_size < sizeof(ALCMidiHdr)) {
+            result->error = "sequence too short";
+            goto close;
+        }
+        /* The header is read as words, the track data a byte at a time */
+        for (i = 0; i < (s32)(sizeof(ALCMidiHdr) / 4); i++) {
+            ((u32*)seq)[i] = be32(seq + i * 4);
+        }
+        for (i = 0; i < 16; i++) {
+            if (((ALCMidiHdr*)seq)->trackOffset[i] >= job->seq_size) {
+                result->error = "track offset out of range";
+                goto close;
+            }
+        }
+#ifdef AL_CSEQ_TRACK_CACHE
+        if (!alCSeqNewCached(s, seq, &heap)) {
+            result->error = "can't decode the sequence's tracks";
+            goto close;
+        }
+#else
+        alCSeqNew(s, seq);
+#endif
+        alCSPNew(cplayer, &seqp);
+        alCSPSetBank(cplayer, bank);
+        alCSPSetSeq(cplayer, s);
+        alCSPPlay(cplayer);
+        result->compressed = TRUE;
+    }
+
+    acmd_init(acmd, arena, RENDER_ARENA_SIZE);
+    acmd_set_kernels(acmd, acmd_kernels_from_env());
+
+    while (result->samples < job->max_samples && tail < job->tail_samples) {
+        s32 state = player != NULL ? alSeqpGetState(player) : alCSPGetState(cplayer);
+        s32 count;
+
+        if (state == AL_PLAYING) {
+            started = TRUE;
+        } else if (started && state == AL_STOPPED) {
+            result->ended = TRUE;
+            tail += job->frame_samples;
+        }
+
+        alAudioFrame(cmds, &count, out, job->frame_samples);
+        if (count > RENDER_COMMANDS) {
+            result->error = "command list overflow";
+            break;
+        }
+        if ((u32)count > result->max_commands) {
+            result->max_commands = count;
+        }
+        acmd_run(acmd, (const AcmdWord*)cmds, count);
+        if (sink(user, out, job->frame_samples) != 0) {
+            result->error = "write failed";
+            break;
+        }
+        result->samples += job->frame_samples;
+    }
+
+#ifdef AL_SYN_STEAL_HEAP
+    {
+        ALSynVoiceStats stats;
+
+        alSynGetVoiceStats(&globals.drvr, &stats);
+        result->voice_steals = stats.steals;
+        result->voice_fails = stats.fails;
+    }
+#endif
+#ifdef AL_ADPCM_SHARE
+    {
+        ALSynLoadStats stats;
+
+        alSynGetLoadStats(&globals.drvr, &stats);
+        result->adpcm_pulls = stats.pulls;
+        result->adpcm_shared = stats.shared;
+        result->dma_fetches = stats.fetches;
+        result->dma_reused = stats.reused;
+        result->dma_saved = stats.savedBytes;
+    }
+#endif
+
+    if (player != NULL) {
+        alSeqpDelete(player);
+    } else {
+        alCSPDelete(cplayer);
+    }
+#ifdef AL_HEAP_MARK
+    alHeapRelease(&heap, &mark);
+#endif
+
+close:
+#ifdef AL_PROFILE
+    profile_length = 0;
+    alProfileDump(&profile);
+    result->profile = profile_text;
+#endif
+    alClose(&globals);
+
+done:
+#ifdef AL_HEAP_MARK
+    alHeapReport(&heap, &report);
+    result->heap_used = report.high;
+#else
+    result->heap_used = heap.cur - heap.base;
+#endif
+    /* The next job's heap starts from zeroed memory, as a fresh audio heap would */
+    bzero(heap.base, result->heap_used);
+    return result->error == NULL ? 0 : -1;
+}
@@ -0,0 +1,68 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/*
+ * The interface between main.c, which only sees the host's headers, and
+ * render.c, which only sees libultra's. Nothing here may pull in either.
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#include "acmd.h"
+
+/*
+ * Each worker owns one arena. It must sit below 2GB (libultra keeps
+ * addresses in s32) and be aligned to its size: the synthesizer hands the
+ * RSP plain addresses, which the interpreter resolves through segment
+ * (address >> 24) & 15, which libultra leaves at 0, plus the low 24 bits.
+ * So with a 16MB-aligned arena those low bits are the arena offset.
+ */
+#define RENDER_ARENA_SIZE  0x1000000u
+#define RENDER_ARENA_FIRST 0x10000000u
+#define RENDER_ARENA_LIMIT 0x80000000u
+
+typedef struct {
+    const uint8_t* ctl;
+    size_t ctl_size;
+    const uint8_t* tbl;
+    size_t tbl_size;
+    const uint8_t* seq;
+    size_t seq_size;
+    int bank;               /* index into the .ctl's bank array */
+    uint32_t output_rate;
+    uint32_t frame_samples; /* per alAudioFrame call, a multiple of 16 */
+    uint32_t max_samples;   /* stop looping sequences here */
+    uint32_t tail_samples;  /* keep rendering releases and reverb after the sequence stops */
+    int voices;
+    int pvoices;            /* physical voices, at most voices */
+    int fx;                 /* AL_FX_* */
+} RenderJob;
+
+typedef struct {
+    uint32_t samples;       /* stereo frames written */
+    uint32_t heap_used;
+    uint32_t max_commands;  /* longest Acmd list of one frame */
+    int compressed;         /* played through ALCSPlayer rather than ALSeqPlayer */
+    int ended;              /* stopped on its own rather than at max_samples */
+    uint32_t voice_steals;  /* these two only with STEAL=heap */
+    uint32_t voice_fails;
+    uint32_t adpcm_pulls;   /* these five only with ADPCM_SHARE=on; see ALSynLoadStats */
+    uint32_t adpcm_shared;
+    uint32_t dma_fetches;
+    uint32_t dma_reused;
+    uint32_t dma_saved;     /* bytes */
+    const char* profile;    /* alProfileDump's output, only with PROFILE=on; the worker's until its next job */
+    const char* error;
+} RenderResult;
+
+/* Receives each frame as interleaved host-endian stereo; nonzero aborts */
+typedef int (*RenderSink)(void* user, const int16_t* samples, uint32_t count);
+
+/* arena is RENDER_ARENA_SIZE bytes, aligned to it; acmd is reinitialized per call */
+int render_sequence(void* arena, AcmdState* acmd, const RenderJob* job, RenderSink sink, void* user,
+                    RenderResult* result);
+
+const char* render_fx_name(int fx);
+int render_fx_from_name(const char* name);
+
+#endif
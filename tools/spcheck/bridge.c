@@ -0,0 +1,250 @@
+/*
+ * Builds a scene of sprites and the lists that draw it, through both
+ * builds of sprite.c: the Makefile links the one without SP_BATCH with its
+ * functions renamed plain_sp*, and the one with SP_BATCH as they are.
+ */
+#include <ultra64.h>
+#include <sp.h>
+
+#include "harness.h"
+
+/* sprite.c as the game builds it */
+void plain_spInit(Gfx** glistp);
+Gfx* plain_spDraw(Sprite* sp);
+void plain_spFinish(Gfx** glistp);
+
+#define FINISH_MAX 5 /* what spFinish can send */
+#define CANARY 0xDEADBEEF
+
+enum {
+    K_RGBA,     /* a cell of the RGBA16 atlas */
+    K_QUAD,     /* all four, as four bitmaps */
+    K_CI_A,     /* a cell of the CI8 atlas, through one TLUT */
+    K_CI_B,     /* or the other */
+    K_IA,       /* a cell of the IA8 atlas */
+    K_SOLO,     /* an RGBA16 texture of its own */
+    K_FILL      /* no bitmap */
+};
+
+typedef struct {
+    u8 kind;
+    u8 cell;
+    u16 attr;
+    u8 alpha;
+    s16 z;
+    s8 layer;
+} SceneSprite;
+
+/*
+ * Atlas cells and TLUTs shared across layers, formats interleaved, and the
+ * attributes spDraw changes render modes, filters and cycle types for.
+ * Each sprite gets a place of its own; the last is half off the screen.
+ */
+static const SceneSprite scene_sprites[] = {
+    { K_RGBA, 0, 0, 255, 0, 1 },
+    { K_CI_A, 1, 0, 255, 0, 0 },
+    { K_RGBA, 1, 0, 255, 0, 0 },
+    { K_IA, 2, 0, 255, 0, 1 },
+    { K_CI_B, 1, 0, 255, 0, 1 },
+    { K_RGBA, 2, SP_TRANSPARENT, 128, 0, 0 },
+    { K_SOLO, 0, 0, 255, 0, 2 },
+    { K_CI_A, 3, SP_FASTCOPY, 255, 0, 1 },
+    { K_FILL, 0, 0, 255, 0, 0 },
+    { K_RGBA, 3, SP_Z, 255, 100, 1 },
+    { K_IA, 0, SP_TEXSHUF, 255, 0, 0 },
+    { K_QUAD, 0, 0, 255, 0, 2 },
+    { K_RGBA, 0, SP_FASTCOPY, 255, 0, 0 },
+    { K_CI_B, 0, SP_CUTOUT, 255, 0, 2 },
+    { K_SOLO, 1, SP_Z, 255, 200, 1 },
+    { K_IA, 1, SP_TRANSPARENT, 64, 0, 2 },
+    { K_RGBA, 2, SP_SCALE, 255, 0, 1 },
+    { K_CI_A, 2, 0, 200, 0, 2 },
+    { K_FILL, 0, SP_TRANSPARENT, 100, 0, 1 },
+    { K_RGBA, 1, SP_HIDDEN, 255, 0, 0 },
+    { K_SOLO, 2, SP_TEXSHIFT, 255, 0, 0 },
+    { K_RGBA, 3, SP_Z, 255, 100, 2 },
+    { K_CI_A, 0, SP_TRANSPARENT | SP_CUTOUT, 255, 0, 0 },
+    { K_IA, 3, 0, 255, 0, 1 },
+    { K_QUAD, 0, SP_Z, 255, 50, 0 },
+    { K_SOLO, 0, 0, 255, 0, 1 },
+    { K_CI_B, 2, 0, 255, 0, 0 },
+    { K_RGBA, 0, 0, 255, 0, 2 },
+    { K_FILL, 0, SP_Z, 255, 10, 2 },
+    { K_RGBA, 2, 0, 255, 0, 1 },
+};
+
+#define SCENE_SPRITES (sizeof(scene_sprites) / sizeof(scene_sprites[0]))
+
+static Sprite sprites[SCENE_SPRITES];
+static s32 layers[SCENE_SPRITES];
+
+static void* rgba_atlas;
+static void* ci_atlas;
+static void* ia_atlas;
+static void* solo[3];
+static int* tlut_a;
+static int* tlut_b;
+
+static void* texture(int size, u32 seed) {
+    u32* t = harness_alloc(size);
+    int i;
+
+    for (i = 0; i < size / 4; i++) {
+        seed = seed * 1103515245 + 12345;
+        t[i] = seed;
+    }
+    return t;
+}
+
+static Bitmap* bitmaps(int n, int width_img, void* buf, int cell) {
+    Bitmap* b = harness_alloc((n + 1) * sizeof(Bitmap));
+    int i;
+
+    for (i = 0; i < n; i++) {
+        b[i].width = 16;
+        b[i].width_img = width_img;
+        b[i].s = (width_img == 32) ? ((cell + i) & 1) * 16 : 0;
+        b[i].t = (width_img == 32) ? ((cell + i) >> 1) * 16 : 0;
+        b[i].buf = buf;
+        b[i].actualHeight = 16;
+        b[i].LUToffset = 0;
+    }
+    b[n].width = 0;
+    return b;
+}
+
+int bridge_scene(void) {
+    unsigned int i;
+
+    rgba_atlas = texture(32 * 32 * 2, 1);
+    ci_atlas = texture(32 * 32, 2);
+    ia_atlas = texture(32 * 32, 3);
+    for (i = 0; i < 3; i++) {
+        solo[i] = texture(16 * 16 * 2, 4 + i);
+    }
+    tlut_a = texture(256 * 2, 7);
+    tlut_b = texture(256 * 2, 8);
+
+    for (i = 0; i < SCENE_SPRITES; i++) {
+        const SceneSprite* d = &scene_sprites[i];
+        Sprite* s = &sprites[i];
+        int nb = 1;
+
+        s->x = 8 + (i % 8) * 38;
+        s->y = 8 + (i / 8) * 40;
+        s->width = 16;
+        s->height = 16;
+        s->scalex = s->scaley = (d->attr & SP_SCALE) ? 2.0f : 1.0f;
+        s->attr = d->attr;
+        s->zdepth = d->z;
+        s->red = 0x40 + i * 4;
+        s->green = 0x80;
+        s->blue = 0xC0 - i * 2;
+        s->alpha = d->alpha;
+        s->bmheight = 16;
+        s->bmHreal = 32;
+
+        switch (d->kind) {
+            case K_RGBA:
+            case K_QUAD:
+                nb = (d->kind == K_QUAD) ? 4 : 1;
+                s->bmfmt = G_IM_FMT_RGBA;
+                s->bmsiz = G_IM_SIZ_16b;
+                s->bitmap = bitmaps(nb, 32, rgba_atlas, d->cell);
+                if (nb == 4) {
+                    s->width = s->height = 32;
+                }
+                break;
+            case K_CI_A:
+            case K_CI_B:
+                s->bmfmt = G_IM_FMT_CI;
+                s->bmsiz = G_IM_SIZ_8b;
+                s->bitmap = bitmaps(1, 32, ci_atlas, d->cell);
+                s->startTLUT = 0;
+                s->nTLUT = 256;
+                s->LUT = (d->kind == K_CI_A) ? tlut_a : tlut_b;
+                break;
+            case K_IA:
+                s->bmfmt = G_IM_FMT_IA;
+                s->bmsiz = G_IM_SIZ_8b;
+                s->bitmap = bitmaps(1, 32, ia_atlas, d->cell);
+                break;
+            case K_SOLO:
+                s->bmfmt = G_IM_FMT_RGBA;
+                s->bmsiz = G_IM_SIZ_16b;
+                s->bmHreal = 16;
+                s->bitmap = bitmaps(1, 16, solo[d->cell], 0);
+                break;
+            case K_FILL:
+                nb = 0;
+                s->bmfmt = G_IM_FMT_RGBA;
+                s->bmsiz = G_IM_SIZ_16b;
+                s->width = 20;
+                s->height = 12;
+                break;
+        }
+        s->nbitmaps = nb;
+        s->ndisplist = NUM_DL(nb);
+        s->rsp_dl = harness_alloc(s->ndisplist * sizeof(Gfx));
+        layers[i] = d->layer;
+    }
+    sprites[SCENE_SPRITES - 1].x = 312;
+    return SCENE_SPRITES;
+}
+
+unsigned int bridge_list(int batched, int room, HarnessStats* stats) {
+    Gfx* root = harness_alloc(room * sizeof(Gfx));
+    Gfx* end = root + room - FINISH_MAX;
+    Gfx* gl = root;
+    Gfx* dl;
+    SpBatchStats bs;
+    s32 layer;
+    u32 i, *w;
+
+    for (w = (u32*)root; w < (u32*)(root + room); w++) {
+        *w = CANARY;
+    }
+    stats->overrun = 0;
+
+    if (batched) {
+        spInit(&gl);
+        for (i = 0; i < SCENE_SPRITES; i++) {
+            spBatchDraw(&sprites[i], layers[i]);
+        }
+        spBatchFlush(&gl, end);
+        for (w = (u32*)end; w < (u32*)(root + room); w++) {
+            stats->overrun += *w != CANARY;
+        }
+        spFinish(&gl);
+
+        spBatchGetStats(&bs);
+        stats->sprites = bs.sprites;
+        stats->rects = bs.rects;
+        stats->loads = bs.loads;
+        stats->loads_skipped = bs.loadsSkipped;
+        stats->tluts = bs.tluts;
+        stats->tluts_skipped = bs.tlutsSkipped;
+        stats->states = bs.states;
+        stats->states_skipped = bs.statesSkipped;
+        stats->syncs_skipped = bs.syncsSkipped;
+        stats->dropped = bs.dropped;
+        return (u32)root;
+    }
+
+    /* A layer at a time, as spBatchFlush would */
+    plain_spInit(&gl);
+    for (layer = 0; layer < 3; layer++) {
+        for (i = 0; i < SCENE_SPRITES; i++) {
+            if (layers[i] != layer) {
+                continue;
+            }
+            sprites[i].rsp_dl_next = NULL;
+            dl = plain_spDraw(&sprites[i]);
+            if (dl != NULL) {
+                gSPDisplayList(gl++, dl);
+            }
+        }
+    }
+    plain_spFinish(&gl);
+    return (u32)root;
+}
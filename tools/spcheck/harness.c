@@ -0,0 +1,503 @@
+/*
+ * spcheck: draws one scene of sprites through sprite.c as the game builds
+ * it, each sprite into its own list called from the root one, and through
+ * sprite.c with SP_BATCH, queued and flushed into the root list; walks both
+ * with tools/dlscan's walker, keeping the RDP state the lists leave, and
+ * checks every rectangle is drawn with the same state either way.
+ *
+ *   spcheck [-v]
+ *
+ * For each rectangle that is its othermode, combiner, primitive color and
+ * G_TEXTURE, the render tile and its size, and what the TMEM words that
+ * tile (and, with a TLUT, the TLUT) covers were loaded from; the fill
+ * color for a fill rectangle, the blend color under an alpha threshold and
+ * the primitive depth if the sprite's own list set it. Rectangles are
+ * matched by their commands, so each sprite has a place of its own.
+ *
+ * "hazards" are rectangles followed by a state command or load with no
+ * pipe sync between (spDraw's fill rectangle is); the batched list may not
+ * have more than the other.
+ * Last, the scene is flushed into a list without room for all of it: the
+ * flush has to drop what doesn't fit, say so, and leave what follows
+ * glistend alone, and what it did draw has to match.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "../dlscan/dlscan.h"
+#include "harness.h"
+
+#define ROOM        4096        /* commands in a root list */
+#define ROOM_TIGHT  300
+#define DRAWS_MAX   256
+#define TMEM_WORDS  512
+#define MISMATCHES  20          /* printed */
+
+/* gbi.h's othermode shifts and values */
+#define MDSFT_TEXTLUT   14
+#define MDSFT_ALPHACMP  0
+#define MDSFT_ZSRCSEL   2
+#define AC_THRESHOLD    1
+
+typedef struct {
+    uint32_t othermode_h;
+    uint32_t othermode_l;
+    uint32_t combine[2];
+    uint32_t prim[2];
+    uint32_t prim_depth;
+    uint32_t fill;
+    uint32_t blend;
+    uint32_t convert[2];
+    uint32_t texture[2];
+    uint32_t tile[8][2];
+    uint32_t tile_size[8][2];
+    uint32_t timg[2];
+    uint64_t tmem[TMEM_WORDS];  /* what each word was loaded from */
+} RdpState;
+
+typedef struct {
+    uint32_t rect[4];           /* the command, and a texture rectangle's halves */
+    int halves;
+    uint32_t othermode_h;
+    uint32_t othermode_l;
+    uint32_t combine[2];
+    uint32_t prim[2];
+    uint32_t prim_depth;
+    int prim_depth_own;         /* set since the list was called */
+    uint32_t fill;
+    uint32_t blend;
+    uint32_t convert[2];
+    uint32_t texture[2];
+    uint32_t tile[2];
+    uint32_t tile_size[2];
+    uint64_t tmem;
+} Draw;
+
+typedef struct {
+    Draw draws[DRAWS_MAX];
+    int count;
+    unsigned int hazards;
+    unsigned int commands;
+} Walk;
+
+static unsigned char* arena;
+static unsigned int arena_used;
+static unsigned int asserts;
+static int verbose;
+
+void* harness_alloc(int size) {
+    void* ptr = arena + arena_used;
+
+    arena_used += (size + 15) & ~15;
+    if (arena_used > HARNESS_ARENA_SIZE) {
+        fprintf(stderr, "spcheck: out of arena\n");
+        exit(1);
+    }
+    return ptr;
+}
+
+/* libultra's assert; sprite.c is built without NDEBUG */
+void __assert(const char* expr, const char* file, int line) {
+    asserts++;
+    if (verbose) {
+        printf("assert at %s:%d\n", file, line);
+    }
+}
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h *= 0xFF51AFD7ED558CCDull;
+    return h ^ (h >> 33);
+}
+
+static uint32_t bits(uint32_t w, int shift, int len) {
+    return (w >> shift) & ((1u << len) - 1);
+}
+
+static void set_othermode(uint32_t* mode, uint32_t w0, uint32_t w1) {
+    int shift = bits(w0, 8, 8);
+    int len = bits(w0, 0, 8);
+    uint32_t mask = (len >= 32) ? ~0u : (((1u << len) - 1) << shift);
+
+    *mode = (*mode & ~mask) | (w1 & mask);
+}
+
+static void load(RdpState* rdp, const DlCommand* cmd) {
+    uint32_t tile = bits(cmd->w1, 24, 3);
+    uint32_t tmem = bits(rdp->tile[tile][0], 0, 9);
+    uint32_t line = bits(rdp->tile[tile][0], 9, 9);
+    uint32_t addr = rdp->timg[1];
+    uint32_t siz = bits(rdp->timg[0], 19, 2);
+    uint32_t n, i, k;
+
+    switch (cmd->opcode) {
+        case DL_RDP_LOADBLOCK:
+            n = bits(cmd->w1, 12, 12) - bits(cmd->w0, 12, 12) + 1;
+            n = (((n << siz) >> 1) + 7) / 8;
+            for (i = 0; i < n; i++) {
+                rdp->tmem[(tmem + i) % TMEM_WORDS] = mix(mix(addr + i * 8, cmd->w1), rdp->timg[0]);
+            }
+            break;
+        case DL_RDP_LOADTILE:
+            n = ((bits(cmd->w1, 0, 12) - bits(cmd->w0, 0, 12)) >> 2) + 1;
+            for (k = 0; k < n; k++) {
+                for (i = 0; i < line; i++) {
+                    rdp->tmem[(tmem + k * line + i) % TMEM_WORDS] =
+                        mix(mix(mix(addr, cmd->w0), cmd->w1), k * line + i);
+                }
+            }
+            break;
+        case DL_RDP_LOADTLUT:
+            n = bits(cmd->w1, 14, 10) + 1;
+            for (i = 0; i < n; i++) {
+                rdp->tmem[(tmem + i) % TMEM_WORDS] = mix(addr + i * 2, 0x544C5554);
+            }
+            break;
+    }
+}
+
+/* What the TMEM words the rectangle's tile reads, and its TLUT, were loaded from */
+static uint64_t tmem_digest(const RdpState* rdp, int tile) {
+    uint32_t tmem = bits(rdp->tile[tile][0], 0, 9);
+    uint32_t line = bits(rdp->tile[tile][0], 9, 9);
+    uint32_t rows = ((bits(rdp->tile_size[tile][1], 0, 12) - bits(rdp->tile_size[tile][0], 0, 12)) >> 2) + 1;
+    uint64_t h = 0;
+    uint32_t i;
+
+    for (i = 0; i < line * rows; i++) {
+        h = mix(h, rdp->tmem[(tmem + i) % TMEM_WORDS]);
+    }
+    if (bits(rdp->othermode_h, MDSFT_TEXTLUT, 2) != 0) {
+        for (i = 256; i < TMEM_WORDS; i++) {
+            h = mix(h, rdp->tmem[i]);
+        }
+    }
+    return h;
+}
+
+static void snapshot(Draw* d, const RdpState* rdp, const DlCommand* cmd, int prim_depth_own) {
+    int tile = bits(cmd->w1, 24, 3);
+
+    memset(d, 0, sizeof(*d));
+    d->rect[0] = cmd->w0;
+    d->rect[1] = cmd->w1;
+    d->othermode_h = rdp->othermode_h;
+    d->othermode_l = rdp->othermode_l;
+    memcpy(d->combine, rdp->combine, sizeof(d->combine));
+    memcpy(d->prim, rdp->prim, sizeof(d->prim));
+    d->prim_depth = rdp->prim_depth;
+    d->prim_depth_own = prim_depth_own;
+    d->fill = rdp->fill;
+    d->blend = rdp->blend;
+    memcpy(d->convert, rdp->convert, sizeof(d->convert));
+    memcpy(d->texture, rdp->texture, sizeof(d->texture));
+    if (cmd->opcode == DL_RDP_TEXRECT) {
+        memcpy(d->tile, rdp->tile[tile], sizeof(d->tile));
+        memcpy(d->tile_size, rdp->tile_size[tile], sizeof(d->tile_size));
+        d->tmem = tmem_digest(rdp, tile);
+    }
+}
+
+/* Counts a rectangle once if something that needs it to have finished follows it unsynced */
+static void hazard(Walk* w, const DlCommand* cmd, int* rect_unsynced) {
+    if (*rect_unsynced) {
+        w->hazards++;
+        *rect_unsynced = 0;
+        if (verbose) {
+            printf("  hazard: %s at %08X\n", dl_name(DL_GBI1, cmd->opcode), cmd->paddr);
+        }
+    }
+}
+
+/* Copies the arena out big-endian, as dlscan reads a capture, and walks the list at root */
+static int walk(uint32_t root, Walk* out) {
+    static RdpState rdp;
+    DlBlock block;
+    DlFrame frame;
+    DlWalker walker;
+    DlCommand cmd;
+    Draw* pending = NULL;
+    int rect_unsynced = 0;
+    int prim_depth_own = 0;
+    uint32_t i;
+    int r;
+
+    block.type = DL_BLOCK_GBI;
+    block.flags = 0;
+    block.paddr = HARNESS_ARENA_BASE;
+    block.size = arena_used;
+    block.data = malloc(arena_used);
+    for (i = 0; i < arena_used; i += 4) {
+        dl_put_word(block.data + i, *(uint32_t*)(arena + i));
+    }
+    memset(&frame, 0, sizeof(frame));
+    frame.blocks = &block;
+    frame.count = 1;
+    frame.root = root;
+
+    memset(&rdp, 0, sizeof(rdp));
+    memset(out, 0, sizeof(*out));
+    dl_walk_init(&walker, &frame, DL_GBI1, root);
+    while ((r = dl_walk_next(&walker, &cmd)) > 0) {
+        out->commands++;
+
+        if (pending != NULL && (cmd.kind == DL_CMD_RDPHALF_1 || cmd.kind == DL_CMD_RDPHALF_2) &&
+            pending->halves < 2) {
+            pending->rect[2 + pending->halves++] = cmd.w1;
+            continue;
+        }
+        pending = NULL;
+
+        switch (cmd.kind) {
+            case DL_CMD_DL:
+                prim_depth_own = 0;
+                break;
+            case DL_CMD_TEXTURE:
+                rdp.texture[0] = cmd.w0 & 0xFFFFFF;
+                rdp.texture[1] = cmd.w1;
+                break;
+            case DL_CMD_SETOTHERMODE_H:
+                set_othermode(&rdp.othermode_h, cmd.w0, cmd.w1);
+                hazard(out, &cmd, &rect_unsynced);
+                break;
+            case DL_CMD_SETOTHERMODE_L:
+                set_othermode(&rdp.othermode_l, cmd.w0, cmd.w1);
+                hazard(out, &cmd, &rect_unsynced);
+                break;
+            case DL_CMD_RDP:
+                switch (cmd.opcode) {
+                    case DL_RDP_PIPESYNC:
+                        rect_unsynced = 0;
+                        break;
+                    case DL_RDP_SETOTHERMODE:
+                        rdp.othermode_h = cmd.w0 & 0xFFFFFF;
+                        rdp.othermode_l = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETCOMBINE:
+                        rdp.combine[0] = cmd.w0 & 0xFFFFFF;
+                        rdp.combine[1] = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETPRIMCOLOR:
+                        rdp.prim[0] = cmd.w0 & 0xFFFF;
+                        rdp.prim[1] = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETPRIMDEPTH:
+                        rdp.prim_depth = cmd.w1;
+                        prim_depth_own = 1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETFILLCOLOR:
+                        rdp.fill = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETBLENDCOLOR:
+                        rdp.blend = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETCONVERT:
+                        rdp.convert[0] = cmd.w0 & 0xFFFFFF;
+                        rdp.convert[1] = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETTIMG:
+                        rdp.timg[0] = cmd.w0;
+                        rdp.timg[1] = cmd.w1;
+                        break;
+                    case DL_RDP_SETTILE:
+                        rdp.tile[bits(cmd.w1, 24, 3)][0] = cmd.w0 & 0xFFFFFF;
+                        rdp.tile[bits(cmd.w1, 24, 3)][1] = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_SETTILESIZE:
+                        rdp.tile_size[bits(cmd.w1, 24, 3)][0] = cmd.w0 & 0xFFFFFF;
+                        rdp.tile_size[bits(cmd.w1, 24, 3)][1] = cmd.w1;
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_LOADBLOCK:
+                    case DL_RDP_LOADTILE:
+                    case DL_RDP_LOADTLUT:
+                        load(&rdp, &cmd);
+                        hazard(out, &cmd, &rect_unsynced);
+                        break;
+                    case DL_RDP_TEXRECT:
+                    case DL_RDP_FILLRECT:
+                        if (out->count == DRAWS_MAX) {
+                            fprintf(stderr, "spcheck: more than %d rectangles\n", DRAWS_MAX);
+                            exit(1);
+                        }
+                        pending = &out->draws[out->count++];
+                        snapshot(pending, &rdp, &cmd, prim_depth_own);
+                        if (cmd.opcode == DL_RDP_FILLRECT) {
+                            pending = NULL;
+                        }
+                        rect_unsynced = 1;
+                        break;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    free(block.data);
+    if (r < 0) {
+        fprintf(stderr, "spcheck: %s\n", walker.error);
+        exit(1);
+    }
+    return out->count;
+}
+
+static const Draw* find(const Walk* w, const Draw* d) {
+    int i;
+
+    for (i = 0; i < w->count; i++) {
+        if (!memcmp(w->draws[i].rect, d->rect, sizeof(d->rect))) {
+            return &w->draws[i];
+        }
+    }
+    return NULL;
+}
+
+/* Where b's draw differs from a's, or NULL */
+static const char* differs(const Draw* a, const Draw* b) {
+    int fill = (a->rect[0] >> 24) == DL_RDP_FILLRECT;
+
+    if (a->othermode_h != b->othermode_h) {
+        return "othermode high";
+    }
+    if (a->othermode_l != b->othermode_l) {
+        return "othermode low";
+    }
+    if (memcmp(a->combine, b->combine, sizeof(a->combine))) {
+        return "combine";
+    }
+    if (memcmp(a->prim, b->prim, sizeof(a->prim))) {
+        return "primitive color";
+    }
+    if ((a->prim_depth_own || bits(a->othermode_l, MDSFT_ZSRCSEL, 1)) && a->prim_depth != b->prim_depth) {
+        return "primitive depth";
+    }
+    if (fill && a->fill != b->fill) {
+        return "fill color";
+    }
+    if (bits(a->othermode_l, MDSFT_ALPHACMP, 2) == AC_THRESHOLD && a->blend != b->blend) {
+        return "blend color";
+    }
+    if (memcmp(a->convert, b->convert, sizeof(a->convert))) {
+        return "convert";
+    }
+    if (memcmp(a->texture, b->texture, sizeof(a->texture))) {
+        return "texture";
+    }
+    if (!fill && memcmp(a->tile, b->tile, sizeof(a->tile))) {
+        return "tile";
+    }
+    if (!fill && memcmp(a->tile_size, b->tile_size, sizeof(a->tile_size))) {
+        return "tile size";
+    }
+    if (!fill && a->tmem != b->tmem) {
+        return "TMEM";
+    }
+    return NULL;
+}
+
+/* Checks each of batched's draws against plain's; returns how many differ or are missing from plain */
+static unsigned int compare(const Walk* plain, const Walk* batched, const char* name) {
+    unsigned int bad = 0;
+    const Draw* p;
+    const char* why;
+    int i;
+
+    for (i = 0; i < batched->count; i++) {
+        const Draw* d = &batched->draws[i];
+
+        p = find(plain, d);
+        why = (p == NULL) ? "not drawn unbatched" : differs(p, d);
+        if (why != NULL) {
+            if (bad++ < MISMATCHES) {
+                printf("%s: rect %08X %08X: %s\n", name, d->rect[0], d->rect[1], why);
+            }
+        }
+    }
+    return bad;
+}
+
+static void print_stats(const char* name, const Walk* w, const HarnessStats* s) {
+    printf("%s: commands %u rects %d hazards %u\n", name, w->commands, w->count, w->hazards);
+    if (s != NULL) {
+        printf("  sprites %u loads %u skipped %u tluts %u skipped %u states %u skipped %u syncs skipped %u dropped "
+               "%u\n",
+               s->sprites, s->loads, s->loads_skipped, s->tluts, s->tluts_skipped, s->states, s->states_skipped,
+               s->syncs_skipped, s->dropped);
+    }
+}
+
+int main(int argc, char** argv) {
+    static Walk plain, batched, tight;
+    HarnessStats stats, tight_stats;
+    uint32_t root;
+    unsigned int bad = 0;
+    unsigned int tight_asserts;
+    int sprites, k;
+
+    for (k = 1; k < argc; k++) {
+        if (!strcmp(argv[k], "-v")) {
+            verbose = 1;
+        } else {
+            fprintf(stderr, "usage: spcheck [-v]\n");
+            return 1;
+        }
+    }
+
+    arena = mmap((void*)(uintptr_t)HARNESS_ARENA_BASE, HARNESS_ARENA_SIZE, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (arena != (void*)(uintptr_t)HARNESS_ARENA_BASE) {
+        perror("spcheck: mmap");
+        return 1;
+    }
+
+    sprites = bridge_scene();
+    printf("sprites %d\n", sprites);
+
+    root = bridge_list(0, ROOM, &stats);
+    walk(root, &plain);
+    print_stats("unbatched", &plain, NULL);
+
+    root = bridge_list(1, ROOM, &stats);
+    walk(root, &batched);
+    print_stats("batched", &batched, &stats);
+
+    bad += compare(&plain, &batched, "batched");
+    if (batched.count != plain.count) {
+        printf("batched: %d rects, unbatched %d\n", batched.count, plain.count);
+        bad++;
+    }
+    if (batched.hazards > plain.hazards) {
+        printf("batched: more hazards than unbatched\n");
+        bad++;
+    }
+    if (stats.dropped != 0 || stats.overrun != 0 || asserts != 0) {
+        printf("batched: dropped %u overrun %u asserts %u\n", stats.dropped, stats.overrun, asserts);
+        bad++;
+    }
+
+    root = bridge_list(1, ROOM_TIGHT, &tight_stats);
+    tight_asserts = asserts;
+    printf("tight: dropped %u overrun %u asserts %u\n", tight_stats.dropped, tight_stats.overrun, tight_asserts);
+    if (tight_stats.dropped == 0 || tight_asserts == 0 || tight_stats.overrun != 0) {
+        /* what follows glistend may be what the walk would have to read */
+        printf("tight: the flush should have dropped sprites, asserted and stayed before glistend\nMISMATCH\n");
+        return 1;
+    }
+    walk(root, &tight);
+    print_stats("tight", &tight, &tight_stats);
+    bad += compare(&plain, &tight, "tight");
+
+    printf("%s\n", bad ? "MISMATCH" : "ok");
+    return bad != 0;
+}
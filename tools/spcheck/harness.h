@@ -0,0 +1,50 @@
+#ifndef HARNESS_H
+#define HARNESS_H
+
+/*
+ * Interface between harness.c, which only sees the host C library and
+ * tools/dlscan, and bridge.c, which only sees libultra's headers and links
+ * against sprite.c built with and without SP_BATCH. As in tools/ovlharness
+ * the two header sets can't share a translation unit (bcopy clashes), so
+ * only plain C types cross this boundary.
+ */
+
+/*
+ * Where bridge.c puts the sprites' textures, TLUTs and lists. gbi.h keeps
+ * addresses as 32-bit words and dlscan takes the low 24 bits as an offset
+ * into segment 0, so it sits below 16MB and an address in a list is the
+ * host pointer itself.
+ */
+#define HARNESS_ARENA_BASE 0x00100000u
+#define HARNESS_ARENA_SIZE 0x00400000u
+
+/* SpBatchStats, and what bridge.c saw of the caller's list */
+typedef struct {
+    unsigned int sprites;
+    unsigned int rects;
+    unsigned int loads;
+    unsigned int loads_skipped;
+    unsigned int tluts;
+    unsigned int tluts_skipped;
+    unsigned int states;
+    unsigned int states_skipped;
+    unsigned int syncs_skipped;
+    unsigned int dropped;
+    unsigned int overrun;       /* words spBatchFlush wrote past glistend */
+} HarnessStats;
+
+/* bridge.c -> harness.c */
+void* harness_alloc(int size);
+
+/* harness.c -> bridge.c */
+int bridge_scene(void);         /* builds the sprites; returns how many */
+
+/*
+ * Builds a root list drawing the scene: spInit, then a G_DL to each
+ * sprite's spDraw list from sprite.c as the game builds it, then spFinish;
+ * or, if batched, spBatchDraw for each and one spBatchFlush between them,
+ * into a list with room for that many commands. Returns its address.
+ */
+unsigned int bridge_list(int batched, int room, HarnessStats* stats);
+
+#endif